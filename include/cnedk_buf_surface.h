@@ -214,6 +214,32 @@ typedef struct CnedkBufSurface {
   void * _reserved[CNEDK_PADDING_LENGTH];
 } CnedkBufSurface;
 
+/** Defines the number of bins of the acquire-wait histogram in \ref CnedkBufPoolStats. */
+#define CNEDK_BUF_POOL_WAIT_HIST_BINS  8
+
+/**
+ * Holds the statistics of a buffer pool.
+ */
+typedef struct CnedkBufPoolStats {
+  /** Holds the number of blocks allocated by the pool. */
+  uint32_t block_num;
+  /** Holds the number of blocks in use. */
+  uint32_t in_use;
+  /** Holds the maximum number of blocks in use at the same time. */
+  uint32_t peak_in_use;
+  /** Holds the number of blocks acquired from the pool. */
+  uint64_t acquire_count;
+  /** Holds the number of acquirements failed since the pool is empty. */
+  uint64_t empty_count;
+  /** Holds the number of acquirements which waited for a free block and timed out. */
+  uint64_t timeout_count;
+  /** Holds the histogram of time waited for a free block by blocking acquirements (e.g. cnedk::BufPool).
+   Bin 0 counts acquirements without waiting, bin i (0 < i < 7) counts waits shorter than 4^(i-1) ms,
+   and the last bin counts the rest. */
+  uint64_t wait_hist[CNEDK_BUF_POOL_WAIT_HIST_BINS];
+  void *_reserved[CNEDK_PADDING_LENGTH];
+} CnedkBufPoolStats;
+
 /**
  * @brief  Creates a Buffer Pool.
  *
@@ -237,6 +263,18 @@ int CnedkBufPoolCreate(void **pool, CnedkBufSurfaceCreateParams *params, uint32_
  */
 int CnedkBufPoolDestroy(void *pool);
 
+/**
+ * @brief  Gets the statistics of a buffer pool.
+ *
+ * Counters are updated with atomic operations, reading them does not block the pool.
+ *
+ * @param[in]  pool   A pointer to a buffer pool.
+ * @param[out] stats  A pointer to an \ref CnedkBufPoolStats structure to be filled.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkBufPoolGetStats(void *pool, CnedkBufPoolStats *stats);
+
 /**
  * @brief  Allocates a single buffer.
  *
@@ -33,6 +33,8 @@
 
 namespace cnedk {
 
+class HostMirror;
+
 /**
  * @class IBufDeleter
  *
@@ -69,14 +71,7 @@ class BufSurfaceWrapper {
    *
    * @return No return value.
    */
-  ~BufSurfaceWrapper() {
-    std::unique_lock<std::mutex> lk(mutex_);
-    if (deleter_) {
-      delete deleter_, deleter_ = nullptr;
-      return;
-    }
-    if (owner_ && surf_) CnedkBufSurfaceDestroy(surf_), surf_ = nullptr;
-  }
+  ~BufSurfaceWrapper();
   /**
    * @brief Gets the pointer of the CnedkBufSurface object.
    *
@@ -209,10 +204,26 @@ class BufSurfaceWrapper {
    * @return Returns the pointer of the host data.
    *
    * @note For memory with type CNEDK_BUF_MEM_DEVICE, set cpu memory as faked mappedData for convenience.
+   *       The data is copied from device at the first call only, items adjacent in device memory are copied
+   *       together. Call InvalidateHostData after the device memory is modified to get the new data.
    */
   void *GetHostData(uint32_t plane_idx, uint32_t batch_idx = 0);
+  /**
+   * @brief Marks the host data as stale, the data will be copied from device again by the next GetHostData.
+   *        Should be called after the device memory has been modified by others, e.g. transform or inference.
+   *
+   * @param[in] batch_idx The batch index, indicates where the buffer is located in the batch.
+   *                      Defaults -1, means the whole batched buffers.
+   *
+   * @return No return value.
+   *
+   * @note For cached memory, the cpu cache is invalidated.
+   */
+  void InvalidateHostData(uint32_t batch_idx = -1);
   /**
    * @brief Synchronizes the host data to device.
+   *        For memory with type CNEDK_BUF_MEM_DEVICE, the whole buffers are copied, items adjacent in device memory
+   *        are copied together.
    *
    * @param[in] plane_idx The plane index, indicates which plane data will be synchronized.
    *                      Defaults -1, means all planes.
@@ -253,12 +264,13 @@ class BufSurfaceWrapper {
 
  private:
   CnedkBufSurfaceParams *GetSurfaceParamsPriv(uint32_t batch_idx = 0) const { return &surf_->surface_list[batch_idx]; }
+  void ReleaseMirror();
 
  private:
   mutable std::mutex mutex_;
   CnedkBufSurface *surf_ = nullptr;
   bool owner_ = true;
-  std::unique_ptr<unsigned char[]> host_data_[128]{{nullptr}};
+  HostMirror *mirror_ = nullptr;  // host data of device memory
 
   IBufDeleter *deleter_ = nullptr;
   CnedkBufSurface surface_;
@@ -310,6 +322,14 @@ class BufPool {
    * @return Returns BufSurfacewrapper if this function has run successfully. Otherwise returns nullptr.
    */
   BufSurfWrapperPtr GetBufSurfaceWrapper(int timeout_ms = 0);
+  /**
+   * @brief Gets statistics of the pool, including the time waited in GetBufSurfaceWrapper.
+   *
+   * @param[out] stats The statistics.
+   *
+   * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+   */
+  int GetStats(CnedkBufPoolStats *stats);
 
  private:
   BufPool(const BufPool &) = delete;
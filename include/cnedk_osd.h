@@ -70,6 +70,8 @@ typedef struct CnedkOsdBitmapParams {
 /**
  * @brief Draws rectangle.
  *
+ * Rectangles on surfaces in system or pinned memory (NV12, NV21, RGB or BGR) are drawn on CPU.
+ *
  * @param[in,out] surf A pointer points to CnedkBufSurface. Draws rectangle on it.
  * @param[in] params The parameters for drawing rectangles.
  * @param[in] num The number of rectangles.
@@ -80,6 +82,8 @@ int CnedkDrawRect(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t nu
 /**
  * @brief Fills rectangle.
  *
+ * Runs on CPU for surfaces in system or pinned memory.
+ *
  * @param[in,out] surf A pointer points to CnedkBufSurface. Fills rectangle on it.
  * @param[in] params The parameters for filling rectangles.
  * @param[in] num The number of rectangles.
@@ -90,6 +94,9 @@ int CnedkFillRect(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t nu
 /**
  * @brief Draws bitmap.
  *
+ * Runs on CPU for surfaces in system or pinned memory. Pixels with the alpha bit set are blended by half,
+ * the others are transparent.
+ *
  * @param[in,out] surf A pointer points to CnedkBufSurface. Draws bitmap on it.
  * @param[in] params The parameters for drawing bitmaps.
  * @param[in] num The number of bitmaps.
@@ -56,7 +56,10 @@ typedef enum {
   /** Specifies a transform to set the filter type. */
   CNEDK_TRANSFORM_FILTER     = 1 << 2,
   /** Specifies a transform to normalize output. */
-  CNEDK_TRANSFORM_MEAN_STD  = 1 << 3
+  CNEDK_TRANSFORM_MEAN_STD  = 1 << 3,
+  /** Specifies a transform to resize keeping aspect ratio into the center of the destination rectangle,
+   and to fill the rest of the destination rectangle with the padding value. */
+  CNEDK_TRANSFORM_LETTERBOX  = 1 << 4
 } CnedkTransformFlag;
 
 /**
@@ -87,6 +90,8 @@ typedef enum {
   CNEDK_TRANSFORM_INT16,
   /** Specifies the data type to int32. */
   CNEDK_TRANSFORM_INT32,
+  /** Specifies the data type to int8. */
+  CNEDK_TRANSFORM_INT8,
   /** Specifies the number of data types. */
   CNEDK_TRANSFORM_NUM
 } CnedkTransformDataType;
@@ -147,6 +152,15 @@ typedef struct CnedkTransformMeanStdParams {
   float std[CNEDK_TRANSFORM_MAX_CHNS];
 } CnedkTransformMeanStdParams;
 
+/**
+ * Holds the parameters of a letterbox transformation.
+ */
+typedef struct CnedkTransformLetterboxParams {
+  /** Holds the padding value of each channel in output channel order. It is a pixel value, normalized as other
+   pixels if CNEDK_TRANSFORM_MEAN_STD is set. */
+  uint8_t pad_value[CNEDK_TRANSFORM_MAX_CHNS];
+} CnedkTransformLetterboxParams;
+
 /**
  * Holds configuration parameters for a transform/composite session.
  */
@@ -163,6 +177,18 @@ typedef struct CnedkTransformConfigParams {
   cnrtQueue_t cnrt_queue;
 } CnedkTransformConfigParams;
 
+/**
+ * Holds parameters of transformations running on CPU, shared by all sessions.
+ */
+typedef struct CnedkTransformHostParams {
+  /** Holds the number of threads, the calling thread included. 0 means the number of CPU cores (at most 8),
+   1 runs in the calling thread only. */
+  uint32_t num_threads;
+  /** Holds the number of output pixels of each tile run by a thread, 0 means the default (65536).
+   Transformations smaller than two tiles run in the calling thread. */
+  uint32_t grain_size;
+} CnedkTransformHostParams;
+
 /**
  * Holds transform parameters for a transform call.
  */
@@ -183,6 +209,9 @@ typedef struct CnedkTransformParams {
   /** Holds a pointer to list of destination rectangle coordinates for
    a crop operation. */
   CnedkTransformRect *dst_rect;
+
+  /** Holds a pointer of letterbox parameters. If it is NULL, padding value is 0. */
+  CnedkTransformLetterboxParams *letterbox_params;
 } CnedkTransformParams;
 
 
@@ -209,9 +238,41 @@ int CnedkTransformSetSessionParams(CnedkTransformConfigParams *config_params);
  */
 int CnedkTransformGetSessionParams(CnedkTransformConfigParams *config_params);
 
+/**
+ * @brief Sets parameters of transformations running on CPU.
+ *
+ * Large outputs are split into tiles of rows which are run by a bounded pool of threads, results do not depend
+ * on the number of threads.
+ *
+ * @param[in] host_params       A pointer to a structure that is populated
+ *                              with the parameters to be used.
+ *
+ * @return Returns 0 if this function run successfully, otherwise returns non-zero values.
+ */
+int CnedkTransformSetHostParams(CnedkTransformHostParams *host_params);
+
+/**
+ * @brief Gets parameters of transformations running on CPU.
+ *
+ * @param[out] host_params      A pointer to a caller-allocated structure to be
+ *                              populated with the parameters used, num_threads is the actual number.
+ *
+ * @return Returns 0 if this function run successfully, otherwise returns non-zero values.
+ */
+int CnedkTransformGetHostParams(CnedkTransformHostParams *host_params);
+
 /**
  * @brief Performs a transformation on batched input images.
  *
+ * If both src and dst are in host memory (CNEDK_BUF_MEM_SYSTEM or CNEDK_BUF_MEM_PINNED), the transformation runs
+ * on CPU. It supports NV12, NV21, RGB and BGR inputs and RGB or BGR outputs (uint8, float32 or float16 NHWC tensor
+ * if dst is a tensor), resizing with bilinear interpolation.
+ *
+ * If CNEDK_TRANSFORM_LETTERBOX is set, the source rectangle is resized into the largest rectangle with the same
+ * aspect ratio at the center of the destination rectangle, and the padding bands around it are filled by the same
+ * call, so the caller does not need to memset the destination. Only RGB-like outputs support it. On device, it is
+ * supported only by YUV420SP to RGB-like transform without CNEDK_TRANSFORM_MEAN_STD.
+ *
  * @param[in]  src  A pointer to input batched buffers to be transformed.
  * @param[out] dst  A pointer to a caller-allocated location where
  *                  transformed output is to be stored.
@@ -0,0 +1,155 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_DETECTION_H_
+#define INFER_SERVER_DETECTION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "infer_server.h"
+
+namespace infer_server {
+
+/**
+ * @brief A detected object, box is given by corners
+ */
+struct Detection {
+  float x0 = 0.f;  ///< left
+  float y0 = 0.f;  ///< top
+  float x1 = 0.f;  ///< right
+  float y1 = 0.f;  ///< bottom
+  float score = 0.f;
+  int label = 0;
+};
+
+/**
+ * @brief Describes candidates in the output tensor of a detection model
+ *
+ * Each candidate is a row of `stride` values, box corners (x0, y0, x1, y1) are consecutive.
+ * Default values match the YOLOv3 output of (batch_id, label, score, x0, y0, x1, y1).
+ */
+struct DetectionLayout {
+  size_t stride = 7;      ///< number of values of each candidate
+  int score_offset = 2;   ///< offset of score in row
+  int label_offset = 1;   ///< offset of label in row, negative if model has only one class
+  int box_offset = 3;     ///< offset of x0 in row
+};
+
+/**
+ * @brief Maps boxes from model input to image, x' = x * scale_x + offset_x, and clips into [0, max_x]
+ */
+struct BoxTransform {
+  float scale_x = 1.f;
+  float scale_y = 1.f;
+  float offset_x = 0.f;
+  float offset_y = 0.f;
+  float max_x = 0.f;  ///< clip bound of x, no clipping if it is not positive
+  float max_y = 0.f;  ///< clip bound of y, no clipping if it is not positive
+
+  /**
+   * @brief Undoes a letterbox resize, which keeps aspect ratio of the image and pads the rest of model input
+   *
+   * @param model_w width of model input
+   * @param model_h height of model input
+   * @param image_w width of image
+   * @param image_h height of image
+   * @param normalized boxes are normalized to [0, 1] on both sides if true, otherwise in pixels
+   * @param centered image is placed at center of model input if true, otherwise at top left
+   * @return BoxTransform clipping boxes into image
+   */
+  static BoxTransform Letterbox(uint32_t model_w, uint32_t model_h, uint32_t image_w, uint32_t image_h,
+                                bool normalized = true, bool centered = true) noexcept;
+};
+
+/**
+ * @brief Parameters of DecodeDetections
+ */
+struct DetectionParams {
+  float threshold = 0.f;       ///< candidates with score less than threshold are dropped
+  float nms_iou = 0.45f;       ///< IoU threshold of NMS, NMS is skipped if it is not less than 1
+  bool class_aware = true;     ///< suppress only boxes of the same label if true
+  size_t pre_nms_top_k = 0;    ///< keep k best candidates before NMS, 0 for all
+  size_t max_detections = 0;   ///< keep at most max_detections results, 0 for all
+};
+
+/**
+ * @brief Selects candidates whose score is not less than threshold
+ *
+ * @param data candidates in float32 on host
+ * @param num number of candidates
+ * @param layout layout of candidates
+ * @param threshold score threshold
+ * @param[out] indices indices of selected candidates in ascending order, appended
+ * @return size_t number of selected candidates
+ */
+size_t FilterByScore(const float *data, size_t num, const DetectionLayout &layout, float threshold,
+                     std::vector<uint32_t> *indices) noexcept;
+
+/**
+ * @brief Maps boxes in place
+ */
+void TransformBoxes(Detection *dets, size_t num, const BoxTransform &transform) noexcept;
+
+/**
+ * @brief Keeps k detections of the highest score, sorted by descending score
+ *
+ * Ties are broken by the original order, so results are deterministic.
+ */
+void SelectTopK(std::vector<Detection> *dets, size_t k) noexcept;
+
+/**
+ * @brief Greedy non-maximum suppression
+ *
+ * Detections are sorted by descending score, a box is dropped if its IoU with a kept box of higher score
+ * is greater than iou_threshold.
+ *
+ * @param dets detections, kept ones sorted by descending score on return
+ * @param iou_threshold IoU threshold
+ * @param class_aware suppress only boxes of the same label if true
+ * @param max_output stop after max_output boxes are kept, 0 for no limit
+ */
+void NonMaxSuppression(std::vector<Detection> *dets, float iou_threshold, bool class_aware = true,
+                       size_t max_output = 0) noexcept;
+
+/**
+ * @brief Decodes output of a detection model
+ *
+ * Thresholds scores, maps and clips boxes, drops empty boxes, selects top k and applies NMS,
+ * working directly on one batch item of a host tensor.
+ *
+ * @param data candidates of one batch item on host
+ * @param dtype data type of candidates, FLOAT32 or FLOAT16
+ * @param num number of candidates
+ * @param layout layout of candidates
+ * @param params decode parameters
+ * @param transform maps boxes to image, nullptr to keep model coordinates
+ * @param[out] out detections sorted by descending score
+ * @retval Status::SUCCESS Succeeded
+ * @retval Status::INVALID_PARAM Layout or data type is not supported
+ */
+Status DecodeDetections(const void *data, DataType dtype, size_t num, const DetectionLayout &layout,
+                        const DetectionParams &params, const BoxTransform *transform,
+                        std::vector<Detection> *out) noexcept;
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_DETECTION_H_
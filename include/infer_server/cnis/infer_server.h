@@ -22,6 +22,7 @@
 #define INFER_SERVER_API_H_
 
 #include <functional>
+#include <future>
 #include <limits>
 #include <map>
 #include <memory>
@@ -46,6 +47,7 @@ enum class DataType {
   FLOAT16 = 2,
   INT16 = 3,
   INT32 = 4,
+  INT8 = 5,
   INVALID = 0xFFFF,
 };
 
@@ -72,6 +74,16 @@ struct DataLayout {
   DimOrder order;  ///< @see DimOrder
 };
 
+/**
+ * @brief Describe quantization of integer data, real value is (quantized - zero_point) * scale
+ *
+ * Parameters are per-tensor if there is one scale, otherwise there is one for each channel.
+ */
+struct QuantParams {
+  std::vector<float> scale;     ///< scale of the whole tensor or of each channel, empty if not quantized
+  std::vector<int> zero_point;  ///< zero point of each scale, all zero if empty
+};
+
 /**
  * @brief Get size in bytes of type
  *
@@ -224,6 +236,14 @@ class ModelInfo {
    */
   virtual std::string GetKey() const noexcept = 0;
 
+  /**
+   * @brief Get quantization of input
+   *
+   * @param index index of input
+   * @return QuantParams quantization of specified input, scale is empty if it is not an integer quantized input
+   */
+  virtual QuantParams InputQuantParams(int index) const noexcept { return QuantParams(); }
+
   // ----------- Observers End -----------
 };  // class ModelInfo
 
@@ -398,6 +418,17 @@ class Processor : public BaseObject {
    */
   virtual Status Process(PackagePtr data) noexcept = 0;
 
+  /**
+   * @brief Process data in package asynchronously
+   *
+   * @note Processor may return before process finished, and invoke done once from another thread later.
+   *       Data is transmitted to the next processor after done is invoked. Default implementation invokes
+   *       `Process` and done in place.
+   * @param data Processed data
+   * @param done Function to be invoked with status once process finished
+   */
+  virtual void ProcessAsync(PackagePtr data, std::function<void(Status)> done) noexcept { done(Process(data)); }
+
   /**
    * @brief Fork an initialized processor which have the same params as this
    *
@@ -490,6 +521,20 @@ enum class NetworkInputFormat {
   INVALID = 0xFFFF,
 };
 
+/**
+ * @brief An input shape planned ahead for model with mutable input shape, @see SessionDesc::shape_buckets
+ */
+struct ShapeBucket {
+  ShapeBucket() = default;
+  ShapeBucket(uint32_t batch_size, uint32_t height, uint32_t width) : batch(batch_size), h(height), w(width) {}
+  /// batch size
+  uint32_t batch{0};
+  /// height
+  uint32_t h{0};
+  /// width
+  uint32_t w{0};
+};
+
 /**
  * @brief A struct to describe execution graph
  */
@@ -511,8 +556,11 @@ struct SessionDesc {
    * @brief host output data layout
    *
    * @note built-in processor will transform from MLU output layout ( @see ModelInfo::OutputLayout(int index) )
-   *       into host output layout automatically after infer
+   *       into host output layout automatically after infer. Dim order is transposed between NCHW and NHWC only,
+   *       and is kept as is for other orders. Output is kept in MLU output layout if dtype is DataType::INVALID.
+   *       Works with built-in Postprocessor without IPostproc handler, @see Postprocessor::Init
    */
+  DataLayout host_output_layout{DataType::INVALID, DimOrder::INVALID};
   /// preprocessor
   std::shared_ptr<Processor> preproc{nullptr};
   /// postprocessor
@@ -527,8 +575,46 @@ struct SessionDesc {
    * @note multi engine can boost process, but will take more MLU resources
    */
   uint32_t engine_num{1};
+  /**
+   * @brief upper bound of engine number, engine number is fixed to engine_num if it is not greater than engine_num
+   *
+   * @note engines are added when batches keep waiting while all engines are busy for about one second, and removed
+   *       when no batch waits and the other engines could take the load for about three seconds, within
+   *       [engine_num, max_engine_num]. Removed engines finish their tasks before their resources are released.
+   *       @see InferServer::GetEngineNum
+   */
+  uint32_t max_engine_num{0};
+  /**
+   * @brief number of batches in flight on device of each engine
+   *
+   * @note more than 1 lets predictor return before inference done, so that the next batch could be staged during
+   *       inference of the previous one. Each batch in flight has its own context, queue and I/O on device.
+   */
+  uint32_t inflight_num{1};
   /// whether print performance
   bool show_perf{true};
+  /**
+   * @brief sample input data to warm up engines, no warm-up if it is nullptr
+   *
+   * @note before session is created, each engine processes batches of every size from 1 to model batch size,
+   *       made of copies of the sample, so that lazy initialization won't delay the first requests.
+   *       Outputs of warm-up are dropped, and time cost is recorded as "WarmUp" in session performance.
+   *       Engines added by autoscaling are warmed up the same way before they take requests.
+   */
+  InferDataPtr warmup_data{nullptr};
+  /**
+   * @brief input shapes planned ahead for model with mutable input shape, no bucketing if it is empty
+   *
+   * @note Applies to model with only one input in NHWC or NCHW order, channel is taken from model input shape.
+   *       Each bucket has its own runner, output pools and output shapes planned once in each engine.
+   *       Each batch (with its shape in ModelIO::shapes) is zero padded on the end of batch, height and width
+   *       to the smallest bucket holding it, and outputs are of the bucket shape.
+   *       Batches no bucket could hold are inferred with their own shape. @see InferServer::GetPadding
+   *       The built-in Preprocessor outputs batches of model input height and width, so only batch size is
+   *       bucketed with it. Buckets of height and width apply to continuous data or custom preprocessor
+   *       reporting the shape of each batch in ModelIO::shapes.
+   */
+  std::vector<ShapeBucket> shape_buckets;
 };
 
 /**
@@ -563,6 +649,22 @@ struct ThroughoutStatistic {
   float ups_rt{0};
 };
 
+/**
+ * @brief Padding statistics of shape-bucketed inference, @see SessionDesc::shape_buckets
+ */
+struct PaddingStatistic {
+  /// batches padded to a bucket, including those already of a bucket shape
+  uint64_t batch_cnt{0};
+  /// batches no bucket could hold
+  uint64_t miss_cnt{0};
+  /// input elements of bucketed batches before padding
+  uint64_t real_elements{0};
+  /// input elements of bucketed batches after padding
+  uint64_t padded_elements{0};
+  /// ratio of padded elements to real elements minus one, 0 means no padding
+  float overhead{0};
+};
+
 /// A structure describes linked session of server
 class Session;
 /// pointer to Session
@@ -675,8 +777,14 @@ class InferServer {
   /**
    * @brief Load model from uri, model won't be loaded again if it is already in cache
    *
+   * @note models are cached by content, the same model reached through symlinks or copies is loaded once
    * @note support download model from remote by HTTP, HTTPS, FTP, while compiled with flag `WITH_CURL`,
    *       use uri such as `../../model_file`, or "https://someweb/model_file"
+   * @note downloaded model is published to model directory after it is complete, interrupted download is resumed.
+   *       It is verified by SHA-256 given in uri like "https://someweb/model_file#sha256=<hex>", or in sidecar file
+   *       "https://someweb/model_file.sha256"
+   * @note set environment CNIS_MODEL_META_DIR to persist model info in the directory, a model loaded again with
+   *       persisted info is returned without building engine, and engine is built in background
    * @param model_uri offline model uri
    * @param in_shapes set input shape when it is mutable
    * @return ModelPtr A model
@@ -686,6 +794,7 @@ class InferServer {
   /**
    * @brief Load model from memory, model won't be loaded again if it is already in cache
    *
+   * @note models are cached by content, the same model data at different addresses is loaded once
    * @param ptr serialized model data in memory
    * @param size size of model data in memory
    * @param in_shapes set input shape when it is mutable
@@ -693,6 +802,20 @@ class InferServer {
    */
   static ModelPtr LoadModel(void* ptr, size_t size, const std::vector<Shape>& in_shapes = {}) noexcept;
 
+  /**
+   * @brief Load model in background, then build engine and create runners on each device ahead of session creation
+   *
+   * @note sessions created after the returned future is ready pick up the prepared runners instead of creating them,
+   *       each engine of a session takes one runner, so set runner_num to engine_num of the sessions
+   * @param model_uri offline model uri, same as `LoadModel`
+   * @param in_shapes set input shape when it is mutable
+   * @param device_ids devices to prepare model on
+   * @param runner_num number of runners to prepare on each device
+   * @return std::future<ModelPtr> A future of the model, which is nullptr if load or prepare failed
+   */
+  static std::future<ModelPtr> PreloadModel(const std::string& model_uri, const std::vector<Shape>& in_shapes = {},
+                                            const std::vector<int>& device_ids = {0}, int runner_num = 1) noexcept;
+
   /**
    * @brief Remove model from cache, model won't be destroyed if still in use
    *
@@ -733,6 +856,22 @@ class InferServer {
    */
   ThroughoutStatistic GetThroughout(Session_t session, const std::string& tag) const noexcept;
 
+  /**
+   * @brief Get the padding statistics of shape-bucketed inference
+   *
+   * @param session a session
+   * @return PaddingStatistic padding statistic, all zero if session has no shape buckets
+   */
+  PaddingStatistic GetPadding(Session_t session) const noexcept;
+
+  /**
+   * @brief Get the number of engines working for session now
+   *
+   * @param session a session
+   * @return uint32_t engine number, @see SessionDesc::max_engine_num
+   */
+  uint32_t GetEngineNum(Session_t session) const noexcept;
+
  private:
   InferServer() = delete;
   InferServerPrivate* priv_;
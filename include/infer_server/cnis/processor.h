@@ -21,6 +21,7 @@
 #ifndef INFER_SERVER_PROCESSOR_H_
 #define INFER_SERVER_PROCESSOR_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -41,6 +42,12 @@ struct ModelIO {
   std::vector<cnedk::BufSurfWrapperPtr> surfs;
   /// shape of input / output
   std::vector<Shape> shapes;
+  /**
+   * shape of valid region of each output, set only if the batch is padded to a larger shape bucket
+   * (see SessionDesc::shape_buckets), while `shapes` are output shapes of the bucket. Valid region starts at the
+   * corner of output. Outputs are cropped to it by default postprocess, custom postprocess should crop by itself.
+   */
+  std::vector<Shape> valid_shapes;
 };
 
 struct PredictorPrivate;
@@ -70,6 +77,16 @@ class Predictor : public ProcessorForkable<Predictor> {
    */
   Status Process(PackagePtr data) noexcept override;
 
+  /**
+   * @brief Submit predict and return before it is done, if more than one batch is allowed in flight
+   *
+   * @note Set param `inflight_num` greater than 1 to pipeline batches, each batch in flight has its own runner.
+   *       Otherwise it is the same as Process.
+   * @param data processed data
+   * @param done callback invoked with the same status as Process once predict is done
+   */
+  void ProcessAsync(PackagePtr data, std::function<void(Status)> done) noexcept override;
+
   /**
    * @brief Initialize predictor
    *
@@ -88,6 +105,8 @@ class Predictor : public ProcessorForkable<Predictor> {
   static std::string Backend() noexcept;
 
  private:
+  Status PrepareOutput(ModelIO* out) noexcept;
+  Status RunBucket(int idx, ModelIO* in, ModelIO* out) noexcept;
   PredictorPrivate* priv_;
 };  // class Predictor
 // -------------------- Predictor END --------------------
@@ -99,6 +118,7 @@ struct CnPreprocTensorParams {
   NetworkInputFormat input_format;  // model_input_format
   DataType input_dtype;
   uint32_t batch_num;
+  QuantParams input_quant;  // quantization of integer input, see ModelInfo::InputQuantParams
 };
 
 class IPreproc {
@@ -113,6 +133,54 @@ void SetPreprocHandler(const std::string &key, IPreproc *handler);
 IPreproc *GetPreprocHandler(const std::string &key);
 void RemovePreprocHandler(const std::string &key);
 
+/**
+ * @brief Built-in IPreproc running on CPU
+ *
+ * Resizes NV12, NV21, RGB or BGR inputs to the model input with bilinear interpolation, converts color, normalizes
+ * and writes the model input layout (NHWC or NCHW, uint8, float32, float16, int8 or int16) in one pass per pixel.
+ * Inputs are read directly if they are in system memory. The model input must have 3 channels.
+ *
+ * Int8 and int16 inputs are quantized from normalized values, rounded to nearest even and saturated, so that no cast
+ * runs on device. Quantization is taken from ModelInfo::InputQuantParams, or from the constructor if the model does
+ * not report it.
+ */
+class HostPreproc : public IPreproc {
+ public:
+  /**
+   * @brief Construct a new HostPreproc object
+   *
+   * @param mean_std mean and std of each channel in model input channel order, nullptr for no normalization
+   * @param tensor_format channel order of model input if the model input format is TENSOR, RGB or BGR
+   * @param letterbox padding of letterbox in model input channel order, nullptr to resize to the whole input
+   * @param quant quantization of int8 / int16 model input in model input channel order, used if the model does not
+   *              report it
+   */
+  explicit HostPreproc(const CnedkTransformMeanStdParams *mean_std = nullptr,
+                       NetworkInputFormat tensor_format = NetworkInputFormat::RGB,
+                       const CnedkTransformLetterboxParams *letterbox = nullptr,
+                       const QuantParams *quant = nullptr) noexcept;
+
+  int OnTensorParams(const CnPreprocTensorParams *params) override;
+  int OnPreproc(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr dst,
+                const std::vector<CnedkTransformRect> &src_rects) override;
+
+ private:
+  bool normalize_ = false;
+  CnedkTransformMeanStdParams mean_std_;
+  NetworkInputFormat tensor_format_;
+  bool letterbox_ = false;
+  CnedkTransformLetterboxParams letterbox_params_;
+  QuantParams quant_;
+  // quantization in use, one value per channel
+  float quant_scale_[3] = {1.f, 1.f, 1.f};
+  int quant_zero_point_[3] = {0, 0, 0};
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  bool planar_ = false;
+  CnedkTransformDataType data_type_ = CNEDK_TRANSFORM_UINT8;
+  CnedkBufSurfaceColorFormat color_format_ = CNEDK_BUF_COLOR_FORMAT_RGB;
+};
+
 //
 struct CNInferBoundingBox {
   float x = 0.0;
@@ -186,6 +254,9 @@ class Postprocessor : public ProcessorForkable<Postprocessor> {
   /**
    * @brief Initialize PostprocessorHost
    *
+   * @note Without IPostproc handler, outputs are handed to user in the layout of model output. Set param
+   *       "output_layout" (DataLayout) to get host outputs in another data type or dim order (NCHW <-> NHWC).
+   *
    * @retval Status::SUCCESS Init succeeded
    * @retval Status::INVALID_PARAM Postprocessor do not have enough params or get wrong params,
    *         @see BaseObject::SetParam
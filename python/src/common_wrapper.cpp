@@ -137,6 +137,8 @@ py::dtype GetPyDtype(DataType dtype) {
     case DataType::FLOAT16:
     case DataType::FLOAT32:
       return py::dtype::of<float>();
+    case DataType::INT8:
+      return py::dtype::of<int8_t>();
     case DataType::INT16:
       return py::dtype::of<int16_t>();
     case DataType::INT32:
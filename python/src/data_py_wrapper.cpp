@@ -114,7 +114,8 @@ void PackageWrapper(const py::module& m) {
   py::class_<ModelIO, std::shared_ptr<ModelIO>>(m, "ModelIO")
       .def(py::init<>())
       .def_readwrite("surfs", &ModelIO::surfs)
-      .def_readwrite("shapes", &ModelIO::shapes);
+      .def_readwrite("shapes", &ModelIO::shapes)
+      .def_readwrite("valid_shapes", &ModelIO::valid_shapes);
 
 
   // InferData
@@ -116,7 +116,15 @@ void InferServerWrapper(const py::module& m) {
               return infer_server->GetThroughout(reinterpret_cast<Session_t>(session.get_pointer()));
             }
             return infer_server->GetThroughout(reinterpret_cast<Session_t>(session.get_pointer()), tag);
-          }, py::arg("session"), py::arg("tag") = "");
+          }, py::arg("session"), py::arg("tag") = "")
+      .def("get_padding",
+          [](std::shared_ptr<InferServer> infer_server, py::capsule session) {
+            return infer_server->GetPadding(reinterpret_cast<Session_t>(session.get_pointer()));
+          })
+      .def("get_engine_num",
+          [](std::shared_ptr<InferServer> infer_server, py::capsule session) {
+            return infer_server->GetEngineNum(reinterpret_cast<Session_t>(session.get_pointer()));
+          });
 }
 
 void StatusWrapper(const py::module& m) {
@@ -152,6 +160,7 @@ void DataLayoutWrapper(py::module* m) {  // NOLINT
       .value("FLOAT16", DataType::FLOAT16)
       .value("INT16", DataType::INT16)
       .value("INT32", DataType::INT32)
+      .value("INT8", DataType::INT8)
       .value("INVALID", DataType::INVALID);
 
   py::enum_<DimOrder>(*m, "DimOrder")
@@ -205,6 +214,14 @@ void PerfWrapper(py::module* m) {
       .def_readwrite("ups", &ThroughoutStatistic::ups)
       .def_readwrite("rps_rt", &ThroughoutStatistic::rps_rt)
       .def_readwrite("ups_rt", &ThroughoutStatistic::ups_rt);
+
+  py::class_<PaddingStatistic>(*m, "PaddingStatistic")
+      .def(py::init())
+      .def_readwrite("batch_cnt", &PaddingStatistic::batch_cnt)
+      .def_readwrite("miss_cnt", &PaddingStatistic::miss_cnt)
+      .def_readwrite("real_elements", &PaddingStatistic::real_elements)
+      .def_readwrite("padded_elements", &PaddingStatistic::padded_elements)
+      .def_readwrite("overhead", &PaddingStatistic::overhead);
 }
 
 }  //  namespace infer_server
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
 
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
@@ -30,6 +31,13 @@ namespace py = pybind11;
 namespace infer_server {
 
 void SessionDescWrapper(const py::module& m) {
+  py::class_<ShapeBucket>(m, "ShapeBucket")
+      .def(py::init<>())
+      .def(py::init<uint32_t, uint32_t, uint32_t>(), py::arg("batch"), py::arg("h"), py::arg("w"))
+      .def_readwrite("batch", &ShapeBucket::batch)
+      .def_readwrite("h", &ShapeBucket::h)
+      .def_readwrite("w", &ShapeBucket::w);
+
   py::class_<SessionDesc, std::shared_ptr<SessionDesc>>(m, "SessionDesc")
       .def(py::init<>())
       .def_readwrite("name", &SessionDesc::name)
@@ -41,7 +49,11 @@ void SessionDescWrapper(const py::module& m) {
       .def_readwrite("batch_timeout", &SessionDesc::batch_timeout)
       .def_readwrite("priority", &SessionDesc::priority)
       .def_readwrite("engine_num", &SessionDesc::engine_num)
-      .def_readwrite("show_perf", &SessionDesc::show_perf);
+      .def_readwrite("max_engine_num", &SessionDesc::max_engine_num)
+      .def_readwrite("inflight_num", &SessionDesc::inflight_num)
+      .def_readwrite("show_perf", &SessionDesc::show_perf)
+      .def_readwrite("warmup_data", &SessionDesc::warmup_data)
+      .def_readwrite("shape_buckets", &SessionDesc::shape_buckets);
 }
 
 }  //  namespace infer_server
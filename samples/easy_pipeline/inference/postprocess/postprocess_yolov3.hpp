@@ -21,18 +21,16 @@
 #ifndef SAMPLE_POST_PROCESS_YOLOV3_HPP_
 #define SAMPLE_POST_PROCESS_YOLOV3_HPP_
 
-#include <algorithm>
 #include <memory>
 #include <vector>
 
+#include "cnis/detection.h"
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
 
 #include "glog/logging.h"
 #include "edk_frame.hpp"
 
-#define CLIP(x) ((x) < 0 ? 0 : ((x) > 1 ? 1 : (x)))
-
 class PostprocYolov3 : public infer_server::IPostproc {
  public:
   PostprocYolov3() = default;
@@ -71,49 +69,37 @@ class PostprocYolov3 : public infer_server::IPostproc {
       return -1;
     }
 
+    // boxes are normalized to model input, scores are thresholded, and boxes of a class are suppressed
+    infer_server::DetectionParams params;
+    params.threshold = threshold_;
+    params.nms_iou = nms_iou_;
+    const infer_server::DataType dtype = model_info->OutputLayout(0).dtype;
+    std::vector<infer_server::Detection> dets;
     for (size_t batch_idx = 0; batch_idx < data_vec.size(); batch_idx++) {
-      float *data = static_cast<float*>(output0->GetHostData(0, batch_idx));
+      const void *data = output0->GetHostData(0, batch_idx);
       int box_num = static_cast<int*>(output1->GetHostData(0, batch_idx))[0];
       if (!box_num) {
         continue;  // no bboxes
       }
 
       std::shared_ptr<EdkFrame> frame = data_vec[batch_idx]->GetUserData<std::shared_ptr<EdkFrame>>();
-
-      const float scaling_w = 1.0f * model_input_w / frame->surf->GetWidth();
-      const float scaling_h = 1.0f * model_input_h / frame->surf->GetHeight();
-      const float scaling = std::min(scaling_w, scaling_h);
-      float scaling_factor_w, scaling_factor_h;
-      scaling_factor_w = scaling_w / scaling;
-      scaling_factor_h = scaling_h / scaling;
-      for (int bi = 0; bi < box_num; ++bi) {
-        if (threshold_ > 0 && data[2] < threshold_) {
-          data += 7;
-          continue;
-        }
-
-        float l = CLIP(data[3]);
-        float t = CLIP(data[4]);
-        float r = CLIP(data[5]);
-        float b = CLIP(data[6]);
-        l = CLIP((l - 0.5f) * scaling_factor_w + 0.5f);
-        t = CLIP((t - 0.5f) * scaling_factor_h + 0.5f);
-        r = CLIP((r - 0.5f) * scaling_factor_w + 0.5f);
-        b = CLIP((b - 0.5f) * scaling_factor_h + 0.5f);
-        if (r <= l || b <= t) {
-          data += 7;
-          continue;
-        }
+      infer_server::BoxTransform letterbox = infer_server::BoxTransform::Letterbox(
+          model_input_w, model_input_h, frame->surf->GetWidth(), frame->surf->GetHeight());
+      if (infer_server::DecodeDetections(data, dtype, box_num, infer_server::DetectionLayout(), params, &letterbox,
+                                         &dets) != infer_server::Status::SUCCESS) {
+        LOG(ERROR) << "[EasyDK Samples] [PostprocYolov3] Postprocess failed, decode detections failed.";
+        return -1;
+      }
+      frame->objs.reserve(frame->objs.size() + dets.size());
+      for (const infer_server::Detection &det : dets) {
         DetectObject obj;
-        uint32_t id = static_cast<uint32_t>(data[1]);
-        obj.label = id;
-        obj.score = data[2];
-        obj.bbox.x = l;
-        obj.bbox.y = t;
-        obj.bbox.w = std::min(1.0f - l, r - l);
-        obj.bbox.h = std::min(1.0f - t, b - t);
+        obj.label = det.label;
+        obj.score = det.score;
+        obj.bbox.x = det.x0;
+        obj.bbox.y = det.y0;
+        obj.bbox.w = det.x1 - det.x0;
+        obj.bbox.h = det.y1 - det.y0;
         frame->objs.push_back(obj);
-        data += 7;
       }
     }
     return 0;
@@ -121,6 +107,7 @@ class PostprocYolov3 : public infer_server::IPostproc {
 
  private:
   float threshold_ = 0.6;
+  float nms_iou_ = 0.45;
 };
 
 #endif
@@ -29,36 +29,6 @@
 #include "glog/logging.h"
 
 
-static CnedkTransformRect KeepAspectRatio(int src_w, int src_h, int dst_w, int dst_h) {
-  float src_ratio = static_cast<float>(src_w) / src_h;
-  float dst_ratio = static_cast<float>(dst_w) / dst_h;
-  CnedkTransformRect res;
-  memset(&res, 0, sizeof(res));
-  if (src_ratio < dst_ratio) {
-    int pad_lenth = dst_w - src_ratio * dst_h;
-    pad_lenth = (pad_lenth % 2) ? pad_lenth - 1 : pad_lenth;
-    if (dst_w - pad_lenth / 2 < 0) return res;
-    res.width = dst_w - pad_lenth;
-    res.left = pad_lenth / 2;
-    res.top = 0;
-    res.height = dst_h;
-  } else if (src_ratio > dst_ratio) {
-    int pad_lenth = dst_h - dst_w / src_ratio;
-    pad_lenth = (pad_lenth % 2) ? pad_lenth - 1 : pad_lenth;
-    if (dst_h - pad_lenth / 2 < 0) return res;
-    res.height = dst_h - pad_lenth;
-    res.top = pad_lenth / 2;
-    res.left = 0;
-    res.width = dst_w;
-  } else {
-    res.left = 0;
-    res.top = 0;
-    res.width = dst_w;
-    res.height = dst_h;
-  }
-  return res;
-}
-
 class PreprocYolov3 : public infer_server::IPreproc {
  public:
   PreprocYolov3() = default;
@@ -76,7 +46,6 @@ class PreprocYolov3 : public infer_server::IPreproc {
 
     uint32_t batch_size = src->GetNumFilled();
     std::vector<CnedkTransformRect> src_rect(batch_size);
-    std::vector<CnedkTransformRect> dst_rect(batch_size);
     CnedkTransformParams params;
     memset(&params, 0, sizeof(params));
     params.transform_flag = 0;
@@ -117,21 +86,11 @@ class PreprocYolov3 : public infer_server::IPreproc {
       return -1;
     }
 
-    params.transform_flag |= CNEDK_TRANSFORM_CROP_DST;
-    params.dst_rect = dst_rect.data();
-    memset(dst_rect.data(), 0, sizeof(CnedkTransformRect) * batch_size);
-    for (uint32_t i = 0; i < batch_size; i++) {
-      CnedkTransformRect *dst_bbox = &dst_rect[i];
-      *dst_bbox = KeepAspectRatio(src_buf->surface_list[i].width, src_buf->surface_list[i].height, dst_desc.shape.w,
-                                  dst_desc.shape.h);
-      // validate bbox
-      dst_bbox->left -= dst_bbox->left & 1;
-      dst_bbox->top -= dst_bbox->top & 1;
-      dst_bbox->width -= dst_bbox->width & 1;
-      dst_bbox->height -= dst_bbox->height & 1;
-      while (dst_bbox->left + dst_bbox->width > dst_desc.shape.w) dst_bbox->width -= 2;
-      while (dst_bbox->top + dst_bbox->height > dst_desc.shape.h) dst_bbox->height -= 2;
-    }
+    // keep aspect ratio, padding is filled by the same transform
+    CnedkTransformLetterboxParams letterbox;
+    memset(&letterbox, 0x80, sizeof(letterbox));
+    params.transform_flag |= CNEDK_TRANSFORM_LETTERBOX;
+    params.letterbox_params = &letterbox;
 
     params.dst_desc = &dst_desc;
 
@@ -139,7 +98,6 @@ class PreprocYolov3 : public infer_server::IPreproc {
     memset(&config, 0, sizeof(config));
     config.compute_mode = CNEDK_TRANSFORM_COMPUTE_MLU;
     CnedkTransformSetSessionParams(&config);
-    CnedkBufSurfaceMemSet(dst_buf, -1, -1, 0x80);
     if (CnedkTransform(src_buf, dst_buf, &params) < 0) {
       LOG(ERROR) << "[EasyDK Samples] [PreprocYolov3] OnPreproc(): CnedkTransform failed";
       return -1;
@@ -52,7 +52,7 @@ int TransformerCe3226::Transform(CnedkBufSurface *src, CnedkBufSurface *dst, Cne
   if (config_params_.compute_mode == CNEDK_TRANSFORM_COMPUTE_MLU ||
       (src->mem_type != CNEDK_BUF_MEM_VB && src->mem_type != CNEDK_BUF_MEM_VB_CACHED) ||
       (dst->mem_type != CNEDK_BUF_MEM_VB && dst->mem_type != CNEDK_BUF_MEM_VB_CACHED) ||
-      transform_params->transform_flag & CNEDK_TRANSFORM_MEAN_STD) {
+      transform_params->transform_flag & (CNEDK_TRANSFORM_MEAN_STD | CNEDK_TRANSFORM_LETTERBOX)) {
     return CncvTransform(src, dst, transform_params);
   }
 
@@ -77,6 +77,14 @@ class BufSurfaceService {
     LOG(ERROR) << "[EasyDK] [BufSurfaceService] BufPoolDestroy(): Pool is not existed";
     return -1;
   }
+  int BufPoolGetStats(void *pool, CnedkBufPoolStats *stats) {
+    if (pool && stats) {
+      MemPool *mempool = reinterpret_cast<MemPool *>(pool);
+      return mempool->GetStats(stats);
+    }
+    LOG(ERROR) << "[EasyDK] [BufSurfaceService] BufPoolGetStats(): pool or stats is nullptr";
+    return -1;
+  }
   int CreateFromPool(CnedkBufSurface **surf, void *pool) {
     if (surf && pool) {
       CnedkBufSurface surface;
@@ -383,6 +391,10 @@ int CnedkBufPoolCreate(void **pool, CnedkBufSurfaceCreateParams *params, uint32_
 
 int CnedkBufPoolDestroy(void *pool) { return cnedk::BufSurfaceService::Instance().BufPoolDestroy(pool); }
 
+int CnedkBufPoolGetStats(void *pool, CnedkBufPoolStats *stats) {
+  return cnedk::BufSurfaceService::Instance().BufPoolGetStats(pool, stats);
+}
+
 int CnedkBufSurfaceCreateFromPool(CnedkBufSurface **surf, void *pool) {
   return cnedk::BufSurfaceService::Instance().CreateFromPool(surf, pool);
 }
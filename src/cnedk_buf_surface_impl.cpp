@@ -20,6 +20,7 @@
 
 #include "cnedk_buf_surface_impl.h"
 
+#include <cstring>  // for memset
 #include <string>
 #include <thread>
 
@@ -91,6 +92,13 @@ int MemPool::Create(CnedkBufSurfaceCreateParams *params, uint32_t block_num) {
   }
 
   alloc_count_ = 0;
+  block_num_ = block_num;
+  in_use_ = 0;
+  peak_in_use_ = 0;
+  acquire_count_ = 0;
+  empty_count_ = 0;
+  timeout_count_ = 0;
+  for (auto &bin : wait_hist_) bin = 0;
   created_ = true;
   return 0;
 }
@@ -139,14 +147,17 @@ int MemPool::Alloc(CnedkBufSurface *surf) {
   cnrtSetDevice(device_id_);
   if (is_vb_pool_) {
     if (allocator_->Alloc(surf) < 0) {
+      empty_count_.fetch_add(1, std::memory_order_relaxed);
       VLOG(4) << "[EasyDK] [MemPool] Alloc(): Memory allocator alloc BufSurface failed";
       return -1;
     }
     surf->opaque = reinterpret_cast<void *>(this);
+    OnAcquired();
     return 0;
   }
 
   if (cache_.empty()) {
+    empty_count_.fetch_add(1, std::memory_order_relaxed);
     VLOG(4) << "[EasyDK] [MemPool] Alloc(): Memory cache is empty";
     return -1;
   }
@@ -155,6 +166,43 @@ int MemPool::Alloc(CnedkBufSurface *surf) {
   cache_.pop();
 
   ++alloc_count_;
+  OnAcquired();
+  return 0;
+}
+
+void MemPool::OnAcquired() {
+  acquire_count_.fetch_add(1, std::memory_order_relaxed);
+  uint32_t in_use = in_use_.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint32_t peak = peak_in_use_.load(std::memory_order_relaxed);
+  while (in_use > peak && !peak_in_use_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+}
+
+void MemPool::RecordWait(uint64_t wait_us, bool timeout) {
+  if (timeout) timeout_count_.fetch_add(1, std::memory_order_relaxed);
+  // bin 0: no wait, bin i: < 4^(i-1) ms, last bin: the rest
+  uint32_t bin = 0;
+  if (wait_us) {
+    uint64_t bound_us = 1000;
+    for (bin = 1; bin < CNEDK_BUF_POOL_WAIT_HIST_BINS - 1 && wait_us >= bound_us; ++bin) bound_us *= 4;
+  }
+  wait_hist_[bin].fetch_add(1, std::memory_order_relaxed);
+}
+
+int MemPool::GetStats(CnedkBufPoolStats *stats) const {
+  if (!stats) {
+    LOG(ERROR) << "[EasyDK] [MemPool] GetStats(): stats is nullptr";
+    return -1;
+  }
+  memset(stats, 0, sizeof(CnedkBufPoolStats));
+  stats->block_num = block_num_.load(std::memory_order_relaxed);
+  stats->in_use = in_use_.load(std::memory_order_relaxed);
+  stats->peak_in_use = peak_in_use_.load(std::memory_order_relaxed);
+  stats->acquire_count = acquire_count_.load(std::memory_order_relaxed);
+  stats->empty_count = empty_count_.load(std::memory_order_relaxed);
+  stats->timeout_count = timeout_count_.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < CNEDK_BUF_POOL_WAIT_HIST_BINS; ++i) {
+    stats->wait_hist[i] = wait_hist_[i].load(std::memory_order_relaxed);
+  }
   return 0;
 }
 
@@ -166,6 +214,7 @@ int MemPool::Free(CnedkBufSurface *surf) {
   }
 
   cnrtSetDevice(device_id_);
+  in_use_.fetch_sub(1, std::memory_order_relaxed);
   if (is_vb_pool_) {
     allocator_->Free(surf);
     return 0;
@@ -21,6 +21,7 @@
 #ifndef CNEDK_BUF_SURFACE_IMPL_H_
 #define CNEDK_BUF_SURFACE_IMPL_H_
 
+#include <atomic>
 #include <string>
 #include <mutex>
 #include <queue>
@@ -51,6 +52,12 @@ class MemPool {
   int Destroy();
   int Alloc(CnedkBufSurface *surf);
   int Free(CnedkBufSurface *surf);
+  int GetStats(CnedkBufPoolStats *stats) const;
+  // called by blocking acquirements (e.g. BufPool) once they succeed or give up
+  void RecordWait(uint64_t wait_us, bool timeout);
+
+ private:
+  void OnAcquired();
 
  private:
   std::mutex mutex_;
@@ -62,6 +69,15 @@ class MemPool {
   IMemAllcator *allocator_ = nullptr;
   bool is_vb_pool_ = false;
   bool is_fake_mapped_ = false;
+
+  // statistics, lock-free
+  std::atomic<uint32_t> block_num_{0};
+  std::atomic<uint32_t> in_use_{0};
+  std::atomic<uint32_t> peak_in_use_{0};
+  std::atomic<uint64_t> acquire_count_{0};
+  std::atomic<uint64_t> empty_count_{0};
+  std::atomic<uint64_t> timeout_count_{0};
+  std::atomic<uint64_t> wait_hist_[CNEDK_BUF_POOL_WAIT_HIST_BINS];
 };
 
 //  for non-pool case
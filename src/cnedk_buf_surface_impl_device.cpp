@@ -79,6 +79,7 @@ int MemAllocatorDevice::Alloc(CnedkBufSurface *surf) {
   surf->opaque = nullptr;  // will be filled by MemPool
   surf->batch_size = create_params_.batch_size;
   surf->device_id = create_params_.device_id;
+  surf->is_contiguous = true;  // the batch is allocated as one block
   surf->surface_list =
       reinterpret_cast<CnedkBufSurfaceParams *>(malloc(sizeof(CnedkBufSurfaceParams) * surf->batch_size));
   memset(surf->surface_list, 0, sizeof(CnedkBufSurfaceParams) * surf->batch_size);
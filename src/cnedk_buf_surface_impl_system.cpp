@@ -66,7 +66,7 @@ int MemAllocatorSystem::Destroy() {
 }
 
 int MemAllocatorSystem::Alloc(CnedkBufSurface *surf) {
-  void *addr = reinterpret_cast<void *>(malloc(block_size_));
+  void *addr = reinterpret_cast<void *>(malloc(block_size_ * create_params_.batch_size));
   if (!addr) {
     LOG(ERROR) << "[EasyDK] [MemAllocatorSystem] Alloc(): malloc failed";
     return -1;
@@ -76,6 +76,7 @@ int MemAllocatorSystem::Alloc(CnedkBufSurface *surf) {
   surf->opaque = nullptr;  // will be filled by MemPool
   surf->batch_size = create_params_.batch_size;
   surf->device_id = create_params_.device_id;
+  surf->is_contiguous = true;  // the batch is allocated as one block
   surf->surface_list =
       reinterpret_cast<CnedkBufSurfaceParams *>(malloc(sizeof(CnedkBufSurfaceParams) * surf->batch_size));
   memset(surf->surface_list, 0, sizeof(CnedkBufSurfaceParams) * surf->batch_size);
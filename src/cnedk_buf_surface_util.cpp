@@ -22,17 +22,40 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <thread>
 
 #include "glog/logging.h"
 #include "cnrt.h"
+#include "cnedk_buf_surface_impl.h"
+#include "common/host_staging_pool.hpp"
 #include "common/utils.hpp"
 
 namespace cnedk {
 //
 // BufSurfaceWrapper
 //
+BufSurfaceWrapper::~BufSurfaceWrapper() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (mirror_) {
+    ReleaseMirror();
+  }
+  if (deleter_) {
+    delete deleter_, deleter_ = nullptr;
+    return;
+  }
+  if (owner_ && surf_) CnedkBufSurfaceDestroy(surf_), surf_ = nullptr;
+}
+
+void BufSurfaceWrapper::ReleaseMirror() {
+  // do not leave the surface mapped to released staging buffer
+  for (uint32_t i = 0; surf_ && i < surf_->batch_size; ++i) {
+    if (mirror_->Owns(surf_->surface_list[i].mapped_data_ptr)) surf_->surface_list[i].mapped_data_ptr = nullptr;
+  }
+  delete mirror_, mirror_ = nullptr;
+}
+
 CnedkBufSurface *BufSurfaceWrapper::GetBufSurface() const {
   std::unique_lock<std::mutex> lk(mutex_);
   return surf_;
@@ -40,6 +63,7 @@ CnedkBufSurface *BufSurfaceWrapper::GetBufSurface() const {
 
 CnedkBufSurface *BufSurfaceWrapper::BufSurfaceChown() {
   std::unique_lock<std::mutex> lk(mutex_);
+  if (mirror_) ReleaseMirror();
   CnedkBufSurface *surf = surf_;
   surf_ = nullptr;
   return surf;
@@ -147,82 +171,63 @@ void *BufSurfaceWrapper::GetHostData(uint32_t plane_idx, uint32_t batch_idx) {
     addr = static_cast<unsigned char *>(params->data_ptr);
   }
 
-  if (addr) {
-    // CnedkBufSurfaceSyncForCpu(surf_, batch_idx, plane_idx);
-    return static_cast<void *>(addr + params->plane_params.offset[plane_idx]);
-  }
-
-  // workaround, FIXME,  copy data from device to host here
-  if (surf_->mem_type == CNEDK_BUF_MEM_DEVICE) {
-    if (surf_->is_contiguous) {
-      size_t total_size = surf_->batch_size * params->data_size;
-      host_data_[0].reset(new unsigned char[(total_size + 63) / 64 * 64]);
-      CALL_CNRT_FUNC(cnrtMemcpy(host_data_[0].get(), surf_->surface_list[0].data_ptr, total_size,
-                                cnrtMemcpyDevToHost),
-                     "[BufSurfaceWrapper] GetHostData(): data is contiguous, copy data D2H failed");
-      for (size_t i = 0; i < surf_->batch_size; i++) {
-        GetSurfaceParamsPriv(i)->mapped_data_ptr = host_data_[0].get() + i * params->data_size;
-      }
-      addr = static_cast<unsigned char *>(params->mapped_data_ptr);
-      return static_cast<void *>(addr + params->plane_params.offset[plane_idx]);
-    } else {
-      if (batch_idx >= 128) {
-        LOG(ERROR) << "[EasyDK] [BufSurfaceWrapper] GetHostData(): batch index should not be greater than 128";
+  // device memory is mirrored to staging buffer, unless it has been mapped by others
+  if (surf_->mem_type == CNEDK_BUF_MEM_DEVICE && (!addr || (mirror_ && mirror_->Owns(addr)))) {
+    if (batch_idx >= surf_->batch_size) {
+      LOG(ERROR) << "[EasyDK] [BufSurfaceWrapper] GetHostData(): batch index is out of range, batch_idx = "
+                 << batch_idx;
+      return nullptr;
+    }
+    if (!mirror_) mirror_ = new HostMirror(HostStagingPool::Instance(surf_->device_id));
+    addr = static_cast<unsigned char *>(mirror_->Cached(surf_, batch_idx));
+    if (!addr) {
+      // the whole batch is mirrored at once, so that accessing items one by one takes the cached addresses
+      if (mirror_->Fetch(surf_) < 0) {
+        LOG(ERROR) << "[EasyDK] [BufSurfaceWrapper] GetHostData(): copy data D2H failed, batch_idx = " << batch_idx;
         return nullptr;
       }
-      host_data_[batch_idx].reset(new unsigned char[(GetSurfaceParamsPriv(batch_idx)->data_size + 63) / 64 * 64]);
-      CALL_CNRT_FUNC(cnrtMemcpy(host_data_[batch_idx].get(), GetSurfaceParamsPriv(batch_idx)->data_ptr,
-                                GetSurfaceParamsPriv(batch_idx)->data_size, cnrtMemcpyDevToHost),
-                     "[BufSurfaceWrapper] GetHostData(): copy data D2H failed, batch_idx = " +
-                     std::to_string(batch_idx));
-      GetSurfaceParamsPriv(batch_idx)->mapped_data_ptr = host_data_[batch_idx].get();
-      addr = static_cast<unsigned char *>(params->mapped_data_ptr);
-      return static_cast<void *>(addr + params->plane_params.offset[plane_idx]);
+      for (uint32_t i = 0; i < surf_->batch_size; ++i) {
+        GetSurfaceParamsPriv(i)->mapped_data_ptr = mirror_->Cached(surf_, i);
+      }
+      addr = static_cast<unsigned char *>(mirror_->Cached(surf_, batch_idx));
     }
   }
+
+  if (addr) {
+    return static_cast<void *>(addr + params->plane_params.offset[plane_idx]);
+  }
   LOG(ERROR) << "[EasyDK] [BufSurfaceWrapper] GetHostData(): Unsupported memory type";
   return nullptr;
 }
 
+void BufSurfaceWrapper::InvalidateHostData(uint32_t batch_idx) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (!surf_) return;
+  if (surf_->mem_type == CNEDK_BUF_MEM_DEVICE) {
+    if (mirror_) mirror_->Invalidate(batch_idx);
+    return;
+  }
+  CnedkBufSurfaceSyncForCpu(surf_, static_cast<int>(batch_idx), -1);
+}
+
 void BufSurfaceWrapper::SyncHostToDevice(uint32_t plane_idx, uint32_t batch_idx) {
   cnrtSetDevice(GetDeviceId());
+  std::unique_lock<std::mutex> lk(mutex_);
   if (surf_->mem_type == CNEDK_BUF_MEM_DEVICE) {
-    if (batch_idx >= 0 && batch_idx < 128 && host_data_[batch_idx]) {
-      CALL_CNRT_FUNC(cnrtMemcpy(surf_->surface_list[batch_idx].data_ptr, host_data_[batch_idx].get(),
-                                surf_->surface_list[batch_idx].data_size, cnrtMemcpyHostToDev),
-                     "[BufSurfaceWrapper] SyncHostToDevice(): copy data H2D failed, batch_idx = " +
-                     std::to_string(batch_idx));
+    if (!mirror_) {
+      LOG(ERROR) << "[EasyDK] [BufSurfaceWrapper] SyncHostToDevice(): Host data is null";
       return;
     }
-
-    if (batch_idx == (uint32_t)(-1)) {
-      if (surf_->is_contiguous) {
-        if (!host_data_[0]) {
-          LOG(ERROR) << "[EasyDK] [BufSurfaceWrapper] SyncHostToDevice(): Host data is null";
-          return;
-        }
-        size_t total_size = surf_->batch_size * GetSurfaceParamsPriv(0)->data_size;
-        CALL_CNRT_FUNC(cnrtMemcpy(surf_->surface_list[0].data_ptr, host_data_[0].get(),
-                                  total_size, cnrtMemcpyHostToDev),
-                       "[BufSurfaceWrapper] SyncHostToDevice(): data is contiguous, copy data H2D failed");
-      } else {
-        if (surf_->batch_size >= 128) {
-          LOG(ERROR) << "[EasyDK] [BufSurfaceWrapper] SyncHostToDevice: batch size should not be greater than 128,"
-                     << " which is: " << surf_->batch_size;
-          return;
-        }
-        for (uint32_t i = 0; i < surf_->batch_size; i++) {
-          CALL_CNRT_FUNC(cnrtMemcpy(surf_->surface_list[i].data_ptr, host_data_[i].get(),
-                                    surf_->surface_list[i].data_size, cnrtMemcpyHostToDev),
-                         "[BufSurfaceWrapper] SyncHostToDevice(): copy data H2D failed, batch_idx = " +
-                         std::to_string(batch_idx));
-        }
-      }
+    // the whole buffer is copied, plane_idx is not used
+    if (mirror_->Sync(surf_, batch_idx) < 0) {
+      LOG(ERROR) << "[EasyDK] [BufSurfaceWrapper] SyncHostToDevice(): copy data H2D failed, batch_idx = "
+                 << static_cast<int>(batch_idx);
     }
     return;
   }
   CnedkBufSurfaceSyncForDevice(surf_, batch_idx, plane_idx);
 }
+
 //
 // BufPool
 //
@@ -278,6 +283,13 @@ BufSurfWrapperPtr BufPool::GetBufSurfaceWrapper(int timeout_ms) {
     return nullptr;
   }
 
+  MemPool *mempool = reinterpret_cast<MemPool *>(pool_);
+  auto start = std::chrono::steady_clock::now();
+  auto waited_us = [&start]() -> uint64_t {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  };
+  bool waited = false;
+
   CnedkBufSurface *surf = nullptr;
   int count = timeout_ms + 1;
   int retry_cnt = 1;
@@ -290,21 +302,33 @@ BufSurfWrapperPtr BufPool::GetBufSurfaceWrapper(int timeout_ms) {
 
     int ret = CnedkBufSurfaceCreateFromPool(&surf, pool_);
     if (ret == 0) {
+      mempool->RecordWait(waited ? waited_us() : 0, false);
       return std::make_shared<BufSurfaceWrapper>(surf);
     }
     count -= retry_cnt;
     VLOG(3) << "[EasyDK] [BufPool] GetBufSurfaceWrapper(): retry, remaining times: " << count;
     if (count <= 0) {
+      mempool->RecordWait(waited_us(), true);
       LOG(ERROR) << "[EasyDK] [BufPool] GetBufSurfaceWrapper(): Maximum number of attempts reached: " << timeout_ms;
       return nullptr;
     }
 
     lk.unlock();
     usleep(1000 * retry_cnt);
+    waited = true;
     retry_cnt = std::min(retry_cnt * 2, 10);
     lk.lock();
   }
   return nullptr;
 }
 
+int BufPool::GetStats(CnedkBufPoolStats *stats) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (!pool_) {
+    LOG(ERROR) << "[EasyDK] [BufPool] GetStats(): Pool is not created";
+    return -1;
+  }
+  return CnedkBufPoolGetStats(pool_, stats);
+}
+
 }  // namespace cnedk
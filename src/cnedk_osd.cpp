@@ -22,6 +22,7 @@
 
 #include "glog/logging.h"
 #include "common/utils.hpp"
+#include "cnedk_osd_impl_host.hpp"
 
 #ifdef PLATFORM_CE3226
 #include "ce3226/cnedk_osd_impl_ce3226.hpp"
@@ -32,6 +33,9 @@ extern "C" {
 #endif
 
 int CnedkDrawRect(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t num) {
+  if (surf->mem_type == CNEDK_BUF_MEM_SYSTEM || surf->mem_type == CNEDK_BUF_MEM_PINNED) {
+    return cnedk::DrawRectHost(surf, params, num);
+  }
   if (surf->mem_type != CNEDK_BUF_MEM_VB && surf->mem_type != CNEDK_BUF_MEM_VB_CACHED) {
     LOG(ERROR) << "[EasyDK] CnedkDrawRect(): Unsupported memory type: " << surf->mem_type;
     return -1;
@@ -43,6 +47,9 @@ int CnedkDrawRect(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t nu
 }
 
 int CnedkFillRect(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t num) {
+  if (surf->mem_type == CNEDK_BUF_MEM_SYSTEM || surf->mem_type == CNEDK_BUF_MEM_PINNED) {
+    return cnedk::FillRectHost(surf, params, num);
+  }
   if (surf->mem_type != CNEDK_BUF_MEM_VB && surf->mem_type != CNEDK_BUF_MEM_VB_CACHED) {
     LOG(ERROR) << "[EasyDK] CnedkFillRect(): Unsupported memory type: " << surf->mem_type;
     return -1;
@@ -54,6 +61,9 @@ int CnedkFillRect(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t nu
 }
 
 int CnedkDrawBitmap(CnedkBufSurface *surf, CnedkOsdBitmapParams *params, uint32_t num) {
+  if (surf->mem_type == CNEDK_BUF_MEM_SYSTEM || surf->mem_type == CNEDK_BUF_MEM_PINNED) {
+    return cnedk::DrawBitmapHost(surf, params, num);
+  }
   if (surf->mem_type != CNEDK_BUF_MEM_VB && surf->mem_type != CNEDK_BUF_MEM_VB_CACHED) {
     LOG(ERROR) << "[EasyDK] CnedkDrawBitmap(): Unsupported memory type: " << surf->mem_type;
     return -1;
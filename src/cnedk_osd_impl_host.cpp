@@ -0,0 +1,405 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_osd_impl_host.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "glog/logging.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HOST_OSD_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#define HOST_OSD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace cnedk {
+
+namespace {
+
+// rows rasterized for all rectangles at a time, the band stays in cache
+constexpr int kBandRows = 32;
+
+struct Yuv {
+  uint8_t y, u, v;
+};
+
+// BT.601 video range
+inline Yuv RgbToYuv(int r, int g, int b) {
+  Yuv res;
+  res.y = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+  res.u = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+  res.v = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+  return res;
+}
+
+inline uint8_t Avg(uint8_t a, uint8_t b) { return static_cast<uint8_t>((a + b + 1) >> 1); }
+
+inline void Expand1555(uint16_t p, int *r, int *g, int *b) {
+  const int r5 = (p >> 10) & 31, g5 = (p >> 5) & 31, b5 = p & 31;
+  *r = (r5 << 3) | (r5 >> 2);
+  *g = (g5 << 3) | (g5 >> 2);
+  *b = (b5 << 3) | (b5 >> 2);
+}
+
+// repeats a pattern of unit bytes count times
+void FillPattern(uint8_t *dst, const uint8_t *pattern, size_t unit, size_t count) {
+  // 48 bytes hold whole patterns of 2 and 3 bytes
+  uint8_t block[48];
+  for (size_t i = 0; i < sizeof(block); ++i) block[i] = pattern[i % unit];
+  size_t bytes = unit * count;
+  const size_t chunk = sizeof(block) / unit * unit;
+  for (; bytes >= chunk; bytes -= chunk, dst += chunk) memcpy(dst, block, chunk);
+  memcpy(dst, block, bytes);
+}
+
+#if defined(HOST_OSD_SSE2)
+inline void Expand1555(__m128i v, __m128i *r, __m128i *g, __m128i *b) {
+  const __m128i mask = _mm_set1_epi16(31);
+  __m128i r5 = _mm_and_si128(_mm_srli_epi16(v, 10), mask);
+  __m128i g5 = _mm_and_si128(_mm_srli_epi16(v, 5), mask);
+  __m128i b5 = _mm_and_si128(v, mask);
+  *r = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+  *g = _mm_or_si128(_mm_slli_epi16(g5, 3), _mm_srli_epi16(g5, 2));
+  *b = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+}
+
+// (c0 * r + c1 * g + c2 * b + 128) >> 8 + offset, signed
+inline __m128i Dot(__m128i r, __m128i g, __m128i b, int16_t c0, int16_t c1, int16_t c2, int16_t offset) {
+  __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(c0)), _mm_mullo_epi16(g, _mm_set1_epi16(c1)));
+  sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(c2)), _mm_set1_epi16(128)));
+  return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(offset));
+}
+
+// lanes 0, 2, 4, 6 to the low half
+inline __m128i EvenLanes(__m128i v) {
+  v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 1, 2, 0));
+  v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 1, 2, 0));
+  return _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+inline __m128i Select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+// blends n pixels of a bitmap row into a luma row
+void BlendLuma(uint8_t *dst, const uint16_t *src, int n) {
+  int i = 0;
+#if defined(HOST_OSD_SSE2)
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i r, g, b;
+    Expand1555(v, &r, &g, &b);
+    // 66 * 255 + 129 * 255 + 25 * 255 + 128 fits unsigned 16 bits, shifted logically
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+    sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+    __m128i y = _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+    __m128i mask = _mm_srai_epi16(v, 15);
+    __m128i y8 = _mm_packus_epi16(y, y), mask8 = _mm_packs_epi16(mask, mask);
+    __m128i d = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(dst + i));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), Select(mask8, _mm_avg_epu8(d, y8), d));
+  }
+#elif defined(HOST_OSD_NEON)
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t v = vld1q_u16(src + i);
+    uint16x8_t r5 = vandq_u16(vshrq_n_u16(v, 10), vdupq_n_u16(31));
+    uint16x8_t g5 = vandq_u16(vshrq_n_u16(v, 5), vdupq_n_u16(31));
+    uint16x8_t b5 = vandq_u16(v, vdupq_n_u16(31));
+    uint16x8_t r = vorrq_u16(vshlq_n_u16(r5, 3), vshrq_n_u16(r5, 2));
+    uint16x8_t g = vorrq_u16(vshlq_n_u16(g5, 3), vshrq_n_u16(g5, 2));
+    uint16x8_t b = vorrq_u16(vshlq_n_u16(b5, 3), vshrq_n_u16(b5, 2));
+    uint16x8_t sum = vaddq_u16(vmulq_n_u16(r, 66), vmulq_n_u16(g, 129));
+    sum = vaddq_u16(sum, vaddq_u16(vmulq_n_u16(b, 25), vdupq_n_u16(128)));
+    uint8x8_t y8 = vmovn_u16(vaddq_u16(vshrq_n_u16(sum, 8), vdupq_n_u16(16)));
+    uint8x8_t mask8 = vmovn_u16(vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(v), 15)));
+    uint8x8_t d = vld1_u8(dst + i);
+    vst1_u8(dst + i, vbsl_u8(mask8, vrhadd_u8(d, y8), d));
+  }
+#endif
+  for (; i < n; ++i) {
+    if (!(src[i] & 0x8000)) continue;
+    int r, g, b;
+    Expand1555(src[i], &r, &g, &b);
+    dst[i] = Avg(dst[i], RgbToYuv(r, g, b).y);
+  }
+}
+
+// blends m chroma samples taken from every second pixel of src (n pixels available) into an interleaved row
+void BlendChroma(uint8_t *dst, const uint16_t *src, int m, int n, bool u_first) {
+  int k = 0;
+#if defined(HOST_OSD_SSE2)
+  for (; k + 4 <= m && 2 * k + 8 <= n; k += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * k));
+    __m128i r, g, b;
+    Expand1555(v, &r, &g, &b);
+    __m128i u = Dot(r, g, b, -38, -74, 112, 128), cr = Dot(r, g, b, 112, -94, -18, 128);
+    __m128i uv = u_first ? _mm_or_si128(u, _mm_slli_epi16(cr, 8)) : _mm_or_si128(cr, _mm_slli_epi16(u, 8));
+    __m128i mask = EvenLanes(_mm_srai_epi16(v, 15));
+    __m128i d = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(dst + 2 * k));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 2 * k), Select(mask, _mm_avg_epu8(d, EvenLanes(uv)), d));
+  }
+#elif defined(HOST_OSD_NEON)
+  for (; k + 4 <= m && 2 * k + 8 <= n; k += 4) {
+    uint16x4_t v = vld2_u16(src + 2 * k).val[0];
+    int16x4_t r5 = vreinterpret_s16_u16(vand_u16(vshr_n_u16(v, 10), vdup_n_u16(31)));
+    int16x4_t g5 = vreinterpret_s16_u16(vand_u16(vshr_n_u16(v, 5), vdup_n_u16(31)));
+    int16x4_t b5 = vreinterpret_s16_u16(vand_u16(v, vdup_n_u16(31)));
+    int16x4_t r = vorr_s16(vshl_n_s16(r5, 3), vshr_n_s16(r5, 2));
+    int16x4_t g = vorr_s16(vshl_n_s16(g5, 3), vshr_n_s16(g5, 2));
+    int16x4_t b = vorr_s16(vshl_n_s16(b5, 3), vshr_n_s16(b5, 2));
+    int16x4_t u = vmla_n_s16(vmla_n_s16(vmul_n_s16(r, -38), g, -74), b, 112);
+    int16x4_t cr = vmla_n_s16(vmla_n_s16(vmul_n_s16(r, 112), g, -94), b, -18);
+    u = vadd_s16(vshr_n_s16(vadd_s16(u, vdup_n_s16(128)), 8), vdup_n_s16(128));
+    cr = vadd_s16(vshr_n_s16(vadd_s16(cr, vdup_n_s16(128)), 8), vdup_n_s16(128));
+    uint16x4_t first = vreinterpret_u16_s16(u_first ? u : cr), second = vreinterpret_u16_s16(u_first ? cr : u);
+    uint8x8_t uv = vreinterpret_u8_u16(vorr_u16(first, vshl_n_u16(second, 8)));
+    uint8x8_t mask = vreinterpret_u8_s16(vshr_n_s16(vreinterpret_s16_u16(v), 15));
+    uint8x8_t d = vld1_u8(dst + 2 * k);
+    vst1_u8(dst + 2 * k, vbsl_u8(mask, vrhadd_u8(d, uv), d));
+  }
+#endif
+  for (; k < m; ++k) {
+    const uint16_t p = src[2 * k];
+    if (!(p & 0x8000)) continue;
+    int r, g, b;
+    Expand1555(p, &r, &g, &b);
+    Yuv yuv = RgbToYuv(r, g, b);
+    dst[2 * k] = Avg(dst[2 * k], u_first ? yuv.u : yuv.v);
+    dst[2 * k + 1] = Avg(dst[2 * k + 1], u_first ? yuv.v : yuv.u);
+  }
+}
+
+// first item of a surface in host memory
+class Canvas {
+ public:
+  // bytes of a color in memory order, Y U V for YUV images
+  struct Pixel {
+    uint8_t c[3];
+  };
+
+  int Init(CnedkBufSurface *surf, const char *func) {
+    if (!surf || !surf->surface_list || !surf->batch_size) {
+      LOG(ERROR) << "[EasyDK] " << func << "(): surface is empty";
+      return -1;
+    }
+    const CnedkBufSurfaceParams &params = surf->surface_list[0];
+    format_ = params.color_format;
+    if (format_ != CNEDK_BUF_COLOR_FORMAT_NV12 && format_ != CNEDK_BUF_COLOR_FORMAT_NV21 &&
+        format_ != CNEDK_BUF_COLOR_FORMAT_RGB && format_ != CNEDK_BUF_COLOR_FORMAT_BGR) {
+      LOG(ERROR) << "[EasyDK] " << func << "(): Unsupported color format: " << format_;
+      return -1;
+    }
+    uint8_t *base = static_cast<uint8_t *>(params.data_ptr);
+    if (!base) {
+      LOG(ERROR) << "[EasyDK] " << func << "(): data is nullptr";
+      return -1;
+    }
+    width_ = params.width;
+    height_ = params.height;
+    planes_[0] = base + params.plane_params.offset[0];
+    planes_[1] = base + params.plane_params.offset[1];
+    pitches_[0] = params.plane_params.pitch[0];
+    pitches_[1] = params.plane_params.pitch[1];
+    return 0;
+  }
+
+  int Width() const { return width_; }
+  int Height() const { return height_; }
+  bool IsYuv() const { return format_ == CNEDK_BUF_COLOR_FORMAT_NV12 || format_ == CNEDK_BUF_COLOR_FORMAT_NV21; }
+  bool UFirst() const { return format_ == CNEDK_BUF_COLOR_FORMAT_NV12; }
+  bool RFirst() const { return format_ == CNEDK_BUF_COLOR_FORMAT_RGB; }
+
+  // color is 0x00rrggbb
+  Pixel MakePixel(uint32_t color) const {
+    const int r = (color >> 16) & 0xff, g = (color >> 8) & 0xff, b = color & 0xff;
+    Pixel p;
+    if (IsYuv()) {
+      Yuv yuv = RgbToYuv(r, g, b);
+      p.c[0] = yuv.y;
+      p.c[1] = UFirst() ? yuv.u : yuv.v;
+      p.c[2] = UFirst() ? yuv.v : yuv.u;
+    } else {
+      p.c[0] = RFirst() ? r : b;
+      p.c[1] = g;
+      p.c[2] = RFirst() ? b : r;
+    }
+    return p;
+  }
+
+  // fills [x0, x1) of row y
+  void FillRow(int y, int x0, int x1, const Pixel &p) {
+    uint8_t *row = planes_[0] + y * pitches_[0];
+    if (!IsYuv()) {
+      FillPattern(row + x0 * 3, p.c, 3, x1 - x0);
+      return;
+    }
+    memset(row + x0, p.c[0], x1 - x0);
+    if (y & 1) return;
+    const int cx0 = (x0 + 1) / 2, cx1 = (x1 + 1) / 2;
+    if (cx1 > cx0) FillPattern(planes_[1] + (y / 2) * pitches_[1] + cx0 * 2, p.c + 1, 2, cx1 - cx0);
+  }
+
+  // blends n pixels of a bitmap row to row y from x0
+  void BlendRow(int y, int x0, int n, const uint16_t *src) {
+    uint8_t *row = planes_[0] + y * pitches_[0];
+    if (!IsYuv()) {
+      const int r_idx = RFirst() ? 0 : 2;
+      for (int i = 0; i < n; ++i) {
+        if (!(src[i] & 0x8000)) continue;
+        int rgb[3];
+        Expand1555(src[i], &rgb[0], &rgb[1], &rgb[2]);
+        uint8_t *px = row + (x0 + i) * 3;
+        px[r_idx] = Avg(px[r_idx], rgb[0]);
+        px[1] = Avg(px[1], rgb[1]);
+        px[2 - r_idx] = Avg(px[2 - r_idx], rgb[2]);
+      }
+      return;
+    }
+    BlendLuma(row + x0, src, n);
+    if (y & 1) return;
+    // chroma samples sit at even columns
+    const int first = x0 & 1, cx0 = (x0 + 1) / 2, cx1 = (x0 + n + 1) / 2;
+    if (cx1 > cx0) {
+      BlendChroma(planes_[1] + (y / 2) * pitches_[1] + cx0 * 2, src + first, cx1 - cx0, n - first, UFirst());
+    }
+  }
+
+ private:
+  CnedkBufSurfaceColorFormat format_ = CNEDK_BUF_COLOR_FORMAT_INVALID;
+  int width_ = 0;
+  int height_ = 0;
+  uint8_t *planes_[2] = {nullptr, nullptr};
+  size_t pitches_[2] = {0, 0};
+};
+
+// a clipped rectangle [x0, x1) x [y0, y1) of one color
+struct Span {
+  int x0, y0, x1, y1;
+  Canvas::Pixel pixel;
+};
+
+void AddSpan(const Canvas &canvas, int x0, int y0, int x1, int y1, const Canvas::Pixel &pixel,
+             std::vector<Span> *spans) {
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::min(x1, canvas.Width());
+  y1 = std::min(y1, canvas.Height());
+  if (x1 > x0 && y1 > y0) spans->push_back(Span{x0, y0, x1, y1, pixel});
+}
+
+// walks the image by bands of rows, spans are drawn in order within a band, so later ones overwrite former ones
+void Rasterize(Canvas *canvas, const std::vector<Span> &spans) {
+  if (spans.empty()) return;
+  int top = canvas->Height(), bottom = 0;
+  for (const Span &s : spans) {
+    top = std::min(top, s.y0);
+    bottom = std::max(bottom, s.y1);
+  }
+  for (int band = top; band < bottom; band += kBandRows) {
+    const int band_end = std::min(band + kBandRows, bottom);
+    for (const Span &s : spans) {
+      const int y0 = std::max(s.y0, band), y1 = std::min(s.y1, band_end);
+      for (int y = y0; y < y1; ++y) canvas->FillRow(y, s.x0, s.x1, s.pixel);
+    }
+  }
+}
+
+}  // namespace
+
+int DrawRectHost(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t num) {
+  Canvas canvas;
+  if (canvas.Init(surf, "DrawRectHost") < 0) return -1;
+  if (num && !params) {
+    LOG(ERROR) << "[EasyDK] DrawRectHost(): params is nullptr";
+    return -1;
+  }
+  std::vector<Span> spans;
+  spans.reserve(num * 4);
+  for (uint32_t i = 0; i < num; ++i) {
+    const CnedkOsdRectParams &p = params[i];
+    if (p.w <= 0 || p.h <= 0) continue;
+    const Canvas::Pixel pixel = canvas.MakePixel(p.color);
+    const int lw = static_cast<int>(std::max<uint32_t>(p.line_width, 1));
+    const int x1 = p.x + p.w, y1 = p.y + p.h;
+    if (2 * lw >= p.w || 2 * lw >= p.h) {
+      AddSpan(canvas, p.x, p.y, x1, y1, pixel, &spans);
+      continue;
+    }
+    // top, bottom, left and right borders, not overlapping
+    AddSpan(canvas, p.x, p.y, x1, p.y + lw, pixel, &spans);
+    AddSpan(canvas, p.x, y1 - lw, x1, y1, pixel, &spans);
+    AddSpan(canvas, p.x, p.y + lw, p.x + lw, y1 - lw, pixel, &spans);
+    AddSpan(canvas, x1 - lw, p.y + lw, x1, y1 - lw, pixel, &spans);
+  }
+  Rasterize(&canvas, spans);
+  return 0;
+}
+
+int FillRectHost(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t num) {
+  Canvas canvas;
+  if (canvas.Init(surf, "FillRectHost") < 0) return -1;
+  if (num && !params) {
+    LOG(ERROR) << "[EasyDK] FillRectHost(): params is nullptr";
+    return -1;
+  }
+  std::vector<Span> spans;
+  spans.reserve(num);
+  for (uint32_t i = 0; i < num; ++i) {
+    const CnedkOsdRectParams &p = params[i];
+    if (p.w <= 0 || p.h <= 0) continue;
+    AddSpan(canvas, p.x, p.y, p.x + p.w, p.y + p.h, canvas.MakePixel(p.color), &spans);
+  }
+  Rasterize(&canvas, spans);
+  return 0;
+}
+
+int DrawBitmapHost(CnedkBufSurface *surf, CnedkOsdBitmapParams *params, uint32_t num) {
+  Canvas canvas;
+  if (canvas.Init(surf, "DrawBitmapHost") < 0) return -1;
+  if (num && !params) {
+    LOG(ERROR) << "[EasyDK] DrawBitmapHost(): params is nullptr";
+    return -1;
+  }
+  for (uint32_t i = 0; i < num; ++i) {
+    const CnedkOsdBitmapParams &p = params[i];
+    if (p.w <= 0 || p.h <= 0) continue;
+    if (!p.bitmap_argb1555 || p.pitch < p.w * sizeof(uint16_t)) {
+      LOG(ERROR) << "[EasyDK] DrawBitmapHost(): Invalid bitmap, index = " << i;
+      return -1;
+    }
+    // clip into the image, bitmap is offset by the clipped part
+    const int x0 = std::max(p.x, 0), y0 = std::max(p.y, 0);
+    const int x1 = std::min(p.x + p.w, canvas.Width()), y1 = std::min(p.y + p.h, canvas.Height());
+    if (x1 <= x0 || y1 <= y0) continue;
+    const uint8_t *bitmap = static_cast<const uint8_t *>(p.bitmap_argb1555);
+    for (int y = y0; y < y1; ++y) {
+      const uint16_t *src = reinterpret_cast<const uint16_t *>(bitmap + (y - p.y) * p.pitch) + (x0 - p.x);
+      canvas.BlendRow(y, x0, x1 - x0, src);
+    }
+  }
+  return 0;
+}
+
+}  // namespace cnedk
@@ -0,0 +1,50 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_OSD_IMPL_HOST_HPP_
+#define CNEDK_OSD_IMPL_HOST_HPP_
+
+#include <stdint.h>
+
+#include "cnedk_osd.h"
+
+namespace cnedk {
+
+/*
+ * OSD of surfaces in host memory (system and pinned), running on CPU.
+ *
+ * NV12, NV21, RGB and BGR are drawn in their own color space, colors are converted by BT.601 video range.
+ * A chroma sample of NV12 / NV21 is written if the luma pixel at its top left is drawn.
+ * Rectangles are clipped into the image, the first item of surf is drawn.
+ */
+
+/// draws borders of line_width pixels inside rectangles, later rectangles are drawn over former ones
+int DrawRectHost(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t num);
+/// fills rectangles, later rectangles are drawn over former ones
+int FillRectHost(CnedkBufSurface *surf, CnedkOsdRectParams *params, uint32_t num);
+/**
+ * draws ARGB1555 bitmaps as the VGU of CE3226 does: pixels with alpha bit set are blended by half,
+ * the others (background) are transparent
+ */
+int DrawBitmapHost(CnedkBufSurface *surf, CnedkOsdBitmapParams *params, uint32_t num);
+
+}  // namespace cnedk
+
+#endif  // CNEDK_OSD_IMPL_HOST_HPP_
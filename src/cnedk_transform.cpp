@@ -29,6 +29,7 @@
 
 #include "cnedk_platform.h"
 #include "cnedk_transform_impl.hpp"
+#include "cnedk_transform_impl_host.hpp"
 
 #ifdef PLATFORM_CE3226
 #include "ce3226/cnedk_transform_impl_ce3226.hpp"
@@ -108,6 +109,14 @@ class TransformService {
       LOG(ERROR) << "[EasyDK] [TransformService] Transform(): src, dst BufSurface or parameters pointer is invalid";
       return -1;
     }
+    // surfaces in host memory are transformed on CPU
+    if (IsHostMemory(src->mem_type) && IsHostMemory(dst->mem_type)) {
+      return host_transformer_.Transform(src, dst, transform_params);
+    }
+    if (!transformer_) {
+      LOG(ERROR) << "[EasyDK] [TransformService] Transform(): No transformer for device memory on this platform";
+      return -1;
+    }
     return transformer_->Transform(src, dst, transform_params);
   }
 
@@ -118,8 +127,13 @@ class TransformService {
   TransformService &operator=(TransformService &&) = delete;
   TransformService() { transformer_.reset(CreateTransformer()); }
 
+  static bool IsHostMemory(CnedkBufSurfaceMemType mem_type) {
+    return mem_type == CNEDK_BUF_MEM_SYSTEM || mem_type == CNEDK_BUF_MEM_PINNED;
+  }
+
  private:
   std::unique_ptr<ITransformer> transformer_ = nullptr;
+  TransformerHost host_transformer_;
   static std::unique_ptr<TransformService> instance_;
 };
 
@@ -137,6 +151,24 @@ int CnedkTransformGetSessionParams(CnedkTransformConfigParams *config_params) {
   return cnedk::TransformService::Instance().GetSessionParams(config_params);
 }
 
+int CnedkTransformSetHostParams(CnedkTransformHostParams *host_params) {
+  if (!host_params) {
+    LOG(ERROR) << "[EasyDK] CnedkTransformSetHostParams(): Parameters pointer is invalid";
+    return -1;
+  }
+  cnedk::SetHostTransformParams(*host_params);
+  return 0;
+}
+
+int CnedkTransformGetHostParams(CnedkTransformHostParams *host_params) {
+  if (!host_params) {
+    LOG(ERROR) << "[EasyDK] CnedkTransformGetHostParams(): Parameters pointer is invalid";
+    return -1;
+  }
+  *host_params = cnedk::GetHostTransformParams();
+  return 0;
+}
+
 int CnedkTransform(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTransformParams *transform_params) {
   return cnedk::TransformService::Instance().Transform(src, dst, transform_params);
 }
@@ -62,6 +62,44 @@ class ITransformer {
 
 ITransformer *CreateTransformer();
 
+/**
+ * @brief Gets the largest rect with the aspect ratio of src_w x src_h at the center of frame
+ */
+inline CnedkTransformRect LetterboxRect(uint32_t src_w, uint32_t src_h, const CnedkTransformRect &frame) {
+  CnedkTransformRect res = frame;
+  if (!src_w || !src_h) return res;
+  // integer math, so that every implementation gets the same rect
+  const uint64_t w_by_h = static_cast<uint64_t>(src_w) * frame.height;
+  const uint64_t h_by_w = static_cast<uint64_t>(src_h) * frame.width;
+  if (w_by_h < h_by_w) {
+    res.width = std::max<uint64_t>((2 * w_by_h + src_h) / (2 * src_h), 1);
+  } else if (w_by_h > h_by_w) {
+    res.height = std::max<uint64_t>((2 * h_by_w + src_w) / (2 * src_w), 1);
+  }
+  res.left = frame.left + (frame.width - res.width) / 2;
+  res.top = frame.top + (frame.height - res.height) / 2;
+  return res;
+}
+
+/**
+ * @brief Gets the padding bands of frame around inner (top, bottom, left, right), empty ones are skipped
+ *
+ * @return Returns the number of bands
+ */
+inline int LetterboxBands(const CnedkTransformRect &frame, const CnedkTransformRect &inner,
+                          CnedkTransformRect bands[4]) {
+  int num = 0;
+  const CnedkTransformRect candidates[4] = {
+      {frame.top, frame.left, frame.width, inner.top - frame.top},
+      {inner.top + inner.height, frame.left, frame.width, frame.top + frame.height - inner.top - inner.height},
+      {inner.top, frame.left, inner.left - frame.left, inner.height},
+      {inner.top, inner.left + inner.width, frame.left + frame.width - inner.left - inner.width, inner.height}};
+  for (const CnedkTransformRect &band : candidates) {
+    if (band.width && band.height) bands[num++] = band;
+  }
+  return num;
+}
+
 }  // namespace cnedk
 
 #endif  // CNEDK_TRANSFORM_IMPL_HPP_
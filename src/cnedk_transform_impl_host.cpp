@@ -0,0 +1,1297 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_transform_impl_host.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "common/host_worker_pool.hpp"
+#include "core/cast_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HOST_TRANSFORM_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#define HOST_TRANSFORM_NEON
+#include <arm_neon.h>
+#endif
+
+namespace cnedk {
+
+namespace {
+
+constexpr int kChannels = 3;
+
+// fractional bits of the weights of fixed point interpolation
+constexpr int kWeightBits = 11;
+constexpr int kWeightOne = 1 << kWeightBits;
+
+// two neighbours of a sampling point, relative to the start of the source roi, and the weight of the second one
+struct Coord {
+  int i0;
+  int i1;
+  float w;
+  // w in fixed point
+  int16_t fw;
+};
+
+// aligns pixel centers of source and destination
+void ComputeCoords(uint32_t dst_len, uint32_t src_len, Coord *coords) {
+  const float scale = static_cast<float>(src_len) / dst_len;
+  const int last = static_cast<int>(src_len) - 1;
+  for (uint32_t d = 0; d < dst_len; ++d) {
+    float s = std::max((d + 0.5f) * scale - 0.5f, 0.f);
+    int i0 = std::min(static_cast<int>(s), last);
+    Coord &c = coords[d];
+    c.i0 = i0;
+    c.i1 = std::min(i0 + 1, last);
+    c.w = i0 == last ? 0.f : s - i0;
+    c.fw = static_cast<int16_t>(c.w * kWeightOne + 0.5f);
+  }
+}
+
+using CoordTable = std::shared_ptr<const std::vector<Coord>>;
+
+// tables of a size pair are shared, stream resolutions and network inputs repeat from frame to frame
+CoordTable GetCoords(uint32_t src_len, uint32_t dst_len) {
+  // a table of 4K is about 64KB, rois of many sizes are not kept forever
+  constexpr size_t kMaxTables = 64;
+  static std::mutex mutex;
+  static std::map<std::pair<uint32_t, uint32_t>, CoordTable> tables;
+  const auto key = std::make_pair(src_len, dst_len);
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = tables.find(key);
+    if (it != tables.end()) return it->second;
+  }
+  std::shared_ptr<std::vector<Coord>> table = std::make_shared<std::vector<Coord>>(dst_len);
+  ComputeCoords(dst_len, src_len, table->data());
+  std::lock_guard<std::mutex> lk(mutex);
+  if (tables.size() >= kMaxTables) tables.clear();
+  return tables.emplace(key, table).first->second;
+}
+
+inline float Lerp(float a, float b, float w) { return a + (b - a) * w; }
+
+inline float Clamp255(float v) { return std::min(std::max(v, 0.f), 255.f); }
+
+// 8 bit values are scaled by 2^kRowBits in rows of fixed point results
+constexpr int kRowBits = 7;
+
+// horizontal coordinates of fixed point resampling, as arrays for simd loads
+struct FixedCoords {
+  // first neighbour in a row of one channel, and the weights (1 - w, w) as a pair of int16
+  std::vector<int32_t> i0;
+  std::vector<int32_t> w;
+  // first chroma pair in an interleaved UV row starting from the even column at left, and the weights
+  std::vector<int32_t> c0;
+  std::vector<int32_t> cw;
+};
+
+inline int32_t WeightPair(int fw) {
+  return static_cast<int32_t>((static_cast<uint32_t>(fw) << 16) | static_cast<uint32_t>(kWeightOne - fw));
+}
+inline int FirstWeight(int32_t pair) { return pair & 0xffff; }
+inline int SecondWeight(int32_t pair) { return pair >> 16; }
+
+// fixed point coordinates of n destination columns of a source roi starting from column left
+void ComputeFixedCoords(const Coord *xs, uint32_t n, int left, FixedCoords *fixed) {
+  fixed->i0.resize(n);
+  fixed->w.resize(n);
+  fixed->c0.resize(n);
+  fixed->cw.resize(n);
+  for (uint32_t x = 0; x < n; ++x) {
+    const int col = left + xs[x].i0;
+    fixed->i0[x] = xs[x].i0;
+    fixed->w[x] = WeightPair(xs[x].fw);
+    fixed->c0[x] = (col & ~1) - (left & ~1);
+    // neighbours in the same pair of columns share the chroma
+    fixed->cw[x] = (col & 1) && xs[x].i1 != xs[x].i0 ? fixed->w[x] : WeightPair(0);
+  }
+}
+
+// vertical pass in fixed point, out[i] = a[i] * (1 - w) + b[i] * w for count 8 bit values of two source rows
+void BlendRows(const uint8_t *a, const uint8_t *b, int fw, uint32_t count, int16_t *out) {
+  constexpr int kShift = kWeightBits - kRowBits;
+  uint32_t i = 0;
+#if defined(HOST_TRANSFORM_SSE2)
+  const __m128i w = _mm_set1_epi32(WeightPair(fw));
+  const __m128i half = _mm_set1_epi32(1 << (kShift - 1));
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= count; i += 16) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    const __m128i a16[2] = {_mm_unpacklo_epi8(va, zero), _mm_unpackhi_epi8(va, zero)};
+    const __m128i b16[2] = {_mm_unpacklo_epi8(vb, zero), _mm_unpackhi_epi8(vb, zero)};
+    for (int h = 0; h < 2; ++h) {
+      // (a, b) pairs multiplied by the weight pair
+      const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a16[h], b16[h]), w);
+      const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a16[h], b16[h]), w);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8 * h),
+                       _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, half), kShift),
+                                       _mm_srai_epi32(_mm_add_epi32(hi, half), kShift)));
+    }
+  }
+#elif defined(HOST_TRANSFORM_NEON)
+  const uint16_t w0 = kWeightOne - fw, w1 = fw;
+  for (; i + 8 <= count; i += 8) {
+    const uint16x8_t va = vmovl_u8(vld1_u8(a + i)), vb = vmovl_u8(vld1_u8(b + i));
+    const uint32x4_t lo = vmlal_n_u16(vmull_n_u16(vget_low_u16(va), w0), vget_low_u16(vb), w1);
+    const uint32x4_t hi = vmlal_n_u16(vmull_n_u16(vget_high_u16(va), w0), vget_high_u16(vb), w1);
+    vst1q_s16(out + i, vreinterpretq_s16_u16(vcombine_u16(vrshrn_n_u32(lo, kShift), vrshrn_n_u32(hi, kShift))));
+  }
+#endif
+  for (; i < count; ++i) out[i] = (a[i] * (kWeightOne - fw) + b[i] * fw + (1 << (kShift - 1))) >> kShift;
+}
+
+// horizontal pass in fixed point of a blended row of one channel, n pixels. The row has an element after the last
+// column, the second neighbour of the last pixel has weight 0.
+void ResampleRow(const int16_t *row, const FixedCoords &xs, uint32_t n, int16_t *out) {
+  constexpr int kHalf = 1 << (kWeightBits - 1);
+  uint32_t x = 0;
+#if defined(HOST_TRANSFORM_SSE2)
+  const __m128i half = _mm_set1_epi32(kHalf);
+  for (; x + 8 <= n; x += 8) {
+    __m128i v[2];
+    for (int h = 0; h < 2; ++h) {
+      // both neighbours of a pixel are loaded at once
+      int32_t pairs[4];
+      for (int k = 0; k < 4; ++k) memcpy(&pairs[k], row + xs.i0[x + 4 * h + k], sizeof(int32_t));
+      const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pairs));
+      const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(xs.w.data() + x + 4 * h));
+      v[h] = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p, w), half), kWeightBits);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_packs_epi32(v[0], v[1]));
+  }
+#elif defined(HOST_TRANSFORM_NEON)
+  for (; x + 4 <= n; x += 4) {
+    int32_t pairs[4];
+    for (int k = 0; k < 4; ++k) memcpy(&pairs[k], row + xs.i0[x + k], sizeof(int32_t));
+    const int16x8_t p = vreinterpretq_s16_s32(vld1q_s32(pairs));
+    const int16x8_t w = vreinterpretq_s16_s32(vld1q_s32(xs.w.data() + x));
+    const int32x4_t sum =
+        vpaddq_s32(vmull_s16(vget_low_s16(p), vget_low_s16(w)), vmull_s16(vget_high_s16(p), vget_high_s16(w)));
+    vst1_s16(out + x, vrshrn_n_s32(sum, kWeightBits));
+  }
+#endif
+  for (; x < n; ++x) {
+    const int16_t *p = row + xs.i0[x];
+    out[x] = (p[0] * FirstWeight(xs.w[x]) + p[1] * SecondWeight(xs.w[x]) + kHalf) >> kWeightBits;
+  }
+}
+
+// horizontal pass in fixed point of a blended UV row, n pixels. The row has two elements after the last pair.
+void ResampleUv(const int16_t *uv, const FixedCoords &xs, uint32_t n, int16_t *out_u, int16_t *out_v) {
+  constexpr int kHalf = 1 << (kWeightBits - 1);
+  uint32_t x = 0;
+#if defined(HOST_TRANSFORM_SSE2)
+  const __m128i half = _mm_set1_epi32(kHalf);
+  for (; x + 4 <= n; x += 4) {
+    __m128i v[2];
+    for (int h = 0; h < 2; ++h) {
+      const uint32_t x0 = x + 2 * h, x1 = x0 + 1;
+      // (u0, v0, u1, v1) of two pixels, reordered as (u0, u1) and (v0, v1) pairs
+      int64_t q0, q1;
+      memcpy(&q0, uv + xs.c0[x0], sizeof(int64_t));
+      memcpy(&q1, uv + xs.c0[x1], sizeof(int64_t));
+      __m128i p = _mm_set_epi64x(q1, q0);
+      p = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+      const __m128i w = _mm_set_epi32(xs.cw[x1], xs.cw[x1], xs.cw[x0], xs.cw[x0]);
+      v[h] = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p, w), half), kWeightBits);
+    }
+    // (u, v) of four pixels to u of them and v of them
+    __m128i uvs = _mm_packs_epi32(v[0], v[1]);
+    uvs = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uvs, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+    uvs = _mm_shuffle_epi32(uvs, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out_u + x), uvs);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out_v + x), _mm_srli_si128(uvs, 8));
+  }
+#endif
+  for (; x < n; ++x) {
+    const int16_t *p = uv + xs.c0[x];
+    const int w0 = FirstWeight(xs.cw[x]), w1 = SecondWeight(xs.cw[x]);
+    out_u[x] = (p[0] * w0 + p[2] * w1 + kHalf) >> kWeightBits;
+    out_v[x] = (p[1] * w0 + p[3] * w1 + kHalf) >> kWeightBits;
+  }
+}
+
+// horizontal pass in fixed point of a blended row of packed pixels, n pixels of channels c, 1 and 2 - c. The row
+// has two pixels after the last one.
+void ResamplePacked(const int16_t *row, const FixedCoords &xs, uint32_t n, int c, int16_t *const *out) {
+  constexpr int kHalf = 1 << (kWeightBits - 1);
+  const int idx[kChannels] = {c, 1, 2 - c};
+  uint32_t x = 0;
+#if defined(HOST_TRANSFORM_SSE2)
+  const __m128i half = _mm_set1_epi32(kHalf);
+  int16_t *const dst[kChannels] = {out[idx[0]], out[1], out[idx[2]]};
+  for (; x + 4 <= n; x += 4) {
+    __m128i px[4];
+    for (int k = 0; k < 4; ++k) {
+      // pairs of the channels of the two neighbours, the fourth lane is not used
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + xs.i0[x + k] * kChannels));
+      const __m128i pairs = _mm_unpacklo_epi16(v, _mm_srli_si128(v, kChannels * sizeof(int16_t)));
+      px[k] = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairs, _mm_set1_epi32(xs.w[x + k])), half), kWeightBits);
+    }
+    // pixels of channels to channels of pixels
+    const __m128i t0 = _mm_unpacklo_epi32(px[0], px[1]), t1 = _mm_unpacklo_epi32(px[2], px[3]);
+    const __m128i t2 = _mm_unpackhi_epi32(px[0], px[1]), t3 = _mm_unpackhi_epi32(px[2], px[3]);
+    const __m128i ch[kChannels] = {_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1), _mm_unpacklo_epi64(t2, t3)};
+    for (int k = 0; k < kChannels; ++k) {
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst[k] + x), _mm_packs_epi32(ch[k], ch[k]));
+    }
+  }
+#endif
+  for (; x < n; ++x) {
+    const int16_t *p = row + xs.i0[x] * kChannels;
+    const int w0 = FirstWeight(xs.w[x]), w1 = SecondWeight(xs.w[x]);
+    for (int k = 0; k < kChannels; ++k) {
+      out[k][x] = (p[idx[k]] * w0 + p[idx[k] + kChannels] * w1 + kHalf) >> kWeightBits;
+    }
+  }
+}
+
+// NV12 / NV21, YUV is interpolated before conversion
+class YuvSource {
+ public:
+  static constexpr bool kYuv = true;
+
+  YuvSource(const CnedkBufSurfaceParams &params, const void *data) {
+    const uint8_t *base = static_cast<const uint8_t *>(data);
+    y_plane_ = base + params.plane_params.offset[0];
+    uv_plane_ = base + params.plane_params.offset[1];
+    y_pitch_ = params.plane_params.pitch[0];
+    uv_pitch_ = params.plane_params.pitch[1];
+    u_idx_ = params.color_format == CNEDK_BUF_COLOR_FORMAT_NV12 ? 0 : 1;
+  }
+
+  // horizontal pass of one source row from column left, outputs Y, U and V
+  void Horizontal(int row, int left, const Coord *xs, uint32_t n, float *const *out) const {
+    const uint8_t *y = y_plane_ + row * y_pitch_ + left;
+    const uint8_t *u = uv_plane_ + (row >> 1) * uv_pitch_ + u_idx_;
+    const uint8_t *v = uv_plane_ + (row >> 1) * uv_pitch_ + 1 - u_idx_;
+    float *out_y = out[0], *out_u = out[1], *out_v = out[2];
+    for (uint32_t i = 0; i < n; ++i) {
+      const Coord &c = xs[i];
+      // chroma of the pair of columns holding each neighbour
+      const int c0 = (left + c.i0) & ~1, c1 = (left + c.i1) & ~1;
+      out_y[i] = Lerp(y[c.i0], y[c.i1], c.w);
+      out_u[i] = Lerp(u[c0], u[c1], c.w);
+      out_v[i] = Lerp(v[c0], v[c1], c.w);
+    }
+  }
+
+  // elements of a blended row of width pixels, Y followed by UV from the even column at left, and their padding
+  static size_t BlendedSize(uint32_t width) { return 2 * width + 5; }
+
+  // vertical pass in fixed point of columns [left, left + width) of two source rows
+  void Blend(int row0, int row1, int fw, int left, uint32_t width, int16_t *out) const {
+    BlendRows(y_plane_ + row0 * y_pitch_ + left, y_plane_ + row1 * y_pitch_ + left, fw, width, out);
+    const int uv_left = left & ~1;
+    const uint32_t uv_count = ((left + width - 1) & ~1) - uv_left + 2;
+    BlendRows(uv_plane_ + (row0 >> 1) * uv_pitch_ + uv_left, uv_plane_ + (row1 >> 1) * uv_pitch_ + uv_left, fw,
+              uv_count, out + width + 1);
+  }
+
+  // horizontal pass in fixed point of a blended row, outputs Y, U and V
+  void Resample(const int16_t *blended, uint32_t width, const FixedCoords &xs, uint32_t n,
+                int16_t *const *out) const {
+    ResampleRow(blended, xs, n, out[0]);
+    ResampleUv(blended + width + 1, xs, n, out[1 + u_idx_], out[2 - u_idx_]);
+  }
+
+ private:
+  const uint8_t *y_plane_, *uv_plane_;
+  size_t y_pitch_, uv_pitch_;
+  int u_idx_;
+};
+
+// RGB / BGR
+class PackedSource {
+ public:
+  static constexpr bool kYuv = false;
+
+  PackedSource(const CnedkBufSurfaceParams &params, const void *data) {
+    data_ = static_cast<const uint8_t *>(data) + params.plane_params.offset[0];
+    pitch_ = params.plane_params.pitch[0];
+    r_idx_ = params.color_format == CNEDK_BUF_COLOR_FORMAT_RGB ? 0 : 2;
+  }
+
+  // horizontal pass of one source row from column left, outputs R, G and B
+  void Horizontal(int row, int left, const Coord *xs, uint32_t n, float *const *out) const {
+    const uint8_t *r = data_ + row * pitch_ + left * kChannels + r_idx_;
+    const uint8_t *g = data_ + row * pitch_ + left * kChannels + 1;
+    const uint8_t *b = data_ + row * pitch_ + left * kChannels + 2 - r_idx_;
+    float *out_r = out[0], *out_g = out[1], *out_b = out[2];
+    for (uint32_t i = 0; i < n; ++i) {
+      const int x0 = xs[i].i0 * kChannels, x1 = xs[i].i1 * kChannels;
+      out_r[i] = Lerp(r[x0], r[x1], xs[i].w);
+      out_g[i] = Lerp(g[x0], g[x1], xs[i].w);
+      out_b[i] = Lerp(b[x0], b[x1], xs[i].w);
+    }
+  }
+
+  // elements of a blended row of width pixels and its padding
+  static size_t BlendedSize(uint32_t width) { return (width + 2) * kChannels; }
+
+  // vertical pass in fixed point of columns [left, left + width) of two source rows
+  void Blend(int row0, int row1, int fw, int left, uint32_t width, int16_t *out) const {
+    BlendRows(data_ + row0 * pitch_ + left * kChannels, data_ + row1 * pitch_ + left * kChannels, fw,
+              width * kChannels, out);
+  }
+
+  // horizontal pass in fixed point of a blended row, outputs R, G and B
+  void Resample(const int16_t *blended, uint32_t, const FixedCoords &xs, uint32_t n, int16_t *const *out) const {
+    ResamplePacked(blended, xs, n, r_idx_, out);
+  }
+
+ private:
+  const uint8_t *data_;
+  size_t pitch_;
+  int r_idx_;
+};
+
+// GRAY8, the gray level is used for R, G and B
+class GraySource {
+ public:
+  static constexpr bool kYuv = false;
+
+  GraySource(const CnedkBufSurfaceParams &params, const void *data) {
+    data_ = static_cast<const uint8_t *>(data) + params.plane_params.offset[0];
+    pitch_ = params.plane_params.pitch[0];
+  }
+
+  // horizontal pass of one source row from column left, the same row is written to the three outputs
+  void Horizontal(int row, int left, const Coord *xs, uint32_t n, float *const *out) const {
+    const uint8_t *gray = data_ + row * pitch_ + left;
+    for (uint32_t i = 0; i < n; ++i) out[0][i] = Lerp(gray[xs[i].i0], gray[xs[i].i1], xs[i].w);
+    memcpy(out[1], out[0], n * sizeof(float));
+    memcpy(out[2], out[0], n * sizeof(float));
+  }
+
+  // elements of a blended row of width pixels and its padding
+  static size_t BlendedSize(uint32_t width) { return width + 1; }
+
+  // vertical pass in fixed point of columns [left, left + width) of two source rows
+  void Blend(int row0, int row1, int fw, int left, uint32_t width, int16_t *out) const {
+    BlendRows(data_ + row0 * pitch_ + left, data_ + row1 * pitch_ + left, fw, width, out);
+  }
+
+  // horizontal pass in fixed point of a blended row, the same row is written to the three outputs
+  void Resample(const int16_t *blended, uint32_t, const FixedCoords &xs, uint32_t n, int16_t *const *out) const {
+    ResampleRow(blended, xs, n, out[0]);
+    memcpy(out[1], out[0], n * sizeof(int16_t));
+    memcpy(out[2], out[0], n * sizeof(int16_t));
+  }
+
+ private:
+  const uint8_t *data_;
+  size_t pitch_;
+};
+
+// rgb channel c goes to output channel offset[c] as rgb[c] * scale[c] + bias[c]
+struct Normalizer {
+  int offset[kChannels];
+  float scale[kChannels];
+  float bias[kChannels];
+  // added to rounded integer output, in output channel order
+  int zero_point[kChannels];
+
+  bool IsIdentity() const {
+    for (int c = 0; c < kChannels; ++c) {
+      if (scale[c] != 1.f || bias[c] != 0.f) return false;
+    }
+    return true;
+  }
+};
+
+// float lanes with the few operations the vertical pass needs, the scalar one handles the tail
+struct ScalarOps {
+  using V = float;
+  static constexpr uint32_t kWidth = 1;
+  static V Load(const float *p) { return *p; }
+  static void Store(float *p, V v) { *p = v; }
+  static V Set(float v) { return v; }
+  static V Add(V a, V b) { return a + b; }
+  static V Sub(V a, V b) { return a - b; }
+  static V Mul(V a, V b) { return a * b; }
+  static V Min(V a, V b) { return std::min(a, b); }
+  static V Max(V a, V b) { return std::max(a, b); }
+};
+
+#if defined(HOST_TRANSFORM_SSE2)
+struct SimdOps {
+  using V = __m128;
+  static constexpr uint32_t kWidth = 4;
+  static V Load(const float *p) { return _mm_loadu_ps(p); }
+  static void Store(float *p, V v) { _mm_storeu_ps(p, v); }
+  static V Set(float v) { return _mm_set1_ps(v); }
+  static V Add(V a, V b) { return _mm_add_ps(a, b); }
+  static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V Min(V a, V b) { return _mm_min_ps(a, b); }
+  static V Max(V a, V b) { return _mm_max_ps(a, b); }
+};
+#elif defined(HOST_TRANSFORM_NEON)
+struct SimdOps {
+  using V = float32x4_t;
+  static constexpr uint32_t kWidth = 4;
+  static V Load(const float *p) { return vld1q_f32(p); }
+  static void Store(float *p, V v) { vst1q_f32(p, v); }
+  static V Set(float v) { return vdupq_n_f32(v); }
+  static V Add(V a, V b) { return vaddq_f32(a, b); }
+  static V Sub(V a, V b) { return vsubq_f32(a, b); }
+  static V Mul(V a, V b) { return vmulq_f32(a, b); }
+  static V Min(V a, V b) { return vminq_f32(a, b); }
+  static V Max(V a, V b) { return vmaxq_f32(a, b); }
+};
+#else
+using SimdOps = ScalarOps;
+#endif
+
+// pixels [begin, end) of the vertical pass, color conversion and normalization
+template <typename Ops, bool kYuv>
+void VerticalSpan(const float *const *r0, const float *const *r1, float wy, uint32_t begin, uint32_t end,
+                  const Normalizer &norm, float *const *out) {
+  using V = typename Ops::V;
+  const V w = Ops::Set(wy);
+  const V zero = Ops::Set(0.f), max = Ops::Set(255.f);
+  V scale[kChannels], bias[kChannels];
+  for (int c = 0; c < kChannels; ++c) {
+    scale[c] = Ops::Set(norm.scale[c]);
+    bias[c] = Ops::Set(norm.bias[c]);
+  }
+  for (uint32_t i = begin; i + Ops::kWidth <= end; i += Ops::kWidth) {
+    V v[kChannels];
+    for (int c = 0; c < kChannels; ++c) {
+      const V a = Ops::Load(r0[c] + i);
+      v[c] = Ops::Add(a, Ops::Mul(Ops::Sub(Ops::Load(r1[c] + i), a), w));
+    }
+    if (kYuv) {
+      // BT.601 video range
+      const V y = Ops::Mul(Ops::Sub(v[0], Ops::Set(16.f)), Ops::Set(1.164383f));
+      const V u = Ops::Sub(v[1], Ops::Set(128.f));
+      const V cr = Ops::Sub(v[2], Ops::Set(128.f));
+      v[0] = Ops::Add(y, Ops::Mul(Ops::Set(1.596027f), cr));
+      v[1] = Ops::Sub(y, Ops::Add(Ops::Mul(Ops::Set(0.391762f), u), Ops::Mul(Ops::Set(0.812968f), cr)));
+      v[2] = Ops::Add(y, Ops::Mul(Ops::Set(2.017232f), u));
+      for (int c = 0; c < kChannels; ++c) v[c] = Ops::Min(Ops::Max(v[c], zero), max);
+    }
+    for (int c = 0; c < kChannels; ++c) Ops::Store(out[c] + i, Ops::Add(Ops::Mul(v[c], scale[c]), bias[c]));
+  }
+}
+
+// writes channel rows of normalized rgb to out[c], n pixels
+template <bool kYuv>
+void VerticalRow(const float *const *r0, const float *const *r1, float wy, uint32_t n, const Normalizer &norm,
+                 float *const *out) {
+  const uint32_t body = n / SimdOps::kWidth * SimdOps::kWidth;
+  VerticalSpan<SimdOps, kYuv>(r0, r1, wy, 0, body, norm, out);
+  VerticalSpan<ScalarOps, kYuv>(r0, r1, wy, body, n, norm, out);
+}
+
+// saturates and rounds to nearest
+void ToUint8(const float *src, uint8_t *dst, uint32_t n) {
+  uint32_t i = 0;
+#if defined(HOST_TRANSFORM_SSE2)
+  const __m128 zero = _mm_set1_ps(0.f), max = _mm_set1_ps(255.f), half = _mm_set1_ps(0.5f);
+  for (; i + 8 <= n; i += 8) {
+    __m128i lo = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), max), half));
+    __m128i hi = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), zero), max), half));
+    __m128i v = _mm_packs_epi32(lo, hi);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(v, v));
+  }
+#elif defined(HOST_TRANSFORM_NEON)
+  const float32x4_t zero = vdupq_n_f32(0.f), max = vdupq_n_f32(255.f), half = vdupq_n_f32(0.5f);
+  for (; i + 8 <= n; i += 8) {
+    uint32x4_t lo = vcvtq_u32_f32(vaddq_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), zero), max), half));
+    uint32x4_t hi = vcvtq_u32_f32(vaddq_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i + 4), zero), max), half));
+    vst1_u8(dst + i, vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi))));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = static_cast<uint8_t>(Clamp255(src[i]) + 0.5f);
+}
+
+// BT.601 video range coefficients with kCoefBits fractional bits
+constexpr int kCoefBits = 13;
+constexpr int kCy = 9539;    // 1.164383
+constexpr int kCrv = 13075;  // 1.596027
+constexpr int kCgu = 3209;   // 0.391762
+constexpr int kCgv = 6660;   // 0.812968
+constexpr int kCbu = 16525;  // 2.017232
+// rgb from fixed point yuv rows has kRowBits + kCoefBits fractional bits
+constexpr int kRgbShift = kRowBits + kCoefBits;
+
+inline uint8_t SaturateUint8(int v) { return static_cast<uint8_t>(std::min(std::max(v, 0), 255)); }
+
+// pixels [begin, n) of ConvertFixed, the simd bodies give the same results
+template <bool kYuv>
+void ConvertSpanFixed(const int16_t *const *in, uint32_t begin, uint32_t n, uint8_t *const *out) {
+  for (uint32_t i = begin; i < n; ++i) {
+    if (kYuv) {
+      const int y = in[0][i] - (16 << kRowBits), u = in[1][i] - (128 << kRowBits), cr = in[2][i] - (128 << kRowBits);
+      constexpr int kHalf = 1 << (kRgbShift - 1);
+      out[0][i] = SaturateUint8((y * kCy + cr * kCrv + kHalf) >> kRgbShift);
+      out[1][i] = SaturateUint8((y * kCy - u * kCgu - cr * kCgv + kHalf) >> kRgbShift);
+      out[2][i] = SaturateUint8((y * kCy + u * kCbu + kHalf) >> kRgbShift);
+    } else {
+      for (int c = 0; c < kChannels; ++c) out[c][i] = SaturateUint8((in[c][i] + (1 << (kRowBits - 1))) >> kRowBits);
+    }
+  }
+}
+
+/**
+ * Writes channel rows of uint8 rgb to out[c], n pixels, from rows of kRowBits fixed point. Integer arithmetic only,
+ * results are within one from the float path without normalization.
+ */
+template <bool kYuv>
+void ConvertFixed(const int16_t *const *in, uint32_t n, uint8_t *const *out) {
+  uint32_t i = 0;
+#if defined(HOST_TRANSFORM_SSE2)
+  // coefficients of (y, u) and (y, v) pairs
+  const __m128i rgb_half = _mm_set1_epi32(1 << (kRgbShift - 1));
+  const __m128i r_yv = _mm_set1_epi32((kCrv << 16) | kCy);
+  const __m128i g_yu = _mm_set1_epi32(static_cast<int>((static_cast<uint32_t>(-kCgu) << 16) | kCy));
+  const __m128i g_yv = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(-kCgv) << 16));
+  const __m128i b_yu = _mm_set1_epi32((kCbu << 16) | kCy);
+  for (; i + 8 <= n; i += 8) {
+    __m128i v[kChannels];
+    for (int c = 0; c < kChannels; ++c) v[c] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in[c] + i));
+    if (kYuv) {
+      const __m128i y = _mm_sub_epi16(v[0], _mm_set1_epi16(16 << kRowBits));
+      const __m128i u = _mm_sub_epi16(v[1], _mm_set1_epi16(128 << kRowBits));
+      const __m128i cr = _mm_sub_epi16(v[2], _mm_set1_epi16(128 << kRowBits));
+      const __m128i yu[2] = {_mm_unpacklo_epi16(y, u), _mm_unpackhi_epi16(y, u)};
+      const __m128i yv[2] = {_mm_unpacklo_epi16(y, cr), _mm_unpackhi_epi16(y, cr)};
+      __m128i rgb[kChannels][2];
+      for (int h = 0; h < 2; ++h) {
+        rgb[0][h] = _mm_madd_epi16(yv[h], r_yv);
+        rgb[1][h] = _mm_add_epi32(_mm_madd_epi16(yu[h], g_yu), _mm_madd_epi16(yv[h], g_yv));
+        rgb[2][h] = _mm_madd_epi16(yu[h], b_yu);
+      }
+      for (int c = 0; c < kChannels; ++c) {
+        const __m128i lo = _mm_srai_epi32(_mm_add_epi32(rgb[c][0], rgb_half), kRgbShift);
+        const __m128i hi = _mm_srai_epi32(_mm_add_epi32(rgb[c][1], rgb_half), kRgbShift);
+        const __m128i v16 = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out[c] + i), _mm_packus_epi16(v16, v16));
+      }
+    } else {
+      const __m128i half = _mm_set1_epi16(1 << (kRowBits - 1));
+      for (int c = 0; c < kChannels; ++c) {
+        const __m128i v16 = _mm_srai_epi16(_mm_add_epi16(v[c], half), kRowBits);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out[c] + i), _mm_packus_epi16(v16, v16));
+      }
+    }
+  }
+#elif defined(HOST_TRANSFORM_NEON)
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v[kChannels];
+    for (int c = 0; c < kChannels; ++c) v[c] = vld1q_s16(in[c] + i);
+    if (kYuv) {
+      const int16x8_t y = vsubq_s16(v[0], vdupq_n_s16(16 << kRowBits));
+      const int16x8_t u = vsubq_s16(v[1], vdupq_n_s16(128 << kRowBits));
+      const int16x8_t cr = vsubq_s16(v[2], vdupq_n_s16(128 << kRowBits));
+      const int16x4_t ys[2] = {vget_low_s16(y), vget_high_s16(y)};
+      const int16x4_t us[2] = {vget_low_s16(u), vget_high_s16(u)};
+      const int16x4_t vs[2] = {vget_low_s16(cr), vget_high_s16(cr)};
+      const int32x4_t rgb_half = vdupq_n_s32(1 << (kRgbShift - 1));
+      int16x4_t rgb[kChannels][2];
+      for (int h = 0; h < 2; ++h) {
+        const int32x4_t luma = vmlal_n_s16(rgb_half, ys[h], kCy);
+        const int32x4_t r = vmlal_n_s16(luma, vs[h], kCrv);
+        const int32x4_t g = vmlsl_n_s16(vmlsl_n_s16(luma, us[h], kCgu), vs[h], kCgv);
+        const int32x4_t b = vmlal_n_s16(luma, us[h], kCbu);
+        rgb[0][h] = vqmovn_s32(vshrq_n_s32(r, kRgbShift));
+        rgb[1][h] = vqmovn_s32(vshrq_n_s32(g, kRgbShift));
+        rgb[2][h] = vqmovn_s32(vshrq_n_s32(b, kRgbShift));
+      }
+      for (int c = 0; c < kChannels; ++c) vst1_u8(out[c] + i, vqmovun_s16(vcombine_s16(rgb[c][0], rgb[c][1])));
+    } else {
+      for (int c = 0; c < kChannels; ++c) vst1_u8(out[c] + i, vqrshrun_n_s16(v[c], kRowBits));
+    }
+  }
+#endif
+  ConvertSpanFixed<kYuv>(in, i, n, out);
+}
+
+template <typename T>
+void Interleave(const T *const *src, T *dst, uint32_t n) {
+  const T *s0 = src[0], *s1 = src[1], *s2 = src[2];
+  for (uint32_t i = 0; i < n; ++i) {
+    dst[i * kChannels] = s0[i];
+    dst[i * kChannels + 1] = s1[i];
+    dst[i * kChannels + 2] = s2[i];
+  }
+}
+
+// a value of normalized output in output data type, zero_point is added to quantized output
+template <typename T>
+T FromFloat(float v, int zero_point);
+template <>
+uint8_t FromFloat<uint8_t>(float v, int) { return static_cast<uint8_t>(Clamp255(v) + 0.5f); }
+template <>
+float FromFloat<float>(float v, int) { return v; }
+template <>
+uint16_t FromFloat<uint16_t>(float v, int) { return infer_server::detail::FloatToHalf(v); }
+
+// values beyond this never fit in int16 after the zero point is added, they are clamped before conversion to int32
+constexpr float kQuantLimit = 65536.f;
+
+// round(v) + zero_point, rounded to nearest even and saturated as the simd conversion does, NaN goes to the minimum
+template <typename Q>
+Q SaturateRound(float v, int zero_point) {
+  v = v > -kQuantLimit ? v : -kQuantLimit;
+  v = v < kQuantLimit ? v : kQuantLimit;
+  const int q = static_cast<int>(std::nearbyint(v)) + zero_point;
+  return static_cast<Q>(std::min<int>(std::max<int>(q, std::numeric_limits<Q>::min()), std::numeric_limits<Q>::max()));
+}
+template <>
+int8_t FromFloat<int8_t>(float v, int zero_point) { return SaturateRound<int8_t>(v, zero_point); }
+template <>
+int16_t FromFloat<int16_t>(float v, int zero_point) { return SaturateRound<int16_t>(v, zero_point); }
+
+// int8 / int16 from float in units of quantization scale, rounds to nearest even, adds zero point and saturates
+template <typename Q>
+void Quantize(const float *src, Q *dst, uint32_t n, int zero_point) {
+  uint32_t i = 0;
+#if defined(HOST_TRANSFORM_SSE2)
+  // the default rounding mode of conversion is to nearest even, packs saturate
+  const __m128 lo = _mm_set1_ps(-kQuantLimit), hi = _mm_set1_ps(kQuantLimit);
+  const __m128i zp = _mm_set1_epi32(zero_point);
+  for (; i + 8 <= n; i += 8) {
+    const __m128i a = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi));
+    const __m128i b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi));
+    const __m128i v = _mm_packs_epi32(_mm_add_epi32(a, zp), _mm_add_epi32(b, zp));
+    if (sizeof(Q) == 1) {
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi16(v, v));
+    } else {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+    }
+  }
+#elif defined(HOST_TRANSFORM_NEON)
+  const float32x4_t lo = vdupq_n_f32(-kQuantLimit), hi = vdupq_n_f32(kQuantLimit);
+  const int32x4_t zp = vdupq_n_s32(zero_point);
+  for (; i + 8 <= n; i += 8) {
+    const int32x4_t a = vaddq_s32(vcvtnq_s32_f32(vminq_f32(vmaxnmq_f32(vld1q_f32(src + i), lo), hi)), zp);
+    const int32x4_t b = vaddq_s32(vcvtnq_s32_f32(vminq_f32(vmaxnmq_f32(vld1q_f32(src + i + 4), lo), hi)), zp);
+    const int16x8_t v = vcombine_s16(vqmovn_s32(a), vqmovn_s32(b));
+    if (sizeof(Q) == 1) {
+      vst1_s8(reinterpret_cast<int8_t *>(dst + i), vqmovn_s16(v));
+    } else {
+      vst1q_s16(reinterpret_cast<int16_t *>(dst + i), v);
+    }
+  }
+#endif
+  for (; i < n; ++i) dst[i] = SaturateRound<Q>(src[i], zero_point);
+}
+
+// quantizes channel rows in to planes, or to channel rows in aux interleaved at base
+template <bool kPlanar, typename Q>
+void QuantizeRows(const float *const *in, uint32_t n, const int *zero_point, Q *base, Q *const *planes, void *aux) {
+  Q *rows[kChannels];
+  for (int k = 0; k < kChannels; ++k) {
+    rows[k] = kPlanar ? planes[k] : static_cast<Q *>(aux) + k * n;
+    Quantize(in[k], rows[k], n, zero_point[k]);
+  }
+  if (!kPlanar) Interleave<Q>(rows, base, n);
+}
+
+// rows [row_begin, row_end) of the resized roi of a job, the unit of work of a thread
+struct HostRoiTile {
+  const HostRoiJob *job;
+  uint32_t row_begin;
+  uint32_t row_end;
+  // first source row read by the tile, tiles are run in this order
+  uint32_t src_top;
+};
+
+// crop-resize of rows [row_begin, row_end) of one roi, destination rows are written in order and read source rows
+// in increasing order. Rows are counted in the resized roi, padding above it goes with the first tile and padding
+// below it with the last one. R is float, or int16_t for fixed point arithmetic of uint8 output without
+// normalization. The float path interpolates each source row horizontally first, the fixed point one blends two
+// source rows first and resamples the result, the cheap vertical pass is done by simd on the wider rows.
+template <typename T, bool kPlanar, typename Source, typename R>
+class RoiResizer {
+ public:
+  RoiResizer(const Source &src, const HostTensorDesc &desc, const Normalizer &norm, const HostRoiTile &tile)
+      : src_(src), desc_(desc), norm_(norm), dst_(tile.job->dst), frame_(tile.job->dst_roi),
+        roi_(tile.job->dst_roi), letterbox_(tile.job->pad_value != nullptr), left_(tile.job->src_roi.left),
+        top_(tile.job->src_roi.top), src_width_(tile.job->src_roi.width), end_(tile.row_end), dy_(tile.row_begin) {
+    const HostRoiJob &job = *tile.job;
+    if (letterbox_) {
+      roi_ = LetterboxRect(job.src_roi.width, job.src_roi.height, frame_);
+      // padding is a pixel value, normalized as the others
+      for (int c = 0; c < kChannels; ++c) {
+        const int k = norm_.offset[c];
+        pad_[k] = FromFloat<T>(job.pad_value[k] * norm_.scale[c] + norm_.bias[c], norm_.zero_point[k]);
+      }
+    }
+    top_done_ = dy_ != 0;
+    bottom_done_ = end_ != roi_.height;
+    // coordinates are computed once, rows and columns are reused by every pixel. Those of a row do not depend on
+    // the tile it belongs to, so tiles give the same result as a whole roi
+    xs_table_ = GetCoords(job.src_roi.width, roi_.width);
+    ys_table_ = GetCoords(job.src_roi.height, roi_.height);
+    xs_ = xs_table_->data();
+    ys_ = ys_table_->data();
+    // float: horizontal results of the two source rows in use. Fixed point: resampled channels and a blended row,
+    // padding after the blended row is read with zero weight and must be defined
+    const size_t blended_size = kFixed ? Source::BlendedSize(job.src_roi.width) : roi_.width * kChannels;
+    rows_buffer_.assign(roi_.width * kChannels + blended_size, R(0));
+    for (int c = 0; c < kChannels; ++c) {
+      rows_[0][c] = rows_buffer_.data() + c * roi_.width;
+      rows_[1][c] = rows_buffer_.data() + (kChannels + c) * roi_.width;
+    }
+    if (kFixed) ComputeFixedCoords(xs_, roi_.width, left_, &fixed_xs_);
+  }
+
+  bool Done() const { return dy_ == end_ && bottom_done_; }
+  // the last source row needed by the next destination row
+  int NextRow() const { return top_ + ys_[dy_].i1; }
+  uint32_t Width() const { return roi_.width; }
+
+  /**
+   * Writes destination rows until the next one needs a source row at or after row_end. scratch holds
+   * kScratchRows rows of roi width, it is used within a row only and may be shared by resizers.
+   */
+  void Run(int row_end, float *scratch);
+
+  static constexpr uint32_t kScratchRows = 2 * kChannels;
+
+ private:
+  static constexpr bool kFixed = std::is_same<R, int16_t>::value;
+
+  // interpolation, color conversion and normalization of a destination row at base, channels at planes
+  void ResizeRow(const Coord &c, T *base, T *const *planes, float *scratch, std::false_type /* fixed */);
+  void ResizeRow(const Coord &c, T *base, T *const *planes, float *scratch, std::true_type /* fixed */);
+  T *Row(uint32_t y, int plane) {
+    if (kPlanar) return static_cast<T *>(dst_) + (plane * desc_.height + y) * static_cast<size_t>(desc_.width);
+    const size_t pitch = desc_.pitch ? desc_.pitch : desc_.width * kChannels * sizeof(T);
+    return reinterpret_cast<T *>(static_cast<uint8_t *>(dst_) + y * pitch);
+  }
+  // fills pixels [x0, x1) of row y with padding
+  void FillPad(uint32_t y, uint32_t x0, uint32_t x1) {
+    if (x0 >= x1) return;
+    if (kPlanar) {
+      for (int k = 0; k < kChannels; ++k) std::fill(Row(y, k) + x0, Row(y, k) + x1, pad_[k]);
+      return;
+    }
+    // the first pixel is doubled until the span is filled
+    T *px = Row(y, 0) + x0 * kChannels;
+    const size_t total = (x1 - x0) * kChannels;
+    for (int k = 0; k < kChannels; ++k) px[k] = pad_[k];
+    for (size_t done = kChannels; done < total; done *= 2) {
+      memcpy(px + done, px, std::min(done, total - done) * sizeof(T));
+    }
+  }
+  // fills rows [y0, y1) of the destination rect, the first one is copied to the others
+  void FillPadRows(uint32_t y0, uint32_t y1) {
+    if (y0 >= y1) return;
+    FillPad(y0, frame_.left, frame_.left + frame_.width);
+    const size_t offset = kPlanar ? frame_.left : frame_.left * kChannels;
+    const size_t bytes = (kPlanar ? frame_.width : frame_.width * kChannels) * sizeof(T);
+    for (int k = 0; k < (kPlanar ? kChannels : 1); ++k) {
+      for (uint32_t y = y0 + 1; y < y1; ++y) memcpy(Row(y, k) + offset, Row(y0, k) + offset, bytes);
+    }
+  }
+
+  const Source &src_;
+  const HostTensorDesc &desc_;
+  const Normalizer &norm_;
+  void *dst_;
+  // destination rect, and the part of it the roi is resized into
+  CnedkTransformRect frame_;
+  CnedkTransformRect roi_;
+  bool letterbox_;
+  T pad_[kChannels];
+  bool top_done_;
+  bool bottom_done_;
+  // origin of source roi, coordinates are relative to it
+  int left_;
+  int top_;
+  uint32_t src_width_;
+  CoordTable xs_table_, ys_table_;
+  const Coord *xs_, *ys_;
+  FixedCoords fixed_xs_;
+  std::vector<R> rows_buffer_;
+  R *rows_[2][kChannels];
+  int slot0_ = 0, slot1_ = 1;
+  int cached_[2] = {-1, -1};
+  // end of the rows of the tile, and the next one to write
+  uint32_t end_;
+  uint32_t dy_;
+};
+
+template <typename T, bool kPlanar, typename Source, typename R>
+void RoiResizer<T, kPlanar, Source, R>::Run(int row_end, float *scratch) {
+  const size_t plane_size = static_cast<size_t>(desc_.width) * desc_.height;
+  const size_t pitch = desc_.pitch ? desc_.pitch : desc_.width * kChannels * sizeof(T);
+
+  // padding bands are written with the rows next to them, no pixel is written twice
+  if (!top_done_) {
+    if (letterbox_) FillPadRows(frame_.top, roi_.top);
+    top_done_ = true;
+  }
+  for (; dy_ < end_ && top_ + ys_[dy_].i1 < row_end; ++dy_) {
+    const size_t y = roi_.top + dy_;
+    if (letterbox_) {
+      FillPad(y, frame_.left, roi_.left);
+      FillPad(y, roi_.left + roi_.width, frame_.left + frame_.width);
+    }
+    T *base = kPlanar ? static_cast<T *>(dst_) + y * desc_.width + roi_.left
+                      : reinterpret_cast<T *>(static_cast<uint8_t *>(dst_) + y * pitch) + roi_.left * kChannels;
+    T *planes[kChannels];
+    for (int k = 0; k < kChannels; ++k) planes[k] = kPlanar ? base + k * plane_size : base;
+    ResizeRow(ys_[dy_], base, planes, scratch, std::integral_constant<bool, kFixed>());
+  }
+  if (dy_ == end_ && !bottom_done_) {
+    if (letterbox_) FillPadRows(roi_.top + roi_.height, frame_.top + frame_.height);
+    bottom_done_ = true;
+  }
+}
+
+template <typename T, bool kPlanar, typename Source, typename R>
+void RoiResizer<T, kPlanar, Source, R>::ResizeRow(const Coord &c, T *base, T *const *planes, float *scratch,
+                                                  std::false_type) {
+  using infer_server::DataType;
+  using infer_server::detail::CastHost;
+  const uint32_t n = roi_.width;
+  const int i0 = top_ + c.i0, i1 = top_ + c.i1;
+  // source rows are shared by adjacent destination rows, each one is interpolated horizontally once
+  if (cached_[slot0_] != i0) {
+    if (cached_[slot1_] == i0) {
+      std::swap(slot0_, slot1_);
+    } else {
+      src_.Horizontal(i0, left_, xs_, n, rows_[slot0_]);
+      cached_[slot0_] = i0;
+    }
+  }
+  if (cached_[slot1_] != i1) {
+    src_.Horizontal(i1, left_, xs_, n, rows_[slot1_]);
+    cached_[slot1_] = i1;
+  }
+  const float *const *r0 = rows_[slot0_], *const *r1 = rows_[slot1_];
+  // planar float is written in place, the others go through channel rows of float
+  constexpr bool kInPlace = kPlanar && std::is_same<T, float>::value;
+
+  // normalized channel rows and a row for layout / type change
+  float *channels[kChannels];
+  for (int k = 0; k < kChannels; ++k) channels[k] = scratch + k * n;
+  float *aux = scratch + kChannels * n;
+
+  // rows of output channels, and the same rows in rgb order
+  float *out[kChannels], *rgb_out[kChannels];
+  for (int k = 0; k < kChannels; ++k) out[k] = kInPlace ? reinterpret_cast<float *>(planes[k]) : channels[k];
+  for (int ch = 0; ch < kChannels; ++ch) rgb_out[ch] = out[norm_.offset[ch]];
+  VerticalRow<Source::kYuv>(r0, r1, c.w, n, norm_, rgb_out);
+  if (kInPlace) return;
+
+  if (std::is_same<T, uint8_t>::value) {
+    uint8_t *bytes = reinterpret_cast<uint8_t *>(aux);
+    uint8_t *u8[kChannels];
+    for (int k = 0; k < kChannels; ++k) {
+      u8[k] = kPlanar ? reinterpret_cast<uint8_t *>(planes[k]) : bytes + k * n;
+      ToUint8(out[k], u8[k], n);
+    }
+    if (!kPlanar) Interleave<uint8_t>(u8, reinterpret_cast<uint8_t *>(base), n);
+  } else if (std::is_same<T, float>::value) {
+    Interleave<float>(out, reinterpret_cast<float *>(base), n);
+  } else if (std::is_same<T, int8_t>::value) {
+    QuantizeRows<kPlanar>(out, n, norm_.zero_point, reinterpret_cast<int8_t *>(base),
+                          reinterpret_cast<int8_t *const *>(planes), aux);
+  } else if (std::is_same<T, int16_t>::value) {
+    QuantizeRows<kPlanar>(out, n, norm_.zero_point, reinterpret_cast<int16_t *>(base),
+                          reinterpret_cast<int16_t *const *>(planes), aux);
+  } else if (kPlanar) {
+    for (int k = 0; k < kChannels; ++k) {
+      CastHost(out[k], planes[k], DataType::FLOAT32, DataType::FLOAT16, n);
+    }
+  } else {
+    Interleave<float>(out, aux, n);
+    CastHost(aux, base, DataType::FLOAT32, DataType::FLOAT16, n * kChannels);
+  }
+}
+
+template <typename T, bool kPlanar, typename Source, typename R>
+void RoiResizer<T, kPlanar, Source, R>::ResizeRow(const Coord &c, T *base, T *const *planes, float *scratch,
+                                                  std::true_type) {
+  const uint32_t n = roi_.width;
+  int16_t *blended = reinterpret_cast<int16_t *>(rows_buffer_.data()) + kChannels * n;
+  int16_t *const *channels = reinterpret_cast<int16_t *const *>(rows_[0]);
+  src_.Blend(top_ + c.i0, top_ + c.i1, c.fw, left_, src_width_, blended);
+  src_.Resample(blended, src_width_, fixed_xs_, n, channels);
+
+  // planar output is written in place, packed output goes through channel rows
+  uint8_t *bytes = reinterpret_cast<uint8_t *>(scratch);
+  uint8_t *u8[kChannels], *rgb_u8[kChannels];
+  for (int k = 0; k < kChannels; ++k) u8[k] = kPlanar ? reinterpret_cast<uint8_t *>(planes[k]) : bytes + k * n;
+  for (int ch = 0; ch < kChannels; ++ch) rgb_u8[ch] = u8[norm_.offset[ch]];
+  ConvertFixed<Source::kYuv>(channels, n, rgb_u8);
+  if (!kPlanar) Interleave<uint8_t>(u8, reinterpret_cast<uint8_t *>(base), n);
+}
+
+// source rows consumed by every roi before moving on, a band of a 1080p NV12 frame is about 45KB
+constexpr int kBandRows = 16;
+
+template <typename T, bool kPlanar, typename Source, typename R = float>
+void ResizeConvert(const Source &src, const HostRoiTile *tiles, uint32_t num, const HostTensorDesc &desc,
+                   const Normalizer &norm) {
+  using Resizer = RoiResizer<T, kPlanar, Source, R>;
+  std::vector<std::unique_ptr<Resizer>> resizers;
+  resizers.reserve(num);
+  uint32_t max_width = 0;
+  int row_end = std::numeric_limits<int>::max();
+  for (uint32_t i = 0; i < num; ++i) {
+    resizers.emplace_back(new Resizer(src, desc, norm, tiles[i]));
+    max_width = std::max(max_width, resizers.back()->Width());
+    row_end = std::min(row_end, resizers.back()->NextRow());
+  }
+  std::vector<float> scratch(max_width * Resizer::kScratchRows);
+
+  // sweeps the source in bands, each band is read from memory once and used by all rois covering it
+  for (bool done = false; !done;) {
+    done = true;
+    row_end += kBandRows;
+    for (auto &resizer : resizers) {
+      if (resizer->Done()) continue;
+      if (resizer->NextRow() < row_end) resizer->Run(row_end, scratch.data());
+      done = done && resizer->Done();
+    }
+  }
+}
+
+template <typename Source>
+void Dispatch(const Source &src, const HostRoiTile *tiles, uint32_t num, const HostTensorDesc &desc,
+              const Normalizer &norm) {
+  switch (desc.data_type) {
+    case CNEDK_TRANSFORM_UINT8:
+      // 8 bit in and out, integer arithmetic is enough unless values are normalized
+      if (norm.IsIdentity()) {
+        desc.planar ? ResizeConvert<uint8_t, true, Source, int16_t>(src, tiles, num, desc, norm)
+                    : ResizeConvert<uint8_t, false, Source, int16_t>(src, tiles, num, desc, norm);
+      } else {
+        desc.planar ? ResizeConvert<uint8_t, true>(src, tiles, num, desc, norm)
+                    : ResizeConvert<uint8_t, false>(src, tiles, num, desc, norm);
+      }
+      break;
+    case CNEDK_TRANSFORM_FLOAT32:
+      desc.planar ? ResizeConvert<float, true>(src, tiles, num, desc, norm)
+                  : ResizeConvert<float, false>(src, tiles, num, desc, norm);
+      break;
+    case CNEDK_TRANSFORM_INT8:
+      desc.planar ? ResizeConvert<int8_t, true>(src, tiles, num, desc, norm)
+                  : ResizeConvert<int8_t, false>(src, tiles, num, desc, norm);
+      break;
+    case CNEDK_TRANSFORM_INT16:
+      desc.planar ? ResizeConvert<int16_t, true>(src, tiles, num, desc, norm)
+                  : ResizeConvert<int16_t, false>(src, tiles, num, desc, norm);
+      break;
+    default:
+      desc.planar ? ResizeConvert<uint16_t, true>(src, tiles, num, desc, norm)
+                  : ResizeConvert<uint16_t, false>(src, tiles, num, desc, norm);
+      break;
+  }
+}
+
+void DispatchSource(const CnedkBufSurfaceParams &src, const void *src_data, const HostRoiTile *tiles,
+                    uint32_t num, const HostTensorDesc &desc, const Normalizer &norm) {
+  if (src.color_format == CNEDK_BUF_COLOR_FORMAT_NV12 || src.color_format == CNEDK_BUF_COLOR_FORMAT_NV21) {
+    Dispatch(YuvSource(src, src_data), tiles, num, desc, norm);
+  } else if (src.color_format == CNEDK_BUF_COLOR_FORMAT_GRAY8) {
+    Dispatch(GraySource(src, src_data), tiles, num, desc, norm);
+  } else {
+    Dispatch(PackedSource(src, src_data), tiles, num, desc, norm);
+  }
+}
+
+bool IsInside(const CnedkTransformRect &rect, uint32_t width, uint32_t height) {
+  return rect.width && rect.height && rect.left + rect.width <= width && rect.top + rect.height <= height;
+}
+
+// output pixels of a tile, about 200KB of uint8 rgb. Smaller tiles balance better, and cost more source rows read
+// twice at their borders
+constexpr uint32_t kDefaultGrainSize = 65536;
+std::atomic<uint32_t> g_grain_size{kDefaultGrainSize};
+
+// splits the rows of each job into tiles of about target pixels
+std::vector<HostRoiTile> MakeTiles(const HostRoiJob *jobs, uint32_t num, uint64_t target) {
+  std::vector<HostRoiTile> tiles;
+  tiles.reserve(num);
+  for (uint32_t i = 0; i < num; ++i) {
+    const HostRoiJob &job = jobs[i];
+    const CnedkTransformRect roi =
+        job.pad_value ? LetterboxRect(job.src_roi.width, job.src_roi.height, job.dst_roi) : job.dst_roi;
+    const uint64_t pixels = static_cast<uint64_t>(roi.width) * roi.height;
+    const uint32_t count =
+        static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(roi.height, (pixels + target / 2) / target)));
+    for (uint32_t t = 0; t < count; ++t) {
+      const uint32_t begin = static_cast<uint64_t>(roi.height) * t / count;
+      const uint32_t end = static_cast<uint64_t>(roi.height) * (t + 1) / count;
+      const uint32_t src_top = job.src_roi.top + (*GetCoords(job.src_roi.height, roi.height))[begin].i0;
+      tiles.push_back(HostRoiTile{&job, begin, end, src_top});
+    }
+  }
+  return tiles;
+}
+
+uint64_t TilePixels(const HostRoiTile &tile) {
+  // padding of a letterbox is cheap, it is not counted
+  const CnedkTransformRect &frame = tile.job->dst_roi;
+  const uint32_t width = tile.job->pad_value
+                             ? LetterboxRect(tile.job->src_roi.width, tile.job->src_roi.height, frame).width
+                             : frame.width;
+  return static_cast<uint64_t>(width) * (tile.row_end - tile.row_begin);
+}
+
+}  // namespace
+
+int HostResizeConvert(const CnedkBufSurfaceParams &src, const void *src_data, const CnedkTransformRect &src_roi,
+                      void *dst, const HostTensorDesc &dst_desc, const CnedkTransformRect &dst_roi,
+                      const CnedkTransformMeanStdParams *mean_std) {
+  HostRoiJob job{src_roi, dst, dst_roi, nullptr};
+  return HostResizeConvertRois(src, src_data, &job, 1, dst_desc, mean_std);
+}
+
+int HostResizeConvertRois(const CnedkBufSurfaceParams &src, const void *src_data, const HostRoiJob *jobs,
+                          uint32_t num, const HostTensorDesc &dst_desc, const CnedkTransformMeanStdParams *mean_std) {
+  if (!src_data || (num && !jobs)) {
+    LOG(ERROR) << "[EasyDK] HostResizeConvertRois(): src data or jobs is nullptr";
+    return -1;
+  }
+  for (uint32_t i = 0; i < num; ++i) {
+    if (!jobs[i].dst) {
+      LOG(ERROR) << "[EasyDK] HostResizeConvertRois(): dst data is nullptr, index = " << i;
+      return -1;
+    }
+    if (!IsInside(jobs[i].src_roi, src.width, src.height) ||
+        !IsInside(jobs[i].dst_roi, dst_desc.width, dst_desc.height)) {
+      LOG(ERROR) << "[EasyDK] HostResizeConvertRois(): Invalid src or dst rect, index = " << i;
+      return -1;
+    }
+  }
+  if (dst_desc.color_format != CNEDK_BUF_COLOR_FORMAT_RGB && dst_desc.color_format != CNEDK_BUF_COLOR_FORMAT_BGR) {
+    LOG(ERROR) << "[EasyDK] HostResizeConvertRois(): Unsupported dst color format: " << dst_desc.color_format;
+    return -1;
+  }
+  const bool quantized = dst_desc.data_type == CNEDK_TRANSFORM_INT8 || dst_desc.data_type == CNEDK_TRANSFORM_INT16;
+  if (dst_desc.data_type != CNEDK_TRANSFORM_UINT8 && dst_desc.data_type != CNEDK_TRANSFORM_FLOAT32 &&
+      dst_desc.data_type != CNEDK_TRANSFORM_FLOAT16 && !quantized) {
+    LOG(ERROR) << "[EasyDK] HostResizeConvertRois(): Unsupported data type: " << dst_desc.data_type;
+    return -1;
+  }
+  for (int c = 0; quantized && c < kChannels; ++c) {
+    if (!(dst_desc.quant_scale[c] > 0.f) || std::isinf(dst_desc.quant_scale[c])) {
+      LOG(ERROR) << "[EasyDK] HostResizeConvertRois(): Invalid quantization scale: " << dst_desc.quant_scale[c];
+      return -1;
+    }
+  }
+  if (src.color_format != CNEDK_BUF_COLOR_FORMAT_NV12 && src.color_format != CNEDK_BUF_COLOR_FORMAT_NV21 &&
+      src.color_format != CNEDK_BUF_COLOR_FORMAT_RGB && src.color_format != CNEDK_BUF_COLOR_FORMAT_BGR &&
+      src.color_format != CNEDK_BUF_COLOR_FORMAT_GRAY8) {
+    LOG(ERROR) << "[EasyDK] HostResizeConvertRois(): Unsupported src color format: " << src.color_format;
+    return -1;
+  }
+
+  // mean and std are given in output channel order
+  Normalizer norm;
+  for (int c = 0; c < kChannels; ++c) {
+    const int k = dst_desc.color_format == CNEDK_BUF_COLOR_FORMAT_RGB ? c : kChannels - 1 - c;
+    norm.offset[c] = k;
+    norm.scale[c] = mean_std ? 1.f / mean_std->std[k] : 1.f;
+    norm.bias[c] = mean_std ? -mean_std->mean[k] / mean_std->std[k] : 0.f;
+    // the scale of quantization is fused into normalization, the zero point is added after rounding
+    if (quantized) {
+      norm.scale[c] /= dst_desc.quant_scale[k];
+      norm.bias[c] /= dst_desc.quant_scale[k];
+    }
+    norm.zero_point[c] = quantized ? dst_desc.quant_zero_point[c] : 0;
+  }
+
+  // small work is not worth waking threads, it runs at once in the calling thread
+  HostWorkerPool &pool = HostWorkerPool::Instance();
+  const uint64_t grain = g_grain_size.load();
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < num; ++i) total += static_cast<uint64_t>(jobs[i].dst_roi.width) * jobs[i].dst_roi.height;
+  const uint32_t threads = static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(pool.Concurrency(),
+                                                                                          total / grain)));
+
+  // tiles from top to bottom, so that each thread sweeps a horizontal stripe of the source. Tiles of one roi share
+  // no output row and interpolate their own source rows (chroma rows of YUV as well), so the output does not
+  // depend on where the rows are split
+  std::vector<HostRoiTile> tiles = MakeTiles(jobs, num, threads == 1 ? total + 1 : grain);
+  std::stable_sort(tiles.begin(), tiles.end(),
+                   [](const HostRoiTile &a, const HostRoiTile &b) { return a.src_top < b.src_top; });
+  if (threads == 1) {
+    DispatchSource(src, src_data, tiles.data(), tiles.size(), dst_desc, norm);
+    return 0;
+  }
+
+  // stripes of about the same number of output pixels
+  uint64_t tile_total = 0;
+  for (const HostRoiTile &tile : tiles) tile_total += TilePixels(tile);
+  std::vector<uint32_t> stripes(1, 0);
+  uint64_t acc = 0;
+  for (uint32_t i = 0; i < tiles.size(); ++i) {
+    acc += TilePixels(tiles[i]);
+    if (acc * threads >= tile_total * stripes.size() && i + 1 < tiles.size()) stripes.push_back(i + 1);
+  }
+  stripes.push_back(tiles.size());
+  pool.ParallelFor(stripes.size() - 1, [&](uint32_t i) {
+    DispatchSource(src, src_data, tiles.data() + stripes[i], stripes[i + 1] - stripes[i], dst_desc, norm);
+  });
+  return 0;
+}
+
+void SetHostTransformParams(const CnedkTransformHostParams &params) {
+  HostWorkerPool::Instance().SetConcurrency(params.num_threads ? params.num_threads
+                                                               : HostWorkerPool::DefaultConcurrency());
+  g_grain_size.store(params.grain_size ? params.grain_size : kDefaultGrainSize);
+}
+
+CnedkTransformHostParams GetHostTransformParams() {
+  CnedkTransformHostParams params;
+  params.num_threads = HostWorkerPool::Instance().Concurrency();
+  params.grain_size = g_grain_size.load();
+  return params;
+}
+
+namespace {
+
+CnedkBufSurfaceColorFormat GetColorFormatFromTensor(CnedkTransformColorFormat format) {
+  switch (format) {
+    case CNEDK_TRANSFORM_COLOR_FORMAT_RGB:
+      return CNEDK_BUF_COLOR_FORMAT_RGB;
+    case CNEDK_TRANSFORM_COLOR_FORMAT_BGR:
+      return CNEDK_BUF_COLOR_FORMAT_BGR;
+    default:
+      return CNEDK_BUF_COLOR_FORMAT_LAST;
+  }
+}
+
+// same validation as the device path, out of range left/top fall back to 0, zero width/height to the rest
+CnedkTransformRect GetRect(const CnedkTransformRect *rect, uint32_t width, uint32_t height) {
+  CnedkTransformRect res{0, 0, width, height};
+  if (!rect) return res;
+  res.left = rect->left >= width ? 0 : rect->left;
+  res.top = rect->top >= height ? 0 : rect->top;
+  res.width = rect->width == 0 ? width - res.left : rect->width;
+  res.height = rect->height == 0 ? height - res.top : rect->height;
+  return res;
+}
+
+bool IsSameImage(const CnedkBufSurfaceParams &a, const CnedkBufSurfaceParams &b) {
+  return a.data_ptr == b.data_ptr && a.color_format == b.color_format && a.width == b.width && a.height == b.height;
+}
+
+bool IsSameDesc(const HostTensorDesc &a, const HostTensorDesc &b) {
+  return a.width == b.width && a.height == b.height && a.color_format == b.color_format && a.pitch == b.pitch;
+}
+
+}  // namespace
+
+int TransformerHost::Transform(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTransformParams *transform_params) {
+  if (src->batch_size > dst->batch_size) {
+    LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): The number of inputs exceeds batch size: "
+               << src->batch_size << " v.s. " << dst->batch_size;
+    return -1;
+  }
+
+  const uint32_t flag = transform_params->transform_flag;
+  const bool is_tensor = dst->surface_list[0].color_format == CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  HostTensorDesc desc;
+  if (is_tensor) {
+    const CnedkTransformTensorDesc *tensor = transform_params->dst_desc;
+    if (!tensor || tensor->shape.c != kChannels) {
+      LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): dst_desc of tensor must be set with 3 channels";
+      return -1;
+    }
+    desc.width = tensor->shape.w;
+    desc.height = tensor->shape.h;
+    desc.color_format = GetColorFormatFromTensor(tensor->color_format);
+    desc.data_type = tensor->data_type;
+  } else if (flag & CNEDK_TRANSFORM_MEAN_STD) {
+    LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): MeanStd is supported only by tensor output";
+    return -1;
+  }
+  if ((flag & CNEDK_TRANSFORM_MEAN_STD) && !transform_params->mean_std_params) {
+    LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): Mean std parameter is not set";
+    return -1;
+  }
+  const CnedkTransformMeanStdParams *mean_std =
+      (flag & CNEDK_TRANSFORM_MEAN_STD) ? transform_params->mean_std_params : nullptr;
+
+  static const uint8_t kZeroPad[CNEDK_TRANSFORM_MAX_CHNS] = {0};
+  const uint8_t *pad_value = nullptr;
+  if (flag & CNEDK_TRANSFORM_LETTERBOX) {
+    pad_value = transform_params->letterbox_params ? transform_params->letterbox_params->pad_value : kZeroPad;
+  }
+
+  std::vector<HostTensorDesc> descs(src->batch_size, desc);
+  std::vector<HostRoiJob> jobs(src->batch_size);
+  for (uint32_t i = 0; i < src->batch_size; ++i) {
+    const CnedkBufSurfaceParams &src_params = src->surface_list[i];
+    const CnedkBufSurfaceParams &dst_params = dst->surface_list[i];
+    if (!is_tensor) {
+      descs[i].width = dst_params.width;
+      descs[i].height = dst_params.height;
+      descs[i].color_format = dst_params.color_format;
+      descs[i].pitch = dst_params.plane_params.pitch[0];
+    }
+    jobs[i].src_roi = GetRect((flag & CNEDK_TRANSFORM_CROP_SRC) ? &transform_params->src_rect[i] : nullptr,
+                              src_params.width, src_params.height);
+    jobs[i].dst = dst_params.data_ptr;
+    jobs[i].dst_roi = GetRect((flag & CNEDK_TRANSFORM_CROP_DST) ? &transform_params->dst_rect[i] : nullptr,
+                              descs[i].width, descs[i].height);
+    jobs[i].pad_value = pad_value;
+  }
+
+  // items cropped from the same source image are resized together, so that the source is read once
+  std::vector<bool> grouped(src->batch_size, false);
+  std::vector<HostRoiJob> group;
+  for (uint32_t i = 0; i < src->batch_size; ++i) {
+    if (grouped[i]) continue;
+    const CnedkBufSurfaceParams &src_params = src->surface_list[i];
+    group.assign(1, jobs[i]);
+    for (uint32_t j = i + 1; j < src->batch_size; ++j) {
+      if (!grouped[j] && IsSameImage(src->surface_list[j], src_params) && IsSameDesc(descs[j], descs[i])) {
+        group.push_back(jobs[j]);
+        grouped[j] = true;
+      }
+    }
+    if (HostResizeConvertRois(src_params, src_params.data_ptr, group.data(), group.size(), descs[i], mean_std) < 0) {
+      LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): Transform failed, batch_idx = " << i;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+}  // namespace cnedk
@@ -0,0 +1,133 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_TRANSFORM_IMPL_HOST_HPP_
+#define CNEDK_TRANSFORM_IMPL_HOST_HPP_
+
+#include <cstdint>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_transform.h"
+#include "cnedk_transform_impl.hpp"
+
+namespace cnedk {
+
+/**
+ * @brief Describes an image or tensor item on host written by HostResizeConvert
+ */
+struct HostTensorDesc {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  /// channel order of output, RGB or BGR
+  CnedkBufSurfaceColorFormat color_format = CNEDK_BUF_COLOR_FORMAT_RGB;
+  /// UINT8, FLOAT32, FLOAT16, INT8 or INT16
+  CnedkTransformDataType data_type = CNEDK_TRANSFORM_UINT8;
+  /**
+   * quantization of INT8 and INT16 output in output channel order, normalized values x are written as
+   * round(x / quant_scale[c]) + quant_zero_point[c], rounded to nearest even and saturated
+   */
+  float quant_scale[3] = {1.f, 1.f, 1.f};
+  int quant_zero_point[3] = {0, 0, 0};
+  /// NCHW if true, otherwise NHWC
+  bool planar = false;
+  /// bytes between rows of NHWC output, 0 for packed rows
+  uint32_t pitch = 0;
+};
+
+/**
+ * @brief Resizes, converts color, normalizes and packs an image on host in one pass
+ *
+ * Each output pixel is sampled bilinearly (pixel centers aligned) from src_roi, converted to RGB/BGR
+ * (BT.601 video range for YUV sources), normalized by (x - mean) / std if mean_std is given, quantized for integer
+ * output and written in the data type and layout of dst_desc. No intermediate image is created. Pixels outside
+ * dst_roi are not touched.
+ *
+ * @param src parameters of source item, NV12, NV21, RGB or BGR
+ * @param src_data host address of source item, planes are located by the offsets in src
+ * @param src_roi source rectangle, must be inside the source image
+ * @param dst host address of output item
+ * @param dst_desc description of output item
+ * @param dst_roi destination rectangle, must be inside the output
+ * @param mean_std mean and std of each output channel, nullptr for no normalization
+ *
+ * @return Returns 0 if succeeded, otherwise returns -1
+ */
+int HostResizeConvert(const CnedkBufSurfaceParams &src, const void *src_data, const CnedkTransformRect &src_roi,
+                      void *dst, const HostTensorDesc &dst_desc, const CnedkTransformRect &dst_roi,
+                      const CnedkTransformMeanStdParams *mean_std);
+
+/**
+ * @brief One crop-resize of HostResizeConvertRois
+ */
+struct HostRoiJob {
+  /// source rectangle, must be inside the source image
+  CnedkTransformRect src_roi;
+  /// host address of output item
+  void *dst;
+  /// destination rectangle, must be inside the output
+  CnedkTransformRect dst_roi;
+  /**
+   * padding value of each output channel for letterbox, nullptr for plain resize. If it is set, src_roi is resized
+   * into the largest rect with the same aspect ratio at the center of dst_roi, the rest of dst_roi is filled with it
+   */
+  const uint8_t *pad_value;
+};
+
+/**
+ * @brief Crops and resizes many rois of one source image on host, as HostResizeConvert does for each of them
+ *
+ * The source is swept once from top to bottom in bands of rows, every roi covering a band consumes it while the
+ * band is in cache, instead of reading the image once per roi. Large rois are split into tiles of output rows, and
+ * tiles are grouped by position into horizontal stripes run by the host worker pool (see SetHostTransformParams).
+ * Results are the same as calling HostResizeConvert for each job, whatever the number of threads.
+ *
+ * @param src parameters of source item, NV12, NV21, RGB or BGR
+ * @param src_data host address of source item, planes are located by the offsets in src
+ * @param jobs rois and outputs, outputs must not overlap
+ * @param num number of jobs
+ * @param dst_desc description of every output item
+ * @param mean_std mean and std of each output channel, nullptr for no normalization
+ *
+ * @return Returns 0 if succeeded, otherwise returns -1
+ */
+int HostResizeConvertRois(const CnedkBufSurfaceParams &src, const void *src_data, const HostRoiJob *jobs,
+                          uint32_t num, const HostTensorDesc &dst_desc, const CnedkTransformMeanStdParams *mean_std);
+
+/**
+ * @brief Sets threads and tile size of host transforms, num_threads 0 and grain_size 0 select the defaults
+ */
+void SetHostTransformParams(const CnedkTransformHostParams &params);
+
+/**
+ * @brief Gets threads and tile size of host transforms, the actual values are returned for defaults
+ */
+CnedkTransformHostParams GetHostTransformParams();
+
+/**
+ * @brief Transformer of surfaces in host memory (system and pinned), running on CPU
+ */
+class TransformerHost : public ITransformer {
+ public:
+  int Transform(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTransformParams *transform_params) override;
+};
+
+}  // namespace cnedk
+
+#endif  // CNEDK_TRANSFORM_IMPL_HOST_HPP_
@@ -0,0 +1,296 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "host_staging_pool.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "cnrt.h"
+
+#include "utils.hpp"
+
+namespace cnedk {
+
+// constexpr is not inline in C++11
+constexpr size_t HostStagingPool::kMinCapacity;
+constexpr size_t HostStagingPool::kDefaultMaxCachedBytes;
+
+namespace {
+class PinnedCopyEngine : public ICopyEngine {
+ public:
+  explicit PinnedCopyEngine(int device_id) : device_id_(device_id) {}
+  void *AllocHost(size_t size) override {
+    void *ptr = nullptr;
+    cnrtSetDevice(device_id_);
+    CNRT_SAFECALL(cnrtHostMalloc(&ptr, size), "[PinnedCopyEngine] AllocHost(): failed", nullptr);
+    return ptr;
+  }
+  void FreeHost(void *ptr) override {
+    cnrtSetDevice(device_id_);
+    CALL_CNRT_FUNC(cnrtFreeHost(ptr), "[PinnedCopyEngine] FreeHost(): failed");
+  }
+  int CopyToHost(void *dst, const void *src, size_t size) override {
+    cnrtSetDevice(device_id_);
+    CNRT_SAFECALL(cnrtMemcpy(dst, const_cast<void *>(src), size, cnrtMemcpyDevToHost),
+                  "[PinnedCopyEngine] CopyToHost(): failed", -1);
+    return 0;
+  }
+  int CopyToDevice(void *dst, const void *src, size_t size) override {
+    cnrtSetDevice(device_id_);
+    CNRT_SAFECALL(cnrtMemcpy(dst, const_cast<void *>(src), size, cnrtMemcpyHostToDev),
+                  "[PinnedCopyEngine] CopyToDevice(): failed", -1);
+    return 0;
+  }
+
+ private:
+  int device_id_;
+};
+
+size_t RoundCapacity(size_t size) {
+  size_t capacity = HostStagingPool::kMinCapacity;
+  while (capacity < size) capacity <<= 1;
+  return capacity;
+}
+}  // namespace
+
+//
+// HostStagingPool
+//
+HostStagingPool *HostStagingPool::Instance(int device_id) {
+  static std::mutex map_mutex;
+  static std::map<int, std::unique_ptr<HostStagingPool>> pools;
+  std::unique_lock<std::mutex> lk(map_mutex);
+  std::unique_ptr<HostStagingPool> &pool = pools[device_id];
+  if (!pool) pool.reset(new HostStagingPool(new PinnedCopyEngine(device_id)));
+  return pool.get();
+}
+
+HostStagingPool::HostStagingPool(ICopyEngine *engine, size_t max_cached_bytes)
+    : engine_(engine), max_cached_bytes_(max_cached_bytes) {}
+
+HostStagingPool::~HostStagingPool() {
+  for (auto &bucket : free_) {
+    for (void *ptr : bucket.second) engine_->FreeHost(ptr);
+  }
+  free_.clear();
+}
+
+void *HostStagingPool::Acquire(size_t size, size_t *capacity) {
+  size_t cap = RoundCapacity(size);
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    auto it = free_.find(cap);
+    if (it != free_.end() && !it->second.empty()) {
+      void *ptr = it->second.back();
+      it->second.pop_back();
+      cached_bytes_ -= cap;
+      *capacity = cap;
+      return ptr;
+    }
+    ++alloc_count_;
+  }
+  void *ptr = engine_->AllocHost(cap);
+  if (!ptr) {
+    LOG(ERROR) << "[EasyDK] [HostStagingPool] Acquire(): Alloc host memory failed, size = " << cap;
+    return nullptr;
+  }
+  *capacity = cap;
+  return ptr;
+}
+
+void HostStagingPool::Release(void *ptr, size_t capacity) {
+  if (!ptr) return;
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (cached_bytes_ + capacity <= max_cached_bytes_) {
+      free_[capacity].push_back(ptr);
+      cached_bytes_ += capacity;
+      return;
+    }
+  }
+  engine_->FreeHost(ptr);
+}
+
+size_t HostStagingPool::CachedBytes() const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  return cached_bytes_;
+}
+
+size_t HostStagingPool::AllocCount() const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  return alloc_count_;
+}
+
+//
+// HostMirror
+//
+HostMirror::~HostMirror() {
+  pool_->Release(buffer_, capacity_);
+  buffer_ = nullptr;
+}
+
+int HostMirror::Reserve(const CnedkBufSurface *surf) {
+  bool same_layout = buffer_ && offsets_.size() == surf->batch_size;
+  for (uint32_t i = 0; same_layout && i < surf->batch_size; ++i) {
+    same_layout = sizes_[i] == surf->surface_list[i].data_size;
+  }
+  if (same_layout) {
+    // items moved to other device memory are stale
+    for (uint32_t i = 0; i < surf->batch_size; ++i) {
+      if (ptrs_[i] != surf->surface_list[i].data_ptr) {
+        ptrs_[i] = surf->surface_list[i].data_ptr;
+        valid_[i] = false;
+      }
+    }
+    return 0;
+  }
+
+  size_t size = 0;
+  std::vector<size_t> offsets(surf->batch_size);
+  sizes_.resize(surf->batch_size);
+  ptrs_.resize(surf->batch_size);
+  for (uint32_t i = 0; i < surf->batch_size; ++i) {
+    offsets[i] = size;
+    sizes_[i] = surf->surface_list[i].data_size;
+    ptrs_[i] = surf->surface_list[i].data_ptr;
+    size += sizes_[i];
+  }
+  if (!buffer_ || capacity_ < size) {
+    size_t capacity = 0;
+    void *buffer = pool_->Acquire(size, &capacity);
+    if (!buffer) {
+      // force relayout at the next call
+      offsets_.clear();
+      return -1;
+    }
+    pool_->Release(buffer_, capacity_);
+    buffer_ = static_cast<unsigned char *>(buffer);
+    capacity_ = capacity;
+  }
+  size_ = size;
+  offsets_.swap(offsets);
+  valid_.assign(surf->batch_size, false);
+  return 0;
+}
+
+bool HostMirror::Adjacent(const CnedkBufSurface *surf, uint32_t i) const {
+  const CnedkBufSurfaceParams &cur = surf->surface_list[i];
+  const CnedkBufSurfaceParams &next = surf->surface_list[i + 1];
+  return static_cast<const unsigned char *>(cur.data_ptr) + cur.data_size == next.data_ptr;
+}
+
+int HostMirror::CopyRun(const CnedkBufSurface *surf, uint32_t first, uint32_t last) {
+  size_t size = offsets_[last] + surf->surface_list[last].data_size - offsets_[first];
+  if (pool_->Engine()->CopyToHost(buffer_ + offsets_[first], surf->surface_list[first].data_ptr, size) < 0) {
+    LOG(ERROR) << "[EasyDK] [HostMirror] copy data D2H failed, batch_idx = " << first << " to " << last;
+    return -1;
+  }
+  for (uint32_t i = first; i <= last; ++i) valid_[i] = true;
+  return 0;
+}
+
+void *HostMirror::Get(const CnedkBufSurface *surf, uint32_t batch_idx) {
+  if (batch_idx >= surf->batch_size) {
+    LOG(ERROR) << "[EasyDK] [HostMirror] Get(): batch index is out of range, batch_idx = " << batch_idx;
+    return nullptr;
+  }
+  if (Reserve(surf) < 0) return nullptr;
+  if (!valid_[batch_idx]) {
+    // fetch the stale neighbours adjacent on device within the same transfer
+    uint32_t first = batch_idx, last = batch_idx;
+    while (first > 0 && !valid_[first - 1] && Adjacent(surf, first - 1)) --first;
+    while (last + 1 < surf->batch_size && !valid_[last + 1] && Adjacent(surf, last)) ++last;
+    if (CopyRun(surf, first, last) < 0) return nullptr;
+  }
+  return buffer_ + offsets_[batch_idx];
+}
+
+int HostMirror::Fetch(const CnedkBufSurface *surf) {
+  if (Reserve(surf) < 0) return -1;
+  for (uint32_t first = 0; first < surf->batch_size;) {
+    if (valid_[first]) {
+      ++first;
+      continue;
+    }
+    uint32_t last = first;
+    while (last + 1 < surf->batch_size && !valid_[last + 1] && Adjacent(surf, last)) ++last;
+    if (CopyRun(surf, first, last) < 0) return -1;
+    first = last + 1;
+  }
+  return 0;
+}
+
+void *HostMirror::Cached(const CnedkBufSurface *surf, uint32_t batch_idx) const {
+  if (!Valid(batch_idx) || batch_idx >= surf->batch_size || offsets_.size() != surf->batch_size) return nullptr;
+  const CnedkBufSurfaceParams &params = surf->surface_list[batch_idx];
+  if (ptrs_[batch_idx] != params.data_ptr || sizes_[batch_idx] != params.data_size) return nullptr;
+  return buffer_ + offsets_[batch_idx];
+}
+
+int HostMirror::Sync(const CnedkBufSurface *surf, uint32_t batch_idx) {
+  if (!buffer_ || offsets_.size() != surf->batch_size) {
+    LOG(ERROR) << "[EasyDK] [HostMirror] Sync(): Host data is null";
+    return -1;
+  }
+  if (batch_idx != static_cast<uint32_t>(-1)) {
+    if (!Valid(batch_idx)) {
+      LOG(ERROR) << "[EasyDK] [HostMirror] Sync(): Host data is null, batch_idx = " << batch_idx;
+      return -1;
+    }
+    return pool_->Engine()->CopyToDevice(surf->surface_list[batch_idx].data_ptr, buffer_ + offsets_[batch_idx],
+                                         surf->surface_list[batch_idx].data_size);
+  }
+  // copy runs of items adjacent on device at once, items never read to host are skipped
+  for (uint32_t first = 0; first < surf->batch_size;) {
+    if (!valid_[first]) {
+      ++first;
+      continue;
+    }
+    uint32_t last = first;
+    while (last + 1 < surf->batch_size && valid_[last + 1] && Adjacent(surf, last)) ++last;
+    size_t size = offsets_[last] + surf->surface_list[last].data_size - offsets_[first];
+    if (pool_->Engine()->CopyToDevice(surf->surface_list[first].data_ptr, buffer_ + offsets_[first], size) < 0) {
+      LOG(ERROR) << "[EasyDK] [HostMirror] Sync(): copy data H2D failed";
+      return -1;
+    }
+    first = last + 1;
+  }
+  return 0;
+}
+
+void HostMirror::Invalidate(uint32_t batch_idx) {
+  if (batch_idx == static_cast<uint32_t>(-1)) {
+    valid_.assign(valid_.size(), false);
+  } else if (batch_idx < valid_.size()) {
+    valid_[batch_idx] = false;
+  }
+}
+
+bool HostMirror::Owns(const void *ptr) const {
+  const unsigned char *p = static_cast<const unsigned char *>(ptr);
+  return buffer_ && p >= buffer_ && p < buffer_ + size_;
+}
+
+}  // namespace cnedk
@@ -0,0 +1,173 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EASYDK_COMMON_HOST_STAGING_POOL_HPP_
+#define EASYDK_COMMON_HOST_STAGING_POOL_HPP_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+
+namespace cnedk {
+
+/**
+ * @brief Allocates staging memory and moves data between host and device.
+ *
+ * The default engine uses page-locked memory and cnrtMemcpy, tests may provide one working on system memory.
+ */
+class ICopyEngine {
+ public:
+  virtual ~ICopyEngine() {}
+  virtual void *AllocHost(size_t size) = 0;
+  virtual void FreeHost(void *ptr) = 0;
+  virtual int CopyToHost(void *dst, const void *src, size_t size) = 0;
+  virtual int CopyToDevice(void *dst, const void *src, size_t size) = 0;
+};
+
+/**
+ * @brief Pool of reusable host staging buffers.
+ *
+ * Buffers are bucketed by power-of-two capacity and cached after release, up to `max_cached_bytes` in total.
+ */
+class HostStagingPool {
+ public:
+  static constexpr size_t kMinCapacity = 4096;
+  static constexpr size_t kDefaultMaxCachedBytes = 64 << 20;
+
+  /**
+   * @brief Gets the pool of page-locked buffers for the device
+   */
+  static HostStagingPool *Instance(int device_id);
+
+  /**
+   * @brief Creates a pool on the engine, the pool takes the ownership of engine
+   */
+  explicit HostStagingPool(ICopyEngine *engine, size_t max_cached_bytes = kDefaultMaxCachedBytes);
+  ~HostStagingPool();
+
+  /**
+   * @brief Gets a buffer of at least size bytes
+   *
+   * @param[in] size required size
+   * @param[out] capacity capacity of the buffer, should be passed back to Release
+   * @return the buffer, nullptr if allocation failed
+   */
+  void *Acquire(size_t size, size_t *capacity);
+  /**
+   * @brief Returns a buffer to the pool
+   */
+  void Release(void *ptr, size_t capacity);
+
+  ICopyEngine *Engine() const { return engine_.get(); }
+  /// bytes of released buffers kept for reuse
+  size_t CachedBytes() const;
+  /// number of buffers allocated from the engine
+  size_t AllocCount() const;
+
+ private:
+  HostStagingPool(const HostStagingPool &) = delete;
+  HostStagingPool &operator=(const HostStagingPool &) = delete;
+
+  std::unique_ptr<ICopyEngine> engine_;
+  size_t max_cached_bytes_;
+  mutable std::mutex mutex_;
+  std::map<size_t, std::vector<void *>> free_;
+  size_t cached_bytes_ = 0;
+  size_t alloc_count_ = 0;
+};  // class HostStagingPool
+
+/**
+ * @brief Host mirror of a batched device surface.
+ *
+ * Items of the batch are staged in one buffer from HostStagingPool. Items with adjacent device addresses are
+ * transferred together. An item is copied from device at the first access only, and copied again after it has
+ * been invalidated, i.e. after the device memory has been modified by others. Items whose device address
+ * changes are taken as stale, and the buffer is laid out again if the size of any item changes.
+ *
+ * @note Not thread-safe, the owner is responsible for locking.
+ */
+class HostMirror {
+ public:
+  explicit HostMirror(HostStagingPool *pool) : pool_(pool) {}
+  ~HostMirror();
+
+  /**
+   * @brief Gets host data of one item, copies it from device if not valid
+   *
+   * @return host address of the item, nullptr if failed
+   */
+  void *Get(const CnedkBufSurface *surf, uint32_t batch_idx);
+  /**
+   * @brief Copies all items not valid from device, items adjacent on device are transferred together
+   *
+   * @return 0 if succeeded, otherwise -1
+   */
+  int Fetch(const CnedkBufSurface *surf);
+  /**
+   * @brief Gets host data of one item without copying, in constant time
+   *
+   * @return host address of the item, nullptr if it is not valid or has been moved to other device memory
+   */
+  void *Cached(const CnedkBufSurface *surf, uint32_t batch_idx) const;
+  /**
+   * @brief Copies host data of one item, or all valid items if batch_idx is -1, to device
+   *
+   * @return 0 if succeeded, otherwise -1
+   */
+  int Sync(const CnedkBufSurface *surf, uint32_t batch_idx);
+  /**
+   * @brief Marks one item, or all items if batch_idx is -1, as stale
+   */
+  void Invalidate(uint32_t batch_idx);
+  /**
+   * @brief Whether host data of the item is the same as device
+   */
+  bool Valid(uint32_t batch_idx) const { return batch_idx < valid_.size() && valid_[batch_idx]; }
+  /**
+   * @brief Whether host address belongs to this mirror
+   */
+  bool Owns(const void *ptr) const;
+
+ private:
+  HostMirror(const HostMirror &) = delete;
+  HostMirror &operator=(const HostMirror &) = delete;
+
+  int Reserve(const CnedkBufSurface *surf);
+  bool Adjacent(const CnedkBufSurface *surf, uint32_t i) const;
+  int CopyRun(const CnedkBufSurface *surf, uint32_t first, uint32_t last);
+
+  HostStagingPool *pool_;
+  unsigned char *buffer_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  std::vector<size_t> offsets_;
+  // layout of the items staged, the buffer is laid out again once any size changes
+  std::vector<size_t> sizes_;
+  std::vector<void *> ptrs_;
+  std::vector<bool> valid_;
+};  // class HostMirror
+
+}  // namespace cnedk
+
+#endif  // EASYDK_COMMON_HOST_STAGING_POOL_HPP_
@@ -0,0 +1,117 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "host_worker_pool.hpp"
+
+#include <algorithm>
+
+namespace cnedk {
+
+constexpr uint32_t HostWorkerPool::kMaxThreads;
+
+HostWorkerPool &HostWorkerPool::Instance() {
+  static HostWorkerPool pool(DefaultConcurrency());
+  return pool;
+}
+
+uint32_t HostWorkerPool::DefaultConcurrency() {
+  // bounded, memory bandwidth is used up by a few threads and an oversubscribed host gains nothing from more
+  return std::max(1u, std::min(std::thread::hardware_concurrency(), 8u));
+}
+
+HostWorkerPool::HostWorkerPool(uint32_t concurrency) : concurrency_(1) { SetConcurrency(concurrency); }
+
+HostWorkerPool::~HostWorkerPool() { StopWorkers(); }
+
+void HostWorkerPool::SetConcurrency(uint32_t concurrency) {
+  concurrency = std::max(1u, std::min(concurrency, kMaxThreads));
+  // waits for the running region
+  std::lock_guard<std::mutex> region_lk(region_mutex_);
+  if (concurrency == concurrency_.load()) return;
+  StopWorkers();
+  concurrency_.store(concurrency);
+  std::lock_guard<std::mutex> lk(mutex_);
+  stop_ = false;
+  for (uint32_t i = 1; i < concurrency; ++i) workers_.emplace_back(&HostWorkerPool::WorkerLoop, this);
+}
+
+void HostWorkerPool::StopWorkers() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &worker : workers_) worker.join();
+  workers_.clear();
+}
+
+void HostWorkerPool::ParallelFor(uint32_t num, const std::function<void(uint32_t)> &func) {
+  if (!num) return;
+  std::unique_lock<std::mutex> region_lk(region_mutex_, std::try_to_lock);
+  if (num == 1 || workers_.empty() || !region_lk.owns_lock()) {
+    for (uint32_t i = 0; i < num; ++i) func(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    func_ = &func;
+    num_tasks_ = num;
+    next_task_.store(0);
+    pending_tasks_ = num;
+    ++generation_;
+  }
+  work_cv_.notify_all();
+  RunTasks();
+
+  // workers may still hold the region after the last task, func must outlive them
+  std::unique_lock<std::mutex> lk(mutex_);
+  done_cv_.wait(lk, [this] { return pending_tasks_ == 0 && active_workers_ == 0; });
+  func_ = nullptr;
+}
+
+void HostWorkerPool::RunTasks() {
+  uint32_t done = 0;
+  for (uint32_t i = next_task_.fetch_add(1); i < num_tasks_; i = next_task_.fetch_add(1)) {
+    (*func_)(i);
+    ++done;
+  }
+  if (!done) return;
+  std::lock_guard<std::mutex> lk(mutex_);
+  pending_tasks_ -= done;
+  if (!pending_tasks_) done_cv_.notify_all();
+}
+
+void HostWorkerPool::WorkerLoop() {
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (true) {
+    work_cv_.wait(lk, [&] { return stop_ || generation_ != seen; });
+    if (stop_) return;
+    seen = generation_;
+    ++active_workers_;
+    lk.unlock();
+    RunTasks();
+    lk.lock();
+    if (--active_workers_ == 0 && !pending_tasks_) done_cv_.notify_all();
+  }
+}
+
+}  // namespace cnedk
@@ -0,0 +1,100 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EASYDK_COMMON_HOST_WORKER_POOL_HPP_
+#define EASYDK_COMMON_HOST_WORKER_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cnedk {
+
+/**
+ * @brief Bounded pool of worker threads for data-parallel host kernels.
+ *
+ * Work is split into tasks that are claimed one by one by the workers and the calling thread. A single parallel
+ * region runs at a time; a caller arriving while the pool is busy runs its tasks by itself, so the number of
+ * threads never exceeds the pool size plus the callers.
+ */
+class HostWorkerPool {
+ public:
+  static constexpr uint32_t kMaxThreads = 64;
+
+  /**
+   * @brief Gets the pool shared by host transforms
+   */
+  static HostWorkerPool &Instance();
+
+  /**
+   * @brief Gets the concurrency of the shared pool by default, the number of CPU cores and at most 8
+   */
+  static uint32_t DefaultConcurrency();
+
+  /**
+   * @brief Creates a pool running up to concurrency tasks at once, the calling thread included
+   */
+  explicit HostWorkerPool(uint32_t concurrency);
+  ~HostWorkerPool();
+
+  /**
+   * @brief Sets the number of tasks running at once, the calling thread included, 1 disables workers
+   */
+  void SetConcurrency(uint32_t concurrency);
+  uint32_t Concurrency() const { return concurrency_.load(); }
+
+  /**
+   * @brief Runs func(i) for each i in [0, num) and returns when all of them have finished
+   */
+  void ParallelFor(uint32_t num, const std::function<void(uint32_t)> &func);
+
+ private:
+  HostWorkerPool(const HostWorkerPool &) = delete;
+  HostWorkerPool &operator=(const HostWorkerPool &) = delete;
+
+  // claims and runs tasks of the current region until none is left
+  void RunTasks();
+  void WorkerLoop();
+  void StopWorkers();
+
+  std::atomic<uint32_t> concurrency_;
+  std::mutex region_mutex_;
+  std::vector<std::thread> workers_;
+
+  // current region, guarded by mutex_ except the task counters
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(uint32_t)> *func_ = nullptr;
+  uint32_t num_tasks_ = 0;
+  std::atomic<uint32_t> next_task_{0};
+  uint32_t pending_tasks_ = 0;
+  uint32_t active_workers_ = 0;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+};
+
+}  // namespace cnedk
+
+#endif  // EASYDK_COMMON_HOST_WORKER_POOL_HPP_
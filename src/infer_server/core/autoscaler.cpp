@@ -0,0 +1,89 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "autoscaler.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+
+namespace infer_server {
+
+namespace {
+
+struct WindowLoad {
+  uint32_t min_depth{UINT32_MAX};
+  uint32_t max_depth{0};
+  float idle_ratio{0};
+  float batch_fill{0};
+};
+
+WindowLoad Summarize(std::deque<LoadSample>::const_iterator begin, std::deque<LoadSample>::const_iterator end) {
+  WindowLoad load;
+  uint32_t num = 0;
+  for (auto it = begin; it != end; ++it, ++num) {
+    load.min_depth = std::min(load.min_depth, it->cache_depth);
+    load.max_depth = std::max(load.max_depth, it->cache_depth);
+    load.idle_ratio += it->idle_ratio;
+    load.batch_fill += it->batch_fill;
+  }
+  if (num) {
+    load.idle_ratio /= num;
+    load.batch_fill /= num;
+  }
+  return load;
+}
+
+}  // namespace
+
+int EngineScaler::Update(const LoadSample& sample, uint32_t engine_num) noexcept {
+  window_.push_back(sample);
+  while (window_.size() > std::max(config_.window, config_.down_window)) window_.pop_front();
+
+  int change = 0;
+  WindowLoad load;
+  if (config_.window && window_.size() >= config_.window && engine_num < config_.max_engine_num) {
+    load = Summarize(window_.end() - config_.window, window_.end());
+    if (load.min_depth >= config_.up_cache_depth && load.idle_ratio <= config_.up_idle_ratio &&
+        load.batch_fill >= config_.up_batch_fill) {
+      change = 1;
+    }
+  }
+  if (!change && config_.down_window && window_.size() >= config_.down_window &&
+      engine_num > config_.min_engine_num) {
+    load = Summarize(window_.end() - config_.down_window, window_.end());
+    // busy engines fit in the others
+    if (load.max_depth == 0 && (1 - load.idle_ratio) * engine_num <= config_.down_busy_ratio * (engine_num - 1)) {
+      change = -1;
+    }
+  }
+  if (change) {
+    VLOG(1) << "[EasyDK InferServer] [EngineScaler] " << (change > 0 ? "Scale up" : "Scale down") << " from "
+            << engine_num << " engines, cache depth: [" << load.min_depth << ", " << load.max_depth
+            << "], idle ratio: " << load.idle_ratio << ", batch fill: " << load.batch_fill;
+    // the next decisions are made on load after this change
+    window_.clear();
+  }
+  return change;
+}
+
+}  // namespace infer_server
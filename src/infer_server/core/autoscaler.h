@@ -0,0 +1,95 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_CORE_AUTOSCALER_H_
+#define INFER_SERVER_CORE_AUTOSCALER_H_
+
+#include <cstdint>
+#include <deque>
+
+namespace infer_server {
+
+/**
+ * @brief Load of an executor sampled at a moment
+ */
+struct LoadSample {
+  /// number of batches waiting in cache
+  uint32_t cache_depth{0};
+  /// ratio of engines without task
+  float idle_ratio{0};
+  /// average ratio of batch size to model batch size of batches dispatched since the last sample, 0 if none
+  float batch_fill{0};
+};
+
+/**
+ * @brief Decides engine number of an executor from load sampled over sliding windows
+ *
+ * Engine number is changed only if load holds over a full window, and windows are restarted after each change,
+ * so that spikes shorter than a window and load between the scale up and scale down conditions change nothing.
+ * Scale down looks at a longer window than scale up, since a retired engine is expensive to bring back.
+ */
+class EngineScaler {
+ public:
+  struct Config {
+    /// lower bound of engine number
+    uint32_t min_engine_num{1};
+    /// upper bound of engine number
+    uint32_t max_engine_num{1};
+    /// number of samples in window of scale up
+    uint32_t window{10};
+    /// number of samples in window of scale down
+    uint32_t down_window{30};
+    /// scale up if at least so many batches are waiting in every sample of window
+    uint32_t up_cache_depth{1};
+    /// and ratio of idle engines is not more than this on average
+    float up_idle_ratio{0.1f};
+    /// and batches are filled at least to this ratio on average
+    float up_batch_fill{0.5f};
+    /// scale down if no batch is waiting in any sample of down window, and the other engines would be busy not
+    /// more than this ratio on average without one engine
+    float down_busy_ratio{0.7f};
+  };
+
+  explicit EngineScaler(const Config& config) noexcept : config_(config) {}
+
+  /**
+   * @brief Adds a sample to window and decides engine number change
+   *
+   * @param sample Load sampled
+   * @param engine_num Current engine number
+   * @retval 1 add an engine
+   * @retval -1 remove an engine
+   * @retval 0 keep engine number
+   */
+  int Update(const LoadSample& sample, uint32_t engine_num) noexcept;
+
+  /// Drops samples in windows
+  void Reset() noexcept { window_.clear(); }
+
+  const Config& GetConfig() const noexcept { return config_; }
+
+ private:
+  Config config_;
+  std::deque<LoadSample> window_;
+};  // class EngineScaler
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_CORE_AUTOSCALER_H_
@@ -46,6 +46,11 @@ class CacheBase {
   const Priority& GetPriority() const noexcept { return priority_; }
   bool Running() const noexcept { return running_.load(); }
   uint32_t BatchSize() const noexcept { return batch_size_; }
+  /// number of packages waiting to be popped
+  size_t Size() noexcept {
+    std::unique_lock<std::mutex> cache_lk(cache_mutex_);
+    return cache_.size();
+  }
   /* -------------- Observer END -----------------*/
 
   virtual void Start() noexcept { running_.store(true); }
@@ -0,0 +1,392 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "core/cast_kernel.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CAST_KERNEL_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#define CAST_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#elif defined(__aarch64__)
+#define CAST_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+namespace infer_server {
+namespace detail {
+
+namespace {
+
+// distinguishes half from int16_t
+struct half_t {
+  uint16_t bits;
+};
+
+inline float FromBits(uint32_t w) {
+  float f;
+  memcpy(&f, &w, sizeof(f));
+  return f;
+}
+
+inline uint32_t ToBits(float f) {
+  uint32_t w;
+  memcpy(&w, &f, sizeof(w));
+  return w;
+}
+
+template <typename I>
+inline I SaturateCast(float v) {
+  if (std::isnan(v)) return 0;
+  // rounds to nearest even in the default rounding mode
+  v = std::nearbyint(v);
+  if (v <= static_cast<float>(std::numeric_limits<I>::min())) return std::numeric_limits<I>::min();
+  if (v >= static_cast<float>(std::numeric_limits<I>::max())) return std::numeric_limits<I>::max();
+  return static_cast<I>(v);
+}
+
+template <typename I>
+inline I SaturateCast(int32_t v) {
+  if (v < static_cast<int32_t>(std::numeric_limits<I>::min())) return std::numeric_limits<I>::min();
+  if (v > static_cast<int32_t>(std::numeric_limits<I>::max())) return std::numeric_limits<I>::max();
+  return static_cast<I>(v);
+}
+
+// integers are widened to int32, floating points to float
+inline float Widen(float v) { return v; }
+inline float Widen(half_t v) { return HalfToFloat(v.bits); }
+inline int32_t Widen(uint8_t v) { return v; }
+inline int32_t Widen(int8_t v) { return v; }
+inline int32_t Widen(int16_t v) { return v; }
+inline int32_t Widen(int32_t v) { return v; }
+
+template <typename D>
+struct Narrow {
+  static D From(float v) { return SaturateCast<D>(v); }
+  static D From(int32_t v) { return SaturateCast<D>(v); }
+};
+
+template <>
+struct Narrow<float> {
+  static float From(float v) { return v; }
+  static float From(int32_t v) { return static_cast<float>(v); }
+};
+
+template <>
+struct Narrow<half_t> {
+  static half_t From(float v) { return half_t{FloatToHalf(v)}; }
+  static half_t From(int32_t v) { return half_t{FloatToHalf(static_cast<float>(v))}; }
+};
+
+template <>
+struct Narrow<int32_t> {
+  static int32_t From(float v) { return SaturateCast<int32_t>(v); }
+  static int32_t From(int32_t v) { return v; }
+};
+
+template <typename S, typename D>
+inline void CastScalar(const S *src, D *dst, size_t count) {
+  for (size_t i = 0; i < count; ++i) dst[i] = Narrow<D>::From(Widen(src[i]));
+}
+
+template <typename S, typename D>
+void CastScalarKernel(const void *src, void *dst, size_t count) {
+  CastScalar(static_cast<const S *>(src), static_cast<D *>(dst), count);
+}
+
+#ifdef CAST_KERNEL_X86
+bool HostSupportsAvx2F16c() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  if (!(ecx & bit_F16C) || !(ecx & bit_AVX) || !(ecx & bit_OSXSAVE)) return false;
+  // ymm registers are enabled by OS
+  unsigned int xcr0_lo, xcr0_hi;
+  __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  if ((xcr0_lo & 0x6) != 0x6) return false;
+  if (__get_cpuid_max(0, nullptr) < 7) return false;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return ebx & bit_AVX2;
+}
+
+// 8 elements are loaded as float
+CAST_TARGET_AVX2 inline __m256 Load8(const float *p) { return _mm256_loadu_ps(p); }
+CAST_TARGET_AVX2 inline __m256 Load8(const half_t *p) {
+  return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+CAST_TARGET_AVX2 inline __m256 Load8(const uint8_t *p) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+}
+CAST_TARGET_AVX2 inline __m256 Load8(const int8_t *p) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+}
+CAST_TARGET_AVX2 inline __m256 Load8(const int16_t *p) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))));
+}
+CAST_TARGET_AVX2 inline __m256 Load8(const int32_t *p) {
+  return _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+}
+
+// NaN to 0, clamps to [lo, hi] and rounds to nearest even
+CAST_TARGET_AVX2 inline __m256i RoundClamp(__m256 v, float lo, float hi) {
+  v = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+  v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(lo)), _mm256_set1_ps(hi));
+  return _mm256_cvtps_epi32(v);
+}
+
+CAST_TARGET_AVX2 inline void Store8(float *p, __m256 v) { _mm256_storeu_ps(p, v); }
+CAST_TARGET_AVX2 inline void Store8(half_t *p, __m256 v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+}
+CAST_TARGET_AVX2 inline void Store8(int32_t *p, __m256 v) {
+  // out of range converts to INT32_MIN, fix the positive side
+  __m256 nan_to_zero = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+  __m256i r = _mm256_cvtps_epi32(nan_to_zero);
+  __m256 overflow = _mm256_cmp_ps(nan_to_zero, _mm256_set1_ps(2147483648.f), _CMP_GE_OQ);
+  r = _mm256_blendv_epi8(r, _mm256_set1_epi32(std::numeric_limits<int32_t>::max()), _mm256_castps_si256(overflow));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), r);
+}
+CAST_TARGET_AVX2 inline void Store8(int16_t *p, __m256 v) {
+  __m256i r = RoundClamp(v, -32768.f, 32767.f);
+  __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), packed);
+}
+CAST_TARGET_AVX2 inline void Store8(uint8_t *p, __m256 v) {
+  __m256i r = RoundClamp(v, 0.f, 255.f);
+  __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi16(packed, packed));
+}
+CAST_TARGET_AVX2 inline void Store8(int8_t *p, __m256 v) {
+  __m256i r = RoundClamp(v, -128.f, 127.f);
+  __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packs_epi16(packed, packed));
+}
+
+template <typename S, typename D>
+CAST_TARGET_AVX2 void CastAvx2Kernel(const void *src, void *dst, size_t count) {
+  const S *s = static_cast<const S *>(src);
+  D *d = static_cast<D *>(dst);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) Store8(d + i, Load8(s + i));
+  CastScalar(s + i, d + i, count - i);
+}
+#endif  // CAST_KERNEL_X86
+
+#ifdef CAST_KERNEL_NEON
+// 8 elements are loaded as float
+inline float32x4x2_t Load8(const float *p) { return float32x4x2_t{{vld1q_f32(p), vld1q_f32(p + 4)}}; }
+inline float32x4x2_t Load8(const half_t *p) {
+  const uint16_t *u = reinterpret_cast<const uint16_t *>(p);
+  return float32x4x2_t{{vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(u))),
+                        vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(u + 4)))}};
+}
+inline float32x4x2_t Load8(const uint8_t *p) {
+  uint16x8_t w = vmovl_u8(vld1_u8(p));
+  return float32x4x2_t{{vcvtq_f32_u32(vmovl_u16(vget_low_u16(w))), vcvtq_f32_u32(vmovl_u16(vget_high_u16(w)))}};
+}
+inline float32x4x2_t Load8(const int8_t *p) {
+  int16x8_t w = vmovl_s8(vld1_s8(p));
+  return float32x4x2_t{{vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))), vcvtq_f32_s32(vmovl_s16(vget_high_s16(w)))}};
+}
+inline float32x4x2_t Load8(const int16_t *p) {
+  int16x8_t w = vld1q_s16(p);
+  return float32x4x2_t{{vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))), vcvtq_f32_s32(vmovl_s16(vget_high_s16(w)))}};
+}
+inline float32x4x2_t Load8(const int32_t *p) {
+  return float32x4x2_t{{vcvtq_f32_s32(vld1q_s32(p)), vcvtq_f32_s32(vld1q_s32(p + 4))}};
+}
+
+// vcvtnq rounds to nearest even, saturates and converts NaN to 0
+inline void Store8(float *p, float32x4x2_t v) {
+  vst1q_f32(p, v.val[0]);
+  vst1q_f32(p + 4, v.val[1]);
+}
+inline void Store8(half_t *p, float32x4x2_t v) {
+  uint16_t *u = reinterpret_cast<uint16_t *>(p);
+  vst1_u16(u, vreinterpret_u16_f16(vcvt_f16_f32(v.val[0])));
+  vst1_u16(u + 4, vreinterpret_u16_f16(vcvt_f16_f32(v.val[1])));
+}
+inline void Store8(int32_t *p, float32x4x2_t v) {
+  vst1q_s32(p, vcvtnq_s32_f32(v.val[0]));
+  vst1q_s32(p + 4, vcvtnq_s32_f32(v.val[1]));
+}
+inline void Store8(int16_t *p, float32x4x2_t v) {
+  vst1q_s16(p, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(v.val[0])), vqmovn_s32(vcvtnq_s32_f32(v.val[1]))));
+}
+inline void Store8(uint8_t *p, float32x4x2_t v) {
+  uint16x8_t w = vcombine_u16(vqmovun_s32(vcvtnq_s32_f32(v.val[0])), vqmovun_s32(vcvtnq_s32_f32(v.val[1])));
+  vst1_u8(p, vqmovn_u16(w));
+}
+inline void Store8(int8_t *p, float32x4x2_t v) {
+  int16x8_t w = vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(v.val[0])), vqmovn_s32(vcvtnq_s32_f32(v.val[1])));
+  vst1_s8(p, vqmovn_s16(w));
+}
+
+template <typename S, typename D>
+void CastNeonKernel(const void *src, void *dst, size_t count) {
+  const S *s = static_cast<const S *>(src);
+  D *d = static_cast<D *>(dst);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) Store8(d + i, Load8(s + i));
+  CastScalar(s + i, d + i, count - i);
+}
+#endif  // CAST_KERNEL_NEON
+
+using CastKernel = void (*)(const void *, void *, size_t);
+
+// index of data type in kernel table
+inline int TypeIndex(DataType type) {
+  switch (type) {
+    case DataType::UINT8: return 0;
+    case DataType::FLOAT16: return 1;
+    case DataType::FLOAT32: return 2;
+    case DataType::INT32: return 3;
+    case DataType::INT16: return 4;
+    case DataType::INT8: return 5;
+    default: return -1;
+  }
+}
+
+#define CAST_KERNEL_ROW(kernel, S)                                                                          \
+  {                                                                                                         \
+    kernel<S, uint8_t>, kernel<S, half_t>, kernel<S, float>, kernel<S, int32_t>, kernel<S, int16_t>,        \
+        kernel<S, int8_t>                                                                                   \
+  }
+#define CAST_KERNEL_TABLE(kernel)                                                                           \
+  {                                                                                                         \
+    CAST_KERNEL_ROW(kernel, uint8_t), CAST_KERNEL_ROW(kernel, half_t), CAST_KERNEL_ROW(kernel, float),      \
+        CAST_KERNEL_ROW(kernel, int32_t), CAST_KERNEL_ROW(kernel, int16_t), CAST_KERNEL_ROW(kernel, int8_t) \
+  }
+
+const CastKernel kScalarKernels[6][6] = CAST_KERNEL_TABLE(CastScalarKernel);
+
+// conversions between integers do not involve floating point, the scalar loop is vectorized by compiler
+#ifdef CAST_KERNEL_X86
+const CastKernel kAvx2Kernels[6][6] = {
+    {CastScalarKernel<uint8_t, uint8_t>, CastAvx2Kernel<uint8_t, half_t>, CastAvx2Kernel<uint8_t, float>,
+     CastScalarKernel<uint8_t, int32_t>, CastScalarKernel<uint8_t, int16_t>, CastScalarKernel<uint8_t, int8_t>},
+    CAST_KERNEL_ROW(CastAvx2Kernel, half_t),
+    CAST_KERNEL_ROW(CastAvx2Kernel, float),
+    {CastScalarKernel<int32_t, uint8_t>, CastAvx2Kernel<int32_t, half_t>, CastAvx2Kernel<int32_t, float>,
+     CastScalarKernel<int32_t, int32_t>, CastScalarKernel<int32_t, int16_t>, CastScalarKernel<int32_t, int8_t>},
+    {CastScalarKernel<int16_t, uint8_t>, CastAvx2Kernel<int16_t, half_t>, CastAvx2Kernel<int16_t, float>,
+     CastScalarKernel<int16_t, int32_t>, CastScalarKernel<int16_t, int16_t>, CastScalarKernel<int16_t, int8_t>},
+    {CastScalarKernel<int8_t, uint8_t>, CastAvx2Kernel<int8_t, half_t>, CastAvx2Kernel<int8_t, float>,
+     CastScalarKernel<int8_t, int32_t>, CastScalarKernel<int8_t, int16_t>, CastScalarKernel<int8_t, int8_t>}};
+#endif
+
+#ifdef CAST_KERNEL_NEON
+const CastKernel kNeonKernels[6][6] = {
+    {CastScalarKernel<uint8_t, uint8_t>, CastNeonKernel<uint8_t, half_t>, CastNeonKernel<uint8_t, float>,
+     CastScalarKernel<uint8_t, int32_t>, CastScalarKernel<uint8_t, int16_t>, CastScalarKernel<uint8_t, int8_t>},
+    CAST_KERNEL_ROW(CastNeonKernel, half_t),
+    CAST_KERNEL_ROW(CastNeonKernel, float),
+    {CastScalarKernel<int32_t, uint8_t>, CastNeonKernel<int32_t, half_t>, CastNeonKernel<int32_t, float>,
+     CastScalarKernel<int32_t, int32_t>, CastScalarKernel<int32_t, int16_t>, CastScalarKernel<int32_t, int8_t>},
+    {CastScalarKernel<int16_t, uint8_t>, CastNeonKernel<int16_t, half_t>, CastNeonKernel<int16_t, float>,
+     CastScalarKernel<int16_t, int32_t>, CastScalarKernel<int16_t, int16_t>, CastScalarKernel<int16_t, int8_t>},
+    {CastScalarKernel<int8_t, uint8_t>, CastNeonKernel<int8_t, half_t>, CastNeonKernel<int8_t, float>,
+     CastScalarKernel<int8_t, int32_t>, CastScalarKernel<int8_t, int16_t>, CastScalarKernel<int8_t, int8_t>}};
+#endif
+
+#undef CAST_KERNEL_TABLE
+#undef CAST_KERNEL_ROW
+
+}  // namespace
+
+// fp16 <-> fp32 conversion of scalar values, same as F16C and NEON.
+// Refers to FP16 library by Marat Dukhan (MIT License)
+uint16_t FloatToHalf(float f) noexcept {
+  const float scale_to_inf = FromBits(UINT32_C(0x77800000));   // 2^112
+  const float scale_to_zero = FromBits(UINT32_C(0x08800000));  // 2^-110
+  float base = (std::fabs(f) * scale_to_inf) * scale_to_zero;
+
+  const uint32_t w = ToBits(f);
+  const uint32_t shl1_w = w + w;
+  const uint32_t sign = w & UINT32_C(0x80000000);
+  uint32_t bias = shl1_w & UINT32_C(0xFF000000);
+  if (bias < UINT32_C(0x71000000)) bias = UINT32_C(0x71000000);
+
+  base = FromBits((bias >> 1) + UINT32_C(0x07800000)) + base;
+  const uint32_t bits = ToBits(base);
+  const uint32_t exp_bits = (bits >> 13) & UINT32_C(0x00007C00);
+  const uint32_t mantissa_bits = bits & UINT32_C(0x00000FFF);
+  const uint32_t nonsign = exp_bits + mantissa_bits;
+  // NaN keeps the payload and is quieted, as the hardware does
+  const uint32_t nan = UINT32_C(0x7E00) | ((w >> 13) & UINT32_C(0x03FF));
+  return static_cast<uint16_t>((sign >> 16) | (shl1_w > UINT32_C(0xFF000000) ? nan : nonsign));
+}
+
+float HalfToFloat(uint16_t h) noexcept {
+  const uint32_t w = static_cast<uint32_t>(h) << 16;
+  const uint32_t sign = w & UINT32_C(0x80000000);
+  const uint32_t two_w = w + w;
+
+  const uint32_t exp_offset = UINT32_C(0xE0) << 23;
+  const float exp_scale = FromBits(UINT32_C(0x7800000));  // 2^-112
+  const float normalized_value = FromBits((two_w >> 4) + exp_offset) * exp_scale;
+
+  const uint32_t magic_mask = UINT32_C(126) << 23;
+  const float magic_bias = 0.5f;
+  const float denormalized_value = FromBits((two_w >> 17) | magic_mask) - magic_bias;
+
+  const uint32_t denormalized_cutoff = UINT32_C(1) << 27;
+  const uint32_t result =
+      sign | (two_w < denormalized_cutoff ? ToBits(denormalized_value) : ToBits(normalized_value));
+  return FromBits(result);
+}
+
+CastIsa DetectCastIsa() noexcept {
+#if defined(CAST_KERNEL_X86)
+  static const CastIsa isa = HostSupportsAvx2F16c() ? CastIsa::AVX2_F16C : CastIsa::SCALAR;
+  return isa;
+#elif defined(CAST_KERNEL_NEON)
+  return CastIsa::NEON;
+#else
+  return CastIsa::SCALAR;
+#endif
+}
+
+bool CastHost(const void *src, void *dst, DataType src_dtype, DataType dst_dtype, size_t count,
+              CastIsa isa) noexcept {
+  int s = TypeIndex(src_dtype), d = TypeIndex(dst_dtype);
+  if (s < 0 || d < 0) return false;
+  if (src_dtype == dst_dtype) {
+    memcpy(dst, src, count * GetTypeSize(src_dtype));
+    return true;
+  }
+  // falls back to scalar if isa is not supported by host
+  CastKernel kernel = kScalarKernels[s][d];
+  if (isa != CastIsa::SCALAR && isa == DetectCastIsa()) {
+#if defined(CAST_KERNEL_X86)
+    kernel = kAvx2Kernels[s][d];
+#elif defined(CAST_KERNEL_NEON)
+    kernel = kNeonKernels[s][d];
+#endif
+  }
+  kernel(src, dst, count);
+  return true;
+}
+
+}  // namespace detail
+}  // namespace infer_server
@@ -0,0 +1,76 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_CORE_CAST_KERNEL_H_
+#define INFER_SERVER_CORE_CAST_KERNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cnis/infer_server.h"
+
+namespace infer_server {
+namespace detail {
+
+/// instruction set of host data type conversion
+enum class CastIsa {
+  SCALAR = 0,
+  AVX2_F16C = 1,  ///< x86 with AVX2 and F16C
+  NEON = 2,       ///< aarch64
+};
+
+/**
+ * @brief Gets the best instruction set supported by the host, detected by CPUID on x86
+ */
+CastIsa DetectCastIsa() noexcept;
+
+/**
+ * @brief Converts data type of count elements on host
+ *
+ * Conversion to FLOAT16 rounds to nearest even. Conversion from floating point to integer rounds to nearest even
+ * and saturates to the range of the integer type, NaN is converted to 0. Conversion between integers saturates.
+ * All instruction sets give the same result.
+ *
+ * @param src source data
+ * @param dst destination data, must not overlap with src
+ * @param src_dtype data type of src
+ * @param dst_dtype data type of dst
+ * @param count number of elements
+ * @param isa instruction set to use, scalar code is used if it is not supported by host
+ * @retval true succeeded
+ * @retval false data type is not supported
+ */
+bool CastHost(const void *src, void *dst, DataType src_dtype, DataType dst_dtype, size_t count,
+              CastIsa isa = DetectCastIsa()) noexcept;
+
+/**
+ * @brief Converts a float to half, rounds to nearest even
+ */
+uint16_t FloatToHalf(float f) noexcept;
+
+/**
+ * @brief Converts a half to float
+ */
+float HalfToFloat(uint16_t h) noexcept;
+
+}  // namespace detail
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_CORE_CAST_KERNEL_H_
@@ -21,21 +21,16 @@
 #include "data_type.h"
 
 #include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include "cnis/processor.h"
+#include "core/cast_kernel.h"
+#include "core/transpose_kernel.h"
 
 namespace infer_server {
 namespace detail {
 
-#define CHECK_CNRT_RET(ret, msg, val)                  \
-  do {                                                 \
-    if ((ret) != cnrtSuccess) {                        \
-      LOG(ERROR) << (msg) << " error code: " << (ret); \
-      return val;                                      \
-    }                                                  \
-  } while (0)
-
 inline std::vector<int> GetTransOrderAxis(DimOrder src, DimOrder dst, size_t n_dims) {
   std::vector<int> axis;
   if (src == DimOrder::NCHW && dst == DimOrder::NHWC) {
@@ -64,15 +59,63 @@ inline std::vector<int> GetTransOrderAxis(DimOrder src, DimOrder dst, size_t n_d
 
 bool CastDataType(void *src_data, void *dst_data, DataType src_dtype, DataType dst_dtype, const Shape &shape) {
   if (src_dtype != dst_dtype) {
-    int size = shape.BatchDataCount();
-    cnrtRet_t error_code = cnrtSuccess;
-    error_code = cnrtCastDataType(src_data, detail::CastDataType(src_dtype), dst_data, detail::CastDataType(dst_dtype),
-                                  size, nullptr);
-    CHECK_CNRT_RET(error_code, "[EasyDK InferServer] Cast data type failed.", false);
+    if (!CastHost(src_data, dst_data, src_dtype, dst_dtype, shape.BatchDataCount())) {
+      LOG(ERROR) << "[EasyDK InferServer] CastDataType(): Unsupported data type, (src) " << DataTypeStr(src_dtype)
+                 << ", (dst) " << DataTypeStr(dst_dtype);
+      return false;
+    }
   }
   return true;
 }
 
+bool TransLayout(const void *src_data, void *dst_data, const DataLayout &src_layout, const DataLayout &dst_layout,
+                 const Shape &shape) {
+  const size_t count = shape.BatchDataCount();
+  const size_t dst_size = GetTypeSize(dst_layout.dtype);
+  if (!GetTypeSize(src_layout.dtype) || !dst_size) {
+    LOG(ERROR) << "[EasyDK InferServer] TransLayout(): Unsupported data type, (src) " << DataTypeStr(src_layout.dtype)
+               << ", (dst) " << DataTypeStr(dst_layout.dtype);
+    return false;
+  }
+
+  bool trans_order = src_layout.order != dst_layout.order && shape.Size() >= 3;
+  // matrix of rows x cols per item to be transposed
+  size_t rows = 1, cols = 1;
+  if (trans_order) {
+    if (src_layout.order == DimOrder::NHWC && dst_layout.order == DimOrder::NCHW) {
+      cols = shape[shape.Size() - 1];
+      for (size_t i = 1; i < shape.Size() - 1; ++i) rows *= shape[i];
+    } else if (src_layout.order == DimOrder::NCHW && dst_layout.order == DimOrder::NHWC) {
+      rows = shape[1];
+      for (size_t i = 2; i < shape.Size(); ++i) cols *= shape[i];
+    } else {
+      LOG(ERROR) << "[EasyDK InferServer] TransLayout(): Unsupported dim order, (src) " << DimOrderStr(src_layout.order)
+                 << ", (dst) " << DimOrderStr(dst_layout.order);
+      return false;
+    }
+  }
+
+  if (!trans_order) {
+    if (src_layout.dtype == dst_layout.dtype) {
+      memcpy(dst_data, src_data, count * dst_size);
+      return true;
+    }
+    return CastHost(src_data, dst_data, src_layout.dtype, dst_layout.dtype, count);
+  }
+
+  if (src_layout.dtype == dst_layout.dtype) {
+    return TransposeHost(src_data, dst_data, shape[0], rows, cols, dst_size);
+  }
+  // cast first, transpose moves the data in destination type
+  std::vector<uint8_t> casted(count * dst_size);
+  if (!CastHost(src_data, casted.data(), src_layout.dtype, dst_layout.dtype, count)) {
+    LOG(ERROR) << "[EasyDK InferServer] TransLayout(): Unsupported data type, (src) " << DataTypeStr(src_layout.dtype)
+               << ", (dst) " << DataTypeStr(dst_layout.dtype);
+    return false;
+  }
+  return TransposeHost(casted.data(), dst_data, shape[0], rows, cols, dst_size);
+}
+
 }  // namespace detail
 
 size_t GetTypeSize(DataType type) noexcept {
@@ -87,6 +130,8 @@ size_t GetTypeSize(DataType type) noexcept {
       return sizeof(int32_t);
     case DataType::INT16:
       return sizeof(int16_t);
+    case DataType::INT8:
+      return sizeof(int8_t);
     default:
       LOG(ERROR) << "[EasyDK InferServer] GetTypeSize(): Unsupported data type";
       return 0;
@@ -50,6 +50,7 @@ inline std::string DataTypeStr(DataType type) noexcept {
     DATATYPE2STR(FLOAT32)
     DATATYPE2STR(INT32)
     DATATYPE2STR(INT16)
+    DATATYPE2STR(INT8)
 #undef DATATYPE2STR
     default:
       LOG(ERROR) << "[EasyDK InferServer] DataTypeStr(): Unsupported data type";
@@ -86,6 +87,7 @@ inline cnrtDataType CastDataType(DataType type) noexcept {
     RETURN_DATA_TYPE(FLOAT32)
     RETURN_DATA_TYPE(INT32)
     RETURN_DATA_TYPE(INT16)
+    RETURN_DATA_TYPE(INT8)
 #undef RETURN_DATA_TYPE
     default:
       LOG(ERROR) << "[EasyDK InferServer] CastDataType(): Unsupported data type";
@@ -103,6 +105,7 @@ inline DataType CastDataType(magicmind::DataType type) noexcept {
     RETURN_DATA_TYPE(FLOAT32)
     RETURN_DATA_TYPE(INT32)
     RETURN_DATA_TYPE(INT16)
+    RETURN_DATA_TYPE(INT8)
 #undef RETURN_DATA_TYPE
     default:
       LOG(ERROR) << "[EasyDK InferServer] CastDataType(): Unsupported MagicMind data type";
@@ -120,6 +123,7 @@ inline DataType CastDataType(cnrtDataType type) noexcept {
     RETURN_DATA_TYPE(FLOAT32)
     RETURN_DATA_TYPE(INT32)
     RETURN_DATA_TYPE(INT16)
+    RETURN_DATA_TYPE(INT8)
 #undef RETURN_DATA_TYPE
     default:
       LOG(ERROR) << "[EasyDK InferServer] CastDataType(): Unsupported CNRT data type";
@@ -152,6 +156,22 @@ inline DimOrder CastDimOrder(magicmind::Layout order) noexcept {
 // shape corresponding to src_data
 bool CastDataType(void *src_data, void *dst_data, DataType src_dtype, DataType dst_dtype, const Shape &shape);
 
+/**
+ * @brief Converts data type and dim order of host data
+ *
+ * Supports any data type conversion of CastDataType, and NCHW to NHWC or NHWC to NCHW. Dim order is not changed
+ * if it is the same in both layouts, or the shape has less than 3 dimensions.
+ *
+ * @param src_data source data
+ * @param dst_data destination data, must not overlap with src_data
+ * @param src_layout layout of src_data
+ * @param dst_layout layout of dst_data
+ * @param shape shape of src_data, interpreted by the order of src_layout
+ * @return true if succeeded
+ */
+bool TransLayout(const void *src_data, void *dst_data, const DataLayout &src_layout, const DataLayout &dst_layout,
+                 const Shape &shape);
+
 }  // namespace detail
 
 template <typename dtype>
@@ -24,6 +24,7 @@
 
 #include <map>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -34,23 +35,48 @@
 namespace infer_server {
 
 void TaskNode::Execute(PackagePtr pack) {
-  Status s;
+  // pack may be done by another thread before this returns, engine owning this node is kept till then
+  ++*executing_;
 #if defined(CNIS_RECORD_PERF) && (!defined(NDEBUG))
   auto before_lock = Clock::Now();
 #endif
   std::unique_lock<std::mutex> lk = processor_->Lock();
+  Clock::time_point start{};
 #ifdef CNIS_RECORD_PERF
-  auto start = Clock::Now();
+  start = Clock::Now();
+#ifndef NDEBUG
+  pack->perf["-WaitLock-" + processor_->TypeName()] = Clock::Duration(before_lock, start);
+#endif
 #endif
-  s = processor_->Process(pack);
+  // synchronous processor invokes done before ProcessAsync returns, finish it after processor is unlocked.
+  // asynchronous processor invokes done from its own thread, which finishes the pack directly.
+  struct InlineState {
+    std::thread::id caller = std::this_thread::get_id();
+    bool in_call = true;
+    bool done = false;
+    Status s = Status::SUCCESS;
+  };
+  auto state = std::make_shared<InlineState>();
+  processor_->ProcessAsync(pack, [this, pack, start, state](Status s) mutable {
+    if (std::this_thread::get_id() == state->caller && state->in_call) {
+      state->done = true;
+      state->s = s;
+      return;
+    }
+    Finish(s, std::move(pack), start);
+  });
+  state->in_call = false;
   lk.unlock();
+  if (state->done) Finish(state->s, std::move(pack), start);
+  pack.reset();
+  // nothing of this node should be touched after the counter drops
+  --*executing_;
+}
+
+void TaskNode::Finish(Status s, PackagePtr&& pack, const Clock::time_point& start) noexcept {
   const std::string& type_name = processor_->TypeName();
 #ifdef CNIS_RECORD_PERF
-  auto end = Clock::Now();
-  pack->perf[type_name] = Clock::Duration(start, end);
-#ifndef NDEBUG
-  pack->perf["-WaitLock-" + type_name] = Clock::Duration(before_lock, start);
-#endif
+  pack->perf[type_name] = Clock::Duration(start, Clock::Now());
 #endif
   if (s != Status::SUCCESS) {
     LOG(ERROR) << "[EasyDK InferServer] [TaskNode] Execute(): processor [" << type_name << "] execute failed";
@@ -92,10 +118,11 @@ Engine::Engine(std::vector<std::shared_ptr<Processor>> processors, NotifyDoneFun
   for (size_t idx = 0; idx < processors.size(); ++idx) {
     nodes_.emplace_back(processors[idx],
                         [this]() {
-                          --task_num_;
+                          // engine may be destroyed once task number decreases
                           done_notifier_(this);
+                          --task_num_;
                         },
-                        tp_);
+                        tp_, &executing_);
   }
   for (size_t idx = 0; idx < nodes_.size() - 1; ++idx) {
     nodes_[idx].Link(&nodes_[idx + 1]);
@@ -109,9 +136,9 @@ std::unique_ptr<Engine> Engine::Fork() {
   fork_engine->nodes_.reserve(nodes_.size());
   for (auto& it : nodes_) {
     fork_engine->nodes_.emplace_back(it.Fork([fork_engine]() {
-      --fork_engine->task_num_;
       fork_engine->done_notifier_(fork_engine);
-    }));
+      --fork_engine->task_num_;
+    }, &fork_engine->executing_));
   }
   for (size_t idx = 0; idx < fork_engine->nodes_.size() - 1; ++idx) {
     fork_engine->nodes_[idx].Link(&fork_engine->nodes_[idx + 1]);
@@ -21,6 +21,7 @@
 #ifndef INFER_SERVER_CORE_ENGINE_H_
 #define INFER_SERVER_CORE_ENGINE_H_
 
+#include <atomic>
 #include <functional>
 #include <list>
 #include <memory>
@@ -30,6 +31,7 @@
 #include <vector>
 
 #include "cnis/infer_server.h"
+#include "profile.h"
 #include "util/thread_pool.h"
 
 namespace infer_server {
@@ -38,17 +40,27 @@ class Engine;
 class TaskNode {
  public:
   using Notifier = std::function<void()>;
-  TaskNode(std::shared_ptr<Processor> processor, Notifier&& done_notifier, PriorityThreadPool* tp) noexcept
-      : processor_(processor), done_notifier_(std::forward<Notifier>(done_notifier)), tp_(tp) {}
-
-  TaskNode Fork(Notifier&& done_notifier) {
+  /**
+   * @param processor Processor of this node
+   * @param done_notifier Invoked once a pack leaves the engine
+   * @param tp Thread pool running nodes
+   * @param executing Counter of Execute calls not returned yet, node is in use until it drops
+   */
+  TaskNode(std::shared_ptr<Processor> processor, Notifier&& done_notifier, PriorityThreadPool* tp,
+           std::atomic<uint32_t>* executing) noexcept
+      : processor_(processor), done_notifier_(std::forward<Notifier>(done_notifier)), tp_(tp), executing_(executing) {}
+
+  TaskNode Fork(Notifier&& done_notifier, std::atomic<uint32_t>* executing) {
     auto fork_proc = processor_->Fork();
     if (!fork_proc) throw std::runtime_error("Fork processor failed: " + processor_->TypeName());
-    return TaskNode(std::move(fork_proc), std::forward<Notifier>(done_notifier), tp_);
+    return TaskNode(std::move(fork_proc), std::forward<Notifier>(done_notifier), tp_, executing);
   }
 
   void Execute(PackagePtr pack);
 
+  // invoked once processor finished processing pack
+  void Finish(Status s, PackagePtr&& pack, const Clock::time_point& start) noexcept;
+
   void Transmit(PackagePtr&& data) noexcept;
 
   void Link(TaskNode* node) noexcept { downnode_ = node; }
@@ -58,6 +70,7 @@ class TaskNode {
   std::shared_ptr<Processor> processor_;
   Notifier done_notifier_;
   PriorityThreadPool* tp_;
+  std::atomic<uint32_t>* executing_;
   TaskNode* downnode_{nullptr};
 };  // struct TaskNode
 
@@ -67,7 +80,7 @@ class Engine {
   Engine() = default;
   Engine(std::vector<std::shared_ptr<Processor>> processors, NotifyDoneFunc&& done_func, PriorityThreadPool* tp);
   ~Engine() {
-    while (task_num_.load()) {
+    while (taskNum()) {
       // wait for all task done
     }
   }
@@ -81,7 +94,8 @@ class Engine {
 
   bool IsIdle() noexcept { return task_num_.load() < nodes_.size(); }
 
-  uint32_t taskNum() const { return task_num_.load();}
+  /// number of packs in engine, including the ones done by asynchronous processors but still in TaskNode::Execute
+  uint32_t taskNum() const { return task_num_.load() + executing_.load(); }
 
   size_t MaxLoad() noexcept { return nodes_.size(); }
 
@@ -90,6 +104,7 @@ class Engine {
   NotifyDoneFunc done_notifier_;
   PriorityThreadPool* tp_;
   std::atomic<uint32_t> task_num_{0};
+  std::atomic<uint32_t> executing_{0};
 };  // class Engine
 
 }  // namespace infer_server
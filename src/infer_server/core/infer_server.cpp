@@ -86,7 +86,7 @@ class InferServerPrivate {
       size_t thread_num = tp_->Size();
       static size_t max_thread_num = 3 * GetCpuCoreNumber();
       if (thread_num < max_thread_num) {
-        tp_->Resize(std::min(thread_num + 4 * desc.engine_num, max_thread_num));
+        tp_->Resize(std::min(thread_num + 4 * executor->GetMaxEngineNum(), max_thread_num));
       }
       tp_lk.unlock();
       return executor;
@@ -107,7 +107,7 @@ class InferServerPrivate {
     if (!executor->GetSessionNum()) {
       auto name = executor->GetName();
       if (executor_map_.count(name)) {
-        auto th_num = 4 * executor->GetEngineNum();
+        auto th_num = 4 * executor->GetMaxEngineNum();
         VLOG(1) << "[EasyDK InferServer] CheckAndDestroyExecutor(): Destroy executor: " << name;
         executor_map_.erase(name);
         lk.unlock();
@@ -173,6 +173,7 @@ Session_t InferServer::CreateSession(SessionDesc desc, std::shared_ptr<Observer>
   if (!executor) return nullptr;
 
   auto* session = new Session(desc.name, executor, !(observer), desc.show_perf);
+  session->RecordWarmUp(executor->GetWarmUpBatchNum(), executor->GetWarmUpTime());
   if (observer) {
     // async link
     session->SetObserver(std::move(observer));
@@ -300,6 +301,11 @@ ModelPtr InferServer::LoadModel(void* mem_cache, size_t size, const std::vector<
   return ModelManager::Instance()->Load(mem_cache, size, in_shapes);
 }
 
+std::future<ModelPtr> InferServer::PreloadModel(const std::string& model_uri, const std::vector<Shape>& in_shapes,
+                                                const std::vector<int>& device_ids, int runner_num) noexcept {
+  return ModelManager::Instance()->Preload(model_uri, in_shapes, device_ids, runner_num);
+}
+
 bool InferServer::UnloadModel(ModelPtr model) noexcept { return ModelManager::Instance()->Unload(std::move(model)); }
 
 void InferServer::ClearModelCache() noexcept { ModelManager::Instance()->ClearCache(); }
@@ -320,4 +326,12 @@ ThroughoutStatistic InferServer::GetThroughout(Session_t session) const noexcept
 ThroughoutStatistic InferServer::GetThroughout(Session_t session, const std::string& tag) const noexcept { return {}; }
 #endif
 
+PaddingStatistic InferServer::GetPadding(Session_t session) const noexcept {
+  return session->GetExecutor()->GetPadding();
+}
+
+uint32_t InferServer::GetEngineNum(Session_t session) const noexcept {
+  return session->GetExecutor()->GetEngineNum();
+}
+
 }  // namespace infer_server
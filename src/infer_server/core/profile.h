@@ -21,6 +21,8 @@
 #ifndef INFER_SERVER_CORE_PROFILE_H_
 #define INFER_SERVER_CORE_PROFILE_H_
 
+#include <glog/logging.h>
+
 #include <chrono>
 #include <limits>
 #include <map>
@@ -20,8 +20,13 @@
 
 #include "session.h"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <list>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -48,11 +53,19 @@ Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_i
   if (desc_.preproc->Init() != Status::SUCCESS)
     throw std::runtime_error(desc_.preproc->TypeName() + "] Init processors failed");
 
-  predictor->SetParams("model_info", desc_.model, "device_id", device_id_);
+  predictor->SetParams("model_info", desc_.model, "device_id", device_id_, "inflight_num", desc_.inflight_num);
+  if (!desc_.shape_buckets.empty()) {
+    bucketer_ = std::make_shared<ShapeBucketer>(desc_.shape_buckets, desc_.model->InputShape(0),
+                                                desc_.model->InputLayout(0).order);
+    predictor->SetParams("shape_bucketer", bucketer_);
+  }
   if (predictor->Init() != Status::SUCCESS)
     throw std::runtime_error(predictor->TypeName() + "] Init processors failed");
 
   desc_.postproc->SetParams("model_info", desc_.model, "device_id", device_id_);
+  if (desc_.host_output_layout.dtype != DataType::INVALID) {
+    desc_.postproc->SetParams("output_layout", desc_.host_output_layout);
+  }
   if (desc_.postproc->Init() != Status::SUCCESS)
     throw std::runtime_error(desc_.postproc->TypeName() + "] Init processors failed");
 
@@ -69,6 +82,7 @@ Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_i
     engines_.emplace_back(engines_[0]->Fork());
   }
   idle_.store(engines_[0].get());
+  engine_num_.store(engines_.size());
 
   // for(auto &it:engines_) {
   //  std::unique_lock<std::mutex> lk(idle_queue_mutex_);
@@ -76,7 +90,7 @@ Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_i
   // }
 
   // TODO(dmh): 3 is number of processors, refactor to adjustable
-  max_processing_num_ = 4 * desc_.engine_num * 3 * desc_.model->BatchSize();
+  max_processing_num_ = 4 * GetMaxEngineNum() * 3 * desc_.model->BatchSize();
 
   // init cache
   if (desc_.strategy == BatchStrategy::DYNAMIC) {
@@ -88,10 +102,81 @@ Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_i
   }
   cache_->Start();
 
+  if (desc_.warmup_data) {
+    auto start = Clock::Now();
+    std::vector<Engine*> engines;
+    for (auto& engine : engines_) engines.push_back(engine.get());
+    warmup_batch_num_ = WarmUp(engines);
+    idle_.store(engines_[0].get());
+    warmup_time_ = Clock::DurationSince(start);
+    VLOG(1) << "[EasyDK InferServer] [Executor] " << desc_.name << "] Warm up done, " << warmup_batch_num_
+            << " batches, " << warmup_time_ << " ms";
+  }
   dispatch_thread_ = std::thread(&Executor::DispatchLoop, this);
+
+  if (desc_.max_engine_num > desc_.engine_num) {
+    EngineScaler::Config config;
+    config.min_engine_num = desc_.engine_num;
+    config.max_engine_num = desc_.max_engine_num;
+    scaler_.reset(new EngineScaler(config));
+    scaling_ = true;
+    scale_thread_ = std::thread(&Executor::ScaleLoop, this);
+  }
+}
+
+uint32_t Executor::WarmUp(const std::vector<Engine*>& engines) noexcept {
+  uint32_t batch_num = 0;
+  uint32_t batch_size = desc_.model->BatchSize();
+  // all engines process batches of the same size at the same time
+  for (uint32_t num = 1; num <= batch_size; ++num) {
+    std::vector<std::unique_ptr<RequestControl>> ctrls;
+    std::vector<std::future<bool>> results;
+    std::vector<std::future<void>> released;
+    for (Engine* engine : engines) {
+      auto done = std::make_shared<std::promise<bool>>();
+      results.emplace_back(done->get_future());
+      ctrls.emplace_back(new RequestControl([](Status, PackagePtr) {},
+                                            [done](const RequestControl* ctrl) { done->set_value(ctrl->IsSuccess()); },
+                                            "warmup", -1, num));
+      // request control is in use until engine releases the package
+      auto release = std::make_shared<std::promise<void>>();
+      released.emplace_back(release->get_future());
+      PackagePtr pack(new Package, [release](Package* p) {
+        delete p;
+        release->set_value();
+      });
+      pack->data.reserve(num);
+      for (uint32_t idx = 0; idx < num; ++idx) {
+        auto data = std::make_shared<InferData>();
+        data->data = desc_.warmup_data->data;
+        data->user_data = desc_.warmup_data->user_data;
+        data->ctrl = ctrls.back().get();
+        data->index = idx;
+        pack->data.emplace_back(std::move(data));
+      }
+      engine->Run(std::move(pack));
+    }
+    for (auto& result : results) {
+      if (!result.get()) {
+        LOG(WARNING) << "[EasyDK InferServer] [Executor] " << desc_.name << "] Warm up with batch size " << num
+                     << " failed";
+      }
+    }
+    for (auto& release : released) release.wait();
+    batch_num += engines.size();
+  }
+  return batch_num;
 }
 
 Executor::~Executor() {
+  if (scale_thread_.joinable()) {
+    {
+      std::unique_lock<std::mutex> scale_lk(scale_mutex_);
+      scaling_ = false;
+    }
+    scale_cond_.notify_one();
+    scale_thread_.join();
+  }
   std::unique_lock<std::mutex> lk(link_mutex_);
   for (auto& session : link_set_) {
     delete session;
@@ -107,9 +192,98 @@ Executor::~Executor() {
   cache_.reset();
   CHECK(link_set_.empty()) << "[EasyDK InferServer] [Executor] Should not have any session in destructor";
   idle_.store(nullptr);
+  retired_.clear();
   engines_.clear();
 }
 
+Engine* Executor::PickIdle() noexcept {
+  Engine* idle = idle_.exchange(nullptr);
+  // engine notified done may have been retired
+  if (idle && std::none_of(engines_.begin(), engines_.end(),
+                           [idle](const std::unique_ptr<Engine>& it) { return it.get() == idle; })) {
+    idle = nullptr;
+  }
+  if (!idle) {
+    // find idle engine
+    for (auto& it : engines_) {
+      if (it->IsIdle()) {
+        idle = it.get();
+        break;
+      }
+    }
+  }
+  return idle;
+}
+
+void Executor::ScaleLoop() noexcept {
+  constexpr uint32_t kSampleIntervalMs = 100;
+  std::unique_lock<std::mutex> scale_lk(scale_mutex_);
+  while (!scale_cond_.wait_for(scale_lk, std::chrono::milliseconds(kSampleIntervalMs), [this] { return !scaling_; })) {
+    scale_lk.unlock();
+    Scale();
+    scale_lk.lock();
+  }
+}
+
+void Executor::Scale() noexcept {
+  LoadSample sample;
+  sample.cache_depth = cache_->Size();
+  uint32_t batch_num = dispatch_batch_num_.exchange(0);
+  uint32_t unit_num = dispatch_unit_num_.exchange(0);
+  if (batch_num) sample.batch_fill = static_cast<float>(unit_num) / (batch_num * desc_.model->BatchSize());
+
+  std::vector<std::unique_ptr<Engine>> finished;
+  uint32_t engine_num = 0, idle_num = 0;
+  {
+    std::unique_lock<std::mutex> engine_lk(engine_mutex_);
+    engine_num = engines_.size();
+    for (auto& it : engines_) {
+      if (!it->taskNum()) ++idle_num;
+    }
+    for (auto it = retired_.begin(); it != retired_.end();) {
+      if (!(*it)->taskNum()) {
+        finished.emplace_back(std::move(*it));
+        it = retired_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  // release resources of retired engines out of lock
+  finished.clear();
+  sample.idle_ratio = static_cast<float>(idle_num) / engine_num;
+
+  int change = scaler_->Update(sample, engine_num);
+  if (change > 0) {
+    std::unique_ptr<Engine> engine;
+    try {
+      // the first engine is never retired, and engines_ is changed only by this thread
+      engine = engines_[0]->Fork();
+    } catch (std::runtime_error& e) {
+      LOG(WARNING) << "[EasyDK InferServer] [Executor] " << desc_.name << "] Add engine failed: " << e.what();
+      return;
+    }
+    // engine is not dispatched to before warmed up, done notification of warm-up is ignored by PickIdle
+    if (desc_.warmup_data) WarmUp({engine.get()});
+    Engine* added = engine.get();
+    {
+      std::unique_lock<std::mutex> engine_lk(engine_mutex_);
+      engines_.emplace_back(std::move(engine));
+      engine_num_.store(engines_.size());
+    }
+    idle_.store(added);
+    dispatch_cond_.notify_one();
+    VLOG(1) << "[EasyDK InferServer] [Executor] " << desc_.name << "] Add engine, engine number: " << engine_num + 1;
+  } else if (change < 0) {
+    // retired engine finishes its tasks, no more task is dispatched to it
+    std::unique_lock<std::mutex> engine_lk(engine_mutex_);
+    retired_.emplace_back(std::move(engines_.back()));
+    engines_.pop_back();
+    engine_num_.store(engines_.size());
+    VLOG(1) << "[EasyDK InferServer] [Executor] " << desc_.name << "] Retire engine, engine number: " << engine_num - 1;
+  }
+}
+
 void Executor::DispatchLoop() noexcept {
 #if 1
   std::unique_lock<std::mutex> dispatch_lk(dispatch_mutex_, std::defer_lock);
@@ -123,27 +297,21 @@ void Executor::DispatchLoop() noexcept {
     size_t batch_size = pack->data.size();
     batch_record_.unit_cnt += 1;
     batch_record_.total += batch_size;
+    dispatch_batch_num_.fetch_add(1);
+    dispatch_unit_num_.fetch_add(batch_size);
 
-    // dispatch to engine
-    Engine* idle{nullptr};
-    if (idle_) {
-      idle = idle_.exchange(idle);
-    } else {
-      // find idle engine
-      for (auto& it : engines_) {
-        if (it->IsIdle()) {
-          idle = it.get();
-          break;
-        }
-      }
-      if (!idle) {
-        dispatch_lk.lock();
-        dispatch_cond_.wait(dispatch_lk, [this]() -> bool { return idle_; });
-        dispatch_lk.unlock();
-        idle = idle_.exchange(idle);
-      }
+    // dispatch to engine, engine is not retired until task is pushed to it
+    std::unique_lock<std::mutex> engine_lk(engine_mutex_);
+    Engine* idle = PickIdle();
+    while (!idle) {
+      engine_lk.unlock();
+      dispatch_lk.lock();
+      dispatch_cond_.wait(dispatch_lk, [this]() -> bool { return idle_; });
+      dispatch_lk.unlock();
+      engine_lk.lock();
+      idle = PickIdle();
     }
-    VLOG(2) << "[EasyDK InferServer] [Executor] " << desc_.name << "] dispatch to engine " << idle_;
+    VLOG(2) << "[EasyDK InferServer] [Executor] " << desc_.name << "] dispatch to engine " << idle;
     idle->Run(std::move(pack));
   }
 #else
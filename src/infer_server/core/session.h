@@ -37,8 +37,10 @@
 #include <vector>
 #include <queue>
 
+#include "autoscaler.h"
 #include "cache.h"
 #include "cnis/infer_server.h"
+#include "model/shape_bucket.h"
 #include "priority.h"
 #include "profile.h"
 #include "request_ctrl.h"
@@ -108,6 +110,12 @@ class Session {
 
   void DiscardTask(const std::string& tag) noexcept;
 
+  void RecordWarmUp(uint32_t batch_num, float time_ms) noexcept {
+#ifdef CNIS_RECORD_PERF
+    if (batch_num) recorder_.RecordPerformance("WarmUp", batch_num, time_ms);
+#endif
+  }
+
 #ifdef CNIS_RECORD_PERF
   const std::map<std::string, LatencyStatistic>& GetPerformance() const noexcept { return recorder_.GetPerformance(); }
   ThroughoutStatistic GetThroughout(const std::string& tag) noexcept { return profiler_.Summary(tag); }
@@ -189,7 +197,16 @@ class Executor {
   const SessionDesc& GetDesc() const noexcept { return desc_; }
   const Priority& GetPriority() const noexcept { return cache_->GetPriority(); }
   std::string GetName() const noexcept { return desc_.name; }
-  uint32_t GetEngineNum() const noexcept { return desc_.engine_num; }
+  /// number of engines working now, changes with load if autoscaling is enabled
+  uint32_t GetEngineNum() const noexcept { return engine_num_.load(); }
+  /// upper bound of engine number
+  uint32_t GetMaxEngineNum() const noexcept { return std::max(desc_.engine_num, desc_.max_engine_num); }
+  /// number of batches processed in warm-up
+  uint32_t GetWarmUpBatchNum() const noexcept { return warmup_batch_num_; }
+  /// time cost of warm-up in milliseconds
+  float GetWarmUpTime() const noexcept { return warmup_time_; }
+  /// padding statistics of shape buckets, all zero if there is no bucket
+  PaddingStatistic GetPadding() const noexcept { return bucketer_ ? bucketer_->Statistic() : PaddingStatistic(); }
   PriorityThreadPool* GetThreadPool() const noexcept { return tp_; }
   /* ----------------- Observer END ------------------- */
 
@@ -209,6 +226,14 @@ class Executor {
   void DispatchLoop() noexcept;
 
  private:
+  // runs warm-up data through engines with each batch size, returns number of batches
+  uint32_t WarmUp(const std::vector<Engine*>& engines) noexcept;
+  // picks an idle engine, engine_mutex_ must be held
+  Engine* PickIdle() noexcept;
+  // samples load and forks or retires engines
+  void ScaleLoop() noexcept;
+  void Scale() noexcept;
+
   SessionDesc desc_;
   PriorityThreadPool* tp_;
   std::unique_ptr<CacheBase> cache_;
@@ -219,6 +244,11 @@ class Executor {
 
   // dispatch to engine
   std::vector<std::unique_ptr<Engine>> engines_;
+  // engines removed by autoscaler, destroyed once their tasks are done
+  std::vector<std::unique_ptr<Engine>> retired_;
+  // guards engines_ and retired_, engines_ is changed only by scale thread
+  std::mutex engine_mutex_;
+  std::atomic<uint32_t> engine_num_{0};
   std::atomic<Engine*> idle_{nullptr};
   // std::queue<Engine*> idle_queue_;
   // std::mutex  idle_queue_mutex_;
@@ -226,6 +256,15 @@ class Executor {
   std::mutex dispatch_mutex_;
   std::condition_variable dispatch_cond_;
 
+  // autoscaling
+  std::unique_ptr<EngineScaler> scaler_;
+  std::thread scale_thread_;
+  std::mutex scale_mutex_;
+  std::condition_variable scale_cond_;
+  bool scaling_{false};
+  std::atomic<uint32_t> dispatch_batch_num_{0};
+  std::atomic<uint32_t> dispatch_unit_num_{0};
+
   // processing number limit
   std::mutex limit_mutex_;
   std::condition_variable limit_cond_;
@@ -234,6 +273,9 @@ class Executor {
   uint32_t max_processing_num_;
 
   LatencyStatistic batch_record_;
+  uint32_t warmup_batch_num_{0};
+  float warmup_time_{0};
+  std::shared_ptr<ShapeBucketer> bucketer_;
   std::atomic_bool running_{false};
   int device_id_;
 };  // class Executor
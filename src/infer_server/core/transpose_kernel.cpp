@@ -0,0 +1,306 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "core/transpose_kernel.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "../../common/host_worker_pool.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TRANSPOSE_KERNEL_SIMD
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#define TRANSPOSE_KERNEL_SIMD
+#include <arm_neon.h>
+#endif
+
+namespace infer_server {
+namespace detail {
+
+namespace {
+
+// batches smaller than this in bytes are not worth waking up workers
+constexpr size_t kParallelThreshold = 1 << 20;
+
+template <typename T>
+struct TileTraits {
+  // edge of the square walked at a time, source and destination blocks stay in L1
+  static constexpr size_t kBlock = sizeof(T) == 4 ? 32 : 64;
+};
+
+template <typename T>
+inline void TransposeScalar(const T *src, size_t src_stride, T *dst, size_t dst_stride, size_t rows, size_t cols) {
+  for (size_t r = 0; r < rows; ++r) {
+    for (size_t c = 0; c < cols; ++c) dst[c * dst_stride + r] = src[r * src_stride + c];
+  }
+}
+
+// few channels, (de)interleave with the channel number known at compile time
+template <typename T, int N>
+void Deinterleave(const T *src, T *dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    for (int k = 0; k < N; ++k) dst[k * n + i] = src[i * N + k];
+  }
+}
+
+template <typename T, int N>
+void Interleave(const T *src, T *dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    for (int k = 0; k < N; ++k) dst[i * N + k] = src[k * n + i];
+  }
+}
+
+template <typename T>
+bool TransposeNarrow(const T *src, T *dst, size_t rows, size_t cols) {
+  switch (cols) {
+    case 1:
+      std::copy(src, src + rows, dst);
+      return true;
+    case 2:
+      Deinterleave<T, 2>(src, dst, rows);
+      return true;
+    case 3:
+      Deinterleave<T, 3>(src, dst, rows);
+      return true;
+    case 4:
+      Deinterleave<T, 4>(src, dst, rows);
+      return true;
+    default:
+      break;
+  }
+  switch (rows) {
+    case 1:
+      std::copy(src, src + cols, dst);
+      return true;
+    case 2:
+      Interleave<T, 2>(src, dst, cols);
+      return true;
+    case 3:
+      Interleave<T, 3>(src, dst, cols);
+      return true;
+    case 4:
+      Interleave<T, 4>(src, dst, cols);
+      return true;
+    default:
+      return false;
+  }
+}
+
+#ifdef TRANSPOSE_KERNEL_SIMD
+// 128-bit register with the few operations the tiles need, lanes are moved bitwise
+#if defined(__x86_64__) || defined(__i386__)
+using Vec = __m128i;
+inline Vec Load16(const void *p) { return _mm_loadu_si128(static_cast<const __m128i *>(p)); }
+inline Vec Load8(const void *p) { return _mm_loadl_epi64(static_cast<const __m128i *>(p)); }
+inline void Store16(void *p, Vec v) { _mm_storeu_si128(static_cast<__m128i *>(p), v); }
+inline void StoreLo8(void *p, Vec v) { _mm_storel_epi64(static_cast<__m128i *>(p), v); }
+inline void StoreHi8(void *p, Vec v) { _mm_storel_epi64(static_cast<__m128i *>(p), _mm_unpackhi_epi64(v, v)); }
+inline Vec ZipLo8(Vec a, Vec b) { return _mm_unpacklo_epi8(a, b); }
+inline Vec ZipLo16(Vec a, Vec b) { return _mm_unpacklo_epi16(a, b); }
+inline Vec ZipHi16(Vec a, Vec b) { return _mm_unpackhi_epi16(a, b); }
+inline Vec ZipLo32(Vec a, Vec b) { return _mm_unpacklo_epi32(a, b); }
+inline Vec ZipHi32(Vec a, Vec b) { return _mm_unpackhi_epi32(a, b); }
+inline Vec ZipLo64(Vec a, Vec b) { return _mm_unpacklo_epi64(a, b); }
+inline Vec ZipHi64(Vec a, Vec b) { return _mm_unpackhi_epi64(a, b); }
+#else
+using Vec = uint8x16_t;
+inline Vec Load16(const void *p) { return vld1q_u8(static_cast<const uint8_t *>(p)); }
+inline Vec Load8(const void *p) { return vcombine_u8(vld1_u8(static_cast<const uint8_t *>(p)), vdup_n_u8(0)); }
+inline void Store16(void *p, Vec v) { vst1q_u8(static_cast<uint8_t *>(p), v); }
+inline void StoreLo8(void *p, Vec v) { vst1_u8(static_cast<uint8_t *>(p), vget_low_u8(v)); }
+inline void StoreHi8(void *p, Vec v) { vst1_u8(static_cast<uint8_t *>(p), vget_high_u8(v)); }
+inline Vec ZipLo8(Vec a, Vec b) { return vzip1q_u8(a, b); }
+inline Vec ZipLo16(Vec a, Vec b) {
+  return vreinterpretq_u8_u16(vzip1q_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+}
+inline Vec ZipHi16(Vec a, Vec b) {
+  return vreinterpretq_u8_u16(vzip2q_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+}
+inline Vec ZipLo32(Vec a, Vec b) {
+  return vreinterpretq_u8_u32(vzip1q_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+}
+inline Vec ZipHi32(Vec a, Vec b) {
+  return vreinterpretq_u8_u32(vzip2q_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+}
+inline Vec ZipLo64(Vec a, Vec b) {
+  return vreinterpretq_u8_u64(vzip1q_u64(vreinterpretq_u64_u8(a), vreinterpretq_u64_u8(b)));
+}
+inline Vec ZipHi64(Vec a, Vec b) {
+  return vreinterpretq_u8_u64(vzip2q_u64(vreinterpretq_u64_u8(a), vreinterpretq_u64_u8(b)));
+}
+#endif
+
+// register tiles, strides are in elements
+template <typename T>
+struct Tile;
+
+template <>
+struct Tile<uint8_t> {
+  static constexpr size_t kSize = 8;
+  static void Transpose(const uint8_t *src, size_t ss, uint8_t *dst, size_t ds) {
+    Vec t0 = ZipLo8(Load8(src), Load8(src + ss));
+    Vec t1 = ZipLo8(Load8(src + 2 * ss), Load8(src + 3 * ss));
+    Vec t2 = ZipLo8(Load8(src + 4 * ss), Load8(src + 5 * ss));
+    Vec t3 = ZipLo8(Load8(src + 6 * ss), Load8(src + 7 * ss));
+    // columns 0-3 and 4-7 of rows 0-3 and rows 4-7
+    Vec u0 = ZipLo16(t0, t1), u1 = ZipHi16(t0, t1);
+    Vec u2 = ZipLo16(t2, t3), u3 = ZipHi16(t2, t3);
+    // two whole columns in each register
+    Vec v0 = ZipLo32(u0, u2), v1 = ZipHi32(u0, u2);
+    Vec v2 = ZipLo32(u1, u3), v3 = ZipHi32(u1, u3);
+    StoreLo8(dst, v0);
+    StoreHi8(dst + ds, v0);
+    StoreLo8(dst + 2 * ds, v1);
+    StoreHi8(dst + 3 * ds, v1);
+    StoreLo8(dst + 4 * ds, v2);
+    StoreHi8(dst + 5 * ds, v2);
+    StoreLo8(dst + 6 * ds, v3);
+    StoreHi8(dst + 7 * ds, v3);
+  }
+};
+
+template <>
+struct Tile<uint16_t> {
+  static constexpr size_t kSize = 8;
+  static void Transpose(const uint16_t *src, size_t ss, uint16_t *dst, size_t ds) {
+    Vec a[8], t[8];
+    for (int i = 0; i < 8; ++i) a[i] = Load16(src + i * ss);
+    for (int i = 0; i < 4; ++i) {
+      t[2 * i] = ZipLo16(a[2 * i], a[2 * i + 1]);
+      t[2 * i + 1] = ZipHi16(a[2 * i], a[2 * i + 1]);
+    }
+    // columns {0,1}, {2,3}, {4,5}, {6,7} of rows 0-3, then of rows 4-7
+    a[0] = ZipLo32(t[0], t[2]);
+    a[1] = ZipHi32(t[0], t[2]);
+    a[2] = ZipLo32(t[1], t[3]);
+    a[3] = ZipHi32(t[1], t[3]);
+    a[4] = ZipLo32(t[4], t[6]);
+    a[5] = ZipHi32(t[4], t[6]);
+    a[6] = ZipLo32(t[5], t[7]);
+    a[7] = ZipHi32(t[5], t[7]);
+    for (int i = 0; i < 4; ++i) {
+      Store16(dst + 2 * i * ds, ZipLo64(a[i], a[i + 4]));
+      Store16(dst + (2 * i + 1) * ds, ZipHi64(a[i], a[i + 4]));
+    }
+  }
+};
+
+template <>
+struct Tile<uint32_t> {
+  static constexpr size_t kSize = 4;
+  static void Transpose(const uint32_t *src, size_t ss, uint32_t *dst, size_t ds) {
+    Vec a0 = Load16(src), a1 = Load16(src + ss), a2 = Load16(src + 2 * ss), a3 = Load16(src + 3 * ss);
+    Vec t0 = ZipLo32(a0, a1), t1 = ZipHi32(a0, a1);
+    Vec t2 = ZipLo32(a2, a3), t3 = ZipHi32(a2, a3);
+    Store16(dst, ZipLo64(t0, t2));
+    Store16(dst + ds, ZipHi64(t0, t2));
+    Store16(dst + 2 * ds, ZipLo64(t1, t3));
+    Store16(dst + 3 * ds, ZipHi64(t1, t3));
+  }
+};
+
+template <typename T>
+void TransposeBlockSimd(const T *src, size_t src_stride, T *dst, size_t dst_stride, size_t rows, size_t cols) {
+  constexpr size_t kTile = Tile<T>::kSize;
+  const size_t full_rows = rows - rows % kTile;
+  const size_t full_cols = cols - cols % kTile;
+  for (size_t r = 0; r < full_rows; r += kTile) {
+    for (size_t c = 0; c < full_cols; c += kTile) {
+      Tile<T>::Transpose(src + r * src_stride + c, src_stride, dst + c * dst_stride + r, dst_stride);
+    }
+  }
+  // ragged edges
+  TransposeScalar(src + full_cols, src_stride, dst + full_cols * dst_stride, dst_stride, rows, cols - full_cols);
+  TransposeScalar(src + full_rows * src_stride, src_stride, dst + full_rows, dst_stride, rows - full_rows,
+                  full_cols);
+}
+#endif  // TRANSPOSE_KERNEL_SIMD
+
+template <typename T>
+void TransposeMatrix(const T *src, T *dst, size_t rows, size_t cols, bool use_simd) {
+  if (TransposeNarrow(src, dst, rows, cols)) return;
+  constexpr size_t kBlock = TileTraits<T>::kBlock;
+  for (size_t r = 0; r < rows; r += kBlock) {
+    const size_t block_rows = std::min(kBlock, rows - r);
+    for (size_t c = 0; c < cols; c += kBlock) {
+      const size_t block_cols = std::min(kBlock, cols - c);
+      const T *s = src + r * cols + c;
+      T *d = dst + c * rows + r;
+#ifdef TRANSPOSE_KERNEL_SIMD
+      if (use_simd) {
+        TransposeBlockSimd(s, cols, d, rows, block_rows, block_cols);
+        continue;
+      }
+#endif
+      TransposeScalar(s, cols, d, rows, block_rows, block_cols);
+    }
+  }
+}
+
+template <typename T>
+void TransposeBatch(const void *src, void *dst, size_t first, size_t last, size_t rows, size_t cols, bool use_simd) {
+  const size_t step = rows * cols;
+  for (size_t b = first; b < last; ++b) {
+    TransposeMatrix(static_cast<const T *>(src) + b * step, static_cast<T *>(dst) + b * step, rows, cols, use_simd);
+  }
+}
+
+using BatchKernel = void (*)(const void *, void *, size_t, size_t, size_t, size_t, bool);
+
+}  // namespace
+
+bool TransposeHost(const void *src, void *dst, size_t batch, size_t rows, size_t cols, size_t elem_size,
+                   bool use_simd) noexcept {
+  BatchKernel kernel = nullptr;
+  switch (elem_size) {
+    case 1:
+      kernel = TransposeBatch<uint8_t>;
+      break;
+    case 2:
+      kernel = TransposeBatch<uint16_t>;
+      break;
+    case 4:
+      kernel = TransposeBatch<uint32_t>;
+      break;
+    default:
+      return false;
+  }
+  if (!batch || !rows || !cols) return true;
+
+  const size_t bytes = batch * rows * cols * elem_size;
+  cnedk::HostWorkerPool &pool = cnedk::HostWorkerPool::Instance();
+  if (batch == 1 || bytes < kParallelThreshold || pool.Concurrency() <= 1) {
+    kernel(src, dst, 0, batch, rows, cols, use_simd);
+    return true;
+  }
+  // shares the workers of host transforms, the calling thread takes part in the work
+  const size_t task_num = std::min<size_t>(pool.Concurrency(), batch);
+  const size_t share = (batch + task_num - 1) / task_num;
+  pool.ParallelFor(task_num, [&](uint32_t i) {
+    const size_t first = i * share;
+    if (first < batch) kernel(src, dst, first, std::min(first + share, batch), rows, cols, use_simd);
+  });
+  return true;
+}
+
+}  // namespace detail
+}  // namespace infer_server
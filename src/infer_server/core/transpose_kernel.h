@@ -0,0 +1,56 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_CORE_TRANSPOSE_KERNEL_H_
+#define INFER_SERVER_CORE_TRANSPOSE_KERNEL_H_
+
+#include <cstddef>
+
+namespace infer_server {
+namespace detail {
+
+/**
+ * @brief Transposes a batch of matrices on host
+ *
+ * Each matrix of rows x cols elements in src is written to dst as cols x rows, i.e.
+ * dst[b][c][r] = src[b][r][c]. NHWC to NCHW is rows = H * W, cols = C, and NCHW to NHWC is rows = C,
+ * cols = H * W. Elements are moved bitwise, so the data type only matters by its size.
+ *
+ * The matrices are walked in cache sized blocks, each block is transposed in SIMD register tiles
+ * (SSE2 on x86, NEON on aarch64). Large batches are split across the worker pool shared with host transforms
+ * (cnedk::HostWorkerPool).
+ *
+ * @param src source data
+ * @param dst destination data, must not overlap with src
+ * @param batch number of matrices
+ * @param rows number of rows of one source matrix
+ * @param cols number of columns of one source matrix
+ * @param elem_size size of element in bytes, 1, 2 or 4
+ * @param use_simd use SIMD tiles if supported by host, otherwise only scalar code is used
+ * @retval true succeeded
+ * @retval false element size is not supported
+ */
+bool TransposeHost(const void *src, void *dst, size_t batch, size_t rows, size_t cols, size_t elem_size,
+                   bool use_simd = true) noexcept;
+
+}  // namespace detail
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_CORE_TRANSPOSE_KERNEL_H_
@@ -0,0 +1,102 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "async_runner.h"
+
+#include <glog/logging.h>
+
+#include <memory>
+#include <utility>
+
+namespace infer_server {
+
+AsyncRunner::AsyncRunner(std::unique_ptr<IAsyncBackend> backend, std::function<void()> thread_init)
+    : backend_(std::move(backend)) {
+  CHECK(backend_) << "[EasyDK InferServer] [AsyncRunner] Backend is null";
+  CHECK_GT(backend_->SlotNum(), 0) << "[EasyDK InferServer] [AsyncRunner] Slot number must be greater than 0";
+  // the first slot is used first
+  for (int slot = backend_->SlotNum() - 1; slot >= 0; --slot) free_slots_.push_back(slot);
+  thread_ = std::thread(&AsyncRunner::CompleteLoop, this, std::move(thread_init));
+}
+
+AsyncRunner::~AsyncRunner() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    running_ = false;
+  }
+  job_cond_.notify_one();
+  // batches in flight are completed before thread quits
+  thread_.join();
+}
+
+void AsyncRunner::Submit(ModelIO* in, ModelIO* out, DoneFunc done) noexcept {
+  std::unique_lock<std::mutex> lk(mutex_);
+  slot_cond_.wait(lk, [this] { return !free_slots_.empty(); });
+  int slot = free_slots_.back();
+  free_slots_.pop_back();
+  lk.unlock();
+
+  Status s = backend_->Enqueue(slot, in, out);
+  if (s != Status::SUCCESS) {
+    LOG(ERROR) << "[EasyDK InferServer] [AsyncRunner] Enqueue batch failed, slot: " << slot;
+    lk.lock();
+    free_slots_.push_back(slot);
+    lk.unlock();
+    slot_cond_.notify_one();
+    done(s);
+    return;
+  }
+
+  lk.lock();
+  jobs_.push_back({slot, out, std::move(done)});
+  lk.unlock();
+  job_cond_.notify_one();
+}
+
+int AsyncRunner::InflightNum() noexcept {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return backend_->SlotNum() - static_cast<int>(free_slots_.size());
+}
+
+void AsyncRunner::CompleteLoop(std::function<void()> thread_init) noexcept {
+  if (thread_init) thread_init();
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (true) {
+    job_cond_.wait(lk, [this] { return !jobs_.empty() || !running_; });
+    if (jobs_.empty()) break;
+    Job job = std::move(jobs_.front());
+    jobs_.pop_front();
+    lk.unlock();
+
+    Status s = backend_->Sync(job.slot, job.out);
+    if (s != Status::SUCCESS) {
+      LOG(ERROR) << "[EasyDK InferServer] [AsyncRunner] Sync batch failed, slot: " << job.slot;
+    }
+    // slot is free before callback, so the next batch could be submitted in callback
+    lk.lock();
+    free_slots_.push_back(job.slot);
+    lk.unlock();
+    slot_cond_.notify_one();
+    job.done(s);
+    lk.lock();
+  }
+}
+
+}  // namespace infer_server
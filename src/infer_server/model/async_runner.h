@@ -0,0 +1,113 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_MODEL_ASYNC_RUNNER_H_
+#define INFER_SERVER_MODEL_ASYNC_RUNNER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "cnis/processor.h"
+
+namespace infer_server {
+
+/**
+ * @brief Device backend of AsyncRunner, each slot has its own queue and I/O, and runs one batch at a time
+ */
+class IAsyncBackend {
+ public:
+  virtual ~IAsyncBackend() = default;
+  /// Gets number of slots
+  virtual int SlotNum() const noexcept = 0;
+  /// Enqueues a batch on slot, returns before it is done
+  virtual Status Enqueue(int slot, ModelIO* in, ModelIO* out) noexcept = 0;
+  /// Waits for the batch on slot to be done, and fills output
+  virtual Status Sync(int slot, ModelIO* out) noexcept = 0;
+};
+
+/**
+ * @brief Keeps up to SlotNum() batches in flight on device
+ *
+ * Submit enqueues a batch on a free slot and returns, a completion thread waits for batches in submission order and
+ * invokes their callbacks, so that staging of the next batch overlaps with compute of the previous one.
+ */
+class AsyncRunner {
+ public:
+  /// invoked with status of batch once it is done
+  using DoneFunc = std::function<void(Status)>;
+
+  /**
+   * @brief Construct a new Async Runner object
+   *
+   * @param backend Device backend
+   * @param thread_init Invoked at start of the completion thread, e.g. to bind device
+   */
+  explicit AsyncRunner(std::unique_ptr<IAsyncBackend> backend, std::function<void()> thread_init = nullptr);
+
+  /**
+   * @brief Destroy the Async Runner object, waits for batches in flight
+   */
+  ~AsyncRunner();
+
+  /**
+   * @brief Submits a batch, blocks while all slots are in flight
+   *
+   * @note in and out must be valid until done is invoked. done is invoked on the completion thread,
+   *       or on caller's thread if enqueue failed.
+   * @param in Input of batch
+   * @param out Output of batch
+   * @param done Callback invoked once batch is done
+   */
+  void Submit(ModelIO* in, ModelIO* out, DoneFunc done) noexcept;
+
+  /// Gets number of batches in flight
+  int InflightNum() noexcept;
+
+  /// Gets number of slots
+  int SlotNum() const noexcept { return backend_->SlotNum(); }
+
+ private:
+  struct Job {
+    int slot;
+    ModelIO* out;
+    DoneFunc done;
+  };
+
+  void CompleteLoop(std::function<void()> thread_init) noexcept;
+
+  std::unique_ptr<IAsyncBackend> backend_;
+  std::vector<int> free_slots_;
+  std::deque<Job> jobs_;
+  std::mutex mutex_;
+  std::condition_variable slot_cond_;
+  std::condition_variable job_cond_;
+  bool running_{true};
+  std::thread thread_;
+};  // class AsyncRunner
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_MODEL_ASYNC_RUNNER_H_
@@ -0,0 +1,306 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "curl_downloader.h"
+
+#ifdef CNIS_HAVE_CURL
+#include <curl/curl.h>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "model_file.h"
+
+namespace infer_server {
+
+namespace {
+
+// exclusive lock on a file, released on destruction
+class FileLock {
+ public:
+  explicit FileLock(const std::string& path) noexcept {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) return;
+    int ret;
+    do {
+      ret = flock(fd_, LOCK_EX);
+    } while (ret != 0 && errno == EINTR);
+    if (ret != 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+  // closing the last descriptor releases the lock
+  ~FileLock() {
+    if (fd_ >= 0) close(fd_);
+  }
+  bool Locked() const noexcept { return fd_ >= 0; }
+
+ private:
+  FileLock(const FileLock&) = delete;
+  FileLock& operator=(const FileLock&) = delete;
+  int fd_ = -1;
+};  // class FileLock
+
+std::string ToLower(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+  return str;
+}
+
+bool IsSha256(const std::string& str) {
+  return str.size() == 64 && std::all_of(str.begin(), str.end(), [](unsigned char c) { return std::isxdigit(c); });
+}
+
+// splits fragment off url, and takes digest in fragment `sha256=<hex>`
+std::string SplitFragment(const std::string& url, std::string* digest) {
+  size_t pos = url.find('#');
+  if (pos == std::string::npos) return url;
+  const std::string key = "sha256=";
+  std::string fragment = url.substr(pos + 1);
+  if (fragment.compare(0, key.size(), key) == 0) {
+    *digest = ToLower(fragment.substr(key.size()));
+  } else {
+    LOG(WARNING) << "[EasyDK InferServer] [CurlDownloader] Ignore unknown url fragment: " << fragment;
+  }
+  return url.substr(0, pos);
+}
+
+std::string FileName(const std::string& url) {
+  std::string path = url.substr(0, url.find('?'));
+  return path.substr(path.find_last_of('/') + 1);
+}
+
+bool VerifyFile(const std::string& path, const std::string& digest) {
+  std::shared_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file) return false;
+  std::string actual = Sha256Hex(file->Data(), file->Size());
+  if (actual != digest) {
+    LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Checksum mismatch, file: " << path
+               << ", expected sha256: " << digest << ", actual: " << actual;
+    return false;
+  }
+  return true;
+}
+
+struct TransferContext {
+  CURL* curl;
+  FILE* file;
+  curl_off_t offset;
+  uint64_t bytes;
+  bool started;
+};
+
+size_t WriteToFile(char* ptr, size_t size, size_t nmemb, void* userdata) {
+  TransferContext* ctx = static_cast<TransferContext*>(userdata);
+  if (!ctx->started) {
+    ctx->started = true;
+    long code = 0;  // NOLINT
+    curl_easy_getinfo(ctx->curl, CURLINFO_RESPONSE_CODE, &code);
+    // server ignores range and sends the whole file
+    if (ctx->offset && code == 200) {
+      LOG(WARNING) << "[EasyDK InferServer] [CurlDownloader] Server does not support resume, download from start";
+      if (ftruncate(fileno(ctx->file), 0) != 0) return 0;
+      ctx->offset = 0;
+    }
+  }
+  size_t written = fwrite(ptr, 1, size * nmemb, ctx->file);
+  ctx->bytes += written;
+  return written;
+}
+
+size_t WriteToString(char* ptr, size_t size, size_t nmemb, void* userdata) {
+  std::string* str = static_cast<std::string*>(userdata);
+  // checksum file is short, do not take a wrong file
+  if (str->size() + size * nmemb > 4096) return 0;
+  str->append(ptr, size * nmemb);
+  return size * nmemb;
+}
+
+}  // namespace
+
+CurlDownloader::CurlDownloader(const std::string& model_dir) : model_dir_(model_dir) {
+  static_assert(CURL_ERROR_SIZE <= sizeof(errbuf_), "error buffer of cURL is too small");
+  CHECK_EQ(access(model_dir_.c_str(), W_OK), 0)
+      << "[EasyDK InferServer] [CurlDownloader] model directory not exist or do not have write permission: "
+      << model_dir_;
+  curl_ = curl_easy_init();
+  CHECK(curl_) << "[EasyDK InferServer] [CurlDownloader] Init cURL failed";
+  errbuf_[0] = '\0';
+}
+
+CurlDownloader::~CurlDownloader() {
+  if (curl_) {
+    curl_easy_cleanup(curl_);
+    curl_ = nullptr;
+  }
+}
+
+std::string CurlDownloader::Download(const std::string& url) noexcept {
+  std::string digest;
+  std::string location = SplitFragment(url, &digest);
+  if (!digest.empty() && !IsSha256(digest)) {
+    LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Invalid sha256 in url: " << url;
+    return {};
+  }
+  std::string name = FileName(location);
+  if (name.empty()) {
+    LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] No file name in url: " << url;
+    return {};
+  }
+  std::string file_path = model_dir_ + "/" + name;
+
+  // the first fetcher transfers, the others wait for it and find the published file
+  FileLock lock(file_path + ".lock");
+  if (!lock.Locked()) {
+    LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Lock file failed: " << file_path << ".lock, "
+               << strerror(errno);
+    return {};
+  }
+  if (access(file_path.c_str(), F_OK) == 0) {
+    if (digest.empty() || VerifyFile(file_path, digest)) {
+      LOG(INFO) << "[EasyDK InferServer] [CurlDownloader] Model exists in specified directory, skip download";
+      return file_path;
+    }
+    LOG(WARNING) << "[EasyDK InferServer] [CurlDownloader] Model in specified directory is corrupted, download again";
+    unlink(file_path.c_str());
+  }
+  if (digest.empty() && FetchChecksum(location + ".sha256", &digest)) {
+    VLOG(1) << "[EasyDK InferServer] [CurlDownloader] Expected sha256: " << digest;
+  }
+
+  LOG(INFO) << "[EasyDK InferServer] [CurlDownloader] Url: " << location;
+  LOG(INFO) << "[EasyDK InferServer] [CurlDownloader] File: " << file_path;
+  std::string part_path = file_path + ".part";
+  constexpr int kMaxAttempts = 3;
+  for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+    bool resumed = false;
+    if (!Transfer(location, part_path, &resumed)) continue;
+    if (!digest.empty() && !VerifyFile(part_path, digest)) {
+      unlink(part_path.c_str());
+      // file might be changed on server since the part was transferred
+      if (resumed) continue;
+      return {};
+    }
+    if (rename(part_path.c_str(), file_path.c_str()) != 0) {
+      LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Publish file failed: " << file_path << ", "
+                 << strerror(errno);
+      return {};
+    }
+    return file_path;
+  }
+  LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Download model failed after " << kMaxAttempts
+             << " attempts, model url: " << url;
+  return {};
+}
+
+bool CurlDownloader::Transfer(const std::string& url, const std::string& part_path, bool* resumed) noexcept {
+  // append to bytes left by an interrupted transfer
+  FILE* file = fopen(part_path.c_str(), "ab");
+  if (!file) {
+    LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Open file failed: " << part_path << ", " << strerror(errno);
+    return false;
+  }
+  fseeko(file, 0, SEEK_END);
+  TransferContext ctx{curl_, file, static_cast<curl_off_t>(ftello(file)), 0, false};
+  if (ctx.offset > 0) {
+    LOG(INFO) << "[EasyDK InferServer] [CurlDownloader] Resume download from " << ctx.offset << " bytes";
+  }
+
+  curl_easy_reset(curl_);
+  curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, errbuf_);
+  curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 0L);
+  // do not take error page as model
+  curl_easy_setopt(curl_, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, WriteToFile);
+  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &ctx);
+  curl_easy_setopt(curl_, CURLOPT_RESUME_FROM_LARGE, ctx.offset);
+  errbuf_[0] = '\0';
+  CURLcode re = curl_easy_perform(curl_);
+  transferred_ += ctx.bytes;
+  *resumed = ctx.offset > 0;
+
+  bool ok = re == CURLE_OK;
+  if (!ok) {
+    LogError(re, url);
+    long code = 0;  // NOLINT
+    curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &code);
+    // bytes left could not be resumed from, start over next time
+    if (ctx.offset && (re == CURLE_BAD_DOWNLOAD_RESUME || re == CURLE_RANGE_ERROR || code == 416)) {
+      if (ftruncate(fileno(file), 0) != 0) {
+        LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Truncate file failed: " << part_path;
+      }
+    }
+  }
+  // data must be on disk before the file is published
+  if (fflush(file) != 0 || fsync(fileno(file)) != 0) ok = false;
+  if (fclose(file) != 0) ok = false;
+  if (re == CURLE_OK && !ok) {
+    LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Write file failed: " << part_path << ", " << strerror(errno);
+  }
+  return ok;
+}
+
+bool CurlDownloader::FetchChecksum(const std::string& url, std::string* digest) noexcept {
+  std::string content;
+  curl_easy_reset(curl_);
+  curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, errbuf_);
+  curl_easy_setopt(curl_, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, WriteToString);
+  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &content);
+  CURLcode re = curl_easy_perform(curl_);
+  if (re != CURLE_OK) {
+    VLOG(1) << "[EasyDK InferServer] [CurlDownloader] No checksum file: " << url;
+    return false;
+  }
+  // format of sha256sum, digest is followed by file name
+  std::string hex = ToLower(content.substr(0, content.find_first_of(" \t\r\n")));
+  if (!IsSha256(hex)) {
+    LOG(WARNING) << "[EasyDK InferServer] [CurlDownloader] Ignore invalid checksum file: " << url;
+    return false;
+  }
+  *digest = hex;
+  return true;
+}
+
+void CurlDownloader::LogError(int code, const std::string& url) noexcept {
+  LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Download model error, error_code: " << code;
+  if (strlen(errbuf_)) {
+    LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Extra message from cURL: " << errbuf_;
+  } else {
+    LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Extra message from cURL: "
+               << curl_easy_strerror(static_cast<CURLcode>(code));
+  }
+  LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Model url: " << url;
+}
+
+}  // namespace infer_server
+
+#endif  // CNIS_HAVE_CURL
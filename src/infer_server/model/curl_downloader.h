@@ -0,0 +1,81 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_MODEL_CURL_DOWNLOADER_H_
+#define INFER_SERVER_MODEL_CURL_DOWNLOADER_H_
+
+#include <cstdint>
+#include <string>
+
+namespace infer_server {
+
+/**
+ * @brief Downloads model files into a directory by cURL
+ *
+ * A file is downloaded to `<name>.part` beside the target, and renamed to the target once it is transferred
+ * completely and verified, so the target is never seen truncated. An interrupted download is resumed from the
+ * temporary file by the next one. Fetchers of the same file, in this process or others, take turns by an exclusive
+ * `flock` on `<name>.lock`, so that the first one transfers and the others find the published file.
+ *
+ * Expected SHA-256 of the file is taken from URL fragment `#sha256=<hex>`, or from sidecar file `<url>.sha256` if
+ * the fragment is absent. A published file is verified again only if digest is given by fragment.
+ */
+class CurlDownloader {
+ public:
+  /**
+   * @brief Construct a new downloader
+   *
+   * @param model_dir Directory to place downloaded files, must be writable
+   */
+  explicit CurlDownloader(const std::string& model_dir);
+
+  ~CurlDownloader();
+
+  /**
+   * @brief Downloads a file if it has not been downloaded
+   *
+   * @param url Url of file
+   * @return Path of downloaded file, or empty string if failed
+   */
+  std::string Download(const std::string& url) noexcept;
+
+  /**
+   * @brief Gets number of bytes transferred by this downloader
+   */
+  uint64_t TransferredBytes() const noexcept { return transferred_; }
+
+ private:
+  CurlDownloader(const CurlDownloader&) = delete;
+  CurlDownloader& operator=(const CurlDownloader&) = delete;
+
+  bool Transfer(const std::string& url, const std::string& part_path, bool* resumed) noexcept;
+  bool FetchChecksum(const std::string& url, std::string* digest) noexcept;
+  void LogError(int code, const std::string& url) noexcept;
+
+  std::string model_dir_;
+  // CURL handle
+  void* curl_ = nullptr;
+  char errbuf_[256];
+  uint64_t transferred_ = 0;
+};  // class CurlDownloader
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_MODEL_CURL_DOWNLOADER_H_
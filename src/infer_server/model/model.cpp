@@ -21,7 +21,9 @@
 #include "model.h"
 
 #include <glog/logging.h>
+#include <sys/stat.h>
 #include <algorithm>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
@@ -29,6 +31,8 @@
 
 #include "cnrt.h"
 #include "core/data_type.h"
+#include "model_meta.h"
+#include "util/env.h"
 #include "../../common/utils.hpp"
 
 using std::string;
@@ -45,6 +49,22 @@ namespace infer_server {
     }                                                                             \
   } while (0)
 
+namespace {
+
+#ifdef MM_PATCH_VERSION
+constexpr uint32_t kRuntimeVersion = MM_MAJOR_VERSION * 1000000 + MM_MINOR_VERSION * 1000 + MM_PATCH_VERSION;
+#else
+constexpr uint32_t kRuntimeVersion = MM_MAJOR_VERSION * 1000000 + MM_MINOR_VERSION * 1000;
+#endif
+
+std::unique_ptr<ModelMetaCache> GetMetaCache() {
+  std::string dir = GetStringFromEnv("CNIS_MODEL_META_DIR");
+  if (dir.empty()) return nullptr;
+  return std::unique_ptr<ModelMetaCache>(new ModelMetaCache(dir, kRuntimeVersion));
+}
+
+}  // namespace
+
 bool ModelRunner::Init(MModel* model, mm_unique_ptr<MContext> ctx, const std::vector<Shape>& input_shape) noexcept {
   input_num_ = model->GetInputNum();
   output_num_ = model->GetOutputNum();
@@ -163,6 +183,12 @@ std::vector<Shape> ModelRunner::InferOutputShape(const std::vector<Shape>& input
 }
 
 Status ModelRunner::Run(ModelIO* in, ModelIO* out) noexcept {  // NOLINT
+  Status s = Enqueue(in, out);
+  if (s != Status::SUCCESS) return s;
+  return Sync(out);
+}
+
+Status ModelRunner::Enqueue(ModelIO* in, ModelIO* out) noexcept {
   auto& input = in->surfs;
   auto& output = out->surfs;
   CHECK_EQ(input_num_, input.size()) << "EasyDK InferServer] [ModelRunner] Input number is mismatched";
@@ -209,9 +235,15 @@ Status ModelRunner::Run(ModelIO* in, ModelIO* out) noexcept {  // NOLINT
                 "[InferServer] [ModelRunner] Place event failed", Status::ERROR_BACKEND);
 #endif
 
+  managed_output_ = output.empty();
+  return Status::SUCCESS;
+}
+
+Status ModelRunner::Sync(ModelIO* out) noexcept {
+  auto& output = out->surfs;
   CNRT_SAFECALL(cnrtQueueSync(task_queue_), "[InferServer] [ModelRunner] Sync queue failed.", Status::ERROR_BACKEND);
 
-  if (output.empty()) {
+  if (managed_output_) {
     for (auto& tensor : outputs_) {
       cnedk::IBufDeleter* deleter = new TensorDeleter(tensor);
       CnedkBufSurfaceMemType mem_type;
@@ -248,8 +280,10 @@ bool Model::Init(const string& model_file, const std::vector<Shape>& in_shape) n
   model_.reset(mm::CreateIModel());
   VLOG(1) << "[EasyDK InferServer] [Model] (success) Load model from graph file: " << model_file_;
   MM_SAFECALL(model_->DeserializeFromFile(model_file_.c_str()), false);
+  struct stat file_stat;
+  if (stat(model_file_.c_str(), &file_stat) == 0) model_size_ = static_cast<size_t>(file_stat.st_size);
 
-  has_init_ = GetModelInfo(in_shape);
+  has_init_ = LoadModelInfo(in_shape);
   return has_init_;
 }
 
@@ -261,11 +295,55 @@ bool Model::Init(void* mem_ptr, size_t size, const std::vector<Shape>& in_shape)
 
   VLOG(1) << "[EasyDK InferServer] [Model] (success) Load model from memory: " << model_file_;
   MM_SAFECALL(model_->DeserializeFromMemory(mem_ptr, size), false);
+  model_size_ = size;
+
+  has_init_ = LoadModelInfo(in_shape);
+  return has_init_;
+}
+
+bool Model::Init(std::shared_ptr<MappedFile> file, const std::vector<Shape>& in_shape) noexcept {
+  model_file_ = file->Path();
+  model_.reset(mm::CreateIModel());
+
+  VLOG(1) << "[EasyDK InferServer] [Model] (success) Load model from mapped file: " << model_file_;
+  MM_SAFECALL(model_->DeserializeFromMemory(file->Data(), file->Size()), false);
+  model_size_ = file->Size();
+  mapped_file_ = std::move(file);
 
-  has_init_ = GetModelInfo(in_shape);
+  has_init_ = LoadModelInfo(in_shape);
   return has_init_;
 }
 
+bool Model::LoadModelInfo(const std::vector<Shape>& in_shape) noexcept {
+  // key is made of model content and input shape
+  std::unique_ptr<ModelMetaCache> cache = key_.empty() ? nullptr : GetMetaCache();
+  ModelMeta meta;
+  if (cache && cache->Load(key_, &meta) && static_cast<int>(meta.input_shapes.size()) == model_->GetInputNum() &&
+      static_cast<int>(meta.output_shapes.size()) == model_->GetOutputNum()) {
+    i_num_ = static_cast<int>(meta.input_shapes.size());
+    o_num_ = static_cast<int>(meta.output_shapes.size());
+    input_shapes_ = std::move(meta.input_shapes);
+    output_shapes_ = std::move(meta.output_shapes);
+    i_mlu_layouts_ = std::move(meta.input_layouts);
+    o_mlu_layouts_ = std::move(meta.output_layouts);
+    model_batch_size_ = meta.batch_size;
+    meta_cached_ = true;
+    VLOG(1) << "[EasyDK InferServer] [Model] Take model info from meta cache: " << cache->Path(key_);
+    return true;
+  }
+
+  if (!GetModelInfo(in_shape)) return false;
+  if (cache) {
+    meta.input_shapes = input_shapes_;
+    meta.output_shapes = output_shapes_;
+    meta.input_layouts = i_mlu_layouts_;
+    meta.output_layouts = o_mlu_layouts_;
+    meta.batch_size = model_batch_size_;
+    cache->Store(key_, meta);
+  }
+  return true;
+}
+
 bool Model::GetModelInfo(const std::vector<Shape>& in_shape) noexcept {
   // get IO messages
   // get io number and data size
@@ -394,6 +472,41 @@ bool Model::GetModelInfo(const std::vector<Shape>& in_shape) noexcept {
   return true;
 }
 
+bool Model::Prepare(int device_id, int runner_num) noexcept {
+  MEngine* engine = GetEngine(device_id);
+  if (!engine) {
+    LOG(ERROR) << "[EasyDK InferServer] [Model] Prepare(): Create engine failed, device id: " << device_id;
+    return false;
+  }
+  int ready_num = 0;
+  {
+    std::unique_lock<std::mutex> lk(runner_map_mutex_);
+    ready_num = runner_map_[device_id].size();
+  }
+  // contexts are created out of lock, since it takes time
+  std::vector<std::shared_ptr<ModelRunner>> runners;
+  for (int i = ready_num; i < runner_num; ++i) {
+    auto runner = std::make_shared<ModelRunner>(device_id);
+    MContext* ctx = engine->CreateIContext();
+    if (!ctx || !runner->Init(model_.get(), mm_unique_ptr<MContext>(ctx), input_shapes_)) {
+      LOG(ERROR) << "[EasyDK InferServer] [Model] Prepare(): Create runner failed, device id: " << device_id;
+      return false;
+    }
+    runners.emplace_back(std::move(runner));
+    ++created_runner_num_;
+  }
+
+  std::unique_lock<std::mutex> lk(runner_map_mutex_);
+  auto& ready = runner_map_[device_id];
+  std::move(runners.begin(), runners.end(), std::back_inserter(ready));
+  return true;
+}
+
+size_t Model::MemoryFootprint() noexcept {
+  // each engine holds a copy of constant data on device, which is about as large as the serialized model
+  return model_size_ * (1 + engine_num_.load());
+}
+
 Model::~Model() {
   VLOG(1) << "[EasyDK InferServer] [Model] Unload model: " << model_file_;
 }
@@ -24,6 +24,9 @@
 #include <cnrt.h>
 #include <glog/logging.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -34,6 +37,8 @@
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
 #include "cnis/shape.h"
+#include "util/lru_cache.h"
+#include "util/single_flight.h"
 
 // for magicmind
 #ifdef HAVE_MM_COMMON_HEADER
@@ -45,6 +50,7 @@
 #endif
 
 #include "mm_helper.h"
+#include "model_file.h"
 
 namespace infer_server {
 
@@ -61,7 +67,12 @@ class ModelRunner {
   bool Init(MModel* model, mm_unique_ptr<MContext> ctx, const std::vector<Shape>& in_shape = {}) noexcept;
   std::vector<Shape> InferOutputShape(const std::vector<Shape>& input) noexcept;
   bool CanInferOutputShape() noexcept { return !outputs_.empty(); }
+  bool FixedInputShape() const noexcept { return fixed_input_shape_; }
   Status Run(ModelIO* input, ModelIO* output) noexcept;  // NOLINT
+  /// enqueues inference and returns, Sync must be called before the next Enqueue
+  Status Enqueue(ModelIO* input, ModelIO* output) noexcept;
+  /// waits for enqueued inference done, and fills output if it is managed by magicmind
+  Status Sync(ModelIO* output) noexcept;
 
  private:
   bool FixedShape(const std::vector<Shape>& shapes) noexcept {
@@ -82,6 +93,8 @@ class ModelRunner {
   std::vector<DataLayout> o_layouts_;
   bool fixed_input_shape_{true};
   bool fixed_output_shape_{true};
+  // output buffer of the enqueued inference is allocated by magicmind
+  bool managed_output_{false};
   cnrtQueue_t task_queue_{nullptr};
 #ifdef PERF_HARDWARE_TIME
   cnrtNotifier_t notifier_start_{nullptr}, notifier_end_{nullptr};
@@ -94,11 +107,17 @@ class ModelRunner {
 class Model : public ModelInfo {
  public:
   Model() = default;
+  /// model is identified by key instead of file path or memory address
+  explicit Model(const std::string& key) : key_(key) {}
   bool Init(void* mem_ptr, size_t size, const std::vector<Shape>& i_shape = {}) noexcept;
   bool Init(const std::string& model_path, const std::vector<Shape>& i_shape = {}) noexcept;
+  /// load from mapped pages, which are kept until model is destroyed
+  bool Init(std::shared_ptr<MappedFile> file, const std::vector<Shape>& i_shape = {}) noexcept;
   ~Model();
 
   bool HasInit() const noexcept { return has_init_; }
+  /// model info is taken from meta persisted by an earlier load, engine has not been built, @see ModelMetaCache
+  bool MetaCached() const noexcept { return meta_cached_; }
 
   const Shape& InputShape(int index) const noexcept override {
     CHECK(index < i_num_ || index >= 0) << "[EasyDK InferServer] [Model] Input shape index overflow";
@@ -137,22 +156,68 @@ class Model : public ModelInfo {
       engine = model_->CreateIEngine(config);
       if (!engine) return nullptr;
       engine_map_[device_id].reset(engine);
+      ++engine_num_;
     } else {
       engine = iter->second.get();
     }
     return engine;
   }
-  std::shared_ptr<ModelRunner> GetRunner(int device_id) noexcept {
+  /**
+   * @brief Gets a runner on device
+   *
+   * @param device_id Device of runner
+   * @param in_shape Input shape the runner is planned for if model input shape is mutable, use model input shape
+   *                 if it is empty
+   */
+  std::shared_ptr<ModelRunner> GetRunner(int device_id, const std::vector<Shape>& in_shape = {}) noexcept {
+    if (in_shape.empty()) {
+      // pick up runner created by Prepare
+      std::unique_lock<std::mutex> lk(runner_map_mutex_);
+      auto iter = runner_map_.find(device_id);
+      if (iter != runner_map_.end() && !iter->second.empty()) {
+        auto runner = std::move(iter->second.back());
+        iter->second.pop_back();
+        return runner;
+      }
+    }
     MEngine* engine = GetEngine(device_id);
+    if (!engine) return nullptr;
     auto runner = std::make_shared<ModelRunner>(device_id);
     MContext* ctx = engine->CreateIContext();
-    if (!ctx || !runner->Init(model_.get(), mm_unique_ptr<MContext>(ctx), input_shapes_)) return nullptr;
+    const std::vector<Shape>& shape = in_shape.empty() ? input_shapes_ : in_shape;
+    if (!ctx || !runner->Init(model_.get(), mm_unique_ptr<MContext>(ctx), shape)) return nullptr;
+    ++created_runner_num_;
     return runner;
   }
+  /**
+   * @brief Builds engine and creates runners on device ahead of use, runners are picked up by GetRunner
+   *
+   * @param device_id Device to prepare
+   * @param runner_num Number of runners to be kept ready on the device
+   * @retval true Succeed
+   * @retval false Failed to create engine or runner
+   */
+  bool Prepare(int device_id, int runner_num) noexcept;
+  /// number of runners created by Prepare and not picked up by GetRunner yet
+  size_t PreparedRunnerNum(int device_id) noexcept {
+    std::unique_lock<std::mutex> lk(runner_map_mutex_);
+    auto iter = runner_map_.find(device_id);
+    return iter == runner_map_.end() ? 0 : iter->second.size();
+  }
+  /// number of runners created on all devices, by either Prepare or GetRunner
+  size_t CreatedRunnerNum() const noexcept { return created_runner_num_.load(); }
   MModel* GetModel() noexcept { return model_.get(); }
-  std::string GetKey() const noexcept override { return model_file_; }
+  /**
+   * @brief Gets bytes of memory held by this model, including the serialized model and engines created on devices
+   *
+   * @note It does not wait for engines being built, so it is safe to be called with model cache locked
+   */
+  size_t MemoryFootprint() noexcept;
+  std::string GetKey() const noexcept override { return key_.empty() ? model_file_ : key_; }
 
  private:
+  // takes model info from meta cache, or gets it from engine and stores it to meta cache
+  bool LoadModelInfo(const std::vector<Shape>& in_shape) noexcept;
   bool GetModelInfo(const std::vector<Shape>& in_shape) noexcept;
   bool FixedShape(const std::vector<Shape>& shapes) noexcept {
     for (auto &shape : shapes) {
@@ -170,16 +235,34 @@ class Model : public ModelInfo {
   mm_unique_ptr<MModel> model_{nullptr};
   std::map<int, mm_unique_ptr<MEngine>> engine_map_;
   std::mutex engine_map_mutex_;
+  // number of engines in engine_map_, read without engine_map_mutex_ which is held while an engine is built
+  std::atomic<size_t> engine_num_{0};
+  std::map<int, std::vector<std::shared_ptr<ModelRunner>>> runner_map_;
+  std::mutex runner_map_mutex_;
+  std::atomic<size_t> created_runner_num_{0};
+  std::shared_ptr<MappedFile> mapped_file_;
   std::string model_file_;
+  std::string key_;
+  size_t model_size_{0};
 
   std::vector<DataLayout> i_mlu_layouts_, o_mlu_layouts_;
   std::vector<Shape> input_shapes_, output_shapes_;
   int i_num_{0}, o_num_{0};
   uint32_t model_batch_size_{1};
   bool has_init_{false};
+  bool meta_cached_{false};
 };  // class Model
 
-// use environment CNIS_MODEL_CACHE_LIMIT to control cache limit
+/**
+ * @brief Caches loaded models, evicts the least recently used unpinned ones
+ *
+ * Use environment CNIS_MODEL_CACHE_BYTES to limit bytes charged to cached models (0 means unlimited, default),
+ * each model is charged by `Model::MemoryFootprint()`. Use environment CNIS_MODEL_CACHE_LIMIT to limit number of
+ * cached models (10 by default). Models referenced outside the cache are pinned and never evicted.
+ * Use environment CNIS_MODEL_PRELOAD_THREADS to set number of threads loading models in background (2 by default).
+ * Use environment CNIS_MODEL_META_DIR to persist model info in the directory (not persisted by default), a model
+ * loaded again with persisted info is returned without building engine, which is built in background.
+ */
 class ModelManager {
  public:
   static ModelManager* Instance() noexcept;
@@ -188,6 +271,9 @@ class ModelManager {
 
   ModelPtr Load(const std::string& model_file, const std::vector<Shape>& in_shape = {}) noexcept;
   ModelPtr Load(void* mem_cache, size_t size, const std::vector<Shape>& in_shape = {}) noexcept;
+  /// loads model and prepares runners on devices in background
+  std::future<ModelPtr> Preload(const std::string& model_file, const std::vector<Shape>& in_shape,
+                                const std::vector<int>& device_ids, int runner_num) noexcept;
   bool Unload(ModelPtr model) noexcept;
 
   void ClearCache() noexcept;
@@ -198,12 +284,15 @@ class ModelManager {
 
  private:
   std::string DownloadModel(const std::string& url) noexcept;
-  void CheckAndCleanCache() noexcept;
+  std::shared_ptr<Model> GetOrLoad(const std::string& model_key, const std::function<bool(Model*)>& init) noexcept;
+  // evicts models to make room for a model charged by incoming bytes, returns the evicted ones
+  std::vector<ModelPtr> CheckAndCleanCache(size_t incoming) noexcept;
 
   std::string model_dir_{"."};
 
-  static std::unordered_map<std::string, std::shared_ptr<Model>> model_cache_;
+  static LruCache<std::string, std::shared_ptr<Model>> model_cache_;
   static std::mutex model_cache_mutex_;
+  static SingleFlight<std::string, std::shared_ptr<Model>> model_loading_;
 };  // class ModelManager
 
 }  // namespace infer_server
@@ -0,0 +1,276 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "model_file.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "util/lru_cache.h"
+
+namespace infer_server {
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path) noexcept {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "[EasyDK InferServer] [MappedFile] Open file failed: " << path << ", " << strerror(errno);
+    return nullptr;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    LOG(ERROR) << "[EasyDK InferServer] [MappedFile] File is empty or could not be stated: " << path;
+    close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(file_stat.st_size);
+  // writable private mapping, in case deserializer writes to the buffer
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "[EasyDK InferServer] [MappedFile] Map file failed: " << path << ", " << strerror(errno);
+    return nullptr;
+  }
+  return std::shared_ptr<MappedFile>(new MappedFile(path, data, size));
+}
+
+MappedFile::~MappedFile() { munmap(data_, size_); }
+
+namespace {
+
+constexpr uint64_t kPrime1 = 11400714785074694791ULL;
+constexpr uint64_t kPrime2 = 14029467366897019727ULL;
+constexpr uint64_t kPrime3 = 1609587929392839161ULL;
+constexpr uint64_t kPrime4 = 9650029242287828579ULL;
+constexpr uint64_t kPrime5 = 2870177450012600261ULL;
+
+inline uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t Read64(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t Read32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) { return Rotl(acc + input * kPrime2, 31) * kPrime1; }
+
+inline uint64_t Merge(uint64_t acc, uint64_t val) { return (acc ^ Round(0, val)) * kPrime1 + kPrime4; }
+
+// identity of a file, changes when the file is modified
+struct FileId {
+  dev_t dev;
+  ino_t ino;
+  int64_t mtime_ns;
+  int64_t size;
+  bool operator==(const FileId& other) const {
+    return dev == other.dev && ino == other.ino && mtime_ns == other.mtime_ns && size == other.size;
+  }
+};
+
+struct FileIdHash {
+  size_t operator()(const FileId& id) const {
+    return std::hash<uint64_t>()(static_cast<uint64_t>(id.ino) ^ (static_cast<uint64_t>(id.dev) << 32) ^
+                                 static_cast<uint64_t>(id.mtime_ns) ^ static_cast<uint64_t>(id.size) * kPrime1);
+  }
+};
+
+bool GetFileId(const std::string& path, FileId* id) {
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) != 0) return false;
+  id->dev = file_stat.st_dev;
+  id->ino = file_stat.st_ino;
+  id->mtime_ns = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+  id->size = file_stat.st_size;
+  return true;
+}
+
+constexpr uint32_t kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+inline uint32_t Rotr(uint32_t x, int r) { return (x >> r) | (x << (32 - r)); }
+
+void Sha256Block(uint32_t* state, const uint8_t* block) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; ++i) {
+    w[i] = (static_cast<uint32_t>(block[4 * i]) << 24) | (static_cast<uint32_t>(block[4 * i + 1]) << 16) |
+           (static_cast<uint32_t>(block[4 * i + 2]) << 8) | static_cast<uint32_t>(block[4 * i + 3]);
+  }
+  for (int i = 16; i < 64; ++i) {
+    uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; ++i) {
+    uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + kSha256K[i] + w[i];
+    uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+// keys of files no longer used, such as old versions of modified files, are dropped as the least recently used ones
+std::mutex g_file_keys_mutex;
+LruCache<FileId, std::string, FileIdHash> g_file_keys([](const std::string&) -> size_t { return 0; },
+                                                      [](const std::string&) { return false; });
+
+}  // namespace
+
+uint64_t HashBytes(const void* data, size_t size) noexcept {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint8_t* end = p + size;
+  uint64_t h;
+  if (size >= 32) {
+    uint64_t v1 = kPrime1 + kPrime2, v2 = kPrime2, v3 = 0, v4 = 0 - kPrime1;
+    const uint8_t* limit = end - 32;
+    do {
+      v1 = Round(v1, Read64(p));
+      v2 = Round(v2, Read64(p + 8));
+      v3 = Round(v3, Read64(p + 16));
+      v4 = Round(v4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+    h = Merge(h, v1);
+    h = Merge(h, v2);
+    h = Merge(h, v3);
+    h = Merge(h, v4);
+  } else {
+    h = kPrime5;
+  }
+  h += static_cast<uint64_t>(size);
+
+  for (; p + 8 <= end; p += 8) {
+    h = Rotl(h ^ Round(0, Read64(p)), 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    h = Rotl(h ^ (static_cast<uint64_t>(Read32(p)) * kPrime1), 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h = Rotl(h ^ (*p * kPrime5), 11) * kPrime1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+std::string Sha256Hex(const void* data, size_t size) noexcept {
+  uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  size_t remain = size;
+  for (; remain >= 64; remain -= 64, p += 64) Sha256Block(state, p);
+
+  // pad with 0x80, zeros and length in bits
+  uint8_t tail[128] = {0};
+  memcpy(tail, p, remain);
+  tail[remain] = 0x80;
+  size_t tail_size = remain < 56 ? 64 : 128;
+  uint64_t bits = static_cast<uint64_t>(size) * 8;
+  for (int i = 0; i < 8; ++i) tail[tail_size - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+  for (size_t offset = 0; offset < tail_size; offset += 64) Sha256Block(state, tail + offset);
+
+  std::ostringstream ss;
+  for (uint32_t v : state) ss << std::hex << std::setw(8) << std::setfill('0') << v;
+  return ss.str();
+}
+
+std::string ContentKey(const void* data, size_t size) noexcept {
+  std::ostringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << HashBytes(data, size) << "_" << std::dec << size;
+  return ss.str();
+}
+
+bool FileContentKey(const std::string& path, std::string* key, std::shared_ptr<MappedFile>* mapped) noexcept {
+  mapped->reset();
+  FileId id;
+  if (!GetFileId(path, &id)) return false;
+  {
+    std::lock_guard<std::mutex> lk(g_file_keys_mutex);
+    std::string memoized = g_file_keys.Get(id);
+    if (!memoized.empty()) {
+      *key = std::move(memoized);
+      return true;
+    }
+  }
+
+  std::shared_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file) return false;
+  *key = ContentKey(file->Data(), file->Size());
+  *mapped = file;
+  // do not memoize if file is modified while hashing
+  FileId after;
+  if (GetFileId(path, &after) && after == id) {
+    std::lock_guard<std::mutex> lk(g_file_keys_mutex);
+    g_file_keys.Put(id, *key);
+    g_file_keys.Evict(std::numeric_limits<size_t>::max(), kMaxFileContentKeys);
+  }
+  return true;
+}
+
+void ClearFileContentKeys() noexcept {
+  std::lock_guard<std::mutex> lk(g_file_keys_mutex);
+  g_file_keys.Clear();
+}
+
+}  // namespace infer_server
@@ -0,0 +1,102 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_MODEL_MODEL_FILE_H_
+#define INFER_SERVER_MODEL_MODEL_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace infer_server {
+
+/**
+ * @brief Read-only view of a file mapped into memory
+ *
+ * Pages are mapped privately, so they are shared with page cache of other processes until being written.
+ */
+class MappedFile {
+ public:
+  /**
+   * @brief Maps the whole file
+   *
+   * @param path Path of file
+   * @return Mapped file, or nullptr if file could not be opened or is empty
+   */
+  static std::shared_ptr<MappedFile> Open(const std::string& path) noexcept;
+  ~MappedFile();
+
+  void* Data() const noexcept { return data_; }
+  size_t Size() const noexcept { return size_; }
+  const std::string& Path() const noexcept { return path_; }
+
+ private:
+  MappedFile(const std::string& path, void* data, size_t size) : path_(path), data_(data), size_(size) {}
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  std::string path_;
+  void* data_;
+  size_t size_;
+};  // class MappedFile
+
+/**
+ * @brief Calculates 64-bit hash of bytes, the algorithm is XXH64 with seed 0
+ */
+uint64_t HashBytes(const void* data, size_t size) noexcept;
+
+/**
+ * @brief Calculates SHA-256 digest of bytes
+ *
+ * @return Digest in lowercase hex
+ */
+std::string Sha256Hex(const void* data, size_t size) noexcept;
+
+/**
+ * @brief Makes key of model content, identical bytes have the same key wherever they are
+ */
+std::string ContentKey(const void* data, size_t size) noexcept;
+
+/**
+ * @brief Gets key of model file content
+ *
+ * Key is memoized by (device, inode, modification time, size) of the file, so symlinks and hard links share the
+ * memoized key, and the file is not read again until it is modified. Up to kMaxFileContentKeys keys are memoized.
+ *
+ * @param path Path of file
+ * @param[out] key Key of file content
+ * @param[out] mapped The file mapped to calculate key, or nullptr if key is memoized
+ * @retval true Succeed
+ * @retval false File could not be read
+ */
+bool FileContentKey(const std::string& path, std::string* key, std::shared_ptr<MappedFile>* mapped) noexcept;
+
+/// Maximum number of memoized keys of files, the least recently used one is dropped beyond it
+constexpr size_t kMaxFileContentKeys = 256;
+
+/**
+ * @brief Clears memoized keys of files
+ */
+void ClearFileContentKeys() noexcept;
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_MODEL_MODEL_FILE_H_
@@ -22,19 +22,29 @@
 
 #include <glog/logging.h>
 #include <algorithm>
-#include <fstream>
+#include <functional>
+#include <future>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "cnrt.h"
+#include "curl_downloader.h"
+#include "model_file.h"
 #include "util/env.h"
+#include "util/thread_pool.h"
 
 namespace infer_server {
 
-std::unordered_map<std::string, std::shared_ptr<Model>> ModelManager::model_cache_;
+LruCache<std::string, std::shared_ptr<Model>> ModelManager::model_cache_(
+    [](const std::shared_ptr<Model>& model) { return model->MemoryFootprint(); },
+    [](const std::shared_ptr<Model>& model) { return model.use_count() > 1; });
 std::mutex ModelManager::model_cache_mutex_;
+SingleFlight<std::string, std::shared_ptr<Model>> ModelManager::model_loading_;
 
 #define RETURN_VAL_IF_FAIL(cond, msg, ret_val) \
   do {                                         \
@@ -65,25 +75,31 @@ ModelManager* ModelManager::Instance() noexcept {
   return &m;
 }
 
-static inline std::string GetModelKey(const std::string& model_path) noexcept {
-  return model_path;
-}
-
-static inline std::string GetModelKey(const void* mem_ptr) noexcept {
+// the same model content with different input shapes is loaded as different models
+static inline std::string GetModelKey(const std::string& content_key, const std::vector<Shape>& in_shape) noexcept {
   std::ostringstream ss;
-  ss << mem_ptr;
+  ss << content_key;
+  for (auto& shape : in_shape) ss << "_" << shape;
   return ss.str();
 }
 
-void ModelManager::CheckAndCleanCache() noexcept {
-  if (model_cache_.size() >= GetUlongFromEnv("CNIS_MODEL_CACHE_LIMIT", 10)) {
-    for (auto& p : model_cache_) {
-      if (p.second.use_count() == 1) {
-        model_cache_.erase(p.first);
-        break;
-      }
-    }
+std::vector<ModelPtr> ModelManager::CheckAndCleanCache(size_t incoming) noexcept {
+  size_t byte_budget = GetUlongFromEnv("CNIS_MODEL_CACHE_BYTES", 0);
+  size_t count_limit = GetUlongFromEnv("CNIS_MODEL_CACHE_LIMIT", 10);
+  if (!byte_budget) byte_budget = std::numeric_limits<size_t>::max();
+  // make room for the incoming model
+  byte_budget = byte_budget > incoming ? byte_budget - incoming : 0;
+  count_limit = count_limit ? count_limit - 1 : 0;
+  std::vector<ModelPtr> evicted;
+  for (auto& model : model_cache_.Evict(byte_budget, count_limit)) {
+    LOG(INFO) << "[EasyDK InferServer] [ModelManager] Evict model from cache: " << model->GetKey();
+    evicted.emplace_back(std::move(model));
   }
+  if (model_cache_.Size() > count_limit || model_cache_.Bytes() > byte_budget) {
+    LOG(WARNING) << "[EasyDK InferServer] [ModelManager] Models in use exceed cache limit, cached models: "
+                 << model_cache_.Size() << ", bytes: " << model_cache_.Bytes();
+  }
+  return evicted;
 }
 
 ModelPtr ModelManager::Load(const std::string& model_file, const std::vector<Shape>& in_shape) noexcept {
@@ -95,31 +111,21 @@ ModelPtr ModelManager::Load(const std::string& model_file, const std::vector<Sha
         "[EasyDK InferServer] [ModelManager] Download model graph file failed: " + model_file, nullptr);
   } else {
     model_path = model_file;
-    std::ifstream f;
-    f.open(model_path);
-    RETURN_VAL_IF_FAIL(f.is_open(),
-        "[EasyDK InferServer] [ModelManager] Model file not exist. Please check model path: " + model_path, nullptr);
-    f.close();
   }
 
-  std::string model_key = model_path;
+  // key on content, so the model reached through symlinks or copies is loaded once
+  std::string content_key;
+  std::shared_ptr<MappedFile> mapped;
+  RETURN_VAL_IF_FAIL(FileContentKey(model_path, &content_key, &mapped),
+      "[EasyDK InferServer] [ModelManager] Model file not exist. Please check model path: " + model_path, nullptr);
 
-  std::unique_lock<std::mutex> lk(model_cache_mutex_);
-  if (model_cache_.find(model_key) == model_cache_.cend()) {
-    // cache not hit
+  return GetOrLoad(GetModelKey(content_key, in_shape), [&model_path, &mapped, &in_shape](Model* model) {
     LOG(INFO) << "[EasyDK InferServer] [ModelManager] Load model from model file: " << model_path;
-    auto model = std::make_shared<Model>();
-    if (!model->Init(model_path, in_shape)) {
-      return nullptr;
-    }
-    CheckAndCleanCache();
-    model_cache_[model_key] = model;
-    return model;
-  } else {
-    // cache hit
-    LOG(INFO) << "[EasyDK InferServer] [ModelManager] Get model from cache";
-    return model_cache_.at(model_key);
-  }
+    // key is memoized, file has not been mapped yet
+    if (!mapped) mapped = MappedFile::Open(model_path);
+    if (!mapped) return false;
+    return model->Init(mapped, in_shape);
+  });
 };
 
 ModelPtr ModelManager::Load(void* mem_ptr, size_t size, const std::vector<Shape>& in_shape) noexcept {
@@ -127,126 +133,120 @@ ModelPtr ModelManager::Load(void* mem_ptr, size_t size, const std::vector<Shape>
   RETURN_VAL_IF_FAIL(mem_ptr,
       "[EasyDK InferServer] [ModelManager] Invalid memory pointer, please check model cached in memory", nullptr);
 
-  std::string model_key = GetModelKey(mem_ptr);
+  RETURN_VAL_IF_FAIL(size, "[EasyDK InferServer] [ModelManager] Model size in memory is 0", nullptr);
 
-  std::unique_lock<std::mutex> lk(model_cache_mutex_);
-  if (model_cache_.find(model_key) == model_cache_.cend()) {
-    // cache not hit
+  std::string model_key = GetModelKey(ContentKey(mem_ptr, size), in_shape);
+  return GetOrLoad(model_key, [mem_ptr, size, &in_shape](Model* model) {
     LOG(INFO) << "[EasyDK InferServer] [ModelManager] Load model from memory: " << mem_ptr << ", size: " << size;
-    auto model = std::make_shared<Model>();
-    if (!model->Init(mem_ptr, size, in_shape)) {
+    return model->Init(mem_ptr, size, in_shape);
+  });
+};
+
+static EqualityThreadPool* PreloadPool() {
+  static EqualityThreadPool pool(nullptr, std::max(GetIntFromEnv("CNIS_MODEL_PRELOAD_THREADS", 2), 1));
+  return &pool;
+}
+
+// model info is taken from meta cache, so engine is built in background, GetEngine waits for it
+static void BuildEngineAsync(const std::shared_ptr<Model>& model) {
+  int device_id = 0;
+  if (cnrtGetDevice(&device_id) != cnrtSuccess) return;
+  std::weak_ptr<Model> weak_model = model;
+  PreloadPool()->Push(0, [weak_model, device_id]() {
+    std::shared_ptr<Model> m = weak_model.lock();
+    if (!m || !SetCurrentDevice(device_id)) return;
+    if (!m->GetEngine(device_id)) {
+      LOG(WARNING) << "[EasyDK InferServer] [ModelManager] Build engine in background failed: " << m->GetKey();
+    }
+  });
+}
+
+std::shared_ptr<Model> ModelManager::GetOrLoad(const std::string& model_key,
+                                               const std::function<bool(Model*)>& init) noexcept {
+  {
+    std::lock_guard<std::mutex> lk(model_cache_mutex_);
+    std::shared_ptr<Model> model = model_cache_.Get(model_key);
+    if (model) {
+      LOG(INFO) << "[EasyDK InferServer] [ModelManager] Get model from cache";
+      return model;
+    }
+  }
+
+  // loads of different models run in parallel, loads of the same model wait for the first one
+  return model_loading_.Do(model_key, [this, &model_key, &init]() -> std::shared_ptr<Model> {
+    {
+      // the model may be loaded by a call finished after cache is checked
+      std::lock_guard<std::mutex> lk(model_cache_mutex_);
+      std::shared_ptr<Model> model = model_cache_.Get(model_key);
+      if (model) return model;
+    }
+    auto model = std::make_shared<Model>(model_key);
+    if (!init(model.get())) {
+      LOG(ERROR) << "[EasyDK InferServer] [ModelManager] Load model failed: " << model_key;
       return nullptr;
     }
-    CheckAndCleanCache();
-    model_cache_[model_key] = model;
+    // charge the model before its engine is built in background, the engine is charged once it is built
+    const size_t footprint = model->MemoryFootprint();
+    if (model->MetaCached()) BuildEngineAsync(model);
+    std::vector<ModelPtr> evicted;
+    std::lock_guard<std::mutex> lk(model_cache_mutex_);
+    evicted = CheckAndCleanCache(footprint);
+    model_cache_.Put(model_key, model);
     return model;
-  } else {
-    // cache hit
-    LOG(INFO) << "[EasyDK InferServer] [ModelManager] Get model from cache";
-    return model_cache_.at(model_key);
-  }
-};
+  });
+}
+
+std::future<ModelPtr> ModelManager::Preload(const std::string& model_file, const std::vector<Shape>& in_shape,
+                                            const std::vector<int>& device_ids, int runner_num) noexcept {
+  return PreloadPool()->Push(0, [this, model_file, in_shape, device_ids, runner_num]() -> ModelPtr {
+    // model info is queried on current device
+    if (!device_ids.empty() && !SetCurrentDevice(device_ids.front())) return nullptr;
+    ModelPtr model = Load(model_file, in_shape);
+    if (!model) return nullptr;
+    std::shared_ptr<Model> m = GetModel(model->GetKey());
+    if (!m) {
+      LOG(ERROR) << "[EasyDK InferServer] [ModelManager] Preload(): Model is evicted before prepared: " << model_file;
+      return nullptr;
+    }
+    for (int device_id : device_ids) {
+      if (!SetCurrentDevice(device_id) || !m->Prepare(device_id, runner_num)) {
+        LOG(ERROR) << "[EasyDK InferServer] [ModelManager] Preload(): Prepare model on device " << device_id
+                   << " failed: " << model_file;
+        return nullptr;
+      }
+    }
+    VLOG(1) << "[EasyDK InferServer] [ModelManager] Preload(): Model is ready: " << model_file;
+    return model;
+  });
+}
 
 std::shared_ptr<Model> ModelManager::GetModel(const std::string& name) noexcept {
   std::unique_lock<std::mutex> lk(model_cache_mutex_);
-  if (model_cache_.find(name) == model_cache_.cend()) {
-    return nullptr;
-  }
-  return model_cache_.at(name);
+  return model_cache_.Get(name);
 }
 
-int ModelManager::CacheSize() noexcept { return model_cache_.size(); }
+int ModelManager::CacheSize() noexcept {
+  std::lock_guard<std::mutex> lk(model_cache_mutex_);
+  return model_cache_.Size();
+}
 
 bool ModelManager::Unload(ModelPtr model) noexcept {
   RETURN_VAL_IF_FAIL(model, "[EasyDK InferServer] [ModelManager] Model is nullptr!", false);
   const std::string& model_key = model->GetKey();
   std::lock_guard<std::mutex> lk(model_cache_mutex_);
-  if (model_cache_.find(model_key) == model_cache_.cend()) {
+  if (!model_cache_.Erase(model_key)) {
     LOG(WARNING) << "[EasyDK InferServer] [ModelManager] Model is not in cache";
     return false;
-  } else {
-    model_cache_.erase(model_key);
-    return true;
   }
+  return true;
 }
 
 void ModelManager::ClearCache() noexcept {
   std::lock_guard<std::mutex> lk(model_cache_mutex_);
-  model_cache_.clear();
+  model_cache_.Clear();
 }
 
 #ifdef CNIS_HAVE_CURL
-#include <curl/curl.h>
-#include <cstdio>
-
-class CurlDownloader {
- public:
-  explicit CurlDownloader(const std::string& model_dir) : model_dir_(model_dir) {
-    CHECK_EQ(access(model_dir_.c_str(), W_OK), 0)
-        << "[EasyDK InferServer] [CurlDownloader] model directory not exist or do not have write permission: "
-        << model_dir_;
-    curl_ = curl_easy_init();
-    curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, false);
-    curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, errbuf_);
-  }
-
-  std::string Download(const std::string& url) noexcept {
-    // get name of model file
-    std::string file_path = model_dir_ + url.substr(url.find_last_of('/'));
-
-    if (access(file_path.c_str(), F_OK) == 0) {
-      LOG(INFO) << "[EasyDK InferServer] [CurlDownloader] Model exists in specified directory, skip download";
-      return file_path;
-    } else {
-      FileHandle f(file_path, "wb");
-      FILE* file = f.GetFile();
-
-      curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
-      curl_easy_setopt(curl_, CURLOPT_WRITEDATA, file);
-      LOG(INFO) << "[EasyDK InferServer] [CurlDownloader] Url: " << url;
-      LOG(INFO) << "[EasyDK InferServer] [CurlDownloader] File: " << file_path;
-
-      auto re = curl_easy_perform(curl_);
-      if (re != CURLE_OK) {
-        LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Download model error, error_code: " << re;
-        size_t len = strlen(errbuf_);
-        if (len) {
-          LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Extra message from cURL: " << errbuf_;
-        } else {
-          LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Extra message from cURL" << curl_easy_strerror(re);
-        }
-        LOG(ERROR) << "[EasyDK InferServer] [CurlDownloader] Model url: " << url;
-        return {};
-      }
-      return file_path;
-    }
-  }
-
-  ~CurlDownloader() {
-    if (curl_) {
-      curl_easy_cleanup(curl_);
-      curl_ = nullptr;
-    }
-  }
-
- private:
-  class FileHandle {
-   public:
-    explicit FileHandle(const std::string& fpath, const char* mode) { file_ = fopen(fpath.c_str(), mode); }
-    FILE* GetFile() { return file_; }
-    ~FileHandle() { fclose(file_); }
-
-   private:
-    FileHandle(const FileHandle&) = delete;
-    const FileHandle& operator=(const FileHandle&) = delete;
-    FILE* file_ = nullptr;
-  };  // class FileHandle
-
-  std::string model_dir_;
-  CURL* curl_ = nullptr;
-  char errbuf_[CURL_ERROR_SIZE];
-};  // class CurlDownloader
-
 std::string ModelManager::DownloadModel(const std::string& url) noexcept {
   thread_local CurlDownloader downloader(model_dir_);
   return downloader.Download(url);
@@ -0,0 +1,221 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "model_meta.h"
+
+#include <glog/logging.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "model_file.h"
+
+namespace infer_server {
+
+constexpr uint32_t ModelMetaCache::kFormatVersion;
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'N', 'I', 'S', 'M', 'E', 'T', 'A'};
+// bounds of numbers in meta, a larger one means the file is broken
+constexpr uint32_t kMaxIoNum = 1024;
+constexpr uint32_t kMaxDimNum = 16;
+constexpr uint32_t kMaxKeySize = 4096;
+
+class Writer {
+ public:
+  template <typename T>
+  void Put(const T& value) {
+    bytes_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  void PutString(const std::string& str) {
+    Put(static_cast<uint32_t>(str.size()));
+    bytes_.append(str);
+  }
+  void PutTensors(const std::vector<Shape>& shapes, const std::vector<DataLayout>& layouts) {
+    Put(static_cast<uint32_t>(shapes.size()));
+    for (size_t idx = 0; idx < shapes.size(); ++idx) {
+      Put(static_cast<uint32_t>(layouts[idx].dtype));
+      Put(static_cast<uint32_t>(layouts[idx].order));
+      std::vector<Shape::value_type> dims = shapes[idx].Vectorize();
+      Put(static_cast<uint32_t>(dims.size()));
+      for (auto dim : dims) Put(dim);
+    }
+  }
+  std::string& Bytes() { return bytes_; }
+
+ private:
+  std::string bytes_;
+};  // class Writer
+
+class Reader {
+ public:
+  Reader(const char* data, size_t size) : data_(data), remain_(size) {}
+  template <typename T>
+  bool Get(T* value) {
+    if (remain_ < sizeof(T)) return false;
+    memcpy(value, data_, sizeof(T));
+    data_ += sizeof(T);
+    remain_ -= sizeof(T);
+    return true;
+  }
+  bool GetString(std::string* str) {
+    uint32_t size = 0;
+    if (!Get(&size) || size > kMaxKeySize || remain_ < size) return false;
+    str->assign(data_, size);
+    data_ += size;
+    remain_ -= size;
+    return true;
+  }
+  bool GetTensors(std::vector<Shape>* shapes, std::vector<DataLayout>* layouts) {
+    uint32_t num = 0;
+    if (!Get(&num) || num > kMaxIoNum) return false;
+    shapes->clear();
+    layouts->clear();
+    for (uint32_t idx = 0; idx < num; ++idx) {
+      uint32_t dtype = 0, order = 0, dim_num = 0;
+      if (!Get(&dtype) || !Get(&order) || !Get(&dim_num) || dim_num > kMaxDimNum) return false;
+      if (dtype > static_cast<uint32_t>(DataType::INVALID) || order > static_cast<uint32_t>(DimOrder::INVALID)) {
+        return false;
+      }
+      std::vector<Shape::value_type> dims(dim_num);
+      for (auto& dim : dims) {
+        if (!Get(&dim)) return false;
+      }
+      layouts->push_back(DataLayout{static_cast<DataType>(dtype), static_cast<DimOrder>(order)});
+      shapes->emplace_back(dims);
+    }
+    return true;
+  }
+  size_t Remain() const { return remain_; }
+
+ private:
+  const char* data_;
+  size_t remain_;
+};  // class Reader
+
+bool MakeDirs(const std::string& dir) {
+  struct stat dir_stat;
+  if (dir.empty() || stat(dir.c_str(), &dir_stat) == 0) return true;
+  size_t pos = dir.find_last_of('/');
+  if (pos != std::string::npos && pos > 0 && !MakeDirs(dir.substr(0, pos))) return false;
+  return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+}  // namespace
+
+std::string ModelMetaCache::Path(const std::string& key) const noexcept {
+  std::ostringstream ss;
+  ss << dir_ << "/" << std::hex << std::setw(16) << std::setfill('0') << HashBytes(key.data(), key.size())
+     << ".meta";
+  return ss.str();
+}
+
+std::string ModelMetaCache::Serialize(const std::string& key, const ModelMeta& meta) const noexcept {
+  Writer payload;
+  payload.PutString(key);
+  payload.Put(meta.batch_size);
+  payload.PutTensors(meta.input_shapes, meta.input_layouts);
+  payload.PutTensors(meta.output_shapes, meta.output_layouts);
+
+  Writer file;
+  file.Bytes().append(kMagic, sizeof(kMagic));
+  file.Put(kFormatVersion);
+  file.Put(runtime_version_);
+  file.Put(static_cast<uint64_t>(payload.Bytes().size()));
+  file.Put(HashBytes(payload.Bytes().data(), payload.Bytes().size()));
+  file.Bytes().append(payload.Bytes());
+  return std::move(file.Bytes());
+}
+
+bool ModelMetaCache::Parse(const std::string& bytes, const std::string& key, ModelMeta* meta) const noexcept {
+  if (bytes.size() < sizeof(kMagic) || memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) return false;
+  Reader header(bytes.data() + sizeof(kMagic), bytes.size() - sizeof(kMagic));
+  uint32_t format_version = 0, runtime_version = 0;
+  uint64_t payload_size = 0, checksum = 0;
+  if (!header.Get(&format_version) || format_version != kFormatVersion) return false;
+  if (!header.Get(&runtime_version) || runtime_version != runtime_version_) return false;
+  if (!header.Get(&payload_size) || !header.Get(&checksum) || header.Remain() != payload_size) return false;
+  const char* payload = bytes.data() + bytes.size() - payload_size;
+  if (HashBytes(payload, payload_size) != checksum) return false;
+
+  Reader reader(payload, payload_size);
+  std::string model_key;
+  ModelMeta parsed;
+  // files of different keys may have the same name
+  if (!reader.GetString(&model_key) || model_key != key) return false;
+  if (!reader.Get(&parsed.batch_size)) return false;
+  if (!reader.GetTensors(&parsed.input_shapes, &parsed.input_layouts)) return false;
+  if (!reader.GetTensors(&parsed.output_shapes, &parsed.output_layouts)) return false;
+  if (reader.Remain() || parsed.input_shapes.empty()) return false;
+  *meta = std::move(parsed);
+  return true;
+}
+
+bool ModelMetaCache::Load(const std::string& key, ModelMeta* meta) const noexcept {
+  std::string path = Path(key);
+  std::ifstream f(path, std::ios::binary);
+  if (!f.is_open()) return false;
+  std::string bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  if (!Parse(bytes, key, meta)) {
+    VLOG(1) << "[EasyDK InferServer] [ModelMetaCache] Ignore invalid or stale model meta: " << path;
+    return false;
+  }
+  return true;
+}
+
+bool ModelMetaCache::Store(const std::string& key, const ModelMeta& meta) const noexcept {
+  if (!MakeDirs(dir_)) {
+    LOG(WARNING) << "[EasyDK InferServer] [ModelMetaCache] Create directory failed: " << dir_ << ", "
+                 << strerror(errno);
+    return false;
+  }
+  static std::atomic<uint32_t> tmp_id{0};
+  std::string path = Path(key);
+  std::string tmp_path = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(tmp_id++);
+  std::string bytes = Serialize(key, meta);
+  FILE* file = fopen(tmp_path.c_str(), "wb");
+  if (!file) {
+    LOG(WARNING) << "[EasyDK InferServer] [ModelMetaCache] Open file failed: " << tmp_path << ", " << strerror(errno);
+    return false;
+  }
+  bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+  ok = fclose(file) == 0 && ok;
+  // replace file atomically, readers see either the old or the new one
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "[EasyDK InferServer] [ModelMetaCache] Write file failed: " << path << ", " << strerror(errno);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  VLOG(1) << "[EasyDK InferServer] [ModelMetaCache] Store model meta: " << path;
+  return true;
+}
+
+}  // namespace infer_server
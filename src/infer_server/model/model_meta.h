@@ -0,0 +1,111 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_MODEL_MODEL_META_H_
+#define INFER_SERVER_MODEL_MODEL_META_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "cnis/shape.h"
+
+namespace infer_server {
+
+/**
+ * @brief Model information extracted from a model, which is enough to configure sessions before engine is built
+ */
+struct ModelMeta {
+  std::vector<Shape> input_shapes;
+  std::vector<Shape> output_shapes;
+  std::vector<DataLayout> input_layouts;
+  std::vector<DataLayout> output_layouts;
+  uint32_t batch_size{1};
+};
+
+/**
+ * @brief Persists model meta in a directory, one small binary file for each model
+ *
+ * Files are named by hash of model key, which is made of model content hash and input shapes. Each file records
+ * format version, runtime version, model key and checksum of its payload, a file mismatched with any of them is
+ * taken as a miss and overwritten by the next Store. Files are written to temporary files and renamed, so that a
+ * file is never seen partially written by other processes.
+ */
+class ModelMetaCache {
+ public:
+  /// version of file format, increase it once format is changed
+  static constexpr uint32_t kFormatVersion = 1;
+
+  /**
+   * @brief Construct a new model meta cache
+   *
+   * @param dir Directory of files, created on the first Store if it does not exist
+   * @param runtime_version Version of runtime extracting meta, files of other versions are not used
+   */
+  ModelMetaCache(const std::string& dir, uint32_t runtime_version) noexcept
+      : dir_(dir), runtime_version_(runtime_version) {}
+
+  /**
+   * @brief Loads meta of model
+   *
+   * @param key Key of model
+   * @param[out] meta Meta of model
+   * @retval true Meta is found and valid
+   * @retval false Meta is not found or not valid
+   */
+  bool Load(const std::string& key, ModelMeta* meta) const noexcept;
+
+  /**
+   * @brief Stores meta of model
+   *
+   * @param key Key of model
+   * @param meta Meta of model
+   * @retval true Succeed
+   * @retval false Failed to write file
+   */
+  bool Store(const std::string& key, const ModelMeta& meta) const noexcept;
+
+  /**
+   * @brief Gets path of meta file of model
+   */
+  std::string Path(const std::string& key) const noexcept;
+
+  /**
+   * @brief Serializes meta of model, @see Parse
+   */
+  std::string Serialize(const std::string& key, const ModelMeta& meta) const noexcept;
+
+  /**
+   * @brief Parses serialized meta of model
+   *
+   * @retval true Bytes are serialized from meta of the model by runtime of the same version
+   * @retval false Otherwise
+   */
+  bool Parse(const std::string& bytes, const std::string& key, ModelMeta* meta) const noexcept;
+
+ private:
+  std::string dir_;
+  uint32_t runtime_version_;
+};  // class ModelMetaCache
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_MODEL_MODEL_META_H_
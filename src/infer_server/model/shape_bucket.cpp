@@ -0,0 +1,185 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "shape_bucket.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "core/data_type.h"
+
+namespace infer_server {
+
+std::vector<PadCopy> PlanPadding(const Shape& src, const Shape& dst, DimOrder order, size_t dtype_size) noexcept {
+  if (src.Size() != 4 || dst.Size() != 4) return {};
+  for (size_t idx = 0; idx < 4; ++idx) {
+    if (src[idx] <= 0 || src[idx] > dst[idx]) return {};
+  }
+  // view both as outer x rows x row bytes, rows of source are placed at start of rows of destination
+  size_t outer, rows, dst_rows, row_bytes, dst_row_bytes;
+  switch (order) {
+    case DimOrder::NHWC:
+      if (src[3] != dst[3]) return {};
+      outer = src[0];
+      rows = src[1], dst_rows = dst[1];
+      row_bytes = src[2] * src[3] * dtype_size, dst_row_bytes = dst[2] * dst[3] * dtype_size;
+      break;
+    case DimOrder::NCHW:
+      if (src[1] != dst[1]) return {};
+      outer = src[0] * src[1];
+      rows = src[2], dst_rows = dst[2];
+      row_bytes = src[3] * dtype_size, dst_row_bytes = dst[3] * dtype_size;
+      break;
+    default:
+      return {};
+  }
+
+  size_t plane_bytes = rows * row_bytes, dst_plane_bytes = dst_rows * dst_row_bytes;
+  if (row_bytes == dst_row_bytes) {
+    // rows are contiguous in each plane, copy planes at once
+    if (plane_bytes == dst_plane_bytes) {
+      return {{0, 0, outer * plane_bytes, 1, outer * plane_bytes, outer * plane_bytes}};
+    }
+    return {{0, 0, plane_bytes, outer, plane_bytes, dst_plane_bytes}};
+  }
+  std::vector<PadCopy> copies;
+  copies.reserve(outer);
+  for (size_t idx = 0; idx < outer; ++idx) {
+    copies.push_back({idx * plane_bytes, idx * dst_plane_bytes, row_bytes, rows, row_bytes, dst_row_bytes});
+  }
+  return copies;
+}
+
+namespace {
+// indexes of height and width, -1 if order is not supported
+inline void HWIndex(DimOrder order, int* h, int* w) {
+  switch (order) {
+    case DimOrder::NHWC:
+      *h = 1, *w = 2;
+      break;
+    case DimOrder::NCHW:
+      *h = 2, *w = 3;
+      break;
+    default:
+      *h = -1, *w = -1;
+  }
+}
+}  // namespace
+
+Shape ValidShape(const Shape& in, const Shape& bucket, DimOrder in_order, const Shape& out,
+                 DimOrder out_order) noexcept {
+  Shape valid = out;
+  if (in.Size() != 4 || bucket.Size() != 4 || out.Empty()) return valid;
+  if (out[0] == bucket[0]) valid[0] = in[0];
+  if (out.Size() != 4) return valid;
+
+  int in_h, in_w, out_h, out_w;
+  HWIndex(in_order, &in_h, &in_w);
+  HWIndex(out_order, &out_h, &out_w);
+  if (in_h < 0 || out_h < 0 || out[out_h] <= 0 || out[out_w] <= 0) return valid;
+  if (bucket[in_h] % out[out_h] || bucket[in_w] % out[out_w]) return valid;
+  const int64_t stride = bucket[in_h] / out[out_h];
+  if (bucket[in_w] / out[out_w] != stride) return valid;
+  valid[out_h] = (in[in_h] + stride - 1) / stride;
+  valid[out_w] = (in[in_w] + stride - 1) / stride;
+  return valid;
+}
+
+ShapeBucketer::ShapeBucketer(const std::vector<ShapeBucket>& buckets, const Shape& model_shape,
+                             DimOrder order) noexcept
+    : order_(order) {
+  int64_t channel = 0;
+  if (model_shape.Size() == 4) {
+    if (order == DimOrder::NHWC) channel = model_shape[3];
+    if (order == DimOrder::NCHW) channel = model_shape[1];
+  }
+  if (channel <= 0) {
+    LOG(WARNING) << "[EasyDK InferServer] [ShapeBucketer] Only NHWC or NCHW input with fixed channel is supported,"
+                 << " model input shape: " << model_shape;
+    return;
+  }
+  for (auto& bucket : buckets) {
+    if (!bucket.batch || !bucket.h || !bucket.w) {
+      LOG(WARNING) << "[EasyDK InferServer] [ShapeBucketer] Drop bucket with zero dimension";
+      continue;
+    }
+    if (order == DimOrder::NHWC) {
+      shapes_.emplace_back(std::vector<Shape::value_type>{bucket.batch, bucket.h, bucket.w, channel});
+    } else {
+      shapes_.emplace_back(std::vector<Shape::value_type>{bucket.batch, channel, bucket.h, bucket.w});
+    }
+  }
+  std::stable_sort(shapes_.begin(), shapes_.end(),
+                   [](const Shape& lhs, const Shape& rhs) { return lhs.BatchDataCount() < rhs.BatchDataCount(); });
+  output_shapes_.resize(shapes_.size());
+}
+
+bool ShapeBucketer::Holds(const Shape& bucket, const Shape& shape) const noexcept {
+  if (shape.Size() != bucket.Size()) return false;
+  for (size_t idx = 0; idx < shape.Size(); ++idx) {
+    if (shape[idx] <= 0 || shape[idx] > bucket[idx]) return false;
+  }
+  // channel is not padded
+  size_t c_idx = order_ == DimOrder::NHWC ? 3 : 1;
+  return shape[c_idx] == bucket[c_idx];
+}
+
+int ShapeBucketer::Select(const Shape& shape) const noexcept {
+  for (size_t idx = 0; idx < shapes_.size(); ++idx) {
+    if (Holds(shapes_[idx], shape)) return static_cast<int>(idx);
+  }
+  return -1;
+}
+
+std::vector<Shape> ShapeBucketer::OutputShapes(int idx, const InferFunc& infer) noexcept {
+  std::unique_lock<std::mutex> lk(output_mutex_);
+  if (output_shapes_[idx].empty()) {
+    output_shapes_[idx] = infer(shapes_[idx]);
+    VLOG(2) << "[EasyDK InferServer] [ShapeBucketer] Plan bucket " << shapes_[idx] << ", output shape: "
+            << output_shapes_[idx];
+  }
+  return output_shapes_[idx];
+}
+
+void ShapeBucketer::Record(const Shape& shape, int idx) noexcept {
+  if (idx < 0) {
+    ++miss_cnt_;
+    return;
+  }
+  ++batch_cnt_;
+  real_elements_ += shape.BatchDataCount();
+  padded_elements_ += shapes_[idx].BatchDataCount();
+}
+
+PaddingStatistic ShapeBucketer::Statistic() const noexcept {
+  PaddingStatistic stat;
+  stat.batch_cnt = batch_cnt_.load();
+  stat.miss_cnt = miss_cnt_.load();
+  stat.real_elements = real_elements_.load();
+  stat.padded_elements = padded_elements_.load();
+  if (stat.real_elements) {
+    stat.overhead = static_cast<float>(static_cast<double>(stat.padded_elements) / stat.real_elements - 1);
+  }
+  return stat;
+}
+
+}  // namespace infer_server
@@ -0,0 +1,143 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_MODEL_SHAPE_BUCKET_H_
+#define INFER_SERVER_MODEL_SHAPE_BUCKET_H_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "cnis/shape.h"
+
+namespace infer_server {
+
+/**
+ * @brief A 2D copy placing rows of source into rows of destination, offsets, width and pitches are in bytes
+ */
+struct PadCopy {
+  size_t src_offset;
+  size_t dst_offset;
+  size_t width;
+  size_t height;
+  size_t src_pitch;
+  size_t dst_pitch;
+};
+
+/**
+ * @brief Plans copies placing a batch into the corner of a larger shape, padding region is left untouched
+ *
+ * @param src Shape of source batch
+ * @param dst Shape of destination, not smaller than src in each dimension
+ * @param order Dim order of both shapes, NHWC or NCHW
+ * @param dtype_size Size of data type in bytes
+ * @return copies to be done, empty if shapes are not supported
+ */
+std::vector<PadCopy> PlanPadding(const Shape& src, const Shape& dst, DimOrder order, size_t dtype_size) noexcept;
+
+/**
+ * @brief Gets the region of an output holding data of a batch padded to a bucket
+ *
+ * Batch dimension equal to bucket batch is cut to input batch. Height and width of a 4D NHWC or NCHW output, which
+ * are bucket height and width divided by the same integer stride, are cut to input height and width divided by
+ * the stride (rounded up). Other dimensions are kept as is.
+ *
+ * @param in Input shape of batch before padding
+ * @param bucket Input shape of bucket
+ * @param in_order Dim order of input
+ * @param out Output shape of bucket
+ * @param out_order Dim order of output
+ * @return shape of valid region, which starts at the corner of output
+ */
+Shape ValidShape(const Shape& in, const Shape& bucket, DimOrder in_order, const Shape& out,
+                 DimOrder out_order) noexcept;
+
+/**
+ * @brief Picks the smallest bucket holding a batch, caches output shapes of buckets and accounts padding
+ *
+ * Thread safe, shared by predictors of all engines in a session.
+ */
+class ShapeBucketer {
+ public:
+  /// infers output shapes of model with the given input shape, empty if failed
+  using InferFunc = std::function<std::vector<Shape>(const Shape&)>;
+
+  /**
+   * @brief Construct a new Shape Bucketer object
+   *
+   * @param buckets (batch, h, w) of buckets
+   * @param model_shape Input shape of model, provides channel
+   * @param order Dim order of model input, NHWC or NCHW
+   */
+  ShapeBucketer(const std::vector<ShapeBucket>& buckets, const Shape& model_shape, DimOrder order) noexcept;
+
+  /// Gets number of valid buckets, buckets with non-positive dimension are dropped
+  int BucketNum() const noexcept { return static_cast<int>(shapes_.size()); }
+
+  /// Gets full input shape of bucket, buckets are sorted by data count ascending
+  const Shape& BucketShape(int idx) const noexcept { return shapes_[idx]; }
+
+  /**
+   * @brief Selects the smallest bucket holding shape
+   *
+   * @param shape Input shape of batch
+   * @return index of bucket, -1 if no bucket could hold it
+   */
+  int Select(const Shape& shape) const noexcept;
+
+  /**
+   * @brief Gets output shapes of bucket, inferred at the first time and cached
+   *
+   * @param idx Index of bucket
+   * @param infer Function to infer output shapes, invoked only if output shapes of bucket have not been cached
+   * @return output shapes, empty if infer failed
+   */
+  std::vector<Shape> OutputShapes(int idx, const InferFunc& infer) noexcept;
+
+  /**
+   * @brief Records a batch
+   *
+   * @param shape Input shape of batch before padding
+   * @param idx Index of bucket selected, -1 if no bucket could hold it
+   */
+  void Record(const Shape& shape, int idx) noexcept;
+
+  /// Gets padding statistics of batches recorded
+  PaddingStatistic Statistic() const noexcept;
+
+ private:
+  bool Holds(const Shape& bucket, const Shape& shape) const noexcept;
+
+  DimOrder order_;
+  std::vector<Shape> shapes_;
+  std::vector<std::vector<Shape>> output_shapes_;
+  std::mutex output_mutex_;
+  std::atomic<uint64_t> batch_cnt_{0};
+  std::atomic<uint64_t> miss_cnt_{0};
+  std::atomic<uint64_t> real_elements_{0};
+  std::atomic<uint64_t> padded_elements_{0};
+};  // class ShapeBucketer
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_MODEL_SHAPE_BUCKET_H_
@@ -0,0 +1,352 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnis/detection.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "core/cast_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DETECTION_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#define DETECTION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace infer_server {
+
+namespace {
+
+// rows of half data converted at a time
+constexpr size_t kConvertRows = 512;
+
+#if defined(DETECTION_SSE2)
+struct Simd {
+  using V = __m128;
+  static V Load(const float *p) { return _mm_loadu_ps(p); }
+  static V Set(float v) { return _mm_set1_ps(v); }
+  static V Set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+  static void Store(float *p, V v) { _mm_storeu_ps(p, v); }
+  static V Add(V a, V b) { return _mm_add_ps(a, b); }
+  static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V Min(V a, V b) { return _mm_min_ps(a, b); }
+  static V Max(V a, V b) { return _mm_max_ps(a, b); }
+  static V Greater(V a, V b) { return _mm_cmpgt_ps(a, b); }
+  static V GreaterEqual(V a, V b) { return _mm_cmpge_ps(a, b); }
+  // bit i is set if lane i of comparison result is true
+  static uint32_t Mask(V m) { return static_cast<uint32_t>(_mm_movemask_ps(m)); }
+};
+#elif defined(DETECTION_NEON)
+struct Simd {
+  using V = float32x4_t;
+  static V Load(const float *p) { return vld1q_f32(p); }
+  static V Set(float v) { return vdupq_n_f32(v); }
+  static V Set(float a, float b, float c, float d) {
+    const float v[4] = {a, b, c, d};
+    return vld1q_f32(v);
+  }
+  static void Store(float *p, V v) { vst1q_f32(p, v); }
+  static V Add(V a, V b) { return vaddq_f32(a, b); }
+  static V Sub(V a, V b) { return vsubq_f32(a, b); }
+  static V Mul(V a, V b) { return vmulq_f32(a, b); }
+  static V Min(V a, V b) { return vminq_f32(a, b); }
+  static V Max(V a, V b) { return vmaxq_f32(a, b); }
+  static V Greater(V a, V b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+  static V GreaterEqual(V a, V b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+  static uint32_t Mask(V m) {
+    const uint32_t bits[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(vreinterpretq_u32_f32(m), vld1q_u32(bits)));
+  }
+};
+#endif
+
+inline float Area(const Detection &d) { return std::max(d.x1 - d.x0, 0.f) * std::max(d.y1 - d.y0, 0.f); }
+
+// indices sorted by descending score, ties in original order
+std::vector<uint32_t> ScoreOrder(const std::vector<Detection> &dets, size_t k) {
+  std::vector<uint32_t> order(dets.size());
+  std::iota(order.begin(), order.end(), 0);
+  auto greater = [&dets](uint32_t a, uint32_t b) {
+    return dets[a].score > dets[b].score || (dets[a].score == dets[b].score && a < b);
+  };
+  if (k && k < order.size()) {
+    std::partial_sort(order.begin(), order.begin() + k, order.end(), greater);
+    order.resize(k);
+  } else {
+    std::sort(order.begin(), order.end(), greater);
+  }
+  return order;
+}
+
+// boxes in sorted order as separate arrays
+class BoxArrays {
+ public:
+  BoxArrays(const std::vector<Detection> &dets, const std::vector<uint32_t> &order) {
+    size_ = order.size();
+    data_.resize(size_ * 5);
+    for (size_t i = 0; i < order.size(); ++i) {
+      const Detection &d = dets[order[i]];
+      X0()[i] = d.x0;
+      Y0()[i] = d.y0;
+      X1()[i] = d.x1;
+      Y1()[i] = d.y1;
+      AreaOf()[i] = Area(d);
+    }
+  }
+  size_t Size() const { return size_; }
+  float *X0() { return data_.data(); }
+  float *Y0() { return data_.data() + size_; }
+  float *X1() { return data_.data() + 2 * size_; }
+  float *Y1() { return data_.data() + 3 * size_; }
+  float *AreaOf() { return data_.data() + 4 * size_; }
+
+ private:
+  size_t size_;
+  std::vector<float> data_;
+};
+
+// marks boxes in (i, end) overlapping box i, IoU > thr is tested as inter > thr * union
+void SuppressOverlaps(BoxArrays *boxes, size_t i, size_t end, float thr, std::vector<uint8_t> *suppressed) {
+  const float *x0 = boxes->X0(), *y0 = boxes->Y0(), *x1 = boxes->X1(), *y1 = boxes->Y1();
+  const float *area = boxes->AreaOf();
+  uint8_t *flags = suppressed->data();
+  size_t j = i + 1;
+#if defined(DETECTION_SSE2) || defined(DETECTION_NEON)
+  const Simd::V bx0 = Simd::Set(x0[i]), by0 = Simd::Set(y0[i]), bx1 = Simd::Set(x1[i]), by1 = Simd::Set(y1[i]);
+  const Simd::V barea = Simd::Set(area[i]);
+  const Simd::V zero = Simd::Set(0.f), vthr = Simd::Set(thr);
+  for (; j + 4 <= end; j += 4) {
+    Simd::V w = Simd::Sub(Simd::Min(bx1, Simd::Load(x1 + j)), Simd::Max(bx0, Simd::Load(x0 + j)));
+    Simd::V h = Simd::Sub(Simd::Min(by1, Simd::Load(y1 + j)), Simd::Max(by0, Simd::Load(y0 + j)));
+    Simd::V inter = Simd::Mul(Simd::Max(w, zero), Simd::Max(h, zero));
+    Simd::V uni = Simd::Sub(Simd::Add(barea, Simd::Load(area + j)), inter);
+    uint32_t mask = Simd::Mask(Simd::Greater(inter, Simd::Mul(vthr, uni)));
+    for (int b = 0; mask; ++b, mask >>= 1) {
+      if (mask & 1) flags[j + b] = 1;
+    }
+  }
+#endif
+  for (; j < end; ++j) {
+    float w = std::max(std::min(x1[i], x1[j]) - std::max(x0[i], x0[j]), 0.f);
+    float h = std::max(std::min(y1[i], y1[j]) - std::max(y0[i], y0[j]), 0.f);
+    float inter = w * h;
+    if (inter > thr * (area[i] + area[j] - inter)) flags[j] = 1;
+  }
+}
+
+void DecodeRows(const float *data, size_t num, const DetectionLayout &layout, float threshold,
+                std::vector<uint32_t> *indices, std::vector<Detection> *out) {
+  indices->clear();
+  FilterByScore(data, num, layout, threshold, indices);
+  for (uint32_t idx : *indices) {
+    const float *row = data + idx * layout.stride;
+    const float *box = row + layout.box_offset;
+    Detection det;
+    det.x0 = box[0];
+    det.y0 = box[1];
+    det.x1 = box[2];
+    det.y1 = box[3];
+    det.score = row[layout.score_offset];
+    det.label = layout.label_offset < 0 ? 0 : static_cast<int>(row[layout.label_offset]);
+    out->push_back(det);
+  }
+}
+
+bool CheckLayout(const DetectionLayout &layout) {
+  const int stride = static_cast<int>(layout.stride);
+  return stride > 0 && layout.score_offset >= 0 && layout.score_offset < stride && layout.label_offset < stride &&
+         layout.box_offset >= 0 && layout.box_offset + 4 <= stride;
+}
+
+}  // namespace
+
+BoxTransform BoxTransform::Letterbox(uint32_t model_w, uint32_t model_h, uint32_t image_w, uint32_t image_h,
+                                     bool normalized, bool centered) noexcept {
+  BoxTransform t;
+  if (!model_w || !model_h || !image_w || !image_h) return t;
+  // image is resized by s into model input, with padding at both sides or at the right / bottom
+  const float s = std::min(static_cast<float>(model_w) / image_w, static_cast<float>(model_h) / image_h);
+  const float pad_x = centered ? (model_w - image_w * s) / 2 : 0.f;
+  const float pad_y = centered ? (model_h - image_h * s) / 2 : 0.f;
+  if (normalized) {
+    t.scale_x = model_w / (image_w * s);
+    t.scale_y = model_h / (image_h * s);
+    t.offset_x = -pad_x / (image_w * s);
+    t.offset_y = -pad_y / (image_h * s);
+    t.max_x = 1.f;
+    t.max_y = 1.f;
+  } else {
+    t.scale_x = 1.f / s;
+    t.scale_y = 1.f / s;
+    t.offset_x = -pad_x / s;
+    t.offset_y = -pad_y / s;
+    t.max_x = static_cast<float>(image_w);
+    t.max_y = static_cast<float>(image_h);
+  }
+  return t;
+}
+
+size_t FilterByScore(const float *data, size_t num, const DetectionLayout &layout, float threshold,
+                     std::vector<uint32_t> *indices) noexcept {
+  const size_t stride = layout.stride;
+  const float *score = data + layout.score_offset;
+  const size_t before = indices->size();
+  size_t i = 0;
+#if defined(DETECTION_SSE2) || defined(DETECTION_NEON)
+  // scores are gathered four rows at a time, most candidates are dropped without a branch per row
+  const Simd::V vthr = Simd::Set(threshold);
+  for (; i + 4 <= num; i += 4) {
+    const float *s = score + i * stride;
+    uint32_t mask = Simd::Mask(Simd::GreaterEqual(Simd::Set(s[0], s[stride], s[2 * stride], s[3 * stride]), vthr));
+    for (uint32_t b = 0; mask; ++b, mask >>= 1) {
+      if (mask & 1) indices->push_back(static_cast<uint32_t>(i + b));
+    }
+  }
+#endif
+  for (; i < num; ++i) {
+    if (score[i * stride] >= threshold) indices->push_back(static_cast<uint32_t>(i));
+  }
+  return indices->size() - before;
+}
+
+void TransformBoxes(Detection *dets, size_t num, const BoxTransform &t) noexcept {
+  const bool clip_x = t.max_x > 0, clip_y = t.max_y > 0;
+#if defined(DETECTION_SSE2) || defined(DETECTION_NEON)
+  // corners of a box fill one vector
+  const Simd::V scale = Simd::Set(t.scale_x, t.scale_y, t.scale_x, t.scale_y);
+  const Simd::V offset = Simd::Set(t.offset_x, t.offset_y, t.offset_x, t.offset_y);
+  const float inf = std::numeric_limits<float>::infinity();
+  const Simd::V lo = Simd::Set(clip_x ? 0.f : -inf, clip_y ? 0.f : -inf, clip_x ? 0.f : -inf, clip_y ? 0.f : -inf);
+  const float mx = clip_x ? t.max_x : inf, my = clip_y ? t.max_y : inf;
+  const Simd::V hi = Simd::Set(mx, my, mx, my);
+  for (size_t i = 0; i < num; ++i) {
+    float *box = &dets[i].x0;
+    Simd::Store(box, Simd::Min(Simd::Max(Simd::Add(Simd::Mul(Simd::Load(box), scale), offset), lo), hi));
+  }
+#else
+  for (size_t i = 0; i < num; ++i) {
+    Detection &d = dets[i];
+    d.x0 = d.x0 * t.scale_x + t.offset_x;
+    d.y0 = d.y0 * t.scale_y + t.offset_y;
+    d.x1 = d.x1 * t.scale_x + t.offset_x;
+    d.y1 = d.y1 * t.scale_y + t.offset_y;
+    if (clip_x) {
+      d.x0 = std::min(std::max(d.x0, 0.f), t.max_x);
+      d.x1 = std::min(std::max(d.x1, 0.f), t.max_x);
+    }
+    if (clip_y) {
+      d.y0 = std::min(std::max(d.y0, 0.f), t.max_y);
+      d.y1 = std::min(std::max(d.y1, 0.f), t.max_y);
+    }
+  }
+#endif
+}
+
+void SelectTopK(std::vector<Detection> *dets, size_t k) noexcept {
+  std::vector<uint32_t> order = ScoreOrder(*dets, k);
+  std::vector<Detection> res;
+  res.reserve(order.size());
+  for (uint32_t idx : order) res.push_back((*dets)[idx]);
+  dets->swap(res);
+}
+
+void NonMaxSuppression(std::vector<Detection> *dets, float iou_threshold, bool class_aware,
+                       size_t max_output) noexcept {
+  if (dets->empty()) return;
+  std::vector<uint32_t> order = ScoreOrder(*dets, 0);
+  if (class_aware) {
+    // boxes of a label are contiguous, so each box is compared only with its own class
+    std::stable_sort(order.begin(), order.end(),
+                     [dets](uint32_t a, uint32_t b) { return (*dets)[a].label < (*dets)[b].label; });
+  }
+  const size_t n = order.size();
+  BoxArrays boxes(*dets, order);
+  std::vector<uint8_t> suppressed(boxes.Size(), 0);
+  std::vector<uint32_t> kept;
+  for (size_t first = 0, last = 0; first < n; first = last) {
+    last = first + 1;
+    if (class_aware) {
+      while (last < n && (*dets)[order[last]].label == (*dets)[order[first]].label) ++last;
+    } else {
+      last = n;
+    }
+    for (size_t i = first; i < last; ++i) {
+      if (suppressed[i]) continue;
+      kept.push_back(order[i]);
+      if (!class_aware && max_output && kept.size() == max_output) break;
+      if (iou_threshold < 1.f) SuppressOverlaps(&boxes, i, last, iou_threshold, &suppressed);
+    }
+  }
+
+  // back to descending score across labels
+  std::sort(kept.begin(), kept.end(), [dets](uint32_t a, uint32_t b) {
+    return (*dets)[a].score > (*dets)[b].score || ((*dets)[a].score == (*dets)[b].score && a < b);
+  });
+  if (max_output && kept.size() > max_output) kept.resize(max_output);
+  std::vector<Detection> res;
+  res.reserve(kept.size());
+  for (uint32_t idx : kept) res.push_back((*dets)[idx]);
+  dets->swap(res);
+}
+
+Status DecodeDetections(const void *data, DataType dtype, size_t num, const DetectionLayout &layout,
+                        const DetectionParams &params, const BoxTransform *transform,
+                        std::vector<Detection> *out) noexcept {
+  if (!data || !out || !CheckLayout(layout)) {
+    LOG(ERROR) << "[EasyDK InferServer] DecodeDetections(): Invalid data or layout";
+    return Status::INVALID_PARAM;
+  }
+  out->clear();
+  std::vector<uint32_t> indices;
+  if (dtype == DataType::FLOAT32) {
+    DecodeRows(static_cast<const float *>(data), num, layout, params.threshold, &indices, out);
+  } else if (dtype == DataType::FLOAT16) {
+    // converted in blocks, which stay in cache
+    const uint16_t *half = static_cast<const uint16_t *>(data);
+    std::vector<float> block(std::min(num, kConvertRows) * layout.stride);
+    for (size_t first = 0; first < num; first += kConvertRows) {
+      const size_t rows = std::min(kConvertRows, num - first);
+      detail::CastHost(half + first * layout.stride, block.data(), DataType::FLOAT16, DataType::FLOAT32,
+                       rows * layout.stride);
+      DecodeRows(block.data(), rows, layout, params.threshold, &indices, out);
+    }
+  } else {
+    LOG(ERROR) << "[EasyDK InferServer] DecodeDetections(): Unsupported data type: " << static_cast<int>(dtype);
+    return Status::INVALID_PARAM;
+  }
+
+  if (transform) TransformBoxes(out->data(), out->size(), *transform);
+  out->erase(std::remove_if(out->begin(), out->end(),
+                            [](const Detection &d) { return !(d.x1 > d.x0) || !(d.y1 > d.y0); }),
+             out->end());
+  if (params.pre_nms_top_k) SelectTopK(out, params.pre_nms_top_k);
+  NonMaxSuppression(out, params.nms_iou, params.class_aware, params.max_detections);
+  return Status::SUCCESS;
+}
+
+}  // namespace infer_server
@@ -0,0 +1,213 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "cnis/processor.h"
+#include "../cnedk_transform_impl_host.hpp"
+
+namespace infer_server {
+
+namespace {
+
+// expands per-tensor or per-channel quantization to each of 3 channels
+bool ExpandQuantParams(const QuantParams &quant, DataType dtype, float *scale, int *zero_point) {
+  const size_t num = quant.scale.size();
+  if ((num != 1 && num != 3) || (!quant.zero_point.empty() && quant.zero_point.size() != num)) {
+    LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnTensorParams(): Quantization must be per-tensor or "
+                  "per-channel, number of scales: " << num << ", number of zero points: " << quant.zero_point.size();
+    return false;
+  }
+  const int lo = dtype == DataType::INT8 ? std::numeric_limits<int8_t>::min() : std::numeric_limits<int16_t>::min();
+  const int hi = dtype == DataType::INT8 ? std::numeric_limits<int8_t>::max() : std::numeric_limits<int16_t>::max();
+  for (int c = 0; c < 3; ++c) {
+    const size_t idx = num == 1 ? 0 : c;
+    scale[c] = quant.scale[idx];
+    zero_point[c] = quant.zero_point.empty() ? 0 : quant.zero_point[idx];
+    if (!(scale[c] > 0.f) || zero_point[c] < lo || zero_point[c] > hi) {
+      LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnTensorParams(): Invalid quantization, scale: " << scale[c]
+                 << ", zero point: " << zero_point[c];
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+HostPreproc::HostPreproc(const CnedkTransformMeanStdParams *mean_std, NetworkInputFormat tensor_format,
+                         const CnedkTransformLetterboxParams *letterbox, const QuantParams *quant) noexcept
+    : normalize_(mean_std != nullptr), tensor_format_(tensor_format), letterbox_(letterbox != nullptr) {
+  memset(&mean_std_, 0, sizeof(mean_std_));
+  if (mean_std) mean_std_ = *mean_std;
+  memset(&letterbox_params_, 0, sizeof(letterbox_params_));
+  if (letterbox) letterbox_params_ = *letterbox;
+  if (quant) quant_ = *quant;
+}
+
+int HostPreproc::OnTensorParams(const CnPreprocTensorParams *params) {
+  const std::vector<int> &shape = params->input_shape;
+  if (shape.size() != 4) {
+    LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnTensorParams(): Input shape must have 4 dimensions";
+    return -1;
+  }
+  int channel = 0;
+  if (params->input_order == DimOrder::NHWC) {
+    height_ = shape[1];
+    width_ = shape[2];
+    channel = shape[3];
+    planar_ = false;
+  } else if (params->input_order == DimOrder::NCHW) {
+    channel = shape[1];
+    height_ = shape[2];
+    width_ = shape[3];
+    planar_ = true;
+  } else {
+    LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnTensorParams(): Unsupported input dim order";
+    return -1;
+  }
+  if (channel != 3) {
+    LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnTensorParams(): Input channel must be 3";
+    return -1;
+  }
+
+  switch (params->input_dtype) {
+    case DataType::UINT8:
+      data_type_ = CNEDK_TRANSFORM_UINT8;
+      break;
+    case DataType::FLOAT32:
+      data_type_ = CNEDK_TRANSFORM_FLOAT32;
+      break;
+    case DataType::FLOAT16:
+      data_type_ = CNEDK_TRANSFORM_FLOAT16;
+      break;
+    case DataType::INT8:
+    case DataType::INT16: {
+      data_type_ = params->input_dtype == DataType::INT8 ? CNEDK_TRANSFORM_INT8 : CNEDK_TRANSFORM_INT16;
+      // quantization reported by the model comes first
+      const QuantParams &quant = params->input_quant.scale.empty() ? quant_ : params->input_quant;
+      if (!ExpandQuantParams(quant, params->input_dtype, quant_scale_, quant_zero_point_)) return -1;
+      break;
+    }
+    default:
+      LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnTensorParams(): Unsupported input data type";
+      return -1;
+  }
+
+  NetworkInputFormat format = params->input_format == NetworkInputFormat::TENSOR ? tensor_format_
+                                                                                  : params->input_format;
+  if (format == NetworkInputFormat::RGB) {
+    color_format_ = CNEDK_BUF_COLOR_FORMAT_RGB;
+  } else if (format == NetworkInputFormat::BGR) {
+    color_format_ = CNEDK_BUF_COLOR_FORMAT_BGR;
+  } else {
+    LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnTensorParams(): Unsupported input format";
+    return -1;
+  }
+  return 0;
+}
+
+int HostPreproc::OnPreproc(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr dst,
+                           const std::vector<CnedkTransformRect> &src_rects) {
+  if (!width_ || !height_) {
+    LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnPreproc(): Tensor params have not been set";
+    return -1;
+  }
+  cnedk::HostTensorDesc desc;
+  desc.width = width_;
+  desc.height = height_;
+  desc.color_format = color_format_;
+  desc.data_type = data_type_;
+  desc.planar = planar_;
+  for (int c = 0; c < 3; ++c) {
+    desc.quant_scale[c] = quant_scale_[c];
+    desc.quant_zero_point[c] = quant_zero_point_[c];
+  }
+  const CnedkTransformRect dst_roi{0, 0, width_, height_};
+
+  const uint32_t batch_size = src->GetNumFilled();
+  // objects of the same frame are grouped by frame address before it is copied to host, so that the frame is
+  // mirrored once and cropped in one pass over it
+  std::vector<uint32_t> leaders(batch_size);
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const CnedkBufSurfaceParams &params = *src->GetSurfaceParams(i);
+    leaders[i] = i;
+    for (uint32_t j = 0; j < i; ++j) {
+      const CnedkBufSurfaceParams &other = *src->GetSurfaceParams(j);
+      if (leaders[j] == j && other.data_ptr == params.data_ptr && other.color_format == params.color_format) {
+        leaders[i] = j;
+        break;
+      }
+    }
+  }
+
+  std::vector<const uint8_t *> sources(batch_size);
+  std::vector<cnedk::HostRoiJob> jobs(batch_size);
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const CnedkBufSurfaceParams &params = *src->GetSurfaceParams(i);
+    if (leaders[i] == i) {
+      uint8_t *src_data = static_cast<uint8_t *>(src->GetHostData(0, i));
+      sources[i] = src_data ? src_data - params.plane_params.offset[0] : nullptr;
+    } else {
+      sources[i] = sources[leaders[i]];
+    }
+    void *dst_data = dst->GetHostData(0, i);
+    if (!sources[i] || !dst_data) {
+      LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnPreproc(): Get host data failed, batch_idx = " << i;
+      return -1;
+    }
+
+    CnedkTransformRect src_roi{0, 0, params.width, params.height};
+    if (i < src_rects.size()) {
+      // clip into the image, an empty rect selects the whole image
+      const CnedkTransformRect &rect = src_rects[i];
+      uint32_t left = std::min(rect.left, params.width - 1), top = std::min(rect.top, params.height - 1);
+      uint32_t width = std::min(rect.width, params.width - left), height = std::min(rect.height, params.height - top);
+      if (width && height) src_roi = CnedkTransformRect{top, left, width, height};
+    }
+    jobs[i] = cnedk::HostRoiJob{src_roi, dst_data, dst_roi, letterbox_ ? letterbox_params_.pad_value : nullptr};
+  }
+
+  std::vector<cnedk::HostRoiJob> group;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    if (leaders[i] != i) continue;
+    const CnedkBufSurfaceParams &params = *src->GetSurfaceParams(i);
+    group.assign(1, jobs[i]);
+    for (uint32_t j = i + 1; j < batch_size; ++j) {
+      if (leaders[j] == i) group.push_back(jobs[j]);
+    }
+    if (cnedk::HostResizeConvertRois(params, sources[i], group.data(), group.size(), desc,
+                                     normalize_ ? &mean_std_ : nullptr) < 0) {
+      LOG(ERROR) << "[EasyDK InferServer] [HostPreproc] OnPreproc(): Resize and convert failed, batch_idx = " << i;
+      return -1;
+    }
+  }
+  if (dst->GetMemType() != CNEDK_BUF_MEM_SYSTEM && dst->GetMemType() != CNEDK_BUF_MEM_PINNED) {
+    dst->SyncHostToDevice(-1, -1);
+  }
+  return 0;
+}
+
+}  // namespace infer_server
@@ -0,0 +1,164 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "processor/output_pool.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "glog/logging.h"
+
+namespace infer_server {
+
+// constexpr is not inline in C++11
+constexpr uint32_t OutputPool::kBlocksPerUser;
+constexpr uint32_t OutputPool::kInitialBlocks;
+
+static std::mutex gOutputPoolMapMutex;
+static std::map<std::string, std::weak_ptr<OutputPool>> gOutputPoolMap;
+
+std::string OutputPool::MakeKey(int device_id, const std::string &model_key, const std::string &shape, int dtype) {
+  return model_key + "_dev" + std::to_string(device_id) + "_" + shape + "_dtype" + std::to_string(dtype);
+}
+
+std::shared_ptr<OutputPool> OutputPool::Attach(const std::string &key, const CnedkBufSurfaceCreateParams &params) {
+  std::unique_lock<std::mutex> lk(gOutputPoolMapMutex);
+  std::shared_ptr<OutputPool> owner = gOutputPoolMap[key].lock();
+  if (!owner) {
+    owner.reset(new OutputPool(params));
+    std::unique_lock<std::mutex> pool_lk(owner->mutex_);
+    if (owner->Grow(kInitialBlocks) < 0) {
+      LOG(ERROR) << "[EasyDK InferServer] [OutputPool] Attach(): Create pool failed, key: " << key;
+      gOutputPoolMap.erase(key);
+      return nullptr;
+    }
+    owner->self_ = owner;
+    gOutputPoolMap[key] = owner;
+    VLOG(2) << "[EasyDK InferServer] [OutputPool] Attach(): Create shared output pool " << key;
+  }
+  {
+    std::unique_lock<std::mutex> pool_lk(owner->mutex_);
+    ++owner->user_num_;
+  }
+  // each user holds the owner, pool is destroyed with the last user
+  return std::shared_ptr<OutputPool>(owner.get(), [owner](OutputPool *pool) { pool->Detach(); });
+}
+
+size_t OutputPool::Count() {
+  std::unique_lock<std::mutex> lk(gOutputPoolMapMutex);
+  size_t count = 0;
+  for (auto it = gOutputPoolMap.begin(); it != gOutputPoolMap.end();) {
+    if (it->second.expired()) {
+      it = gOutputPoolMap.erase(it);
+    } else {
+      ++count, ++it;
+    }
+  }
+  return count;
+}
+
+OutputPool::~OutputPool() {
+  for (auto &chunk : chunks_) {
+    // blocks still in use are waited inside
+    if (CnedkBufPoolDestroy(chunk) < 0) {
+      LOG(ERROR) << "[EasyDK InferServer] [OutputPool] ~OutputPool(): Destroy pool failed";
+    }
+  }
+  chunks_.clear();
+}
+
+void OutputPool::Detach() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  --user_num_;
+}
+
+int OutputPool::Grow(uint32_t block_num) {
+  void *chunk = nullptr;
+  if (CnedkBufPoolCreate(&chunk, &params_, block_num) < 0) {
+    LOG(ERROR) << "[EasyDK InferServer] [OutputPool] Grow(): Create BufSurface pool failed";
+    return -1;
+  }
+  chunks_.push_back(chunk);
+  block_num_ += block_num;
+  VLOG(3) << "[EasyDK InferServer] [OutputPool] Grow(): Pool grows to " << block_num_ << " blocks";
+  return 0;
+}
+
+CnedkBufSurface *OutputPool::TryGet() {
+  CnedkBufSurface *surf = nullptr;
+  for (auto &chunk : chunks_) {
+    if (CnedkBufSurfaceCreateFromPool(&surf, chunk) == 0) return surf;
+  }
+  return nullptr;
+}
+
+cnedk::BufSurfWrapperPtr OutputPool::GetBufSurfaceWrapper(int timeout_ms) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  int count = timeout_ms + 1;
+  int retry_cnt = 1;
+  while (1) {
+    CnedkBufSurface *surf = TryGet();
+    if (!surf && block_num_ < user_num_ * kBlocksPerUser && Grow(1) == 0) {
+      surf = TryGet();
+    }
+    if (surf) {
+      // blocks may outlive the predictors (e.g. outputs of the last batch), keep the pool alive
+      std::shared_ptr<OutputPool> owner = self_.lock();
+      return cnedk::BufSurfWrapperPtr(new cnedk::BufSurfaceWrapper(surf),
+                                      [owner](cnedk::BufSurfaceWrapper *wrapper) { delete wrapper; });
+    }
+
+    count -= retry_cnt;
+    VLOG(3) << "[EasyDK InferServer] [OutputPool] GetBufSurfaceWrapper(): retry, remaining times: " << count;
+    if (count <= 0) {
+      LOG(ERROR) << "[EasyDK InferServer] [OutputPool] GetBufSurfaceWrapper(): Maximum number of attempts reached: "
+                 << timeout_ms;
+      return nullptr;
+    }
+
+    lk.unlock();
+    usleep(1000 * retry_cnt);
+    retry_cnt = std::min(retry_cnt * 2, 10);
+    lk.lock();
+  }
+  return nullptr;
+}
+
+uint32_t OutputPool::BlockNum() const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  return block_num_;
+}
+
+uint32_t OutputPool::MaxBlockNum() const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  return user_num_ * kBlocksPerUser;
+}
+
+uint32_t OutputPool::UserNum() const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  return user_num_;
+}
+
+}  // namespace infer_server
@@ -0,0 +1,106 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_PROCESSOR_OUTPUT_POOL_H_
+#define INFER_SERVER_PROCESSOR_OUTPUT_POOL_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_buf_surface_util.hpp"
+
+namespace infer_server {
+
+/**
+ * @brief Output buffer pool shared by all predictors of the same model output on one device.
+ *
+ * The pool starts with a small number of blocks and grows by one block whenever every block is in use, up to
+ * `kBlocksPerUser` blocks for each predictor attached to it. Blocks are kept until the pool is released by the
+ * last predictor. Blocks in use hold the pool, it is destroyed after all blocks are returned.
+ */
+class OutputPool {
+ public:
+  /// blocks reserved for each attached predictor at most, same as the former per-predictor pool
+  static constexpr uint32_t kBlocksPerUser = 3;
+  /// blocks created with the pool
+  static constexpr uint32_t kInitialBlocks = 2;
+
+  /**
+   * @brief Gets the pool for the given key and attaches a user to it, the pool is created at the first time
+   *
+   * @param key key of the pool, @see OutputPool::MakeKey
+   * @param params parameters used to create blocks
+   * @return shared pool, nullptr if create failed
+   */
+  static std::shared_ptr<OutputPool> Attach(const std::string &key, const CnedkBufSurfaceCreateParams &params);
+
+  /**
+   * @brief Makes pool key from device, model, output shape and data type
+   */
+  static std::string MakeKey(int device_id, const std::string &model_key, const std::string &shape, int dtype);
+
+  /**
+   * @brief Gets the number of live shared pools
+   */
+  static size_t Count();
+
+  ~OutputPool();
+
+  /**
+   * @brief Gets a block from pool, grows the pool if all blocks are in use and the limit has not been reached
+   *
+   * @param timeout_ms wait time if no block is available
+   * @return buffer wrapper, nullptr if timeout
+   */
+  cnedk::BufSurfWrapperPtr GetBufSurfaceWrapper(int timeout_ms = 0);
+
+  /// number of blocks allocated
+  uint32_t BlockNum() const;
+  /// maximum number of blocks
+  uint32_t MaxBlockNum() const;
+  /// number of predictors attached
+  uint32_t UserNum() const;
+
+ private:
+  explicit OutputPool(const CnedkBufSurfaceCreateParams &params) : params_(params) {}
+  OutputPool(const OutputPool &) = delete;
+  OutputPool &operator=(const OutputPool &) = delete;
+
+  // must be called with mutex_ held
+  int Grow(uint32_t block_num);
+  // must be called with mutex_ held
+  CnedkBufSurface *TryGet();
+
+  void Detach();
+
+  CnedkBufSurfaceCreateParams params_;
+  mutable std::mutex mutex_;
+  std::weak_ptr<OutputPool> self_;
+  std::vector<void *> chunks_;
+  uint32_t block_num_{0};
+  uint32_t user_num_{0};
+};  // class OutputPool
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_PROCESSOR_OUTPUT_POOL_H_
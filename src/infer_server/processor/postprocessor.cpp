@@ -20,6 +20,8 @@
 
 #include <glog/logging.h>
 
+#include <cstdlib>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <string>
@@ -31,6 +33,7 @@
 #include "cnrt.h"
 #include "core/data_type.h"
 #include "model/model.h"
+#include "model/shape_bucket.h"
 #include "util/env.h"
 #include "util/thread_pool.h"
 
@@ -66,6 +69,17 @@ struct PostprocessorPrivate {
   IPostproc* handler;
   // output layouts of model output on device
   vector<DataLayout> layouts;
+  // layout of output handed to user without IPostproc handler
+  bool has_output_layout{false};
+  DataLayout output_layout;
+};
+
+class SharedHostDataDeleter : public cnedk::IBufDeleter {
+ public:
+  explicit SharedHostDataDeleter(std::shared_ptr<void> data) : data_(std::move(data)) {}
+
+ private:
+  std::shared_ptr<void> data_;
 };
 
 Postprocessor::Postprocessor() noexcept : ProcessorForkable("Postprocessor"), priv_(new PostprocessorPrivate) {}
@@ -92,6 +106,10 @@ Status Postprocessor::Init() noexcept {
                    << " postprocessor will output ModelIO directly";
     }
     int device_id = GetParam<int>("device_id");
+    if (HaveParam("output_layout")) {
+      priv_->output_layout = GetParam<DataLayout>("output_layout");
+      priv_->has_output_layout = true;
+    }
 
     if (!SetCurrentDevice(device_id)) return Status::ERROR_BACKEND;
   } catch (bad_any_cast&) {
@@ -108,14 +126,96 @@ Status Postprocessor::Init() noexcept {
   return Status::SUCCESS;
 }
 
-class HostDataDeleter : public cnedk::IBufDeleter {
- public:
-  explicit HostDataDeleter(void* data) : data_(data) {}
-  ~HostDataDeleter() { free(data_); }
+namespace {
 
- private:
-  void* data_;
-};
+inline bool IsTransposable(DimOrder order) { return order == DimOrder::NCHW || order == DimOrder::NHWC; }
+
+// dim orders other than NCHW and NHWC are kept as is
+inline DataLayout TargetLayout(const DataLayout& src, const DataLayout& dst) {
+  if (IsTransposable(src.order) && IsTransposable(dst.order)) return dst;
+  return DataLayout{dst.dtype, src.order};
+}
+
+Shape ItemShape(Shape shape) {
+  shape[0] = 1;
+  return shape;
+}
+
+// copies valid region at the corner of an item of a padded batch into contiguous memory
+void CropItem(const uint8_t* src, uint8_t* dst, const Shape& shape, const Shape& valid, DimOrder order,
+              size_t dtype_size) {
+  // planned as padding from valid region to the whole item, and copied reversely
+  for (const PadCopy& copy : PlanPadding(valid, shape, order, dtype_size)) {
+    for (size_t row = 0; row < copy.height; ++row) {
+      memcpy(dst + copy.src_offset + row * copy.src_pitch, src + copy.dst_offset + row * copy.dst_pitch, copy.width);
+    }
+  }
+}
+
+// copies and converts into system memory shared by items, the whole batch at once if items are contiguous on host.
+// outputs are not handed out as views of the batch, which would pin pooled output buffers as long as users hold them
+Status CopyOutput(const cnedk::BufSurfWrapperPtr& surf, const Shape& shape, const Shape& valid_shape,
+                  const DataLayout& src_layout, const DataLayout& dst_layout, vector<ModelIO>* outs) {
+  const size_t batch_size = outs->size();
+  const Shape src_shape = ItemShape(shape);
+  const Shape item_shape = ItemShape(valid_shape);
+  const bool crop = src_shape != item_shape;
+  const size_t src_len = src_shape.DataCount() * GetTypeSize(src_layout.dtype);
+  const size_t dst_len = item_shape.DataCount() * GetTypeSize(dst_layout.dtype);
+  std::shared_ptr<void> data(malloc(dst_len * batch_size), free);
+  if (!data) {
+    LOG(ERROR) << "[EasyDK InferServer] [Postprocessor] Process(): Alloc host memory failed";
+    return Status::ERROR_BACKEND;
+  }
+  uint8_t* dst = static_cast<uint8_t*>(data.get());
+
+  uint8_t* first = static_cast<uint8_t*>(surf->GetHostData(0, 0));
+  uint8_t* last = static_cast<uint8_t*>(surf->GetHostData(0, batch_size - 1));
+  bool ret = true;
+  if (!crop && first && last == first + (batch_size - 1) * src_len) {
+    Shape batch_shape = item_shape;
+    batch_shape[0] = batch_size;
+    ret = detail::TransLayout(first, dst, src_layout, dst_layout, batch_shape);
+  } else {
+    // cropped item is converted from a temporary buffer if layout changes
+    const bool same_layout = src_layout.dtype == dst_layout.dtype && src_layout.order == dst_layout.order;
+    vector<uint8_t> cropped(crop && !same_layout ? item_shape.DataCount() * GetTypeSize(src_layout.dtype) : 0);
+    for (size_t batch_idx = 0; ret && batch_idx < batch_size; ++batch_idx) {
+      uint8_t* src = static_cast<uint8_t*>(surf->GetHostData(0, batch_idx));
+      uint8_t* item_dst = dst + batch_idx * dst_len;
+      if (!src) {
+        ret = false;
+      } else if (!crop) {
+        ret = detail::TransLayout(src, item_dst, src_layout, dst_layout, item_shape);
+      } else if (same_layout) {
+        CropItem(src, item_dst, src_shape, item_shape, src_layout.order, GetTypeSize(src_layout.dtype));
+      } else {
+        CropItem(src, cropped.data(), src_shape, item_shape, src_layout.order, GetTypeSize(src_layout.dtype));
+        ret = detail::TransLayout(cropped.data(), item_dst, src_layout, dst_layout, item_shape);
+      }
+    }
+  }
+  if (!ret) {
+    LOG(ERROR) << "[EasyDK InferServer] [Postprocessor] Process(): Convert output layout failed";
+    return Status::ERROR_BACKEND;
+  }
+
+  Shape dst_shape = item_shape;
+  if (src_layout.order == DimOrder::NHWC && dst_layout.order == DimOrder::NCHW) {
+    dst_shape = DimNHWC2NCHW(item_shape.Vectorize());
+  } else if (src_layout.order == DimOrder::NCHW && dst_layout.order == DimOrder::NHWC) {
+    dst_shape = DimNCHW2NHWC(item_shape.Vectorize());
+  }
+  for (size_t batch_idx = 0; batch_idx < batch_size; ++batch_idx) {
+    auto item = std::make_shared<cnedk::BufSurfaceWrapper>(dst + batch_idx * dst_len, dst_len, CNEDK_BUF_MEM_SYSTEM,
+                                                           -1, new SharedHostDataDeleter(data));
+    (*outs)[batch_idx].surfs.emplace_back(std::move(item));
+    (*outs)[batch_idx].shapes.emplace_back(dst_shape);
+  }
+  return Status::SUCCESS;
+}
+
+}  // namespace
 
 Status Postprocessor::Process(PackagePtr pack) noexcept {
   CHECK(pack) << "[EasyDK InferServer] [Postprocessor] Process pack. It should not be nullptr";
@@ -143,25 +243,29 @@ Status Postprocessor::Process(PackagePtr pack) noexcept {
     outputs.surfs.emplace_back(out_mlu.surfs[out_idx]);
     outputs.shapes.emplace_back(out_mlu.shapes[out_idx]);
   }
+  outputs.valid_shapes = out_mlu.valid_shapes;
   if (priv_->handler) {
     priv_->handler->OnPostproc(datav, outputs, priv_->model.get());
   } else {
     VLOG(4) << "[EasyDK InferServer] [Postprocessor] do not have IPostproc handler, output ModelIO directly";
-    for (size_t batch_idx = 0; batch_idx < batch_size; ++batch_idx) {
-      ModelIO out;
-      for (size_t out_idx = 0; out_idx < out_mlu.surfs.size(); ++out_idx) {
-        void* host_data = out_mlu.surfs[out_idx]->GetHostData(0, batch_idx);
-        uint32_t len = out_mlu.surfs[out_idx]->GetSurfaceParams(0)->data_size;
-        void* data = malloc(len);
-        memcpy(data, host_data, len);
-        HostDataDeleter* deleter = new HostDataDeleter(data);
-        auto surf = std::make_shared<cnedk::BufSurfaceWrapper>(data, len, CNEDK_BUF_MEM_SYSTEM, -1, deleter);
-        out.surfs.emplace_back(surf);
-        auto shape = out_mlu.shapes[out_idx];
-        shape[0] = 1;
-        out.shapes.emplace_back(shape);
+    for (size_t out_idx = 0; out_idx < out_mlu.surfs.size(); ++out_idx) {
+      // copy the whole batch to host at once if data is on device
+      if (!out_mlu.surfs[out_idx]->GetHostData(0)) {
+        LOG(ERROR) << "[EasyDK InferServer] [Postprocessor] Process(): Get host data failed";
+        return Status::ERROR_BACKEND;
       }
-      pack->data[batch_idx]->Set(std::move(out));
+    }
+    vector<ModelIO> outs(batch_size);
+    for (size_t out_idx = 0; out_idx < out_mlu.surfs.size(); ++out_idx) {
+      const DataLayout& src_layout = priv_->layouts[out_idx];
+      DataLayout dst_layout = priv_->has_output_layout ? TargetLayout(src_layout, priv_->output_layout) : src_layout;
+      const Shape& shape = out_mlu.shapes[out_idx];
+      const Shape& valid_shape = out_idx < out_mlu.valid_shapes.size() ? out_mlu.valid_shapes[out_idx] : shape;
+      Status s = CopyOutput(out_mlu.surfs[out_idx], shape, valid_shape, src_layout, dst_layout, &outs);
+      if (s != Status::SUCCESS) return s;
+    }
+    for (size_t batch_idx = 0; batch_idx < batch_size; ++batch_idx) {
+      pack->data[batch_idx]->Set(std::move(outs[batch_idx]));
     }
   }
 
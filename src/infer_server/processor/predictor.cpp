@@ -20,7 +20,9 @@
 
 #include <glog/logging.h>
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -31,7 +33,10 @@
 #include "cnedk_buf_surface_util.hpp"
 #include "cnis/processor.h"
 #include "core/data_type.h"
+#include "model/async_runner.h"
 #include "model/model.h"
+#include "model/shape_bucket.h"
+#include "processor/output_pool.h"
 #include "../common/utils.hpp"
 
 using std::shared_ptr;
@@ -39,10 +44,61 @@ using std::vector;
 
 namespace infer_server {
 
+namespace {
+
+// each slot is a runner with its own context and queue
+class RunnerBackend : public IAsyncBackend {
+ public:
+  explicit RunnerBackend(vector<std::shared_ptr<ModelRunner>>&& runners) : runners_(std::move(runners)) {}
+  int SlotNum() const noexcept override { return static_cast<int>(runners_.size()); }
+  Status Enqueue(int slot, ModelIO* in, ModelIO* out) noexcept override { return runners_[slot]->Enqueue(in, out); }
+  Status Sync(int slot, ModelIO* out) noexcept override { return runners_[slot]->Sync(out); }
+
+ private:
+  vector<std::shared_ptr<ModelRunner>> runners_;
+};
+
+// attaches to the pool of batches of tensor, shared among all predictors (engines) of the model
+std::shared_ptr<OutputPool> AttachTensorPool(const std::string& model_key, int device_id,
+                                             CnedkBufSurfaceMemType mem_type, const Shape& shape, DataType dtype,
+                                             uint32_t batch_size) {
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.mem_type = mem_type;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  create_params.device_id = device_id;
+  create_params.batch_size = batch_size;
+  create_params.force_align_1 = 1;  // to meet mm's requirement
+  create_params.size = shape.BatchDataCount() * GetTypeSize(dtype);
+  create_params.size /= create_params.batch_size;
+  std::ostringstream shape_str;
+  shape_str << shape;
+  std::string key = OutputPool::MakeKey(device_id, model_key, shape_str.str(), static_cast<int>(dtype));
+  return OutputPool::Attach(key, create_params);
+}
+
+}  // namespace
+
+// runner, output pools and output shapes planned for one shape bucket
+struct BucketContext {
+  std::shared_ptr<ModelRunner> runner;
+  vector<std::shared_ptr<OutputPool>> output_pools;
+  vector<Shape> output_shapes;
+  // input is padded into blocks of this pool
+  std::shared_ptr<OutputPool> pad_pool;
+};
+
 struct PredictorPrivate {
   ModelPtr model{nullptr};
-  vector<std::shared_ptr<cnedk::BufPool>> output_pools;
+  vector<std::shared_ptr<OutputPool>> output_pools;
+  // extra attachments to output pools, reserve blocks for batches in flight
+  vector<std::shared_ptr<OutputPool>> inflight_pool_refs;
   std::shared_ptr<ModelRunner> runner;
+  // batches are pipelined if more than one is allowed in flight
+  std::unique_ptr<AsyncRunner> async_runner;
+  // shape buckets shared by predictors of all engines, and contexts of this predictor for each bucket
+  std::shared_ptr<ShapeBucketer> bucketer;
+  vector<BucketContext> buckets;
   // output layouts of model output on device
   vector<DataLayout> layouts;
 };
@@ -50,7 +106,11 @@ struct PredictorPrivate {
 Predictor::Predictor() noexcept : ProcessorForkable("Predictor"), priv_(new PredictorPrivate) {}
 
 Predictor::~Predictor() {
+  // batches in flight are done before output pools are released
+  priv_->async_runner.reset();
+  priv_->inflight_pool_refs.clear();
   priv_->output_pools.clear();
+  priv_->buckets.clear();
 
   delete priv_;
 }
@@ -65,9 +125,12 @@ Status Predictor::Init() noexcept {
   }
 
   int device_id = 0;
+  uint32_t inflight_num = 1;
   try {
     priv_->model = GetParam<ModelPtr>("model_info");
     device_id = GetParam<int>("device_id");
+    if (HaveParam("inflight_num")) inflight_num = GetParam<uint32_t>("inflight_num");
+    if (HaveParam("shape_bucketer")) priv_->bucketer = GetParam<std::shared_ptr<ShapeBucketer>>("shape_bucketer");
 
     if (cnrtSetDevice(device_id) != cnrtSuccess) return Status::ERROR_BACKEND;
   } catch (bad_any_cast&) {
@@ -75,16 +138,38 @@ Status Predictor::Init() noexcept {
     return Status::WRONG_TYPE;
   }
 
-  priv_->runner = ModelManager::Instance()->GetModel(priv_->model->GetKey())->GetRunner(device_id);
+  auto model = ModelManager::Instance()->GetModel(priv_->model->GetKey());
+  priv_->runner = model->GetRunner(device_id);
   if (!priv_->runner) {
     return Status::INVALID_PARAM;
   }
+  if (priv_->bucketer && (priv_->runner->FixedInputShape() || priv_->model->InputNum() != 1)) {
+    LOG(WARNING) << "[EasyDK InferServer] [Predictor] Shape buckets apply to model with one mutable input only,"
+                 << " ignored";
+    priv_->bucketer.reset();
+  }
+  if (priv_->bucketer && inflight_num > 1) {
+    LOG(WARNING) << "[EasyDK InferServer] [Predictor] Batches are not pipelined with shape buckets";
+    inflight_num = 1;
+  }
+  if (inflight_num > 1) {
+    vector<std::shared_ptr<ModelRunner>> runners{priv_->runner};
+    for (uint32_t idx = 1; idx < inflight_num; ++idx) {
+      runners.emplace_back(model->GetRunner(device_id));
+      if (!runners.back()) return Status::INVALID_PARAM;
+    }
+    std::unique_ptr<IAsyncBackend> backend(new RunnerBackend(std::move(runners)));
+    priv_->async_runner.reset(new AsyncRunner(std::move(backend), [device_id]() { cnrtSetDevice(device_id); }));
+  }
 
   CnedkPlatformInfo platform_info;
   if (CnedkPlatformGetInfo(device_id, &platform_info) < 0) {
     return Status::INVALID_PARAM;
   }
   std::string platform_name(platform_info.name);
+  CnedkBufSurfaceMemType mem_type =
+      cnedk::IsEdgePlatform(platform_name) ? CNEDK_BUF_MEM_UNIFIED_CACHED : CNEDK_BUF_MEM_DEVICE;
+  const std::string& model_key = priv_->model->GetKey();
 
   size_t o_num = priv_->model->OutputNum();
   priv_->layouts.reserve(o_num);
@@ -93,23 +178,110 @@ Status Predictor::Init() noexcept {
   if (priv_->model->FixedOutputShape()) {
     for (size_t i = 0; i < o_num; ++i) {
       priv_->layouts.emplace_back(priv_->model->OutputLayout(i));
-      // FIXME(dmh): 3 buffer?
-      std::shared_ptr<cnedk::BufPool> pool = std::make_shared<cnedk::BufPool>();
-      CnedkBufSurfaceCreateParams create_params;
-      memset(&create_params, 0, sizeof(create_params));
-      if (cnedk::IsEdgePlatform(platform_name)) {
-        create_params.mem_type = CNEDK_BUF_MEM_UNIFIED_CACHED;
-      } else {
-        create_params.mem_type = CNEDK_BUF_MEM_DEVICE;
+      std::shared_ptr<OutputPool> pool = AttachTensorPool(model_key, device_id, mem_type, priv_->model->OutputShape(i),
+                                                          priv_->layouts[i].dtype, priv_->model->BatchSize());
+      if (!pool) {
+        priv_->output_pools.clear();
+        return Status::ERROR_BACKEND;
       }
-      create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
-      create_params.device_id = device_id;
-      create_params.batch_size = priv_->model->BatchSize();
-      create_params.force_align_1 = 1;  // to meet mm's requirement
-      create_params.size = priv_->model->OutputShape(i).BatchDataCount() * GetTypeSize(priv_->layouts[i].dtype);
-      create_params.size /= create_params.batch_size;
-      pool->CreatePool(&create_params, 3);
       priv_->output_pools.emplace_back(pool);
+      for (uint32_t idx = 1; idx < inflight_num; ++idx) {
+        priv_->inflight_pool_refs.emplace_back(AttachTensorPool(model_key, device_id, mem_type,
+                                                                priv_->model->OutputShape(i),
+                                                                priv_->layouts[i].dtype, priv_->model->BatchSize()));
+      }
+    }
+  }
+
+  if (priv_->bucketer) {
+    // each bucket is planned once, and its pools are shared with other predictors
+    for (int idx = 0; idx < priv_->bucketer->BucketNum(); ++idx) {
+      const Shape& in_shape = priv_->bucketer->BucketShape(idx);
+      uint32_t batch_size = in_shape[0];
+      BucketContext bucket;
+      bucket.runner = model->GetRunner(device_id, {in_shape});
+      if (!bucket.runner) return Status::INVALID_PARAM;
+      ModelRunner* runner = bucket.runner.get();
+      bucket.output_shapes = priv_->bucketer->OutputShapes(
+          idx, [runner](const Shape& shape) { return runner->InferOutputShape({shape}); });
+      if (runner->CanInferOutputShape() && bucket.output_shapes.size() == o_num) {
+        for (size_t i = 0; i < o_num; ++i) {
+          bucket.output_pools.emplace_back(AttachTensorPool(model_key, device_id, mem_type, bucket.output_shapes[i],
+                                                            priv_->model->OutputLayout(i).dtype, batch_size));
+          if (!bucket.output_pools.back()) return Status::ERROR_BACKEND;
+        }
+      }
+      bucket.pad_pool = AttachTensorPool(model_key + "_pad", device_id, mem_type, in_shape,
+                                         priv_->model->InputLayout(0).dtype, batch_size);
+      if (!bucket.pad_pool) return Status::ERROR_BACKEND;
+      VLOG(1) << "[EasyDK InferServer] [Predictor] Shape bucket " << in_shape << " is planned";
+      priv_->buckets.emplace_back(std::move(bucket));
+    }
+  }
+  return Status::SUCCESS;
+}
+
+Status Predictor::RunBucket(int idx, ModelIO* in, ModelIO* out) noexcept {
+  BucketContext& bucket = priv_->buckets[idx];
+  const Shape& shape = in->shapes[0];
+  const Shape& bucket_shape = priv_->bucketer->BucketShape(idx);
+  ModelIO padded;
+  if (shape == bucket_shape) {
+    padded.surfs = in->surfs;
+  } else {
+    const DataLayout& layout = priv_->model->InputLayout(0);
+    size_t dtype_size = GetTypeSize(layout.dtype);
+    cnedk::BufSurfWrapperPtr buf = bucket.pad_pool->GetBufSurfaceWrapper(1000);
+    if (!buf) return Status::ERROR_BACKEND;
+    uint8_t* dst = static_cast<uint8_t*>(buf->GetData(0));
+    uint8_t* src = static_cast<uint8_t*>(in->surfs[0]->GetData(0));
+    // pad with zero on the end of batch, height and width
+    CNRT_SAFECALL(cnrtMemset(dst, 0, bucket_shape.BatchDataCount() * dtype_size),
+                  "[EasyDK InferServer] [Predictor] Clear padded input failed", Status::ERROR_BACKEND);
+    for (const PadCopy& copy : PlanPadding(shape, bucket_shape, layout.order, dtype_size)) {
+      CNRT_SAFECALL(cnrtMemcpy2D(dst + copy.dst_offset, copy.dst_pitch, src + copy.src_offset, copy.src_pitch,
+                                 copy.width, copy.height, cnrtMemcpyDevToDev),
+                    "[EasyDK InferServer] [Predictor] Pad input failed", Status::ERROR_BACKEND);
+    }
+    padded.surfs.emplace_back(std::move(buf));
+  }
+  padded.shapes.emplace_back(bucket_shape);
+
+  out->surfs.reserve(bucket.output_pools.size());
+  for (size_t i = 0; i < bucket.output_pools.size(); ++i) {
+    cnedk::BufSurfWrapperPtr buf = bucket.output_pools[i]->GetBufSurfaceWrapper(1000);
+    if (!buf) {
+      LOG(ERROR) << "[EasyDK InferServer] [Predictor] Get output buffer from pool failed, output index: " << i;
+      return Status::ERROR_BACKEND;
+    }
+    out->surfs.emplace_back(std::move(buf));
+    out->shapes.emplace_back(bucket.output_shapes[i]);
+  }
+  Status s = bucket.runner->Run(&padded, out);
+  if (s != Status::SUCCESS || shape == bucket_shape) return s;
+  // tell postprocess which part of outputs holds data of the batch
+  const DimOrder in_order = priv_->model->InputLayout(0).order;
+  out->valid_shapes.reserve(out->shapes.size());
+  for (size_t i = 0; i < out->shapes.size(); ++i) {
+    out->valid_shapes.emplace_back(
+        ValidShape(shape, bucket_shape, in_order, out->shapes[i], priv_->model->OutputLayout(i).order));
+  }
+  return s;
+}
+
+Status Predictor::PrepareOutput(ModelIO* out) noexcept {
+  out->surfs.reserve(priv_->model->OutputNum());
+  out->shapes.reserve(priv_->model->OutputNum());
+  if (priv_->runner->CanInferOutputShape() && priv_->model->FixedOutputShape()) {
+    for (size_t idx = 0; idx < priv_->output_pools.size(); ++idx) {
+      // pool is drained if outputs are held too long
+      cnedk::BufSurfWrapperPtr buf = priv_->output_pools[idx]->GetBufSurfaceWrapper(1000);
+      if (!buf) {
+        LOG(ERROR) << "[EasyDK InferServer] [Predictor] Get output buffer from pool failed, output index: " << idx;
+        return Status::ERROR_BACKEND;
+      }
+      out->surfs.emplace_back(std::move(buf));
+      out->shapes.emplace_back(priv_->model->OutputShape(idx));
     }
   }
   return Status::SUCCESS;
@@ -126,18 +298,21 @@ Status Predictor::Process(PackagePtr pack) noexcept {
   InferDataPtr& cdata = pack->predict_io;
 
   ModelIO out_mlu;
-  out_mlu.surfs.reserve(priv_->model->OutputNum());
-  out_mlu.shapes.reserve(priv_->model->OutputNum());
   Status s = Status::SUCCESS;
   try {
     ModelIO& in_mlu = cdata->GetLref<ModelIO>();
-    if (priv_->runner->CanInferOutputShape() && priv_->model->FixedOutputShape()) {
-      for (size_t idx = 0; idx < priv_->output_pools.size(); ++idx) {
-        out_mlu.surfs.emplace_back(priv_->output_pools[idx]->GetBufSurfaceWrapper(1000));
-        out_mlu.shapes.emplace_back(priv_->model->OutputShape(idx));
-      }
+    int bucket = -1;
+    if (priv_->bucketer && !in_mlu.shapes.empty()) {
+      bucket = priv_->bucketer->Select(in_mlu.shapes[0]);
+      priv_->bucketer->Record(in_mlu.shapes[0], bucket);
+      if (bucket < 0) VLOG(3) << "[EasyDK InferServer] [Predictor] No bucket holds input shape " << in_mlu.shapes[0];
+    }
+    if (bucket >= 0) {
+      s = RunBucket(bucket, &in_mlu, &out_mlu);
+    } else {
+      s = PrepareOutput(&out_mlu);
+      if (s == Status::SUCCESS) s = priv_->runner->Run(&in_mlu, &out_mlu);
     }
-    s = priv_->runner->Run(&in_mlu, &out_mlu);
   } catch (bad_any_cast&) {
     LOG(ERROR) << "[EasyDK InferServer] [Predictor] Received unsupported data type";
     return Status::WRONG_TYPE;
@@ -147,6 +322,40 @@ Status Predictor::Process(PackagePtr pack) noexcept {
   return s;
 }
 
+void Predictor::ProcessAsync(PackagePtr pack, std::function<void(Status)> done) noexcept {
+  if (!priv_->async_runner) {
+    done(Process(std::move(pack)));
+    return;
+  }
+  CHECK(pack) << "[EasyDK InferServer] [Predictor] Process pack. It should not be empty";
+  if (!pack->predict_io || !pack->predict_io->HasValue()) {
+    LOG(ERROR) << "[EasyDK InferServer] [Predictor] Can process continuous data only";
+    done(Status::INVALID_PARAM);
+    return;
+  }
+
+  ModelIO* in_mlu = nullptr;
+  try {
+    in_mlu = &pack->predict_io->GetLref<ModelIO>();
+  } catch (bad_any_cast&) {
+    LOG(ERROR) << "[EasyDK InferServer] [Predictor] Received unsupported data type";
+    done(Status::WRONG_TYPE);
+    return;
+  }
+  // input is held by pack and output by callback until the batch is done
+  std::shared_ptr<ModelIO> out_mlu = std::make_shared<ModelIO>();
+  Status s = PrepareOutput(out_mlu.get());
+  if (s != Status::SUCCESS) {
+    done(s);
+    return;
+  }
+  ModelIO* out = out_mlu.get();
+  priv_->async_runner->Submit(in_mlu, out, [pack, out_mlu, done](Status s) {
+    pack->predict_io->Set(std::move(*out_mlu));
+    done(s);
+  });
+}
+
 std::string Predictor::Backend() noexcept { return "magicmind"; }
 
 }  // namespace infer_server
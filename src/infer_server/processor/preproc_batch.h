@@ -0,0 +1,117 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_PROCESSOR_PREPROC_BATCH_H_
+#define INFER_SERVER_PROCESSOR_PREPROC_BATCH_H_
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_buf_surface_util.hpp"
+#include "cnedk_transform.h"
+#include "cnis/processor.h"
+
+namespace infer_server {
+
+/**
+ * @brief Per-batch staging area of the preprocessor.
+ *
+ * Holds the batched source surface handed to IPreproc::OnPreproc and the crop rects of the batch. Storage is
+ * reserved up to the model batch size once and is reset (not released) after each batch, so building a batch
+ * does not touch the heap in steady state.
+ */
+class PreprocBatch {
+ public:
+  PreprocBatch() {
+    memset(&surf_, 0, sizeof(CnedkBufSurface));
+    // non-owning, lives as long as the staging area
+    wrapper_ = std::make_shared<cnedk::BufSurfaceWrapper>(&surf_, false);
+  }
+
+  /**
+   * @brief Reserves storage for batches of up to batch_size items
+   */
+  void Reserve(uint32_t batch_size, int dev_id) {
+    params_.reserve(batch_size);
+    rects_.reserve(batch_size);
+    surf_.device_id = dev_id;
+  }
+
+  /**
+   * @brief Fills the staging area with the inputs of a batch
+   *
+   * @note Inputs beyond the reserved capacity are still accepted, the storage grows once and is kept afterwards.
+   */
+  void Build(const BatchData &data) {
+    Reset();
+    for (size_t batch_idx = 0; batch_idx < data.size(); ++batch_idx) {
+      const PreprocInput &input = data[batch_idx]->GetLref<PreprocInput>();
+      CnedkBufSurface *surf = input.surf->GetBufSurface();
+
+      // the batch shares the same mem type
+      surf_.mem_type = surf->mem_type;
+      params_.push_back(surf->surface_list[0]);
+
+      if (!input.has_bbox) continue;
+      CnedkTransformRect rect;
+      rect.left = surf->surface_list->width * input.bbox.x;
+      rect.top = surf->surface_list->height * input.bbox.y;
+      rect.width = surf->surface_list->width * input.bbox.w;
+      rect.height = surf->surface_list->height * input.bbox.h;
+      rects_.push_back(rect);
+    }
+    surf_.batch_size = params_.size();
+    surf_.num_filled = params_.size();
+    surf_.is_contiguous = false;
+    surf_.surface_list = params_.data();
+  }
+
+  /**
+   * @brief Drops the content of the current batch, keeping the storage for the next one
+   */
+  void Reset() {
+    // host data mirrored from device belongs to the dropped batch
+    if (surf_.mem_type == CNEDK_BUF_MEM_DEVICE) wrapper_->InvalidateHostData();
+    params_.clear();
+    rects_.clear();
+    surf_.batch_size = 0;
+    surf_.num_filled = 0;
+    surf_.surface_list = nullptr;
+  }
+
+  const cnedk::BufSurfWrapperPtr &Surface() const { return wrapper_; }
+  const std::vector<CnedkTransformRect> &Rects() const { return rects_; }
+  size_t Capacity() const { return params_.capacity(); }
+
+ private:
+  PreprocBatch(const PreprocBatch &) = delete;
+  PreprocBatch &operator=(const PreprocBatch &) = delete;
+
+  CnedkBufSurface surf_;
+  std::vector<CnedkBufSurfaceParams> params_;
+  std::vector<CnedkTransformRect> rects_;
+  cnedk::BufSurfWrapperPtr wrapper_;
+};  // class PreprocBatch
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_PROCESSOR_PREPROC_BATCH_H_
@@ -34,6 +34,7 @@
 #include "cnedk_transform.h"
 #include "cnedk_buf_surface_util.hpp"
 #include "core/data_type.h"
+#include "processor/preproc_batch.h"
 #include "../common/utils.hpp"
 
 namespace infer_server {
@@ -100,6 +101,7 @@ class Solver {
     }
     err_ = CreatePool();
     if (err_ < 0) return -1;
+    batch_.Reserve(tensor_params_.batch_num, dev_id_);
     initialized_ = true;
     return 0;
   }
@@ -109,6 +111,7 @@ class Solver {
 
  private:
   cnedk::BufPool pool_;
+  PreprocBatch batch_;
 
  private:
   std::mutex mutex_;
@@ -127,43 +130,19 @@ int Solver::Execute(Package *pack, cnedk::BufSurfWrapperPtr* output) {
   if (!handler_) return -1;
   if (pack->data.size() == 0) return 0;
 
-  std::vector<CnedkBufSurfaceParams> surface_list(pack->data.size());
-  CnedkBufSurface src_surf;
-  cnedk::BufSurfWrapperPtr src_surf_wrapper = std::make_shared<cnedk::BufSurfaceWrapper>(&src_surf, false);
-  memset(&src_surf, 0, sizeof(CnedkBufSurface));
-  src_surf.batch_size = pack->data.size();
-  src_surf.device_id = dev_id_;
-  src_surf.is_contiguous = false;
-  src_surf.num_filled = pack->data.size();
-  src_surf.surface_list = surface_list.data();
-
-  std::vector<CnedkTransformRect> src_rects;
-  for (size_t batch_idx = 0; batch_idx < pack->data.size(); ++batch_idx) {
-    PreprocInput input = pack->data[batch_idx]->GetLref<PreprocInput>();
-    CnedkBufSurface *surf = input.surf->GetBufSurface();
-
-    // the batch shares the same mem type
-    src_surf.mem_type = surf->mem_type;
-    surface_list[batch_idx] = surf->surface_list[0];
-
-    if (!input.has_bbox) continue;
-    CnedkTransformRect rect;
-    rect.left = surf->surface_list->width * input.bbox.x;
-    rect.top = surf->surface_list->height * input.bbox.y;
-    rect.width = surf->surface_list->width * input.bbox.w;
-    rect.height = surf->surface_list->height * input.bbox.h;
-    src_rects.push_back(rect);
-  }
-
+  batch_.Build(pack->data);
   *output = pool_.GetBufSurfaceWrapper(2000);
   if (*output) {
     cnrtSetDevice(dev_id_);
-    if (handler_->OnPreproc(src_surf_wrapper, *output, src_rects) < 0) {
+    int ret = handler_->OnPreproc(batch_.Surface(), *output, batch_.Rects());
+    batch_.Reset();
+    if (ret < 0) {
       LOG(ERROR) << "[EasyDK InferServer] [Solver] Execute(): OnPreproc failed";
       return -1;
     }
     return 0;
   }
+  batch_.Reset();
   LOG(ERROR) << "[EasyDK InferServer] [Solver] Execute(): Get BufSurface wrapper failed";
   return -1;
 }
@@ -235,7 +214,7 @@ int Solver::CreatePool() {
       create_params.size = model_input_w * model_input_h * model_input_c;
       create_params.width = model_input_w;
       create_params.height = model_input_h;
-      if (tensor_params_.input_dtype == DataType::UINT8) {
+      if (tensor_params_.input_dtype == DataType::UINT8 || tensor_params_.input_dtype == DataType::INT8) {
         create_params.size = create_params.size;
       } else if (tensor_params_.input_dtype == DataType::INT16) {
         create_params.size *= 2;
@@ -318,6 +297,9 @@ class PreprocImpl {
       case DataType::UINT8:
         tensor_params.input_dtype = DataType::UINT8;
         break;
+      case DataType::INT8:
+        tensor_params.input_dtype = DataType::INT8;
+        break;
       case DataType::INT16:
         tensor_params.input_dtype = DataType::INT16;
         break;
@@ -335,10 +317,20 @@ class PreprocImpl {
         break;
     }
 
+    tensor_params.input_quant = model->InputQuantParams(0);
     tensor_params.input_format = model_input_format;
     tensor_params.batch_num = model->BatchSize();
     return 0;
   }
+
+  // shape of preprocessed batch, model input shape with batch dim set to number of data
+  Shape BatchShape(size_t batch_size) const {
+    Shape shape(std::vector<Shape::value_type>(tensor_params.input_shape.begin(), tensor_params.input_shape.end()));
+    bool batch_first = tensor_params.input_order == DimOrder::NHWC || tensor_params.input_order == DimOrder::NCHW ||
+                       tensor_params.input_order == DimOrder::NTC;
+    if (batch_first && shape.Size() > 0) shape[0] = batch_size;
+    return shape;
+  }
 };
 
 Preprocessor::Preprocessor() noexcept : ProcessorForkable("InferPreprocessor"), impl_(new PreprocImpl) {}
@@ -403,7 +395,8 @@ Status Preprocessor::Process(PackagePtr pack) noexcept {
 
   ModelIO model_input;
   model_input.surfs.emplace_back(preproc_output);
-  model_input.shapes.emplace_back(impl_->model->InputShape(0));
+  // model input shape is -1 on mutable batch, shape buckets are selected on the real one
+  model_input.shapes.emplace_back(impl_->BatchShape(pack->data.size()));
   pack->predict_io.reset(new InferData);
   pack->predict_io->Set(std::move(model_input));
   return Status::SUCCESS;
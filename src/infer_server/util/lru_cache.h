@@ -0,0 +1,149 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_UTIL_LRU_CACHE_H_
+#define INFER_SERVER_UTIL_LRU_CACHE_H_
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace infer_server {
+
+/**
+ * @brief Least recently used cache with a byte budget
+ *
+ * Each entry is charged by `ChargeFunc`, which is evaluated on each eviction, so charges may grow after insertion.
+ * Pinned entries are skipped by eviction. The cache is not thread-safe, it should be guarded by caller.
+ *
+ * @tparam Key Type of key
+ * @tparam Value Type of value, default constructed value means miss
+ * @tparam Hash Hash function of key
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+ public:
+  /// calculates bytes charged to a value
+  using ChargeFunc = std::function<size_t(const Value&)>;
+  /// tells whether a value is pinned and must not be evicted
+  using PinnedFunc = std::function<bool(const Value&)>;
+
+  LruCache(ChargeFunc charge, PinnedFunc pinned) : charge_(std::move(charge)), pinned_(std::move(pinned)) {}
+
+  /**
+   * @brief Gets value and marks it as the most recently used
+   *
+   * @return Value stored with key, or default constructed value if key is not in cache
+   */
+  Value Get(const Key& key) {
+    auto iter = index_.find(key);
+    if (iter == index_.end()) return Value();
+    entries_.splice(entries_.begin(), entries_, iter->second);
+    return iter->second->second;
+  }
+
+  /**
+   * @brief Inserts or replaces value as the most recently used, no eviction happens
+   */
+  void Put(const Key& key, Value value) {
+    auto iter = index_.find(key);
+    if (iter != index_.end()) {
+      iter->second->second = std::move(value);
+      entries_.splice(entries_.begin(), entries_, iter->second);
+      return;
+    }
+    entries_.emplace_front(key, std::move(value));
+    index_[key] = entries_.begin();
+  }
+
+  /**
+   * @brief Removes value regardless of whether it is pinned
+   *
+   * @retval true Succeed
+   * @retval false Key is not in cache
+   */
+  bool Erase(const Key& key) {
+    auto iter = index_.find(key);
+    if (iter == index_.end()) return false;
+    entries_.erase(iter->second);
+    index_.erase(iter);
+    return true;
+  }
+
+  /**
+   * @brief Evicts unpinned values from the least recently used one, until both limits are met or no value is evictable
+   *
+   * @param byte_budget Maximum bytes charged to remaining values
+   * @param count_limit Maximum number of remaining values
+   * @return Evicted values, which could be released after caller drops the lock
+   */
+  std::vector<Value> Evict(size_t byte_budget, size_t count_limit) {
+    std::vector<Value> evicted;
+    size_t bytes = Bytes();
+    for (auto iter = entries_.end(); iter != entries_.begin() && (bytes > byte_budget || Size() > count_limit);) {
+      --iter;
+      if (pinned_(iter->second)) continue;
+      size_t charge = charge_(iter->second);
+      bytes = bytes > charge ? bytes - charge : 0;
+      evicted.emplace_back(std::move(iter->second));
+      index_.erase(iter->first);
+      iter = entries_.erase(iter);
+    }
+    return evicted;
+  }
+
+  /// Removes all values
+  void Clear() {
+    index_.clear();
+    entries_.clear();
+  }
+
+  /// Gets number of values
+  size_t Size() const noexcept { return index_.size(); }
+
+  /// Gets bytes charged to all values
+  size_t Bytes() const {
+    size_t bytes = 0;
+    for (auto& entry : entries_) bytes += charge_(entry.second);
+    return bytes;
+  }
+
+  /// Gets keys from the most recently used to the least recently used
+  std::vector<Key> Keys() const {
+    std::vector<Key> keys;
+    keys.reserve(entries_.size());
+    for (auto& entry : entries_) keys.push_back(entry.first);
+    return keys;
+  }
+
+ private:
+  using EntryList = std::list<std::pair<Key, Value>>;
+  EntryList entries_;
+  std::unordered_map<Key, typename EntryList::iterator, Hash> index_;
+  ChargeFunc charge_;
+  PinnedFunc pinned_;
+};  // class LruCache
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_UTIL_LRU_CACHE_H_
@@ -0,0 +1,106 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_UTIL_SINGLE_FLIGHT_H_
+#define INFER_SERVER_UTIL_SINGLE_FLIGHT_H_
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace infer_server {
+
+/**
+ * @brief Deduplicates concurrent calls with the same key
+ *
+ * The first call of a key runs the function, later calls of the key wait for its result instead of running again.
+ * Calls of different keys run in parallel. Result is not kept after the call finishes, so a failed call could be
+ * retried, caller should cache successful results on its own.
+ *
+ * @tparam Key Type of key
+ * @tparam Value Type of result
+ */
+template <typename Key, typename Value>
+class SingleFlight {
+ public:
+  /**
+   * @brief Runs func, or waits for the result of the running call with the same key
+   *
+   * @param key Key of call
+   * @param func Function to produce result
+   * @return Result of func, exception thrown by func is rethrown to all callers
+   */
+  Value Do(const Key& key, const std::function<Value()>& func) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    auto iter = calls_.find(key);
+    if (iter != calls_.end()) {
+      std::shared_future<Value> result = iter->second.result;
+      ++iter->second.waiters;
+      lk.unlock();
+      return result.get();
+    }
+    std::promise<Value> promise;
+    calls_[key].result = promise.get_future().share();
+    lk.unlock();
+
+    Value value;
+    try {
+      value = func();
+    } catch (...) {
+      Finish(key);
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+    Finish(key);
+    promise.set_value(value);
+    return value;
+  }
+
+  /**
+   * @brief Gets number of callers waiting for the running call with the key
+   */
+  size_t Waiters(const Key& key) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto iter = calls_.find(key);
+    return iter == calls_.end() ? 0 : iter->second.waiters;
+  }
+
+ private:
+  struct Call {
+    std::shared_future<Value> result;
+    size_t waiters = 0;
+  };
+
+  void Finish(const Key& key) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    calls_.erase(key);
+  }
+
+  std::unordered_map<Key, Call> calls_;
+  std::mutex mutex_;
+};  // class SingleFlight
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_UTIL_SINGLE_FLIGHT_H_
@@ -20,6 +20,7 @@
 
 #include "cnedk_transform_cncv.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
 #include <map>
@@ -30,6 +31,7 @@
 #include "glog/logging.h"
 #include "cncv.h"
 #include "../common/utils.hpp"
+#include "../cnedk_transform_impl.hpp"
 
 namespace cnedk {
 
@@ -196,6 +198,12 @@ int Yuv2RgbxResizeCncvCtx::Process(const CnedkBufSurface &src, CnedkBufSurface *
     dst_rois_.resize(batch_size);
   }
 
+  keep_aspect_ratio_ = (transform_params->transform_flag & CNEDK_TRANSFORM_LETTERBOX) != 0;
+  memset(pad_value_, 0, sizeof(pad_value_));
+  if (keep_aspect_ratio_ && transform_params->letterbox_params) {
+    memcpy(pad_value_, transform_params->letterbox_params->pad_value, sizeof(pad_value_));
+  }
+
   for (size_t batch_idx = 0; batch_idx < batch_size; ++batch_idx) {
     // configure src desc
     cncvImageDescriptor src_desc;
@@ -251,6 +259,24 @@ int Yuv2RgbxResizeCncvCtx::Process(const CnedkBufSurface &src, CnedkBufSurface *
       dst_roi.w = dst->surface_list[batch_idx].width;
       dst_roi.h = dst->surface_list[batch_idx].height;
     }
+    if (keep_aspect_ratio_) {
+      // resizes into the center of dst roi, the bands around it are filled here
+      CnedkTransformRect frame;
+      frame.top = dst_roi.y;
+      frame.left = dst_roi.x;
+      frame.width = dst_roi.w;
+      frame.height = dst_roi.h;
+      CnedkTransformRect inner = LetterboxRect(src_roi.w, src_roi.h, frame);
+      if (FillLetterboxBands(dst->surface_list[batch_idx], frame, inner,
+                             GetChannelNumFromColor(dst->surface_list[batch_idx].color_format)) < 0) {
+        LOG(ERROR) << "[EasyDK] [Yuv2RgbxResizeCncvCtx] Process(): Fill letterbox padding failed";
+        return -1;
+      }
+      dst_roi.x = inner.left;
+      dst_roi.y = inner.top;
+      dst_roi.w = inner.width;
+      dst_roi.h = inner.height;
+    }
     dst_rois_[batch_idx] = dst_roi;
 
     // copy one input frame addr to device
@@ -290,6 +316,46 @@ int Yuv2RgbxResizeCncvCtx::Process(const CnedkBufSurface &src, CnedkBufSurface *
   return 0;
 }
 
+int Yuv2RgbxResizeCncvCtx::StagePadBlock(size_t row_bytes, size_t height, int channel_num) {
+  if (pad_block_ && row_bytes <= pad_block_pitch_ && height <= pad_block_height_ &&
+      channel_num == pad_block_channels_ && !memcmp(pad_value_, pad_block_value_, sizeof(pad_value_))) {
+    return 0;
+  }
+  const size_t pitch = std::max(row_bytes, pad_block_pitch_);
+  const size_t rows = std::max(height, pad_block_height_);
+  if (pitch * rows > pad_block_pitch_ * pad_block_height_) {
+    if (pad_block_) cnrtFree(pad_block_);
+    pad_block_ = nullptr;
+    CNRT_SAFECALL(cnrtMalloc(&pad_block_, pitch * rows), "[Yuv2RgbxResizeCncvCtx] StagePadBlock(): malloc failed.", -1);
+  }
+  std::vector<uint8_t> host(pitch * rows);
+  for (size_t k = 0; k < host.size(); ++k) host[k] = pad_value_[(k % pitch) % channel_num];
+  CNRT_SAFECALL(cnrtMemcpy(pad_block_, host.data(), host.size(), CNRT_MEM_TRANS_DIR_HOST2DEV),
+                "[Yuv2RgbxResizeCncvCtx] StagePadBlock(): Copy padding H2D failed.", -1);
+  pad_block_pitch_ = pitch;
+  pad_block_height_ = rows;
+  pad_block_channels_ = channel_num;
+  memcpy(pad_block_value_, pad_value_, sizeof(pad_value_));
+  return 0;
+}
+
+// fills the padding bands around inner of a letterbox, only the bands are written.
+// bands are copied on device from the staged padding, so that nothing is uploaded per frame
+int Yuv2RgbxResizeCncvCtx::FillLetterboxBands(const CnedkBufSurfaceParams &dst, const CnedkTransformRect &frame,
+                                              const CnedkTransformRect &inner, int channel_num) {
+  CnedkTransformRect bands[4];
+  const int num = LetterboxBands(frame, inner, bands);
+  for (int i = 0; i < num; ++i) {
+    const size_t row_bytes = bands[i].width * channel_num;
+    if (StagePadBlock(row_bytes, bands[i].height, channel_num) < 0) return -1;
+    uint8_t *band_ptr = static_cast<uint8_t *>(dst.data_ptr) + bands[i].top * dst.pitch + bands[i].left * channel_num;
+    CNRT_SAFECALL(cnrtMemcpy2D(band_ptr, dst.pitch, pad_block_, pad_block_pitch_, row_bytes, bands[i].height,
+                               CNRT_MEM_TRANS_DIR_DEV2DEV),
+                  "[Yuv2RgbxResizeCncvCtx] FillLetterboxBands(): Copy padding D2D failed.", -1);
+  }
+  return 0;
+}
+
 int RgbxToYuvCncvCtx::Process(const CnedkBufSurface &src, CnedkBufSurface *dst,
                               CnedkTransformParams *transform_params) {
   for (size_t i = 0; i < src.batch_size; ++i) {
@@ -613,6 +679,12 @@ int DoCncvTransform(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTransformPa
   if (dst->surface_list[0].color_format == CNEDK_BUF_COLOR_FORMAT_TENSOR) {
     if (transform_params->transform_flag & CNEDK_TRANSFORM_MEAN_STD) {
       auto dst_fmt = GetColorFormatFromTensor(transform_params->dst_desc->color_format);
+      // padding bands are not normalized by cncv, so the fused mean std resize does not letterbox
+      if (transform_params->transform_flag & CNEDK_TRANSFORM_LETTERBOX) {
+        LOG(ERROR) << "[EasyDK] DoCncvTransform(): Letterbox is supported only by YUV420SP to RGB-like transform"
+                   << " without mean std";
+        return -1;
+      }
       if (IsYuv420sp(src->surface_list[0].color_format) && IsRgbx(dst_fmt)) {
         static thread_local std::shared_ptr<Yuv2RgbxResizeWithMeanStdCncv> resize_meanstd_ctx = nullptr;
         if (!resize_meanstd_ctx) {
@@ -656,6 +728,13 @@ int DoCncvTransform(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTransformPa
     dst_buf = dst_buf_for_tensor.get();
   }
 
+  // padding value is given in RGB-like channels
+  if ((transform_params->transform_flag & CNEDK_TRANSFORM_LETTERBOX) &&
+      !(IsYuv420sp(src->surface_list[0].color_format) && IsRgbx(dst_buf->surface_list[0].color_format))) {
+    LOG(ERROR) << "[EasyDK] DoCncvTransform(): Letterbox is supported only by YUV420SP to RGB-like transform";
+    return -1;
+  }
+
   if (IsRgbx(src->surface_list[0].color_format) &&
       IsYuv420sp(dst_buf->surface_list[0].color_format)) {
     static thread_local std::shared_ptr<Rgbx2YuvResizeAndConvert> cncv_ctx = nullptr;
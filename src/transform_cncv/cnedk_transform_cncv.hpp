@@ -117,8 +117,14 @@ class Yuv2RgbxResizeCncvCtx : public CncvContext {
     if (mlu_input_) cnrtFree(mlu_input_);
     if (mlu_output_) cnrtFree(mlu_output_);
     if (workspace_) cnrtFree(workspace_);
+    if (pad_block_) cnrtFree(pad_block_);
   }
 
+ private:
+  int FillLetterboxBands(const CnedkBufSurfaceParams& dst, const CnedkTransformRect& frame,
+                         const CnedkTransformRect& inner, int channel_num);
+  int StagePadBlock(size_t row_bytes, size_t height, int channel_num);
+
  private:
   std::vector<void**> cpu_input_;
   std::vector<void**> cpu_output_;
@@ -130,8 +136,14 @@ class Yuv2RgbxResizeCncvCtx : public CncvContext {
   std::vector<cncvImageDescriptor> dst_descs_;
   std::vector<cncvRect> src_rois_;
   std::vector<cncvRect> dst_rois_;
-  bool keep_aspect_ratio_;
-  uint8_t pad_value_ = 0;
+  bool keep_aspect_ratio_ = false;
+  uint8_t pad_value_[CNEDK_TRANSFORM_MAX_CHNS];
+  // padding pixels staged on device, rows of pad_block_pitch_ bytes, uploaded again only if pad value or size changes
+  void* pad_block_ = nullptr;
+  size_t pad_block_pitch_ = 0;
+  size_t pad_block_height_ = 0;
+  int pad_block_channels_ = 0;
+  uint8_t pad_block_value_[CNEDK_TRANSFORM_MAX_CHNS];
   void* workspace_ = nullptr;
   size_t workspace_size_ = 0;
   size_t batch_size_ = 0;
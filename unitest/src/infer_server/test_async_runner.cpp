@@ -0,0 +1,210 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "model/async_runner.h"
+
+namespace infer_server {
+namespace {
+
+// "device" is a worker thread running one batch at a time, output is a copy of input shapes
+class FakeDeviceBackend : public IAsyncBackend {
+ public:
+  FakeDeviceBackend(int slot_num, std::chrono::milliseconds latency)
+      : latency_(latency), slots_(slot_num), device_(&FakeDeviceBackend::DeviceLoop, this) {}
+
+  ~FakeDeviceBackend() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      running_ = false;
+    }
+    cond_.notify_all();
+    device_.join();
+  }
+
+  int SlotNum() const noexcept override { return static_cast<int>(slots_.size()); }
+
+  Status Enqueue(int slot, ModelIO* in, ModelIO* out) noexcept override {
+    if (fail_enqueue) return Status::ERROR_BACKEND;
+    std::lock_guard<std::mutex> lk(mutex_);
+    EXPECT_FALSE(slots_[slot].busy) << "slot is enqueued twice";
+    slots_[slot].busy = true;
+    slots_[slot].done = false;
+    slots_[slot].result = in->shapes;
+    ++inflight_;
+    if (inflight_ > max_inflight) max_inflight = inflight_;
+    queue_.push_back(slot);
+    cond_.notify_all();
+    return Status::SUCCESS;
+  }
+
+  Status Sync(int slot, ModelIO* out) noexcept override {
+    std::unique_lock<std::mutex> lk(mutex_);
+    cond_.wait(lk, [this, slot] { return slots_[slot].done; });
+    slots_[slot].busy = false;
+    --inflight_;
+    if (fail_sync) return Status::ERROR_BACKEND;
+    out->shapes = std::move(slots_[slot].result);
+    return Status::SUCCESS;
+  }
+
+  std::atomic<bool> fail_enqueue{false};
+  std::atomic<bool> fail_sync{false};
+  int max_inflight = 0;
+
+ private:
+  struct Slot {
+    bool busy = false;
+    bool done = false;
+    std::vector<Shape> result;
+  };
+
+  void DeviceLoop() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+      cond_.wait(lk, [this] { return !queue_.empty() || !running_; });
+      if (queue_.empty()) break;
+      int slot = queue_.front();
+      queue_.pop_front();
+      lk.unlock();
+      std::this_thread::sleep_for(latency_);
+      lk.lock();
+      slots_[slot].done = true;
+      cond_.notify_all();
+    }
+  }
+
+  std::chrono::milliseconds latency_;
+  std::vector<Slot> slots_;
+  std::deque<int> queue_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int inflight_ = 0;
+  bool running_ = true;
+  std::thread device_;
+};
+
+// collects callbacks of batches
+class DoneRecorder {
+ public:
+  AsyncRunner::DoneFunc Get(ModelIO* out) {
+    return [this, out](Status s) {
+      std::lock_guard<std::mutex> lk(mutex_);
+      status.push_back(s);
+      order.push_back(out->shapes.empty() ? -1 : static_cast<int>(out->shapes[0][0]));
+      cond_.notify_all();
+    };
+  }
+
+  bool Wait(size_t num) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    return cond_.wait_for(lk, std::chrono::seconds(5), [this, num] { return status.size() >= num; });
+  }
+
+  std::vector<Status> status;
+  std::vector<int> order;
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+std::vector<ModelIO> MakeBatches(int num) {
+  std::vector<ModelIO> batches(num);
+  for (int i = 0; i < num; ++i) batches[i].shapes.emplace_back(Shape({i}));
+  return batches;
+}
+
+TEST(InferServerCore, AsyncRunnerOrder) {
+  constexpr int kBatchNum = 16;
+  FakeDeviceBackend* backend = new FakeDeviceBackend(3, std::chrono::milliseconds(2));
+  AsyncRunner runner{std::unique_ptr<IAsyncBackend>(backend)};
+  ASSERT_EQ(runner.SlotNum(), 3);
+
+  std::vector<ModelIO> in = MakeBatches(kBatchNum), out(kBatchNum);
+  DoneRecorder recorder;
+  for (int i = 0; i < kBatchNum; ++i) {
+    runner.Submit(&in[i], &out[i], recorder.Get(&out[i]));
+    EXPECT_LE(runner.InflightNum(), 3);
+  }
+  ASSERT_TRUE(recorder.Wait(kBatchNum));
+  for (int i = 0; i < kBatchNum; ++i) {
+    EXPECT_EQ(recorder.status[i], Status::SUCCESS);
+    EXPECT_EQ(recorder.order[i], i);
+  }
+  // batches are pipelined, slots are reused and never more than slot number in flight
+  EXPECT_GT(backend->max_inflight, 1);
+  EXPECT_LE(backend->max_inflight, 3);
+  EXPECT_EQ(runner.InflightNum(), 0);
+}
+
+TEST(InferServerCore, AsyncRunnerFailure) {
+  FakeDeviceBackend* backend = new FakeDeviceBackend(2, std::chrono::milliseconds(1));
+  AsyncRunner runner{std::unique_ptr<IAsyncBackend>(backend)};
+  std::vector<ModelIO> in = MakeBatches(4), out(4);
+  DoneRecorder recorder;
+
+  // enqueue failure is reported on caller's thread, slot is given back
+  backend->fail_enqueue = true;
+  runner.Submit(&in[0], &out[0], recorder.Get(&out[0]));
+  ASSERT_EQ(recorder.status.size(), 1u);
+  EXPECT_EQ(recorder.status[0], Status::ERROR_BACKEND);
+  EXPECT_EQ(runner.InflightNum(), 0);
+  backend->fail_enqueue = false;
+
+  runner.Submit(&in[1], &out[1], recorder.Get(&out[1]));
+  ASSERT_TRUE(recorder.Wait(2));
+  EXPECT_EQ(recorder.status[1], Status::SUCCESS);
+  EXPECT_EQ(recorder.order[1], 1);
+
+  backend->fail_sync = true;
+  runner.Submit(&in[2], &out[2], recorder.Get(&out[2]));
+  ASSERT_TRUE(recorder.Wait(3));
+  EXPECT_EQ(recorder.status[2], Status::ERROR_BACKEND);
+  EXPECT_EQ(runner.InflightNum(), 0);
+}
+
+TEST(InferServerCore, AsyncRunnerDrain) {
+  std::vector<ModelIO> in = MakeBatches(6), out(6);
+  DoneRecorder recorder;
+  {
+    AsyncRunner runner(std::unique_ptr<IAsyncBackend>(new FakeDeviceBackend(3, std::chrono::milliseconds(5))));
+    for (int i = 0; i < 6; ++i) {
+      runner.Submit(&in[i], &out[i], recorder.Get(&out[i]));
+    }
+  }
+  // batches in flight are done before runner is destroyed
+  ASSERT_EQ(recorder.status.size(), 6u);
+  for (int i = 0; i < 6; ++i) EXPECT_EQ(recorder.order[i], i);
+}
+
+}  // namespace
+}  // namespace infer_server
@@ -0,0 +1,183 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "core/autoscaler.h"
+
+namespace infer_server {
+namespace {
+
+EngineScaler::Config TestConfig(uint32_t min_num, uint32_t max_num) {
+  EngineScaler::Config config;
+  config.min_engine_num = min_num;
+  config.max_engine_num = max_num;
+  config.window = 5;
+  config.down_window = 5;
+  return config;
+}
+
+LoadSample Sample(uint32_t depth, float idle_ratio, float batch_fill) {
+  LoadSample sample;
+  sample.cache_depth = depth;
+  sample.idle_ratio = idle_ratio;
+  sample.batch_fill = batch_fill;
+  return sample;
+}
+
+LoadSample Busy(uint32_t depth) { return Sample(depth, 0.f, 1.f); }
+LoadSample Idle(float idle_ratio) { return Sample(0, idle_ratio, 0.2f); }
+
+TEST(InferServerCore, EngineScalerSustainedBacklog) {
+  EngineScaler scaler(TestConfig(1, 3));
+  for (int i = 0; i < 4; ++i) EXPECT_EQ(scaler.Update(Busy(2), 1), 0);
+  EXPECT_EQ(scaler.Update(Busy(2), 1), 1);
+  // window restarts after change
+  for (int i = 0; i < 4; ++i) EXPECT_EQ(scaler.Update(Busy(2), 2), 0);
+  EXPECT_EQ(scaler.Update(Busy(2), 2), 1);
+  // never above upper bound
+  for (int i = 0; i < 20; ++i) EXPECT_EQ(scaler.Update(Busy(2), 3), 0);
+}
+
+TEST(InferServerCore, EngineScalerIgnoreSpike) {
+  EngineScaler scaler(TestConfig(1, 3));
+  // backlog drains within every window
+  for (int i = 0; i < 40; ++i) {
+    EXPECT_EQ(scaler.Update(i % 4 == 3 ? Busy(0) : Busy(5), 1), 0) << i;
+  }
+  // backlog of small batches is not worth an engine
+  for (int i = 0; i < 20; ++i) EXPECT_EQ(scaler.Update(Sample(3, 0.f, 0.3f), 1), 0);
+  // engines are idle from time to time
+  for (int i = 0; i < 20; ++i) EXPECT_EQ(scaler.Update(Sample(3, 0.4f, 1.f), 2), 0);
+}
+
+TEST(InferServerCore, EngineScalerRetireIdle) {
+  EngineScaler scaler(TestConfig(2, 4));
+  // 2 busy engines of 4, the other 3 engines would be busy at 0.67
+  for (int i = 0; i < 4; ++i) EXPECT_EQ(scaler.Update(Idle(0.5f), 4), 0);
+  EXPECT_EQ(scaler.Update(Idle(0.5f), 4), -1);
+  // 1.5 busy engines of 3 are too much for 2 engines
+  for (int i = 0; i < 20; ++i) EXPECT_EQ(scaler.Update(Idle(0.5f), 3), 0);
+  scaler.Reset();
+  for (int i = 0; i < 4; ++i) EXPECT_EQ(scaler.Update(Idle(0.6f), 3), 0);
+  EXPECT_EQ(scaler.Update(Idle(0.6f), 3), -1);
+  // never below lower bound
+  for (int i = 0; i < 20; ++i) EXPECT_EQ(scaler.Update(Idle(1.f), 2), 0);
+
+  // a waiting batch keeps engines
+  EngineScaler another(TestConfig(1, 4));
+  for (int i = 0; i < 20; ++i) EXPECT_EQ(another.Update(i % 5 ? Idle(1.f) : Sample(1, 1.f, 0.2f), 4), 0);
+}
+
+TEST(InferServerCore, EngineScalerHysteresis) {
+  EngineScaler scaler(TestConfig(1, 4));
+  // load between scale up and scale down conditions keeps engine number
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> idle(0.15f, 0.45f);
+  std::uniform_int_distribution<int> depth(0, 2);
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(scaler.Update(Sample(static_cast<uint32_t>(depth(gen)), idle(gen), 1.f), 3), 0) << i;
+  }
+}
+
+// engines served by host, each batch takes service_ticks ticks, batches arrive randomly at given rate per tick,
+// load is sampled every sample_ticks ticks
+class LoadSimulator {
+ public:
+  LoadSimulator(uint32_t engine_num, uint32_t service_ticks, uint32_t sample_ticks)
+      : busy_(engine_num, 0), service_ticks_(service_ticks), sample_ticks_(sample_ticks) {}
+
+  LoadSample Sample(float arrival_rate) {
+    uint32_t idle_num = 0;
+    for (uint32_t tick = 0; tick < sample_ticks_; ++tick) {
+      if (dis_(gen_) < arrival_rate) ++cache_depth_;
+      for (auto& remain : busy_) {
+        if (remain) --remain;
+        if (!remain && cache_depth_) {
+          --cache_depth_;
+          remain = service_ticks_;
+        }
+        if (!remain) ++idle_num;
+      }
+    }
+    return infer_server::Sample(cache_depth_, static_cast<float>(idle_num) / busy_.size() / sample_ticks_, 1.f);
+  }
+
+  void Apply(int change) {
+    if (change > 0) busy_.push_back(0);
+    // retired engine finishes its batch, which is not counted any more
+    if (change < 0) busy_.pop_back();
+    if (change) ++change_num;
+  }
+
+  uint32_t EngineNum() const { return busy_.size(); }
+  uint32_t CacheDepth() const { return cache_depth_; }
+
+  int change_num = 0;
+
+ private:
+  std::vector<uint32_t> busy_;
+  uint32_t service_ticks_;
+  uint32_t sample_ticks_;
+  uint32_t cache_depth_ = 0;
+  std::mt19937 gen_{42};
+  std::uniform_real_distribution<float> dis_{0, 1};
+};
+
+TEST(InferServerCore, EngineScalerSyntheticLoad) {
+  EngineScaler::Config config;
+  config.min_engine_num = 1;
+  config.max_engine_num = 6;
+  EngineScaler scaler(config);
+  // one engine serves 0.25 batch per tick
+  LoadSimulator sim(1, 4, 10);
+
+  // heavy load needs 3 engines
+  for (int i = 0; i < 1000; ++i) {
+    sim.Apply(scaler.Update(sim.Sample(0.6f), sim.EngineNum()));
+  }
+  EXPECT_GE(sim.EngineNum(), 3u);
+  EXPECT_LE(sim.EngineNum(), 4u);
+  EXPECT_LT(sim.CacheDepth(), 10u);
+  // steady under steady load
+  int changes = sim.change_num;
+  for (int i = 0; i < 1000; ++i) {
+    sim.Apply(scaler.Update(sim.Sample(0.6f), sim.EngineNum()));
+    EXPECT_GE(sim.EngineNum(), 3u);
+    EXPECT_LE(sim.EngineNum(), 4u);
+  }
+  EXPECT_LE(sim.change_num, changes + 2);
+
+  // light load, idle engines are retired down to lower bound
+  changes = sim.change_num;
+  for (int i = 0; i < 1000; ++i) {
+    sim.Apply(scaler.Update(sim.Sample(0.05f), sim.EngineNum()));
+  }
+  EXPECT_EQ(sim.EngineNum(), 1u);
+  EXPECT_LE(sim.change_num, changes + 3);
+}
+
+}  // namespace
+}  // namespace infer_server
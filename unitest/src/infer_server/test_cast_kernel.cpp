@@ -0,0 +1,278 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "core/cast_kernel.h"
+#include "core/data_type.h"
+#include "half.h"
+
+namespace infer_server {
+namespace {
+
+using detail::CastHost;
+using detail::CastIsa;
+
+const std::vector<CastIsa> g_isas = {CastIsa::SCALAR, detail::DetectCastIsa()};
+const std::vector<DataType> g_types = {DataType::UINT8, DataType::FLOAT16, DataType::FLOAT32, DataType::INT32,
+                                       DataType::INT16, DataType::INT8};
+
+inline uint32_t FloatBits(float f) {
+  uint32_t w;
+  memcpy(&w, &f, sizeof(w));
+  return w;
+}
+
+inline bool IsHalfNaN(uint16_t h) { return (h & 0x7C00) == 0x7C00 && (h & 0x03FF); }
+
+// rounds to nearest even based on the truncation of reference implementation
+uint16_t ReferenceFloatToHalf(float f) {
+  uint16_t lo = half::float2half(f);
+  uint16_t hi = lo + 1;
+  double d_lo = std::fabs(static_cast<double>(half::half2float(lo)) - f);
+  double d_hi = std::fabs(static_cast<double>(half::half2float(hi)) - f);
+  if (d_lo < d_hi) return lo;
+  if (d_hi < d_lo) return hi;
+  return (lo & 1) ? hi : lo;
+}
+
+TEST(InferServerCastKernel, HalfToFloatBitExact) {
+  std::vector<uint16_t> src(1 << 16);
+  for (uint32_t i = 0; i < src.size(); ++i) src[i] = i;
+  for (CastIsa isa : g_isas) {
+    std::vector<float> dst(src.size());
+    ASSERT_TRUE(CastHost(src.data(), dst.data(), DataType::FLOAT16, DataType::FLOAT32, src.size(), isa));
+    for (uint32_t i = 0; i < src.size(); ++i) {
+      float ref = half::half2float(src[i]);
+      if (IsHalfNaN(src[i])) {
+        ASSERT_TRUE(std::isnan(dst[i])) << "half: " << i;
+        ASSERT_EQ(std::signbit(dst[i]), std::signbit(ref)) << "half: " << i;
+      } else {
+        ASSERT_EQ(FloatBits(dst[i]), FloatBits(ref)) << "half: " << i << ", isa: " << static_cast<int>(isa);
+      }
+      ASSERT_EQ(FloatBits(detail::HalfToFloat(src[i])), FloatBits(dst[i])) << "half: " << i;
+    }
+  }
+}
+
+TEST(InferServerCastKernel, FloatToHalfBitExact) {
+  // every representable value converts back to itself, same as reference
+  std::vector<float> src;
+  std::vector<uint16_t> expected;
+  for (uint32_t i = 0; i < (1 << 16); ++i) {
+    if (IsHalfNaN(i)) continue;
+    src.push_back(half::half2float(i));
+    expected.push_back(i);
+  }
+  // values in the middle of two halves and random values, the reference truncates and is rounded here
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dis(-65504.f, 65504.f);
+  for (uint32_t i = 0x0400; i < 0x7BFF; i += 7) {
+    float mid = (half::half2float(i) + half::half2float(i + 1)) / 2;
+    src.push_back(mid);
+    expected.push_back((i & 1) ? i + 1 : i);
+  }
+  for (int i = 0; i < 100000; ++i) {
+    float f = dis(gen);
+    if (std::fabs(f) < 6.2e-5f) continue;
+    src.push_back(f);
+    expected.push_back(ReferenceFloatToHalf(f));
+  }
+  // overflow
+  src.push_back(65520.f);
+  expected.push_back(0x7C00);
+  src.push_back(-1e10f);
+  expected.push_back(0xFC00);
+
+  for (CastIsa isa : g_isas) {
+    std::vector<uint16_t> dst(src.size());
+    ASSERT_TRUE(CastHost(src.data(), dst.data(), DataType::FLOAT32, DataType::FLOAT16, src.size(), isa));
+    for (size_t i = 0; i < src.size(); ++i) {
+      ASSERT_EQ(dst[i], expected[i]) << "float: " << src[i] << ", isa: " << static_cast<int>(isa);
+      ASSERT_EQ(detail::FloatToHalf(src[i]), dst[i]) << "float: " << src[i];
+    }
+  }
+}
+
+TEST(InferServerCastKernel, RoundAndSaturate) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const std::vector<float> src = {0.5f, 1.5f, 2.5f, -0.5f, -1.5f, 254.5f, 300.f, -1.f, 40000.f, -40000.f,
+                                  1e10f, -1e10f, nan, 2147483520.f, 3.f, 7.5f, -7.5f, 0.49999997f};
+  const std::vector<uint8_t> u8 = {0, 2, 2, 0, 0, 254, 255, 0, 255, 0, 255, 0, 0, 255, 3, 8, 0, 0};
+  const std::vector<int16_t> i16 = {0, 2, 2, 0, -2, 254, 300, -1, 32767, -32768, 32767, -32768, 0, 32767, 3, 8, -8, 0};
+  const std::vector<int8_t> i8 = {0, 2, 2, 0, -2, 127, 127, -1, 127, -128, 127, -128, 0, 127, 3, 8, -8, 0};
+  const std::vector<int32_t> i32 = {0, 2, 2, 0, -2, 254, 300, -1, 40000, -40000, std::numeric_limits<int32_t>::max(),
+                                    std::numeric_limits<int32_t>::min(), 0, 2147483520, 3, 8, -8, 0};
+  // repeated to run both vectorized body and scalar tail
+  constexpr int repeat = 3;
+  std::vector<float> input;
+  for (int r = 0; r < repeat; ++r) input.insert(input.end(), src.begin(), src.end());
+
+  for (CastIsa isa : g_isas) {
+    std::vector<uint8_t> out_u8(input.size());
+    std::vector<int8_t> out_i8(input.size());
+    std::vector<int16_t> out_i16(input.size());
+    std::vector<int32_t> out_i32(input.size());
+    ASSERT_TRUE(CastHost(input.data(), out_u8.data(), DataType::FLOAT32, DataType::UINT8, input.size(), isa));
+    ASSERT_TRUE(CastHost(input.data(), out_i8.data(), DataType::FLOAT32, DataType::INT8, input.size(), isa));
+    ASSERT_TRUE(CastHost(input.data(), out_i16.data(), DataType::FLOAT32, DataType::INT16, input.size(), isa));
+    ASSERT_TRUE(CastHost(input.data(), out_i32.data(), DataType::FLOAT32, DataType::INT32, input.size(), isa));
+    for (size_t i = 0; i < input.size(); ++i) {
+      size_t j = i % src.size();
+      EXPECT_EQ(out_u8[i], u8[j]) << "float: " << input[i] << ", isa: " << static_cast<int>(isa);
+      EXPECT_EQ(out_i8[i], i8[j]) << "float: " << input[i] << ", isa: " << static_cast<int>(isa);
+      EXPECT_EQ(out_i16[i], i16[j]) << "float: " << input[i] << ", isa: " << static_cast<int>(isa);
+      EXPECT_EQ(out_i32[i], i32[j]) << "float: " << input[i] << ", isa: " << static_cast<int>(isa);
+    }
+  }
+
+  // integers saturate
+  const std::vector<int32_t> ints = {-70000, -32769, -129, -1, 0, 127, 255, 256, 32768, 70000};
+  const std::vector<uint8_t> ints_u8 = {0, 0, 0, 0, 0, 127, 255, 255, 255, 255};
+  const std::vector<int16_t> ints_i16 = {-32768, -32768, -129, -1, 0, 127, 255, 256, 32767, 32767};
+  const std::vector<int8_t> ints_i8 = {-128, -128, -128, -1, 0, 127, 127, 127, 127, 127};
+  std::vector<uint8_t> out_u8(ints.size());
+  std::vector<int16_t> out_i16(ints.size());
+  std::vector<int8_t> out_i8(ints.size());
+  ASSERT_TRUE(CastHost(ints.data(), out_u8.data(), DataType::INT32, DataType::UINT8, ints.size()));
+  ASSERT_TRUE(CastHost(ints.data(), out_i16.data(), DataType::INT32, DataType::INT16, ints.size()));
+  ASSERT_TRUE(CastHost(ints.data(), out_i8.data(), DataType::INT32, DataType::INT8, ints.size()));
+  EXPECT_EQ(out_u8, ints_u8);
+  EXPECT_EQ(out_i16, ints_i16);
+  EXPECT_EQ(out_i8, ints_i8);
+}
+
+TEST(InferServerCastKernel, Int8ToFromFloat) {
+  // every int8 value is exact in float and half, and converts back to itself
+  std::vector<int8_t> src;
+  for (int r = 0; r < 3; ++r) {
+    for (int v = -128; v < 128; ++v) src.push_back(static_cast<int8_t>(v));
+  }
+  for (CastIsa isa : g_isas) {
+    std::vector<float> f32(src.size());
+    std::vector<uint16_t> f16(src.size());
+    ASSERT_TRUE(CastHost(src.data(), f32.data(), DataType::INT8, DataType::FLOAT32, src.size(), isa));
+    ASSERT_TRUE(CastHost(src.data(), f16.data(), DataType::INT8, DataType::FLOAT16, src.size(), isa));
+    for (size_t i = 0; i < src.size(); ++i) {
+      ASSERT_EQ(f32[i], static_cast<float>(src[i])) << "int8: " << static_cast<int>(src[i]);
+      ASSERT_EQ(f16[i], detail::FloatToHalf(src[i])) << "int8: " << static_cast<int>(src[i]);
+    }
+
+    std::vector<int8_t> from_f32(src.size()), from_f16(src.size());
+    ASSERT_TRUE(CastHost(f32.data(), from_f32.data(), DataType::FLOAT32, DataType::INT8, src.size(), isa));
+    ASSERT_TRUE(CastHost(f16.data(), from_f16.data(), DataType::FLOAT16, DataType::INT8, src.size(), isa));
+    EXPECT_EQ(from_f32, src);
+    EXPECT_EQ(from_f16, src);
+  }
+
+  // half rounds to nearest even and saturates
+  const std::vector<float> halves = {0.5f, 1.5f, -2.5f, 126.5f, 127.5f, -128.5f, 1000.f, -1000.f};
+  const std::vector<int8_t> expected = {0, 2, -2, 126, 127, -128, 127, -128};
+  std::vector<uint16_t> h;
+  for (int r = 0; r < 3; ++r) {
+    for (float f : halves) h.push_back(detail::FloatToHalf(f));
+  }
+  for (CastIsa isa : g_isas) {
+    std::vector<int8_t> out(h.size());
+    ASSERT_TRUE(CastHost(h.data(), out.data(), DataType::FLOAT16, DataType::INT8, h.size(), isa));
+    for (size_t i = 0; i < h.size(); ++i) {
+      EXPECT_EQ(out[i], expected[i % halves.size()]) << "half: " << halves[i % halves.size()];
+    }
+  }
+}
+
+std::vector<uint8_t> RandomData(DataType type, size_t count, std::mt19937 *gen) {
+  std::vector<uint8_t> data(count * GetTypeSize(type));
+  std::uniform_real_distribution<float> dis(-70000.f, 70000.f);
+  for (size_t i = 0; i < count; ++i) {
+    float f = dis(*gen);
+    switch (type) {
+      case DataType::UINT8: data[i] = static_cast<uint8_t>((*gen)()); break;
+      case DataType::FLOAT16: reinterpret_cast<uint16_t *>(data.data())[i] = detail::FloatToHalf(f / 2); break;
+      case DataType::FLOAT32: reinterpret_cast<float *>(data.data())[i] = f / 1000; break;
+      case DataType::INT32: reinterpret_cast<int32_t *>(data.data())[i] = static_cast<int32_t>(f); break;
+      case DataType::INT16: reinterpret_cast<int16_t *>(data.data())[i] = static_cast<int16_t>((*gen)()); break;
+      case DataType::INT8: reinterpret_cast<int8_t *>(data.data())[i] = static_cast<int8_t>((*gen)()); break;
+      default: break;
+    }
+  }
+  return data;
+}
+
+TEST(InferServerCastKernel, AllPairsSameAsScalar) {
+  std::mt19937 gen(1);
+  constexpr size_t count = 1003;
+  for (DataType src_type : g_types) {
+    std::vector<uint8_t> src = RandomData(src_type, count, &gen);
+    for (DataType dst_type : g_types) {
+      std::vector<uint8_t> scalar(count * GetTypeSize(dst_type));
+      std::vector<uint8_t> simd(count * GetTypeSize(dst_type));
+      ASSERT_TRUE(CastHost(src.data(), scalar.data(), src_type, dst_type, count, CastIsa::SCALAR));
+      ASSERT_TRUE(CastHost(src.data(), simd.data(), src_type, dst_type, count, detail::DetectCastIsa()));
+      EXPECT_EQ(scalar, simd) << detail::DataTypeStr(src_type) << " -> " << detail::DataTypeStr(dst_type);
+    }
+  }
+
+  uint8_t in[4] = {1, 2, 3, 4};
+  float out[4];
+  EXPECT_FALSE(CastHost(in, out, DataType::INVALID, DataType::FLOAT32, 4));
+  EXPECT_TRUE(detail::CastDataType(in, out, DataType::UINT8, DataType::FLOAT32, Shape({1, 4})));
+  EXPECT_EQ(out[3], 4.f);
+}
+
+TEST(InferServerCastKernel, Benchmark) {
+  constexpr size_t count = 1 << 22;
+  constexpr int loop = 10;
+  std::mt19937 gen(2);
+  struct Case {
+    DataType src, dst;
+  };
+  const std::vector<Case> cases = {{DataType::FLOAT16, DataType::FLOAT32},
+                                   {DataType::FLOAT32, DataType::FLOAT16},
+                                   {DataType::FLOAT32, DataType::UINT8},
+                                   {DataType::UINT8, DataType::FLOAT32}};
+  for (const Case &c : cases) {
+    std::vector<uint8_t> src = RandomData(c.src, count, &gen);
+    std::vector<uint8_t> dst(count * GetTypeSize(c.dst));
+    double ms[2];
+    for (int n = 0; n < 2; ++n) {
+      auto start = std::chrono::steady_clock::now();
+      for (int l = 0; l < loop; ++l) {
+        ASSERT_TRUE(CastHost(src.data(), dst.data(), c.src, c.dst, count, g_isas[n]));
+      }
+      std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+      ms[n] = dura.count() / loop;
+    }
+    LOG(INFO) << "[EasyDK Tests] [InferServer] Cast " << detail::DataTypeStr(c.src) << " -> "
+              << detail::DataTypeStr(c.dst) << " of " << count << " elements, scalar: " << ms[0]
+              << " ms, isa " << static_cast<int>(g_isas[1]) << ": " << ms[1] << " ms";
+  }
+}
+
+}  // namespace
+}  // namespace infer_server
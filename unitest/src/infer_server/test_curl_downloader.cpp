@@ -0,0 +1,177 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifdef CNIS_HAVE_CURL
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "model/curl_downloader.h"
+#include "model/model_file.h"
+
+namespace infer_server {
+namespace {
+
+class CurlDownloaderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    char src_tmpl[] = "/tmp/cnis_download_src_XXXXXX";
+    char dst_tmpl[] = "/tmp/cnis_download_dst_XXXXXX";
+    ASSERT_TRUE(mkdtemp(src_tmpl));
+    ASSERT_TRUE(mkdtemp(dst_tmpl));
+    src_dir_ = src_tmpl;
+    dst_dir_ = dst_tmpl;
+    data_.resize(1 << 20);
+    for (size_t i = 0; i < data_.size(); ++i) data_[i] = static_cast<char>(i * 131 + i / 4096);
+    Write(src_dir_ + "/model.bin", data_);
+    url_ = "file://" + src_dir_ + "/model.bin";
+    target_ = dst_dir_ + "/model.bin";
+  }
+
+  void TearDown() override {
+    for (auto& name : {"model.bin", "model.bin.sha256"}) unlink((src_dir_ + "/" + name).c_str());
+    for (auto& name : {"model.bin", "model.bin.part", "model.bin.lock"}) unlink((dst_dir_ + "/" + name).c_str());
+    rmdir(src_dir_.c_str());
+    rmdir(dst_dir_.c_str());
+  }
+
+  static void Write(const std::string& path, const std::vector<char>& data) {
+    std::ofstream f(path, std::ios::binary);
+    f.write(data.data(), data.size());
+  }
+
+  static std::vector<char> Read(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+  }
+
+  static bool Exists(const std::string& path) { return access(path.c_str(), F_OK) == 0; }
+
+  std::string Digest() const { return Sha256Hex(data_.data(), data_.size()); }
+
+  std::string src_dir_, dst_dir_, url_, target_;
+  std::vector<char> data_;
+};
+
+TEST_F(CurlDownloaderTest, Download) {
+  CurlDownloader downloader(dst_dir_);
+  EXPECT_EQ(downloader.Download(url_), target_);
+  EXPECT_EQ(Read(target_), data_);
+  EXPECT_FALSE(Exists(target_ + ".part"));
+  EXPECT_EQ(downloader.TransferredBytes(), data_.size());
+
+  // published file is reused
+  EXPECT_EQ(downloader.Download(url_), target_);
+  EXPECT_EQ(downloader.TransferredBytes(), data_.size());
+
+  EXPECT_TRUE(downloader.Download("file://" + src_dir_ + "/not_exist.bin").empty());
+  EXPECT_FALSE(Exists(dst_dir_ + "/not_exist.bin"));
+  unlink((dst_dir_ + "/not_exist.bin.part").c_str());
+  unlink((dst_dir_ + "/not_exist.bin.lock").c_str());
+}
+
+TEST_F(CurlDownloaderTest, Resume) {
+  // bytes left by an interrupted download
+  size_t left = data_.size() / 3;
+  Write(target_ + ".part", std::vector<char>(data_.begin(), data_.begin() + left));
+  CurlDownloader downloader(dst_dir_);
+  EXPECT_EQ(downloader.Download(url_), target_);
+  EXPECT_EQ(Read(target_), data_);
+  EXPECT_EQ(downloader.TransferredBytes(), data_.size() - left);
+  EXPECT_FALSE(Exists(target_ + ".part"));
+}
+
+TEST_F(CurlDownloaderTest, RestartIfNotResumable) {
+  // the file on server is shorter than bytes left
+  std::vector<char> left(data_);
+  left.resize(data_.size() + 100, 'x');
+  Write(target_ + ".part", left);
+  CurlDownloader downloader(dst_dir_);
+  EXPECT_EQ(downloader.Download(url_), target_);
+  EXPECT_EQ(Read(target_), data_);
+  EXPECT_EQ(downloader.TransferredBytes(), data_.size());
+}
+
+TEST_F(CurlDownloaderTest, ChecksumInFragment) {
+  CurlDownloader downloader(dst_dir_);
+  std::string wrong(64, '0');
+  EXPECT_TRUE(downloader.Download(url_ + "#sha256=" + wrong).empty());
+  EXPECT_FALSE(Exists(target_));
+  EXPECT_FALSE(Exists(target_ + ".part"));
+  EXPECT_TRUE(downloader.Download(url_ + "#sha256=invalid").empty());
+
+  EXPECT_EQ(downloader.Download(url_ + "#sha256=" + Digest()), target_);
+  EXPECT_EQ(Read(target_), data_);
+
+  // corrupted file is downloaded again
+  Write(target_, std::vector<char>(data_.begin(), data_.begin() + 100));
+  uint64_t transferred = downloader.TransferredBytes();
+  EXPECT_EQ(downloader.Download(url_ + "#sha256=" + Digest()), target_);
+  EXPECT_EQ(Read(target_), data_);
+  EXPECT_EQ(downloader.TransferredBytes(), transferred + data_.size());
+}
+
+TEST_F(CurlDownloaderTest, ChecksumInSidecar) {
+  CurlDownloader downloader(dst_dir_);
+  std::string sidecar = src_dir_ + "/model.bin.sha256";
+  std::string wrong = std::string(64, 'f') + "  model.bin\n";
+  Write(sidecar, std::vector<char>(wrong.begin(), wrong.end()));
+  EXPECT_TRUE(downloader.Download(url_).empty());
+  EXPECT_FALSE(Exists(target_));
+
+  std::string right = Digest() + "  model.bin\n";
+  Write(sidecar, std::vector<char>(right.begin(), right.end()));
+  EXPECT_EQ(downloader.Download(url_), target_);
+  EXPECT_EQ(Read(target_), data_);
+}
+
+TEST_F(CurlDownloaderTest, ConcurrentFetchers) {
+  constexpr int kFetcherNum = 4;
+  std::vector<std::thread> threads;
+  std::vector<std::string> paths(kFetcherNum);
+  std::vector<uint64_t> bytes(kFetcherNum);
+  for (int i = 0; i < kFetcherNum; ++i) {
+    threads.emplace_back([this, i, &paths, &bytes]() {
+      CurlDownloader downloader(dst_dir_);
+      paths[i] = downloader.Download(url_);
+      bytes[i] = downloader.TransferredBytes();
+    });
+  }
+  uint64_t total = 0;
+  for (int i = 0; i < kFetcherNum; ++i) {
+    threads[i].join();
+    EXPECT_EQ(paths[i], target_);
+    total += bytes[i];
+  }
+  // file is transferred once
+  EXPECT_EQ(total, data_.size());
+  EXPECT_EQ(Read(target_), data_);
+}
+
+}  // namespace
+}  // namespace infer_server
+
+#endif  // CNIS_HAVE_CURL
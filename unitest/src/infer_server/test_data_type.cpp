@@ -51,6 +51,7 @@ TEST(InferServerCore, CastDataType) {
   TEST_CAST_DATATYPE(FLOAT32);
   TEST_CAST_DATATYPE(INT16);
   TEST_CAST_DATATYPE(INT32);
+  TEST_CAST_DATATYPE(INT8);
 #undef TEST_CAST_DATATYPE
 }
 
@@ -62,6 +63,7 @@ TEST(InferServerCore, DataTypeStr) {
   TEST_DATATYPE_STR(FLOAT32);
   TEST_DATATYPE_STR(INT16);
   TEST_DATATYPE_STR(INT32);
+  TEST_DATATYPE_STR(INT8);
 #undef TEST_DATATYPE_STR
 }
 
@@ -0,0 +1,315 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "cnis/detection.h"
+#include "core/cast_kernel.h"
+
+namespace infer_server {
+namespace {
+
+std::vector<float> MakeRow(float label, float score, float x0, float y0, float x1, float y1) {
+  return {0.f, label, score, x0, y0, x1, y1};
+}
+
+Detection MakeDet(float x0, float y0, float x1, float y1, float score, int label) {
+  Detection d;
+  d.x0 = x0;
+  d.y0 = y0;
+  d.x1 = x1;
+  d.y1 = y1;
+  d.score = score;
+  d.label = label;
+  return d;
+}
+
+float IoU(const Detection &a, const Detection &b) {
+  float w = std::max(std::min(a.x1, b.x1) - std::max(a.x0, b.x0), 0.f);
+  float h = std::max(std::min(a.y1, b.y1) - std::max(a.y0, b.y0), 0.f);
+  float area_a = std::max(a.x1 - a.x0, 0.f) * std::max(a.y1 - a.y0, 0.f);
+  float area_b = std::max(b.x1 - b.x0, 0.f) * std::max(b.y1 - b.y0, 0.f);
+  return w * h / (area_a + area_b - w * h);
+}
+
+// textbook greedy NMS
+std::vector<Detection> ReferenceNms(std::vector<Detection> dets, float thr, bool class_aware) {
+  std::stable_sort(dets.begin(), dets.end(), [](const Detection &a, const Detection &b) { return a.score > b.score; });
+  std::vector<bool> suppressed(dets.size(), false);
+  std::vector<Detection> res;
+  for (size_t i = 0; i < dets.size(); ++i) {
+    if (suppressed[i]) continue;
+    res.push_back(dets[i]);
+    for (size_t j = i + 1; j < dets.size(); ++j) {
+      if (class_aware && dets[i].label != dets[j].label) continue;
+      if (IoU(dets[i], dets[j]) > thr) suppressed[j] = true;
+    }
+  }
+  return res;
+}
+
+std::vector<Detection> RandomDetections(size_t num, int classes, std::mt19937 *gen) {
+  std::uniform_real_distribution<float> pos(0.f, 1.f), size(0.02f, 0.3f), score(0.f, 1.f);
+  std::uniform_int_distribution<int> label(0, classes - 1);
+  std::vector<Detection> dets;
+  for (size_t i = 0; i < num; ++i) {
+    float x = pos(*gen), y = pos(*gen);
+    dets.push_back(MakeDet(x, y, x + size(*gen), y + size(*gen), score(*gen), label(*gen)));
+  }
+  return dets;
+}
+
+// candidates in the YOLOv3 layout
+std::vector<float> ToRows(const std::vector<Detection> &dets) {
+  std::vector<float> rows;
+  for (const Detection &d : dets) {
+    std::vector<float> row = MakeRow(d.label, d.score, d.x0, d.y0, d.x1, d.y1);
+    rows.insert(rows.end(), row.begin(), row.end());
+  }
+  return rows;
+}
+
+void ExpectSame(const std::vector<Detection> &a, const std::vector<Detection> &b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    EXPECT_EQ(a[i].score, b[i].score) << i;
+    EXPECT_EQ(a[i].label, b[i].label) << i;
+    EXPECT_EQ(a[i].x0, b[i].x0) << i;
+    EXPECT_EQ(a[i].y1, b[i].y1) << i;
+  }
+}
+
+TEST(Detection, FilterByScore) {
+  std::vector<float> rows;
+  const float scores[] = {0.1f, 0.5f, 0.49f, std::numeric_limits<float>::quiet_NaN(), 0.9f, 0.5f, 0.7f};
+  for (float s : scores) {
+    std::vector<float> row = MakeRow(0, s, 0, 0, 1, 1);
+    rows.insert(rows.end(), row.begin(), row.end());
+  }
+  DetectionLayout layout;
+  std::vector<uint32_t> indices;
+  // threshold is inclusive, NaN is dropped, the tail after whole vectors is handled
+  EXPECT_EQ(FilterByScore(rows.data(), 7, layout, 0.5f, &indices), 4u);
+  EXPECT_EQ(indices, std::vector<uint32_t>({1, 4, 5, 6}));
+  EXPECT_EQ(FilterByScore(rows.data(), 3, layout, 0.f, &indices), 3u);
+  EXPECT_EQ(indices.size(), 7u);
+
+  // scores of a separate array
+  DetectionLayout soa;
+  soa.stride = 1;
+  soa.score_offset = 0;
+  soa.label_offset = -1;
+  soa.box_offset = 0;
+  indices.clear();
+  EXPECT_EQ(FilterByScore(scores, 7, soa, 0.6f, &indices), 2u);
+  EXPECT_EQ(indices, std::vector<uint32_t>({4, 6}));
+}
+
+TEST(Detection, Letterbox) {
+  // image 832x416 into 416x416, content is 416x208 with 104 rows of padding at top and bottom
+  Detection det = MakeDet(0.25f, 0.5f, 0.75f, 0.75f, 1.f, 0);
+  BoxTransform t = BoxTransform::Letterbox(416, 416, 832, 416);
+  TransformBoxes(&det, 1, t);
+  EXPECT_FLOAT_EQ(det.x0, 0.25f);
+  EXPECT_FLOAT_EQ(det.y0, 0.5f);
+  EXPECT_FLOAT_EQ(det.x1, 0.75f);
+  EXPECT_FLOAT_EQ(det.y1, 1.f);
+
+  // same as (x - 0.5) * factor + 0.5, and clipped into image
+  det = MakeDet(0.1f, 0.1f, 0.9f, 0.3f, 1.f, 0);
+  TransformBoxes(&det, 1, t);
+  EXPECT_FLOAT_EQ(det.x0, 0.1f);
+  EXPECT_FLOAT_EQ(det.y0, 0.f);
+  EXPECT_FLOAT_EQ(det.y1, (0.3f - 0.5f) * 2 + 0.5f);
+
+  // pixels
+  det = MakeDet(104, 208, 312, 312, 1.f, 0);
+  TransformBoxes(&det, 1, BoxTransform::Letterbox(416, 416, 832, 416, false));
+  EXPECT_FLOAT_EQ(det.x0, 208);
+  EXPECT_FLOAT_EQ(det.y0, 208);
+  EXPECT_FLOAT_EQ(det.x1, 624);
+  EXPECT_FLOAT_EQ(det.y1, 416);
+
+  // image at top left, padding at bottom
+  det = MakeDet(0.f, 0.25f, 1.f, 0.5f, 1.f, 0);
+  TransformBoxes(&det, 1, BoxTransform::Letterbox(416, 416, 832, 416, true, false));
+  EXPECT_FLOAT_EQ(det.y0, 0.5f);
+  EXPECT_FLOAT_EQ(det.y1, 1.f);
+}
+
+TEST(Detection, TopK) {
+  std::vector<Detection> dets = {MakeDet(0, 0, 1, 1, 0.5f, 0), MakeDet(0, 0, 1, 1, 0.9f, 1),
+                                 MakeDet(0, 0, 1, 1, 0.5f, 2), MakeDet(0, 0, 1, 1, 0.7f, 3)};
+  SelectTopK(&dets, 3);
+  ASSERT_EQ(dets.size(), 3u);
+  // ties keep the original order
+  EXPECT_EQ(dets[0].label, 1);
+  EXPECT_EQ(dets[1].label, 3);
+  EXPECT_EQ(dets[2].label, 0);
+  SelectTopK(&dets, 10);
+  EXPECT_EQ(dets.size(), 3u);
+}
+
+TEST(Detection, NmsGolden) {
+  // b overlaps a with IoU 0.6, c overlaps a with IoU 0.25, d is b of another class
+  const Detection a = MakeDet(0, 0, 10, 10, 0.9f, 0);
+  const Detection b = MakeDet(0, 0, 10, 6, 0.8f, 0);
+  const Detection c = MakeDet(5, 0, 10, 5, 0.7f, 0);
+  const Detection d = MakeDet(0, 0, 10, 6, 0.95f, 1);
+  std::vector<Detection> dets = {c, b, a, d};
+  NonMaxSuppression(&dets, 0.5f, true);
+  ASSERT_EQ(dets.size(), 3u);
+  EXPECT_EQ(dets[0].score, d.score);
+  EXPECT_EQ(dets[1].score, a.score);
+  EXPECT_EQ(dets[2].score, c.score);
+
+  dets = {c, b, a, d};
+  NonMaxSuppression(&dets, 0.5f, false);
+  ASSERT_EQ(dets.size(), 2u);
+  EXPECT_EQ(dets[0].score, d.score);
+  EXPECT_EQ(dets[1].score, c.score);
+
+  dets = {c, b, a, d};
+  NonMaxSuppression(&dets, 0.2f, true, 1);
+  ASSERT_EQ(dets.size(), 1u);
+
+  // NMS is skipped, detections are only sorted
+  dets = {c, b, a, d};
+  NonMaxSuppression(&dets, 1.f, true);
+  EXPECT_EQ(dets.size(), 4u);
+  EXPECT_EQ(dets[3].score, c.score);
+}
+
+TEST(Detection, NmsSameAsReference) {
+  std::mt19937 gen(3);
+  for (size_t num : {1, 5, 37, 1000}) {
+    for (bool class_aware : {true, false}) {
+      std::vector<Detection> dets = RandomDetections(num, 5, &gen);
+      std::vector<Detection> ref = ReferenceNms(dets, 0.4f, class_aware);
+      NonMaxSuppression(&dets, 0.4f, class_aware);
+      ExpectSame(dets, ref);
+    }
+  }
+}
+
+TEST(Detection, Decode) {
+  std::vector<float> rows;
+  for (auto row : {MakeRow(2, 0.9f, 0.1f, 0.1f, 0.5f, 0.5f), MakeRow(2, 0.8f, 0.1f, 0.1f, 0.5f, 0.45f),
+                   MakeRow(1, 0.7f, 0.1f, 0.1f, 0.5f, 0.45f), MakeRow(1, 0.2f, 0.6f, 0.6f, 0.8f, 0.8f),
+                   MakeRow(3, 0.9f, 0.5f, 0.95f, 0.6f, 1.f)}) {
+    rows.insert(rows.end(), row.begin(), row.end());
+  }
+  DetectionParams params;
+  params.threshold = 0.5f;
+  BoxTransform t = BoxTransform::Letterbox(416, 416, 832, 416);
+  std::vector<Detection> out;
+  ASSERT_EQ(DecodeDetections(rows.data(), DataType::FLOAT32, 5, DetectionLayout(), params, &t, &out),
+            Status::SUCCESS);
+  // the last one is in padding, empty after clipping, the second is suppressed
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].label, 2);
+  EXPECT_FLOAT_EQ(out[0].y0, 0.f);
+  EXPECT_FLOAT_EQ(out[0].y1, 0.5f);
+  EXPECT_EQ(out[1].label, 1);
+
+  params.max_detections = 1;
+  ASSERT_EQ(DecodeDetections(rows.data(), DataType::FLOAT32, 5, DetectionLayout(), params, nullptr, &out),
+            Status::SUCCESS);
+  EXPECT_EQ(out.size(), 1u);
+
+  DetectionLayout bad;
+  bad.box_offset = 4;
+  EXPECT_EQ(DecodeDetections(rows.data(), DataType::FLOAT32, 5, bad, params, nullptr, &out), Status::INVALID_PARAM);
+  EXPECT_EQ(DecodeDetections(rows.data(), DataType::INT32, 5, DetectionLayout(), params, nullptr, &out),
+            Status::INVALID_PARAM);
+}
+
+TEST(Detection, DecodeHalf) {
+  std::mt19937 gen(5);
+  // values exact in half, so both data types give the same result
+  std::vector<float> rows = ToRows(RandomDetections(1500, 10, &gen));
+  std::vector<uint16_t> half(rows.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    half[i] = detail::FloatToHalf(rows[i]);
+    rows[i] = detail::HalfToFloat(half[i]);
+  }
+  DetectionParams params;
+  params.threshold = 0.3f;
+  params.pre_nms_top_k = 500;
+  BoxTransform t = BoxTransform::Letterbox(640, 640, 1280, 720);
+  std::vector<Detection> out_float, out_half;
+  ASSERT_EQ(DecodeDetections(rows.data(), DataType::FLOAT32, 1500, DetectionLayout(), params, &t, &out_float),
+            Status::SUCCESS);
+  ASSERT_EQ(DecodeDetections(half.data(), DataType::FLOAT16, 1500, DetectionLayout(), params, &t, &out_half),
+            Status::SUCCESS);
+  EXPECT_FALSE(out_float.empty());
+  ExpectSame(out_half, out_float);
+}
+
+TEST(Detection, Benchmark) {
+  constexpr size_t kNum = 10000;
+  constexpr int kLoop = 20;
+  std::mt19937 gen(9);
+  std::vector<Detection> dets = RandomDetections(kNum, 80, &gen);
+  std::vector<float> rows = ToRows(dets);
+  DetectionParams params;
+  params.threshold = 0.3f;
+  BoxTransform t = BoxTransform::Letterbox(416, 416, 1920, 1080);
+  std::vector<Detection> out;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int l = 0; l < kLoop; ++l) {
+    ASSERT_EQ(DecodeDetections(rows.data(), DataType::FLOAT32, kNum, DetectionLayout(), params, &t, &out),
+              Status::SUCCESS);
+  }
+  std::chrono::duration<double, std::milli> lib = std::chrono::steady_clock::now() - start;
+
+  // scalar decode as in samples, then textbook NMS
+  std::vector<Detection> ref;
+  start = std::chrono::steady_clock::now();
+  for (int l = 0; l < kLoop; ++l) {
+    std::vector<Detection> cand;
+    const float *row = rows.data();
+    for (size_t i = 0; i < kNum; ++i, row += 7) {
+      if (row[2] < params.threshold) continue;
+      Detection d = MakeDet(row[3], row[4], row[5], row[6], row[2], static_cast<int>(row[1]));
+      TransformBoxes(&d, 1, t);
+      if (d.x1 <= d.x0 || d.y1 <= d.y0) continue;
+      cand.push_back(d);
+    }
+    ref = ReferenceNms(cand, params.nms_iou, true);
+  }
+  std::chrono::duration<double, std::milli> naive = std::chrono::steady_clock::now() - start;
+  ExpectSame(out, ref);
+  LOG(INFO) << "[EasyDK Tests] [Detection] " << kNum << " candidates, " << out.size() << " kept: "
+            << lib.count() / kLoop << " ms, scalar reference " << naive.count() / kLoop << " ms";
+}
+
+}  // namespace
+}  // namespace infer_server
@@ -20,7 +20,13 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -111,5 +117,73 @@ TEST(InferServerCore, EngineProcess) {
   }
 }
 
+// packs are done by another thread before ProcessAsync returns, which is held until gate is opened
+struct Gate {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool open{false};
+  uint32_t done_num{0};
+};
+
+class LateReturnProcessor : public ProcessorForkable<LateReturnProcessor> {
+ public:
+  LateReturnProcessor() noexcept : ProcessorForkable<LateReturnProcessor>("LateReturnProcessor") {}
+  Status Process(PackagePtr data) noexcept override { return Status::SUCCESS; }
+  void ProcessAsync(PackagePtr data, std::function<void(Status)> done) noexcept override {
+    std::thread(done, Status::SUCCESS).join();
+    std::unique_lock<std::mutex> lk(gate_->mutex);
+    ++gate_->done_num;
+    gate_->cond.notify_all();
+    gate_->cond.wait(lk, [this]() { return gate_->open; });
+  }
+  Status Init() noexcept override {
+    gate_ = GetParam<std::shared_ptr<Gate>>("gate");
+    return Status::SUCCESS;
+  }
+
+ private:
+  std::shared_ptr<Gate> gate_;
+};
+
+TEST(InferServerCore, EngineRetireUnderAsyncLoad) {
+  auto gate = std::make_shared<Gate>();
+  auto processors = PrepareProcessors(0);
+  processors[0] = LateReturnProcessor::Create();
+  processors[0]->SetParams("gate", gate);
+  ASSERT_EQ(processors[0]->Init(), Status::SUCCESS);
+
+  PriorityThreadPool tp(nullptr, 3);
+  std::unique_ptr<Engine> engine(new Engine(processors, [](Engine* idle) {}, &tp));
+  // engines added by autoscaling are forked
+  std::unique_ptr<Engine> forked = engine->Fork();
+  ASSERT_TRUE(forked);
+
+  std::unique_ptr<RequestControl> ctrl(new RequestControl(empty_response_func, empty_notifier_func, "", 0, 1));
+  auto input = Package::Create(1);
+  input->data[0]->ctrl = ctrl.get();
+  input->data[0]->index = 0;
+  forked->Run(std::move(input));
+  {
+    std::unique_lock<std::mutex> lk(gate->mutex);
+    ASSERT_TRUE(gate->cond.wait_for(lk, std::chrono::seconds(1), [&gate]() { return gate->done_num == 1; }));
+  }
+  // pack is done by the other nodes, while Execute of the first node has not returned yet
+  while (!ctrl->IsProcessFinished()) std::this_thread::yield();
+
+  // retired engine is destroyed once it has no task, wait for it the way executor does
+  auto idle = std::async(std::launch::async, [&forked]() {
+    while (forked->taskNum()) std::this_thread::yield();
+  });
+  EXPECT_EQ(std::future_status::timeout, idle.wait_for(std::chrono::milliseconds(50)));
+
+  {
+    std::lock_guard<std::mutex> lk(gate->mutex);
+    gate->open = true;
+  }
+  gate->cond.notify_all();
+  ASSERT_EQ(std::future_status::ready, idle.wait_for(std::chrono::seconds(1)));
+  forked.reset();
+}
+
 }  // namespace
 }  // namespace infer_server
@@ -20,6 +20,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
 #include <utility>
@@ -178,4 +181,56 @@ TEST(InferServerCore, Executor) {
   ASSERT_EQ(get_session_number, 0u);
 }
 
+TEST(InferServerCore, ExecutorWarmUp) {
+  int device_id = 0;
+  PriorityThreadPool tp([device_id]() -> bool { return SetCurrentDevice(device_id); }, 6);
+  std::shared_ptr<PreprocHandleTest> handler = std::make_shared<PreprocHandleTest>();
+  SessionDesc desc = ReturnSessionDesc("test executor warm up", handler.get(), 10, BatchStrategy::DYNAMIC, 2);
+  ASSERT_TRUE(desc.model);
+  CnedkBufSurfaceCreateParams create_params;
+  CreateBufSurfaceParams(device_id, &create_params);
+  PreprocInput sample;
+  PrepareInput(&create_params, &sample);
+  desc.warmup_data = std::make_shared<InferData>();
+  desc.warmup_data->Set(sample);
+
+  std::unique_ptr<Executor> executor(new Executor(desc, &tp, device_id));
+  uint32_t batch_size = desc.model->BatchSize();
+  EXPECT_EQ(executor->GetWarmUpBatchNum(), desc.engine_num * batch_size);
+  EXPECT_GT(executor->GetWarmUpTime(), 0);
+
+  // request of a full batch, returns latency in milliseconds
+  auto request = [&executor, &sample, batch_size]() -> double {
+    std::promise<void> response_flag;
+    auto empty_response_func = [](Status, PackagePtr) {};
+    auto notifier_func = [&response_flag](const RequestControl *) { response_flag.set_value(); };
+    std::unique_ptr<RequestControl> ctrl(new RequestControl(empty_response_func, notifier_func, "", 0, batch_size));
+    auto input = Package::Create(batch_size);
+    for (uint32_t idx = 0; idx < batch_size; ++idx) {
+      input->data[idx]->Set(sample);
+      input->data[idx]->ctrl = ctrl.get();
+      input->data[idx]->index = idx;
+    }
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(executor->WaitIfCacheFull(-1));
+    EXPECT_TRUE(executor->Upload(std::move(input), ctrl.get()));
+    EXPECT_EQ(response_flag.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    executor->ReleaseCount(batch_size);
+    return latency;
+  };
+
+  double first = request();
+  std::vector<double> steady;
+  for (int i = 0; i < 10; ++i) steady.push_back(request());
+  std::sort(steady.begin(), steady.end());
+  double median = steady[steady.size() / 2];
+  LOG(INFO) << "[EasyDK Tests] [InferServer] Warm up " << executor->GetWarmUpBatchNum() << " batches: "
+            << executor->GetWarmUpTime() << " ms, first request: " << first << " ms, steady state: " << median << " ms";
+  // lazy initialization is done in warm up
+  EXPECT_LT(first, 3 * median + 5);
+  executor.reset();
+  InferServer::ClearModelCache();
+}
+
 }  // namespace infer_server
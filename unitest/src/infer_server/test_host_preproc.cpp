@@ -0,0 +1,410 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_buf_surface_util.hpp"
+#include "cnedk_transform.h"
+#include "cnis/processor.h"
+#include "cnrt.h"
+
+namespace infer_server {
+namespace {
+
+CnedkBufSurface *CreateHostSurface(CnedkBufSurfaceColorFormat fmt, uint32_t width, uint32_t height,
+                                   uint32_t size = 0) {
+  CnedkBufSurfaceCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  params.batch_size = 1;
+  params.width = width;
+  params.height = height;
+  params.size = size;
+  params.color_format = fmt;
+  params.force_align_1 = 1;
+  CnedkBufSurface *surf = nullptr;
+  CnedkBufSurfaceCreate(&surf, &params);
+  // batched inputs of preprocessing are filled
+  if (surf) surf->num_filled = 1;
+  return surf;
+}
+
+// NHWC float by CnedkTransform on host surfaces
+std::vector<float> TransformNHWC(CnedkBufSurface *src, const CnedkTransformRect *src_rect, uint32_t w, uint32_t h,
+                                 CnedkTransformColorFormat color, CnedkTransformMeanStdParams *mean_std,
+                                 CnedkTransformLetterboxParams *letterbox = nullptr) {
+  std::unique_ptr<cnedk::BufSurfaceWrapper> dst(
+      new cnedk::BufSurfaceWrapper(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_TENSOR, w, h, w * h * 3 * 4)));
+  CnedkTransformTensorDesc desc;
+  desc.shape = {1, 3, h, w};
+  desc.data_type = CNEDK_TRANSFORM_FLOAT32;
+  desc.color_format = color;
+  CnedkTransformParams params;
+  memset(&params, 0, sizeof(params));
+  params.transform_flag = CNEDK_TRANSFORM_MEAN_STD;
+  if (src_rect) {
+    params.transform_flag |= CNEDK_TRANSFORM_CROP_SRC;
+    params.src_rect = const_cast<CnedkTransformRect *>(src_rect);
+  }
+  if (letterbox) {
+    params.transform_flag |= CNEDK_TRANSFORM_LETTERBOX;
+    params.letterbox_params = letterbox;
+  }
+  params.mean_std_params = mean_std;
+  params.dst_desc = &desc;
+  EXPECT_EQ(CnedkTransform(src, dst->GetBufSurface(), &params), 0);
+  const float *data = static_cast<const float *>(dst->GetData(0, 0));
+  return std::vector<float>(data, data + w * h * 3);
+}
+
+TEST(InferServer, HostPreprocNCHW) {
+  constexpr uint32_t kW = 30, kH = 20;
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> dis(0, 255);
+  cnedk::BufSurfWrapperPtr src =
+      std::make_shared<cnedk::BufSurfaceWrapper>(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 64, 48));
+  uint8_t *src_data = static_cast<uint8_t *>(src->GetData(0, 0));
+  for (uint32_t i = 0; i < src->GetSurfaceParams(0)->data_size; ++i) src_data[i] = dis(gen);
+  cnedk::BufSurfWrapperPtr dst = std::make_shared<cnedk::BufSurfaceWrapper>(
+      CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_TENSOR, kW, kH, kW * kH * 3 * sizeof(float)));
+  CnedkTransformMeanStdParams mean_std{{103.5f, 116.3f, 123.7f}, {57.4f, 57.1f, 58.4f}};
+
+  HostPreproc preproc(&mean_std);
+  CnPreprocTensorParams params{DimOrder::NCHW, {1, 3, kH, kW}, NetworkInputFormat::BGR, DataType::FLOAT32, 1};
+  ASSERT_EQ(preproc.OnTensorParams(&params), 0);
+
+  const CnedkTransformRect crop{4, 6, 40, 30};
+  for (bool use_crop : {false, true}) {
+    std::vector<CnedkTransformRect> rects;
+    if (use_crop) rects.push_back(crop);
+    ASSERT_EQ(preproc.OnPreproc(src, dst, rects), 0);
+    // same kernel as the device-style NHWC output, only layout differs
+    std::vector<float> ref = TransformNHWC(src->GetBufSurface(), use_crop ? &crop : nullptr, kW, kH,
+                                           CNEDK_TRANSFORM_COLOR_FORMAT_BGR, &mean_std);
+    const float *out = static_cast<const float *>(dst->GetData(0, 0));
+    for (uint32_t c = 0; c < 3; ++c) {
+      for (uint32_t i = 0; i < kW * kH; ++i) ASSERT_FLOAT_EQ(out[c * kW * kH + i], ref[i * 3 + c]) << c << " " << i;
+    }
+  }
+}
+
+TEST(InferServer, HostPreprocLetterbox) {
+  constexpr uint32_t kW = 33, kH = 33;
+  std::mt19937 gen(8);
+  std::uniform_int_distribution<int> dis(0, 255);
+  cnedk::BufSurfWrapperPtr src =
+      std::make_shared<cnedk::BufSurfaceWrapper>(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 64, 36));
+  uint8_t *src_data = static_cast<uint8_t *>(src->GetData(0, 0));
+  for (uint32_t i = 0; i < src->GetSurfaceParams(0)->data_size; ++i) src_data[i] = dis(gen);
+  cnedk::BufSurfWrapperPtr dst = std::make_shared<cnedk::BufSurfaceWrapper>(
+      CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_TENSOR, kW, kH, kW * kH * 3 * sizeof(float)));
+  CnedkTransformMeanStdParams mean_std{{0.f, 0.f, 0.f}, {255.f, 255.f, 255.f}};
+  CnedkTransformLetterboxParams letterbox{{114, 114, 114, 114}};
+
+  HostPreproc preproc(&mean_std, NetworkInputFormat::RGB, &letterbox);
+  CnPreprocTensorParams params{DimOrder::NHWC, {1, kH, kW, 3}, NetworkInputFormat::RGB, DataType::FLOAT32, 1};
+  ASSERT_EQ(preproc.OnTensorParams(&params), 0);
+  ASSERT_EQ(preproc.OnPreproc(src, dst, {}), 0);
+  std::vector<float> ref =
+      TransformNHWC(src->GetBufSurface(), nullptr, kW, kH, CNEDK_TRANSFORM_COLOR_FORMAT_RGB, &mean_std, &letterbox);
+  EXPECT_EQ(memcmp(dst->GetData(0, 0), ref.data(), ref.size() * sizeof(float)), 0);
+  // 64x36 into 33x33 is 33x19 at row 7, the first row is padding
+  EXPECT_FLOAT_EQ(static_cast<const float *>(dst->GetData(0, 0))[0], 114.f / 255.f);
+  EXPECT_FLOAT_EQ(static_cast<const float *>(dst->GetData(0, 0))[(6 * kW + 5) * 3], 114.f / 255.f);
+}
+
+TEST(InferServer, HostPreprocSharedFrame) {
+  constexpr uint32_t kW = 24, kH = 16, kNum = 3;
+  std::mt19937 gen(9);
+  std::uniform_int_distribution<int> dis(0, 255);
+  std::unique_ptr<cnedk::BufSurfaceWrapper> frame(
+      new cnedk::BufSurfaceWrapper(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV21, 64, 48)));
+  uint8_t *frame_data = static_cast<uint8_t *>(frame->GetData(0, 0));
+  for (uint32_t i = 0; i < frame->GetSurfaceParams(0)->data_size; ++i) frame_data[i] = dis(gen);
+
+  // objects of one frame, batched the way the preprocessor does
+  std::vector<CnedkBufSurfaceParams> items(kNum, *frame->GetSurfaceParams(0));
+  CnedkBufSurface batch;
+  memset(&batch, 0, sizeof(batch));
+  batch.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  batch.batch_size = kNum;
+  batch.num_filled = kNum;
+  batch.surface_list = items.data();
+  cnedk::BufSurfWrapperPtr src = std::make_shared<cnedk::BufSurfaceWrapper>(&batch, false);
+
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  create_params.batch_size = kNum;
+  create_params.size = kW * kH * 3 * sizeof(float);
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  CnedkBufSurface *dst_surf = nullptr;
+  ASSERT_EQ(CnedkBufSurfaceCreate(&dst_surf, &create_params), 0);
+  dst_surf->num_filled = kNum;
+  cnedk::BufSurfWrapperPtr dst = std::make_shared<cnedk::BufSurfaceWrapper>(dst_surf);
+
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  HostPreproc preproc(&mean_std);
+  CnPreprocTensorParams params{DimOrder::NHWC, {kNum, kH, kW, 3}, NetworkInputFormat::RGB, DataType::FLOAT32, kNum};
+  ASSERT_EQ(preproc.OnTensorParams(&params), 0);
+  const std::vector<CnedkTransformRect> rects{{4, 6, 40, 30}, {0, 0, 64, 48}, {21, 33, 9, 5}};
+  ASSERT_EQ(preproc.OnPreproc(src, dst, rects), 0);
+  for (uint32_t i = 0; i < kNum; ++i) {
+    std::vector<float> ref = TransformNHWC(frame->GetBufSurface(), &rects[i], kW, kH,
+                                           CNEDK_TRANSFORM_COLOR_FORMAT_RGB, &mean_std);
+    EXPECT_EQ(memcmp(dst->GetData(0, i), ref.data(), ref.size() * sizeof(float)), 0) << "batch_idx " << i;
+  }
+}
+
+TEST(InferServer, HostPreprocSharedDeviceFrame) {
+  constexpr uint32_t kW = 24, kH = 16, kNum = 3;
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<int> dis(0, 255);
+  std::unique_ptr<cnedk::BufSurfaceWrapper> frame(
+      new cnedk::BufSurfaceWrapper(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 64, 48)));
+  uint8_t *frame_data = static_cast<uint8_t *>(frame->GetData(0, 0));
+  for (uint32_t i = 0; i < frame->GetSurfaceParams(0)->data_size; ++i) frame_data[i] = dis(gen);
+
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.mem_type = CNEDK_BUF_MEM_DEVICE;
+  create_params.batch_size = 1;
+  create_params.width = 64;
+  create_params.height = 48;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  create_params.force_align_1 = 1;
+  CnedkBufSurface *dev_surf = nullptr;
+  ASSERT_EQ(CnedkBufSurfaceCreate(&dev_surf, &create_params), 0);
+  std::unique_ptr<cnedk::BufSurfaceWrapper> dev_frame(new cnedk::BufSurfaceWrapper(dev_surf));
+  ASSERT_EQ(dev_surf->surface_list[0].data_size, frame->GetSurfaceParams(0)->data_size);
+  ASSERT_EQ(cnrtMemcpy(dev_surf->surface_list[0].data_ptr, frame_data, dev_surf->surface_list[0].data_size,
+                       cnrtMemcpyHostToDev), cnrtSuccess);
+
+  // objects of one frame on device, batched the way the preprocessor does
+  std::vector<CnedkBufSurfaceParams> items(kNum, dev_surf->surface_list[0]);
+  CnedkBufSurface batch;
+  memset(&batch, 0, sizeof(batch));
+  batch.mem_type = CNEDK_BUF_MEM_DEVICE;
+  batch.batch_size = kNum;
+  batch.num_filled = kNum;
+  batch.surface_list = items.data();
+  cnedk::BufSurfWrapperPtr src = std::make_shared<cnedk::BufSurfaceWrapper>(&batch, false);
+
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  create_params.batch_size = kNum;
+  create_params.width = 0;
+  create_params.height = 0;
+  create_params.size = kW * kH * 3 * sizeof(float);
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  CnedkBufSurface *dst_surf = nullptr;
+  ASSERT_EQ(CnedkBufSurfaceCreate(&dst_surf, &create_params), 0);
+  dst_surf->num_filled = kNum;
+  cnedk::BufSurfWrapperPtr dst = std::make_shared<cnedk::BufSurfaceWrapper>(dst_surf);
+
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  HostPreproc preproc(&mean_std);
+  CnPreprocTensorParams params{DimOrder::NHWC, {kNum, kH, kW, 3}, NetworkInputFormat::RGB, DataType::FLOAT32, kNum};
+  ASSERT_EQ(preproc.OnTensorParams(&params), 0);
+  const std::vector<CnedkTransformRect> rects{{4, 6, 40, 30}, {0, 0, 64, 48}, {21, 33, 9, 5}};
+  ASSERT_EQ(preproc.OnPreproc(src, dst, rects), 0);
+  // the frame is copied to host once for all of its objects
+  EXPECT_NE(items[0].mapped_data_ptr, nullptr);
+  for (uint32_t i = 1; i < kNum; ++i) EXPECT_EQ(items[i].mapped_data_ptr, nullptr) << "batch_idx " << i;
+  for (uint32_t i = 0; i < kNum; ++i) {
+    std::vector<float> ref = TransformNHWC(frame->GetBufSurface(), &rects[i], kW, kH,
+                                           CNEDK_TRANSFORM_COLOR_FORMAT_RGB, &mean_std);
+    EXPECT_EQ(memcmp(dst->GetData(0, i), ref.data(), ref.size() * sizeof(float)), 0) << "batch_idx " << i;
+  }
+}
+
+TEST(InferServer, HostPreprocUnsupported) {
+  HostPreproc preproc;
+  cnedk::BufSurfWrapperPtr src =
+      std::make_shared<cnedk::BufSurfaceWrapper>(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 64, 48));
+  cnedk::BufSurfWrapperPtr dst =
+      std::make_shared<cnedk::BufSurfaceWrapper>(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_TENSOR, 8, 8, 8 * 8 * 3));
+  // tensor params are not set
+  EXPECT_NE(preproc.OnPreproc(src, dst, {}), 0);
+
+  CnPreprocTensorParams params{DimOrder::NHWC, {1, 8, 8, 4}, NetworkInputFormat::RGB, DataType::UINT8, 1};
+  EXPECT_NE(preproc.OnTensorParams(&params), 0);
+  params.input_shape = {1, 8, 8, 3};
+  params.input_dtype = DataType::INT32;
+  EXPECT_NE(preproc.OnTensorParams(&params), 0);
+  params.input_dtype = DataType::UINT8;
+  params.input_format = NetworkInputFormat::GRAY;
+  EXPECT_NE(preproc.OnTensorParams(&params), 0);
+  params.input_format = NetworkInputFormat::TENSOR;
+  EXPECT_EQ(preproc.OnTensorParams(&params), 0);
+  EXPECT_EQ(preproc.OnPreproc(src, dst, {}), 0);
+
+  // integer input needs quantization, per-tensor or per-channel
+  params.input_dtype = DataType::INT8;
+  EXPECT_NE(preproc.OnTensorParams(&params), 0);
+  params.input_quant = QuantParams{{1.f, 2.f}, {}};
+  EXPECT_NE(preproc.OnTensorParams(&params), 0);
+  params.input_quant = QuantParams{{1.f}, {1, 2}};
+  EXPECT_NE(preproc.OnTensorParams(&params), 0);
+  params.input_quant = QuantParams{{0.f}, {}};
+  EXPECT_NE(preproc.OnTensorParams(&params), 0);
+  params.input_quant = QuantParams{{1.f}, {128}};
+  EXPECT_NE(preproc.OnTensorParams(&params), 0);
+  params.input_dtype = DataType::INT16;
+  EXPECT_EQ(preproc.OnTensorParams(&params), 0);
+}
+
+// runs preproc into an int8 / int16 model input from a source of one color, rows are long enough for simd and tail
+template <typename Q>
+std::vector<Q> QuantizeColor(HostPreproc *preproc, CnPreprocTensorParams *params, const uint8_t (&color)[3]) {
+  constexpr uint32_t kW = 19, kH = 3;
+  cnedk::BufSurfWrapperPtr src =
+      std::make_shared<cnedk::BufSurfaceWrapper>(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_RGB, 16, 8));
+  uint8_t *src_data = static_cast<uint8_t *>(src->GetData(0, 0));
+  for (uint32_t i = 0; i < 16 * 8; ++i) memcpy(src_data + i * 3, color, 3);
+  cnedk::BufSurfWrapperPtr dst = std::make_shared<cnedk::BufSurfaceWrapper>(
+      CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_TENSOR, kW, kH, kW * kH * 3 * sizeof(Q)));
+  params->input_dtype = sizeof(Q) == 1 ? DataType::INT8 : DataType::INT16;
+  params->input_shape = params->input_order == DimOrder::NHWC ? std::vector<int>{1, kH, kW, 3}
+                                                              : std::vector<int>{1, 3, kH, kW};
+  EXPECT_EQ(preproc->OnTensorParams(params), 0);
+  EXPECT_EQ(preproc->OnPreproc(src, dst, {}), 0);
+  const Q *out = static_cast<const Q *>(dst->GetData(0, 0));
+  return std::vector<Q>(out, out + kW * kH * 3);
+}
+
+// every pixel of NHWC / NCHW output is expected
+template <typename Q>
+void ExpectPixels(const std::vector<Q> &out, bool nchw, const std::vector<int> &expected) {
+  const size_t pixels = out.size() / 3;
+  for (size_t i = 0; i < pixels; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      ASSERT_EQ(out[nchw ? c * pixels + i : i * 3 + c], expected[c]) << "pixel " << i << ", channel " << c;
+    }
+  }
+}
+
+TEST(InferServer, HostPreprocQuantizeRounding) {
+  const uint8_t color[3] = {5, 7, 255};
+  CnPreprocTensorParams params{DimOrder::NHWC, {}, NetworkInputFormat::RGB, DataType::INT8, 1};
+  // x / scale + zero point: ties go to even before the zero point is added, and out of range values saturate
+  QuantParams half_scale{{2.f}, {}};
+  HostPreproc preproc(nullptr, NetworkInputFormat::RGB, nullptr, &half_scale);
+  ExpectPixels(QuantizeColor<int8_t>(&preproc, &params, color), false, {2, 4, 127});
+  // quantization of model comes first
+  params.input_quant = QuantParams{{2.f}, {-3}};
+  ExpectPixels(QuantizeColor<int8_t>(&preproc, &params, color), false, {-1, 1, 125});
+
+  // per-channel, NCHW
+  params.input_order = DimOrder::NCHW;
+  params.input_quant = QuantParams{{0.5f, 1.f, 4.f}, {-128, 10, 0}};
+  const uint8_t color2[3] = {200, 0, 2};
+  ExpectPixels(QuantizeColor<int8_t>(&preproc, &params, color2), true, {127, 10, 0});
+
+  // fused with mean std, negative ties and the lower bound
+  CnedkTransformMeanStdParams mean_std{{255.f, 13.f, 0.f}, {1.f, 2.f, 1.f}};
+  HostPreproc normalized(&mean_std);
+  params.input_quant = QuantParams{{1.f}, {0}};
+  const uint8_t color3[3] = {5, 8, 3};
+  ExpectPixels(QuantizeColor<int8_t>(&normalized, &params, color3), true, {-128, -2, 3});
+
+  // int16, channel order of BGR model input
+  params.input_order = DimOrder::NHWC;
+  params.input_format = NetworkInputFormat::BGR;
+  params.input_quant = QuantParams{{0.01f, 0.01f, 0.01f}, {10000, 0, -32768}};
+  const uint8_t color4[3] = {1, 3, 255};
+  ExpectPixels(QuantizeColor<int16_t>(&preproc, &params, color4), false, {32767, 300, -32668});
+}
+
+TEST(InferServer, HostPreprocQuantizeSameAsFloat) {
+  constexpr uint32_t kW = 45, kH = 31;
+  std::mt19937 gen(10);
+  std::uniform_int_distribution<int> dis(0, 255);
+  cnedk::BufSurfWrapperPtr src =
+      std::make_shared<cnedk::BufSurfaceWrapper>(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 64, 48));
+  uint8_t *src_data = static_cast<uint8_t *>(src->GetData(0, 0));
+  for (uint32_t i = 0; i < src->GetSurfaceParams(0)->data_size; ++i) src_data[i] = dis(gen);
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  std::vector<float> ref = TransformNHWC(src->GetBufSurface(), nullptr, kW, kH, CNEDK_TRANSFORM_COLOR_FORMAT_RGB,
+                                         &mean_std);
+
+  const QuantParams quant{{0.02f, 0.017f, 0.03f}, {3, -7, 0}};
+  HostPreproc preproc(&mean_std);
+  for (DataType dtype : {DataType::INT8, DataType::INT16}) {
+    const size_t elem = dtype == DataType::INT8 ? 1 : 2;
+    cnedk::BufSurfWrapperPtr dst = std::make_shared<cnedk::BufSurfaceWrapper>(
+        CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_TENSOR, kW, kH, kW * kH * 3 * elem));
+    CnPreprocTensorParams params{DimOrder::NHWC, {1, kH, kW, 3}, NetworkInputFormat::RGB, dtype, 1, quant};
+    ASSERT_EQ(preproc.OnTensorParams(&params), 0);
+    ASSERT_EQ(preproc.OnPreproc(src, dst, {}), 0);
+    const int lo = dtype == DataType::INT8 ? -128 : -32768, hi = dtype == DataType::INT8 ? 127 : 32767;
+    for (size_t i = 0; i < ref.size(); ++i) {
+      const int c = i % 3;
+      const int q = static_cast<int>(std::nearbyint(ref[i] / quant.scale[c])) + quant.zero_point[c];
+      const int expected = std::min(std::max(q, lo), hi);
+      const int out = elem == 1 ? static_cast<const int8_t *>(dst->GetData(0, 0))[i]
+                                : static_cast<const int16_t *>(dst->GetData(0, 0))[i];
+      // the scale is fused into normalization, ties may be rounded to the other side
+      ASSERT_NEAR(out, expected, 1) << "index " << i;
+    }
+  }
+}
+
+TEST(InferServer, HostPreprocQuantizeBenchmark) {
+  constexpr uint32_t kW = 640, kH = 640;
+  constexpr int loop = 10;
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<int> dis(0, 255);
+  cnedk::BufSurfWrapperPtr src =
+      std::make_shared<cnedk::BufSurfaceWrapper>(CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080));
+  uint8_t *src_data = static_cast<uint8_t *>(src->GetData(0, 0));
+  for (uint32_t i = 0; i < src->GetSurfaceParams(0)->data_size; ++i) src_data[i] = dis(gen);
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  const QuantParams quant{{0.02f, 0.02f, 0.02f}, {0, 0, 0}};
+  HostPreproc preproc(&mean_std, NetworkInputFormat::RGB, nullptr, &quant);
+  const std::pair<DataType, const char *> dtypes[] = {
+      {DataType::FLOAT32, "float32"}, {DataType::INT8, "int8"}, {DataType::INT16, "int16"}};
+  for (const auto &dtype_name : dtypes) {
+    const DataType dtype = dtype_name.first;
+    cnedk::BufSurfWrapperPtr dst = std::make_shared<cnedk::BufSurfaceWrapper>(
+        CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_TENSOR, kW, kH, kW * kH * 3 * GetTypeSize(dtype)));
+    CnPreprocTensorParams params{DimOrder::NCHW, {1, 3, kH, kW}, NetworkInputFormat::RGB, dtype, 1};
+    ASSERT_EQ(preproc.OnTensorParams(&params), 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int l = 0; l < loop; ++l) ASSERT_EQ(preproc.OnPreproc(src, dst, {}), 0);
+    std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+    LOG(INFO) << "[EasyDK Tests] [InferServer] HostPreproc NV12 1920x1080 -> NCHW " << kW << "x" << kH << " "
+              << dtype_name.second << " with mean std: " << dura.count() / loop << " ms";
+  }
+}
+
+}  // namespace
+}  // namespace infer_server
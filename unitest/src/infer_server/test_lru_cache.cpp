@@ -0,0 +1,137 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/lru_cache.h"
+
+namespace infer_server {
+namespace {
+
+// stands in for Model, charged by bytes it holds
+struct FakeModel {
+  explicit FakeModel(size_t b) : bytes(b) {}
+  size_t bytes;
+};
+
+using FakeModelPtr = std::shared_ptr<FakeModel>;
+
+class LruCacheTest : public testing::Test {
+ protected:
+  LruCacheTest()
+      : cache_([](const FakeModelPtr& m) { return m->bytes; },
+               [](const FakeModelPtr& m) { return m.use_count() > 1; }) {}
+
+  void Put(const std::string& key, size_t bytes) { cache_.Put(key, std::make_shared<FakeModel>(bytes)); }
+
+  LruCache<std::string, FakeModelPtr> cache_;
+};
+
+TEST_F(LruCacheTest, EvictLeastRecentlyUsed) {
+  Put("a", 100);
+  Put("b", 100);
+  Put("c", 100);
+  EXPECT_EQ(cache_.Bytes(), 300u);
+  // a is hot
+  ASSERT_TRUE(cache_.Get("a"));
+  EXPECT_EQ(cache_.Keys(), (std::vector<std::string>{"a", "c", "b"}));
+
+  auto evicted = cache_.Evict(200, 10);
+  ASSERT_EQ(evicted.size(), 1u);
+  EXPECT_FALSE(cache_.Get("b"));
+  EXPECT_EQ(cache_.Keys(), (std::vector<std::string>{"a", "c"}));
+
+  evicted = cache_.Evict(200, 1);
+  ASSERT_EQ(evicted.size(), 1u);
+  EXPECT_EQ(cache_.Keys(), (std::vector<std::string>{"a"}));
+}
+
+TEST_F(LruCacheTest, ChargeByBytes) {
+  Put("detector", 3000);
+  Put("classifier_0", 10);
+  Put("classifier_1", 10);
+  Put("classifier_2", 10);
+  // one large cold model is evicted instead of many small ones
+  auto evicted = cache_.Evict(1000, 10);
+  ASSERT_EQ(evicted.size(), 1u);
+  EXPECT_EQ(evicted[0]->bytes, 3000u);
+  EXPECT_EQ(cache_.Size(), 3u);
+  EXPECT_EQ(cache_.Bytes(), 30u);
+
+  // charge is evaluated on eviction, it may grow after insertion
+  FakeModelPtr m = cache_.Get("classifier_0");
+  m->bytes = 2000;
+  m.reset();
+  evicted = cache_.Evict(2000, 10);
+  ASSERT_EQ(evicted.size(), 2u);
+  EXPECT_EQ(evicted[0]->bytes, 10u);
+  EXPECT_EQ(evicted[1]->bytes, 10u);
+  EXPECT_EQ(cache_.Keys(), (std::vector<std::string>{"classifier_0"}));
+  evicted = cache_.Evict(1000, 10);
+  ASSERT_EQ(evicted.size(), 1u);
+  EXPECT_EQ(cache_.Size(), 0u);
+}
+
+TEST_F(LruCacheTest, NeverEvictPinned) {
+  Put("a", 100);
+  Put("b", 100);
+  FakeModelPtr in_use = cache_.Get("a");
+  Put("c", 100);
+
+  auto evicted = cache_.Evict(0, 0);
+  EXPECT_EQ(evicted.size(), 2u);
+  EXPECT_EQ(cache_.Keys(), (std::vector<std::string>{"a"}));
+  EXPECT_EQ(cache_.Get("a"), in_use);
+
+  // unpinned after released
+  in_use.reset();
+  evicted = cache_.Evict(0, 0);
+  EXPECT_EQ(evicted.size(), 1u);
+  EXPECT_EQ(cache_.Size(), 0u);
+}
+
+TEST_F(LruCacheTest, PutEraseClear) {
+  Put("a", 100);
+  Put("b", 100);
+  // replace value, and the entry becomes the most recently used
+  Put("a", 50);
+  EXPECT_EQ(cache_.Size(), 2u);
+  EXPECT_EQ(cache_.Bytes(), 150u);
+  EXPECT_EQ(cache_.Keys(), (std::vector<std::string>{"a", "b"}));
+
+  // pinned entry could be erased explicitly
+  FakeModelPtr in_use = cache_.Get("b");
+  EXPECT_TRUE(cache_.Erase("b"));
+  EXPECT_FALSE(cache_.Erase("b"));
+  EXPECT_EQ(cache_.Size(), 1u);
+  EXPECT_EQ(in_use->bytes, 100u);
+
+  cache_.Clear();
+  EXPECT_EQ(cache_.Size(), 0u);
+  EXPECT_EQ(cache_.Bytes(), 0u);
+  EXPECT_TRUE(cache_.Evict(0, 0).empty());
+}
+
+}  // namespace
+}  // namespace infer_server
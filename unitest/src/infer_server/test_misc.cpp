@@ -33,6 +33,7 @@ TEST(InferServer, DataTypeSize) {
   EXPECT_EQ(GetTypeSize(DataType::FLOAT32), 4u);
   EXPECT_EQ(GetTypeSize(DataType::INT32), 4u);
   EXPECT_EQ(GetTypeSize(DataType::INT16), 2u);
+  EXPECT_EQ(GetTypeSize(DataType::INT8), 1u);
 }
 
 TEST(InferServer, PredictorBackend) { EXPECT_EQ(Predictor::Backend(), std::string("magicmind")); }
@@ -23,6 +23,7 @@
 
 #include <chrono>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -60,5 +61,98 @@ TEST_F(InferServerTestAPI, ModelManager) {
   EXPECT_EQ(ModelManager::Instance()->CacheSize(), 0);
 }
 
+TEST_F(InferServerTestAPI, PreloadModel) {
+  InferServer::ClearModelCache();
+  constexpr int kEngineNum = 2;
+  auto create_session = [this](ModelPtr model) {
+    SessionDesc desc;
+    desc.name = "test preload model";
+    desc.model = model;
+    desc.preproc = std::make_shared<TestProcessor>();
+    desc.engine_num = kEngineNum;
+    desc.show_perf = false;
+    return server_->CreateSyncSession(desc);
+  };
+
+  // engine and runners are created in CreateSession
+  auto model = server_->LoadModel(GetModelInfoStr("resnet50", "url"));
+  ASSERT_TRUE(model);
+  EXPECT_EQ(ModelManager::Instance()->GetModel(model->GetKey())->PreparedRunnerNum(device_id_), 0u);
+  Session_t session = create_session(model);
+  ASSERT_TRUE(session);
+  server_->DestroySession(session);
+  model.reset();
+  InferServer::ClearModelCache();
+
+  // CreateSession picks up runners prepared in background, no runner is created on the way
+  auto preloaded = InferServer::PreloadModel(GetModelInfoStr("resnet50", "url"), {}, {device_id_}, kEngineNum);
+  ASSERT_EQ(preloaded.wait_for(std::chrono::seconds(60)), std::future_status::ready);
+  model = preloaded.get();
+  ASSERT_TRUE(model);
+  EXPECT_EQ(ModelManager::Instance()->CacheSize(), 1);
+  std::shared_ptr<Model> m = ModelManager::Instance()->GetModel(model->GetKey());
+  ASSERT_TRUE(m);
+  EXPECT_EQ(m->PreparedRunnerNum(device_id_), static_cast<size_t>(kEngineNum));
+  EXPECT_EQ(m->CreatedRunnerNum(), static_cast<size_t>(kEngineNum));
+  session = create_session(model);
+  ASSERT_TRUE(session);
+  EXPECT_EQ(m->PreparedRunnerNum(device_id_), 0u);
+  EXPECT_EQ(m->CreatedRunnerNum(), static_cast<size_t>(kEngineNum));
+  server_->DestroySession(session);
+
+  EXPECT_FALSE(InferServer::PreloadModel("not_exist_model").get());
+  m.reset();
+  InferServer::ClearModelCache();
+}
+
+TEST_F(InferServerTestAPI, ModelMetaCache) {
+  char tmpl[] = "/tmp/cnis_model_meta_XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl));
+  std::string meta_dir = tmpl;
+  ASSERT_EQ(setenv("CNIS_MODEL_META_DIR", meta_dir.c_str(), 1), 0);
+  InferServer::ClearModelCache();
+  auto load = []() { return InferServer::LoadModel(GetModelInfoStr("resnet50", "url")); };
+
+  // model info is extracted by engine and persisted
+  ModelPtr cold = load();
+  ASSERT_TRUE(cold);
+  EXPECT_FALSE(ModelManager::Instance()->GetModel(cold->GetKey())->MetaCached());
+  InferServer::ClearModelCache();
+
+  // model info is taken from meta, engine is built in background
+  ModelPtr warm = load();
+  ASSERT_TRUE(warm);
+  EXPECT_TRUE(ModelManager::Instance()->GetModel(warm->GetKey())->MetaCached());
+  EXPECT_EQ(warm->BatchSize(), cold->BatchSize());
+  ASSERT_EQ(warm->InputNum(), cold->InputNum());
+  ASSERT_EQ(warm->OutputNum(), cold->OutputNum());
+  for (uint32_t i = 0; i < warm->InputNum(); ++i) {
+    EXPECT_EQ(warm->InputShape(i), cold->InputShape(i));
+    EXPECT_EQ(warm->InputLayout(i).dtype, cold->InputLayout(i).dtype);
+    EXPECT_EQ(warm->InputLayout(i).order, cold->InputLayout(i).order);
+  }
+  for (uint32_t i = 0; i < warm->OutputNum(); ++i) {
+    EXPECT_EQ(warm->OutputShape(i), cold->OutputShape(i));
+    EXPECT_EQ(warm->OutputLayout(i).dtype, cold->OutputLayout(i).dtype);
+    EXPECT_EQ(warm->OutputLayout(i).order, cold->OutputLayout(i).order);
+  }
+
+  // session waits for engine built in background
+  SessionDesc desc;
+  desc.name = "test model meta cache";
+  desc.model = warm;
+  desc.preproc = std::make_shared<TestProcessor>();
+  desc.show_perf = false;
+  Session_t session = server_->CreateSyncSession(desc);
+  ASSERT_TRUE(session);
+  server_->DestroySession(session);
+
+  cold.reset();
+  warm.reset();
+  InferServer::ClearModelCache();
+  unsetenv("CNIS_MODEL_META_DIR");
+  ASSERT_EQ(system(("rm -rf " + meta_dir).c_str()), 0);
+}
+
 }  // namespace
 }  // namespace infer_server
@@ -0,0 +1,220 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "model/model_file.h"
+
+namespace infer_server {
+namespace {
+
+class ModelFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    char tmpl[] = "/tmp/cnis_model_file_XXXXXX";
+    ASSERT_TRUE(mkdtemp(tmpl));
+    dir_ = tmpl;
+    ClearFileContentKeys();
+  }
+
+  void TearDown() override {
+    for (auto& file : files_) unlink(file.c_str());
+    rmdir(dir_.c_str());
+    ClearFileContentKeys();
+  }
+
+  std::string Path(const std::string& name) {
+    files_.push_back(dir_ + "/" + name);
+    return files_.back();
+  }
+
+  std::string Write(const std::string& name, const std::vector<char>& data) {
+    std::string path = Path(name);
+    std::ofstream f(path, std::ios::binary);
+    f.write(data.data(), data.size());
+    return path;
+  }
+
+  static std::vector<char> FakeModelData(size_t size, char seed) {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; ++i) data[i] = static_cast<char>(i * 131 + seed);
+    return data;
+  }
+
+  static std::string Key(const std::string& path, bool* mapped = nullptr) {
+    std::string key;
+    std::shared_ptr<MappedFile> file;
+    EXPECT_TRUE(FileContentKey(path, &key, &file));
+    if (mapped) *mapped = file != nullptr;
+    return key;
+  }
+
+  std::string dir_;
+  std::vector<std::string> files_;
+};
+
+TEST_F(ModelFileTest, HashBytes) {
+  // known answers of XXH64 with seed 0
+  EXPECT_EQ(HashBytes("", 0), 0xEF46DB3751D8E999ULL);
+  EXPECT_EQ(HashBytes("abc", 3), 0x44BC2CF5AD770999ULL);
+  const char* text = "Nobody inspects the spammish repetition";
+  EXPECT_EQ(HashBytes(text, strlen(text)), 0xFBCEA83C8A378BF1ULL);
+}
+
+TEST_F(ModelFileTest, Sha256) {
+  // known answers of FIPS 180-2, the second one takes two blocks of padding
+  EXPECT_EQ(Sha256Hex("", 0), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  EXPECT_EQ(Sha256Hex("abc", 3), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  const char* text = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  EXPECT_EQ(Sha256Hex(text, strlen(text)), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  std::vector<char> data = FakeModelData(1000, 7);
+  EXPECT_EQ(Sha256Hex(data.data(), data.size()), "533b698850849b7908b20a22658f639c0b2a476f1791f85f50188287c31a9aba");
+}
+
+TEST_F(ModelFileTest, MapFile) {
+  std::vector<char> data = FakeModelData(10000, 1);
+  std::string path = Write("model", data);
+  auto file = MappedFile::Open(path);
+  ASSERT_TRUE(file);
+  EXPECT_EQ(file->Path(), path);
+  ASSERT_EQ(file->Size(), data.size());
+  EXPECT_EQ(memcmp(file->Data(), data.data(), data.size()), 0);
+
+  EXPECT_FALSE(MappedFile::Open(Path("not_exist")));
+  EXPECT_FALSE(MappedFile::Open(Write("empty", {})));
+  std::string key;
+  std::shared_ptr<MappedFile> mapped;
+  EXPECT_FALSE(FileContentKey(dir_ + "/not_exist", &key, &mapped));
+}
+
+TEST_F(ModelFileTest, Aliasing) {
+  std::vector<char> data = FakeModelData(100000, 2);
+  std::string path = Write("model", data);
+  std::string key = Key(path);
+
+  // symlink and hard link
+  std::string symlink_path = Path("symlink");
+  ASSERT_EQ(symlink(path.c_str(), symlink_path.c_str()), 0);
+  EXPECT_EQ(Key(symlink_path), key);
+  std::string link_path = Path("link");
+  ASSERT_EQ(link(path.c_str(), link_path.c_str()), 0);
+  EXPECT_EQ(Key(link_path), key);
+  // copy
+  EXPECT_EQ(Key(Write("copy", data)), key);
+  // same bytes at different addresses
+  std::vector<char> another(data);
+  ASSERT_NE(another.data(), data.data());
+  EXPECT_EQ(ContentKey(another.data(), another.size()), key);
+  EXPECT_EQ(ContentKey(data.data(), data.size()), key);
+
+  // different content
+  std::vector<char> modified(data);
+  modified[data.size() / 2] ^= 1;
+  EXPECT_NE(Key(Write("modified", modified)), key);
+  EXPECT_NE(ContentKey(data.data(), data.size() - 1), key);
+  EXPECT_NE(Key(Write("other", FakeModelData(100000, 3))), key);
+}
+
+TEST_F(ModelFileTest, Memoize) {
+  std::string path = Write("model", FakeModelData(4096, 4));
+  bool mapped = false;
+  std::string key = Key(path, &mapped);
+  EXPECT_TRUE(mapped);
+  // repeat opens do not read the file
+  EXPECT_EQ(Key(path, &mapped), key);
+  EXPECT_FALSE(mapped);
+  std::string symlink_path = Path("symlink");
+  ASSERT_EQ(symlink(path.c_str(), symlink_path.c_str()), 0);
+  EXPECT_EQ(Key(symlink_path, &mapped), key);
+  EXPECT_FALSE(mapped);
+
+  // modified file is hashed again
+  Write("model", FakeModelData(4096 + 1, 4));
+  std::string new_key = Key(path, &mapped);
+  EXPECT_TRUE(mapped);
+  EXPECT_NE(new_key, key);
+
+  ClearFileContentKeys();
+  EXPECT_EQ(Key(path, &mapped), new_key);
+  EXPECT_TRUE(mapped);
+}
+
+TEST_F(ModelFileTest, MemoizeBounded) {
+  std::vector<std::string> paths;
+  for (size_t i = 0; i <= kMaxFileContentKeys; ++i) {
+    paths.push_back(Write("model_" + std::to_string(i), FakeModelData(64 + i, 5)));
+  }
+  bool mapped = false;
+  Key(paths[0], &mapped);
+  EXPECT_TRUE(mapped);
+  for (size_t i = 1; i < kMaxFileContentKeys; ++i) Key(paths[i]);
+  // the least recently used key is dropped
+  Key(paths[0], &mapped);
+  EXPECT_FALSE(mapped);
+  Key(paths[kMaxFileContentKeys], &mapped);
+  EXPECT_TRUE(mapped);
+  Key(paths[1], &mapped);
+  EXPECT_TRUE(mapped);
+  Key(paths[0], &mapped);
+  EXPECT_FALSE(mapped);
+}
+
+TEST_F(ModelFileTest, StartupBenchmark) {
+  constexpr int kModelNum = 8;
+  constexpr size_t kModelSize = 32 << 20;
+  std::vector<std::string> paths;
+  for (int i = 0; i < kModelNum; ++i) {
+    paths.push_back(Write("model_" + std::to_string(i), FakeModelData(kModelSize, i)));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto& path : paths) {
+    std::ifstream f(path, std::ios::binary);
+    std::vector<char> buffer(kModelSize);
+    f.read(buffer.data(), buffer.size());
+  }
+  std::chrono::duration<double, std::milli> read_time = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (auto& path : paths) Key(path);
+  std::chrono::duration<double, std::milli> hash_time = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (auto& path : paths) Key(path);
+  std::chrono::duration<double, std::milli> memo_time = std::chrono::steady_clock::now() - start;
+
+  LOG(INFO) << "[EasyDK Tests] [ModelFile] " << kModelNum << " models of " << (kModelSize >> 20) << " MB, "
+            << "read whole file: " << read_time.count() << " ms, map and hash: " << hash_time.count()
+            << " ms, memoized: " << memo_time.count() << " ms";
+  EXPECT_LT(memo_time.count(), hash_time.count());
+}
+
+}  // namespace
+}  // namespace infer_server
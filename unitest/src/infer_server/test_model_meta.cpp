@@ -0,0 +1,178 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "model/model_meta.h"
+
+namespace infer_server {
+namespace {
+
+constexpr uint32_t kRuntimeVersion = 1000;
+
+class ModelMetaTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    char tmpl[] = "/tmp/cnis_model_meta_XXXXXX";
+    ASSERT_TRUE(mkdtemp(tmpl));
+    dir_ = tmpl;
+  }
+
+  void TearDown() override {
+    ASSERT_EQ(system(("rm -rf " + dir_).c_str()), 0);
+  }
+
+  static ModelMeta FakeMeta(uint32_t batch_size) {
+    ModelMeta meta;
+    meta.batch_size = batch_size;
+    meta.input_shapes.push_back(Shape({batch_size, 3, 224, 224}));
+    meta.input_layouts.push_back(DataLayout{DataType::UINT8, DimOrder::NHWC});
+    meta.output_shapes.push_back(Shape({batch_size, 1000}));
+    meta.output_shapes.push_back(Shape({batch_size, 7, 7, 256}));
+    meta.output_layouts.push_back(DataLayout{DataType::FLOAT32, DimOrder::NCHW});
+    meta.output_layouts.push_back(DataLayout{DataType::FLOAT16, DimOrder::NHWC});
+    return meta;
+  }
+
+  static void ExpectEqual(const ModelMeta& a, const ModelMeta& b) {
+    EXPECT_EQ(a.batch_size, b.batch_size);
+    EXPECT_EQ(a.input_shapes, b.input_shapes);
+    EXPECT_EQ(a.output_shapes, b.output_shapes);
+    ASSERT_EQ(a.input_layouts.size(), b.input_layouts.size());
+    for (size_t i = 0; i < a.input_layouts.size(); ++i) {
+      EXPECT_EQ(a.input_layouts[i].dtype, b.input_layouts[i].dtype);
+      EXPECT_EQ(a.input_layouts[i].order, b.input_layouts[i].order);
+    }
+    ASSERT_EQ(a.output_layouts.size(), b.output_layouts.size());
+    for (size_t i = 0; i < a.output_layouts.size(); ++i) {
+      EXPECT_EQ(a.output_layouts[i].dtype, b.output_layouts[i].dtype);
+      EXPECT_EQ(a.output_layouts[i].order, b.output_layouts[i].order);
+    }
+  }
+
+  static std::string Read(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  }
+
+  static void Write(const std::string& path, const std::string& bytes) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(bytes.data(), bytes.size());
+  }
+
+  std::string dir_;
+};
+
+TEST_F(ModelMetaTest, RoundTrip) {
+  ModelMetaCache cache(dir_ + "/a/b", kRuntimeVersion);
+  ModelMeta meta = FakeMeta(4), loaded;
+  EXPECT_FALSE(cache.Load("model_key", &loaded));
+  // directory is created
+  ASSERT_TRUE(cache.Store("model_key", meta));
+  ASSERT_TRUE(cache.Load("model_key", &loaded));
+  ExpectEqual(meta, loaded);
+  EXPECT_EQ(access((dir_ + "/a/b").c_str(), F_OK), 0);
+
+  // mutable dimensions are kept
+  meta.input_shapes[0] = Shape({-1, 3, -1, -1});
+  ASSERT_TRUE(cache.Store("another_key", meta));
+  ASSERT_TRUE(cache.Load("another_key", &loaded));
+  ExpectEqual(meta, loaded);
+  EXPECT_NE(cache.Path("model_key"), cache.Path("another_key"));
+
+  // loaded by another cache on the same directory
+  ModelMetaCache another(dir_ + "/a/b", kRuntimeVersion);
+  ASSERT_TRUE(another.Load("model_key", &loaded));
+  ExpectEqual(FakeMeta(4), loaded);
+}
+
+TEST_F(ModelMetaTest, Invalidation) {
+  ModelMetaCache cache(dir_, kRuntimeVersion);
+  ModelMeta meta = FakeMeta(8), loaded;
+  std::string bytes = cache.Serialize("model_key", meta);
+  ASSERT_TRUE(cache.Parse(bytes, "model_key", &loaded));
+
+  // another model, or model with other input shapes
+  EXPECT_FALSE(cache.Parse(bytes, "model_key_[1, 3, 224, 224]", &loaded));
+  // runtime upgraded
+  EXPECT_FALSE(ModelMetaCache(dir_, kRuntimeVersion + 1).Parse(bytes, "model_key", &loaded));
+  // format changed, version follows magic
+  std::string other_format = bytes;
+  other_format[8] ^= 0x1;
+  EXPECT_FALSE(cache.Parse(other_format, "model_key", &loaded));
+  // any byte broken
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    std::string broken = bytes;
+    broken[i] ^= 0x20;
+    EXPECT_FALSE(cache.Parse(broken, "model_key", &loaded)) << i;
+  }
+  // truncated or extended
+  for (size_t size = 0; size < bytes.size(); ++size) {
+    EXPECT_FALSE(cache.Parse(bytes.substr(0, size), "model_key", &loaded)) << size;
+  }
+  EXPECT_FALSE(cache.Parse(bytes + 'x', "model_key", &loaded));
+  ExpectEqual(meta, loaded);
+
+  // invalid file is a miss and replaced by the next store
+  std::string path = cache.Path("model_key");
+  Write(path, bytes.substr(0, bytes.size() / 2));
+  EXPECT_FALSE(cache.Load("model_key", &loaded));
+  ASSERT_TRUE(cache.Store("model_key", meta));
+  EXPECT_EQ(Read(path), bytes);
+  ASSERT_TRUE(cache.Load("model_key", &loaded));
+
+  // stale meta is replaced
+  ASSERT_TRUE(cache.Store("model_key", FakeMeta(16)));
+  ASSERT_TRUE(cache.Load("model_key", &loaded));
+  EXPECT_EQ(loaded.batch_size, 16u);
+}
+
+TEST_F(ModelMetaTest, StartupBenchmark) {
+  constexpr int kModelNum = 64;
+  ModelMetaCache cache(dir_, kRuntimeVersion);
+  std::vector<std::string> keys;
+  for (int i = 0; i < kModelNum; ++i) {
+    keys.push_back("model_" + std::to_string(i));
+    ASSERT_TRUE(cache.Store(keys.back(), FakeMeta(i + 1)));
+  }
+
+  ModelMeta meta;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kModelNum; ++i) {
+    ASSERT_TRUE(cache.Load(keys[i], &meta));
+    EXPECT_EQ(meta.batch_size, static_cast<uint32_t>(i + 1));
+  }
+  std::chrono::duration<double, std::milli> load_time = std::chrono::steady_clock::now() - start;
+  LOG(INFO) << "[EasyDK Tests] [ModelMeta] Load meta of " << kModelNum << " models: " << load_time.count() << " ms";
+  // far less than building an engine, which takes seconds
+  EXPECT_LT(load_time.count() / kModelNum, 1.0);
+}
+
+}  // namespace
+}  // namespace infer_server
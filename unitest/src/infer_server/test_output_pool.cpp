@@ -0,0 +1,194 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "cnis/processor.h"
+#include "fixture.h"
+#include "processor/output_pool.h"
+
+namespace infer_server {
+namespace {
+
+CnedkBufSurfaceCreateParams TensorParams(size_t size) {
+  CnedkBufSurfaceCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  params.device_id = 0;
+  params.batch_size = 1;
+  params.size = size;
+  return params;
+}
+
+TEST(InferServerOutputPool, GrowByOccupancy) {
+  std::string key = OutputPool::MakeKey(0, "test_grow", "[1, 1024]", 0);
+  auto pool = OutputPool::Attach(key, TensorParams(1024));
+  ASSERT_TRUE(pool);
+  EXPECT_EQ(pool->UserNum(), 1u);
+  EXPECT_EQ(pool->BlockNum(), OutputPool::kInitialBlocks);
+  EXPECT_EQ(pool->MaxBlockNum(), OutputPool::kBlocksPerUser);
+
+  // sequential use never grows the pool
+  for (int i = 0; i < 10; ++i) {
+    auto buf = pool->GetBufSurfaceWrapper();
+    ASSERT_TRUE(buf);
+  }
+  EXPECT_EQ(pool->BlockNum(), OutputPool::kInitialBlocks);
+
+  // all blocks in use, grows up to the limit
+  std::vector<cnedk::BufSurfWrapperPtr> hold;
+  for (uint32_t i = 0; i < OutputPool::kBlocksPerUser; ++i) {
+    hold.emplace_back(pool->GetBufSurfaceWrapper());
+    ASSERT_TRUE(hold.back());
+  }
+  EXPECT_EQ(pool->BlockNum(), OutputPool::kBlocksPerUser);
+  EXPECT_FALSE(pool->GetBufSurfaceWrapper(5));
+
+  // one more user raises the limit
+  auto another = OutputPool::Attach(key, TensorParams(1024));
+  ASSERT_EQ(another.get(), pool.get());
+  EXPECT_EQ(pool->UserNum(), 2u);
+  hold.emplace_back(pool->GetBufSurfaceWrapper());
+  EXPECT_TRUE(hold.back());
+  EXPECT_EQ(pool->BlockNum(), OutputPool::kBlocksPerUser + 1);
+  another.reset();
+  EXPECT_EQ(pool->UserNum(), 1u);
+
+  hold.clear();
+  size_t live = OutputPool::Count();
+  pool.reset();
+  EXPECT_EQ(OutputPool::Count(), live - 1);
+}
+
+TEST(InferServerOutputPool, KeyedByShapeAndType) {
+  auto a = OutputPool::Attach(OutputPool::MakeKey(0, "test_key", "[1, 16]", 1), TensorParams(64));
+  auto b = OutputPool::Attach(OutputPool::MakeKey(0, "test_key", "[1, 16]", 1), TensorParams(64));
+  auto c = OutputPool::Attach(OutputPool::MakeKey(0, "test_key", "[1, 16]", 2), TensorParams(32));
+  auto d = OutputPool::Attach(OutputPool::MakeKey(0, "test_key", "[1, 32]", 1), TensorParams(128));
+  ASSERT_TRUE(a && b && c && d);
+  EXPECT_EQ(a.get(), b.get());
+  EXPECT_NE(a.get(), c.get());
+  EXPECT_NE(a.get(), d.get());
+}
+
+TEST(InferServerOutputPool, BlocksHoldPool) {
+  std::string key = OutputPool::MakeKey(0, "test_hold", "[4, 16]", 1);
+  auto params = TensorParams(64);
+  params.batch_size = 4;
+  size_t live = OutputPool::Count();
+  auto pool = OutputPool::Attach(key, params);
+  ASSERT_TRUE(pool);
+  auto buf = pool->GetBufSurfaceWrapper();
+  ASSERT_TRUE(buf);
+
+  // output of the last batch is still in use after predictors are released
+  pool.reset();
+  EXPECT_EQ(OutputPool::Count(), live + 1);
+  memset(buf->GetHostData(0, 3), 0, 64);
+  buf.reset();
+  EXPECT_EQ(OutputPool::Count(), live);
+}
+
+TEST_F(InferServerTestAPI, OutputPoolFootprint) {
+  auto model = server_->LoadModel(GetModelInfoStr("resnet50", "url"));
+  ASSERT_TRUE(model);
+  ASSERT_TRUE(model->FixedOutputShape());
+
+  constexpr uint32_t engine_num = 8;
+  auto predictor = Predictor::Create();
+  predictor->SetParams("model_info", model, "device_id", device_id_);
+  ASSERT_EQ(predictor->Init(), Status::SUCCESS);
+  std::vector<std::shared_ptr<Processor>> forks;
+  for (uint32_t i = 1; i < engine_num; ++i) {
+    forks.emplace_back(predictor->Fork());
+    ASSERT_TRUE(forks.back());
+  }
+
+  for (uint32_t i = 0; i < model->OutputNum(); ++i) {
+    std::ostringstream shape;
+    shape << model->OutputShape(i);
+    std::string key =
+        OutputPool::MakeKey(device_id_, model->GetKey(), shape.str(), static_cast<int>(model->OutputLayout(i).dtype));
+    CnedkBufSurfaceCreateParams params;
+    memset(&params, 0, sizeof(params));
+    // pool has been created by predictors, params are not used
+    auto pool = OutputPool::Attach(key, params);
+    ASSERT_TRUE(pool);
+    // all engines share one pool, no engine has run yet, pool stays at the initial size
+    EXPECT_GE(pool->UserNum(), engine_num + 1);
+    EXPECT_EQ(pool->BlockNum(), OutputPool::kInitialBlocks);
+    EXPECT_LT(pool->BlockNum(), engine_num * OutputPool::kBlocksPerUser);
+    VLOG(1) << "[EasyDK Tests] [InferServer] output " << i << " blocks: " << pool->BlockNum()
+            << ", former per-engine pools: " << engine_num * OutputPool::kBlocksPerUser;
+  }
+}
+
+TEST(InferServerOutputPool, Throughput) {
+  constexpr int thread_num = 4;
+  constexpr int loop = 2000;
+  auto params = TensorParams(1000 * 4);
+
+  auto run = [&](bool shared) {
+    std::vector<std::shared_ptr<OutputPool>> pools;
+    for (int i = 0; i < thread_num; ++i) {
+      std::string model_key = shared ? "test_tp_shared" : "test_tp_" + std::to_string(i);
+      std::string key = OutputPool::MakeKey(0, model_key, "[1, 1000]", 1);
+      pools.emplace_back(OutputPool::Attach(key, params));
+    }
+    std::atomic<int> fail{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; ++i) {
+      threads.emplace_back([&, i]() {
+        for (int l = 0; l < loop; ++l) {
+          // two batches in flight per engine, as predictor and postprocessor overlap
+          auto a = pools[i]->GetBufSurfaceWrapper(1000);
+          auto b = pools[i]->GetBufSurfaceWrapper(1000);
+          if (!a || !b) ++fail;
+        }
+      });
+    }
+    for (auto& t : threads) t.join();
+    std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+    uint32_t blocks = 0;
+    for (int i = 0; i < thread_num; ++i) {
+      blocks += shared ? (i ? 0 : pools[0]->BlockNum()) : pools[i]->BlockNum();
+    }
+    EXPECT_EQ(fail.load(), 0);
+    LOG(INFO) << "[EasyDK Tests] [InferServer] OutputPool " << (shared ? "shared" : "per-engine") << ": "
+              << thread_num * loop * 2 / dura.count() << " buffers/ms, " << blocks << " blocks";
+  };
+  run(false);
+  run(true);
+}
+
+}  // namespace
+}  // namespace infer_server
@@ -0,0 +1,197 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "cnis/processor.h"
+#include "cnrt.h"
+#include "processor/preproc_batch.h"
+
+namespace {
+// per thread, allocations by other threads of the test process (e.g. logging, thread pools) are not counted
+thread_local bool g_count_alloc = false;
+thread_local uint64_t g_alloc_count = 0;
+
+__attribute__((noinline)) void *CountedAlloc(std::size_t size) {
+  if (g_count_alloc) ++g_alloc_count;
+  void *p = std::malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+__attribute__((noinline)) void CountedFree(void *p) noexcept { std::free(p); }
+}  // namespace
+
+// count heap allocations of the current thread while g_count_alloc is set
+void *operator new(std::size_t size) { return CountedAlloc(size); }
+void *operator new[](std::size_t size) { return CountedAlloc(size); }
+void operator delete(void *p) noexcept { CountedFree(p); }
+void operator delete[](void *p) noexcept { CountedFree(p); }
+void operator delete(void *p, std::size_t) noexcept { CountedFree(p); }
+void operator delete[](void *p, std::size_t) noexcept { CountedFree(p); }
+
+namespace infer_server {
+namespace {
+
+class AllocCounter {
+ public:
+  AllocCounter() {
+    g_alloc_count = 0;
+    g_count_alloc = true;
+  }
+  ~AllocCounter() { g_count_alloc = false; }
+  uint64_t Count() const { return g_alloc_count; }
+};
+
+struct FakeFrame {
+  FakeFrame(uint32_t w, uint32_t h) {
+    memset(&surf, 0, sizeof(surf));
+    memset(&params, 0, sizeof(params));
+    params.width = w;
+    params.height = h;
+    params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+    params.data_ptr = this;
+    surf.mem_type = CNEDK_BUF_MEM_SYSTEM;
+    surf.batch_size = 1;
+    surf.num_filled = 1;
+    surf.surface_list = &params;
+  }
+  CnedkBufSurface surf;
+  CnedkBufSurfaceParams params;
+};
+
+BatchData MakeBatch(std::vector<std::unique_ptr<FakeFrame>> *frames, uint32_t batch_size, bool bbox) {
+  BatchData data;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    frames->emplace_back(new FakeFrame(1920, 1080));
+    PreprocInput input;
+    input.surf = std::make_shared<cnedk::BufSurfaceWrapper>(&frames->back()->surf, false);
+    input.has_bbox = bbox;
+    input.bbox = CNInferBoundingBox(0.25, 0.5, 0.5, 0.25);
+    data.emplace_back(new InferData);
+    data.back()->Set(std::move(input));
+  }
+  return data;
+}
+
+TEST(InferServerProcessor, PreprocBatchBuild) {
+  constexpr uint32_t batch_size = 4;
+  std::vector<std::unique_ptr<FakeFrame>> frames;
+  BatchData data = MakeBatch(&frames, batch_size, true);
+
+  PreprocBatch batch;
+  batch.Reserve(batch_size, 0);
+  batch.Build(data);
+  CnedkBufSurface *surf = batch.Surface()->GetBufSurface();
+  ASSERT_EQ(surf->batch_size, batch_size);
+  ASSERT_EQ(surf->num_filled, batch_size);
+  EXPECT_EQ(surf->mem_type, CNEDK_BUF_MEM_SYSTEM);
+  ASSERT_EQ(batch.Rects().size(), batch_size);
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    EXPECT_EQ(surf->surface_list[i].data_ptr, frames[i].get());
+    EXPECT_EQ(batch.Rects()[i].left, 480u);
+    EXPECT_EQ(batch.Rects()[i].top, 540u);
+    EXPECT_EQ(batch.Rects()[i].width, 960u);
+    EXPECT_EQ(batch.Rects()[i].height, 270u);
+  }
+
+  batch.Reset();
+  EXPECT_EQ(surf->batch_size, 0u);
+  EXPECT_TRUE(batch.Rects().empty());
+  EXPECT_GE(batch.Capacity(), batch_size);
+}
+
+TEST(InferServerProcessor, PreprocBatchHostDataOfNewBatch) {
+  constexpr size_t size = 4096;
+  void *memory = nullptr;
+  ASSERT_EQ(cnrtMalloc(&memory, size), cnrtSuccess);
+  ASSERT_EQ(cnrtMemset(memory, 100, size), cnrtSuccess);
+  FakeFrame frame(64, 32);
+  frame.surf.mem_type = CNEDK_BUF_MEM_DEVICE;
+  frame.params.data_ptr = memory;
+  frame.params.data_size = 1024;
+  BatchData data;
+  data.emplace_back(new InferData);
+  PreprocInput input;
+  input.surf = std::make_shared<cnedk::BufSurfaceWrapper>(&frame.surf, false);
+  data.back()->Set(std::move(input));
+
+  PreprocBatch batch;
+  batch.Reserve(1, 0);
+  batch.Build(data);
+  EXPECT_EQ(static_cast<uint8_t *>(batch.Surface()->GetHostData(0, 0))[0], 100);
+
+  // device memory is reused by the next batch
+  ASSERT_EQ(cnrtMemset(memory, 200, size), cnrtSuccess);
+  batch.Build(data);
+  EXPECT_EQ(static_cast<uint8_t *>(batch.Surface()->GetHostData(0, 0))[0], 200);
+
+  // larger frame of the next batch
+  ASSERT_EQ(cnrtMemset(static_cast<uint8_t *>(memory) + 1024, 201, size - 1024), cnrtSuccess);
+  frame.params.data_size = size;
+  batch.Build(data);
+  uint8_t *host = static_cast<uint8_t *>(batch.Surface()->GetHostData(0, 0));
+  ASSERT_TRUE(host);
+  EXPECT_EQ(host[0], 200);
+  EXPECT_EQ(host[size - 1], 201);
+  batch.Reset();
+  EXPECT_EQ(cnrtFree(memory), cnrtSuccess);
+}
+
+TEST(InferServerProcessor, PreprocBatchNoAllocInSteadyState) {
+  constexpr uint32_t batch_size = 16;
+  std::vector<std::unique_ptr<FakeFrame>> frames;
+  BatchData full = MakeBatch(&frames, batch_size, true);
+  BatchData partial(full.begin(), full.begin() + batch_size / 2);
+
+  PreprocBatch batch;
+  batch.Reserve(batch_size, 0);
+  {
+    AllocCounter counter;
+    for (int iter = 0; iter < 100; ++iter) {
+      batch.Build(iter % 2 ? full : partial);
+      batch.Reset();
+    }
+    EXPECT_EQ(counter.Count(), 0u);
+  }
+
+  // without reservation, storage grows on the first batch only
+  PreprocBatch lazy;
+  lazy.Build(full);
+  lazy.Reset();
+  {
+    AllocCounter counter;
+    for (int iter = 0; iter < 100; ++iter) {
+      lazy.Build(full);
+      lazy.Reset();
+    }
+    EXPECT_EQ(counter.Count(), 0u);
+  }
+}
+
+}  // namespace
+}  // namespace infer_server
@@ -19,6 +19,7 @@
  *************************************************************************/
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -27,6 +28,8 @@
 
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
+#include "cnedk_buf_surface.h"
+#include "cnedk_buf_surface_util.hpp"
 #include "fixture.h"
 
 namespace infer_server {
@@ -98,5 +101,83 @@ TEST_F(InferServerTestAPI, Postprocessor) {
   }
 }
 
+class LayoutModel : public ModelInfo {
+ public:
+  LayoutModel(const Shape& shape, DataLayout layout) : shape_(shape), layout_(layout) {}
+  const Shape& InputShape(int index) const noexcept override { return shape_; }
+  const Shape& OutputShape(int index) const noexcept override { return shape_; }
+  bool FixedOutputShape() noexcept override { return true; }
+  const DataLayout& InputLayout(int index) const noexcept override { return layout_; }
+  const DataLayout& OutputLayout(int index) const noexcept override { return layout_; }
+  uint32_t InputNum() const noexcept override { return 1; }
+  uint32_t OutputNum() const noexcept override { return 1; }
+  uint32_t BatchSize() const noexcept override { return shape_[0]; }
+  std::string GetKey() const noexcept override { return "test_postproc_output_layout"; }
+
+ private:
+  Shape shape_;
+  DataLayout layout_;
+};
+
+TEST_F(InferServerTestAPI, PostprocessorOutputLayout) {
+  constexpr uint32_t kBatch = 2, kH = 3, kW = 5, kC = 4;
+  const size_t item_count = kH * kW * kC;
+  std::vector<float> src(kBatch * item_count);
+  for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<float>(i);
+
+  for (bool nhwc : {true, false}) {
+    const DataLayout src_layout{DataType::FLOAT32, nhwc ? DimOrder::NHWC : DimOrder::NCHW};
+    const DataLayout dst_layout{DataType::FLOAT32, nhwc ? DimOrder::NCHW : DimOrder::NHWC};
+    const Shape src_shape = nhwc ? Shape({kBatch, kH, kW, kC}) : Shape({kBatch, kC, kH, kW});
+    const Shape dst_shape = nhwc ? Shape({1, kC, kH, kW}) : Shape({1, kH, kW, kC});
+    auto model = std::make_shared<LayoutModel>(src_shape, src_layout);
+
+    auto processor = Postprocessor::Create();
+    processor->SetParams("model_info", ModelPtr(model), "device_id", device_id_, "output_layout", dst_layout);
+    ASSERT_EQ(processor->Init(), Status::SUCCESS);
+
+    // contiguous batch in system memory, as output mirrored to host
+    CnedkBufSurfaceParams items[kBatch];
+    memset(items, 0, sizeof(items));
+    CnedkBufSurface surf;
+    memset(&surf, 0, sizeof(surf));
+    surf.mem_type = CNEDK_BUF_MEM_SYSTEM;
+    surf.device_id = device_id_;
+    surf.batch_size = kBatch;
+    surf.num_filled = kBatch;
+    surf.surface_list = items;
+    for (uint32_t b = 0; b < kBatch; ++b) {
+      items[b].color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+      items[b].data_ptr = src.data() + b * item_count;
+      items[b].data_size = item_count * sizeof(float);
+    }
+    ModelIO out_mlu;
+    out_mlu.surfs.emplace_back(std::make_shared<cnedk::BufSurfaceWrapper>(&surf, false));
+    out_mlu.shapes.emplace_back(src_shape);
+
+    auto pack = Package::Create(kBatch);
+    pack->predict_io.reset(new InferData);
+    pack->predict_io->Set(std::move(out_mlu));
+    ASSERT_EQ(processor->Process(pack), Status::SUCCESS);
+
+    for (uint32_t b = 0; b < kBatch; ++b) {
+      const ModelIO& out = pack->data[b]->GetLref<ModelIO>();
+      ASSERT_EQ(out.surfs.size(), 1u);
+      EXPECT_EQ(out.shapes[0], dst_shape);
+      const float* dst = static_cast<const float*>(out.surfs[0]->GetHostData(0));
+      ASSERT_TRUE(dst);
+      const float* item = src.data() + b * item_count;
+      for (uint32_t h = 0; h < kH; ++h) {
+        for (uint32_t w = 0; w < kW; ++w) {
+          for (uint32_t c = 0; c < kC; ++c) {
+            const size_t hwc = (h * kW + w) * kC + c, chw = (c * kH + h) * kW + w;
+            ASSERT_EQ(dst[nhwc ? chw : hwc], item[nhwc ? hwc : chw]) << "h " << h << " w " << w << " c " << c;
+          }
+        }
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace infer_server
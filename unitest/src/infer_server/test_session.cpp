@@ -20,8 +20,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -243,4 +247,53 @@ TEST(InferServerCore, SessionDiscardTask) {
   executor->Unlink(session.get());
 }
 
+TEST(InferServerCore, ExecutorScaleUnderAsyncLoad) {
+  PriorityThreadPool tp([]() -> bool { return SetCurrentDevice(device_id); }, 6);
+  auto handler = std::make_shared<PreprocHandleTest>();
+  SessionDesc desc = ReturnSessionDesc("scale session", handler.get(), 5, BatchStrategy::DYNAMIC, 1);
+  desc.max_engine_num = 3;
+  // predictor finishes batches on its own thread
+  desc.inflight_num = 2;
+  std::unique_ptr<Executor> executor(new Executor(desc, &tp, 0));
+  std::unique_ptr<Session> session(new Session("scale session", executor.get(), false, false));
+  executor->Link(session.get());
+
+  CnedkBufSurfaceCreateParams create_params;
+  CreateBufSurfaceParams(device_id, &create_params);
+  const std::string tag = "scale tag";
+  std::atomic<uint32_t> response_num{0};
+  uint32_t request_num = 0;
+  auto send = [&](uint32_t num) {
+    for (uint32_t idx = 0; idx < num; ++idx) {
+      auto input = Package::Create(1, tag);
+      PreprocInput preproc_input;
+      PrepareInput(&create_params, &preproc_input);
+      input->data[0]->Set(std::move(preproc_input));
+      if (session->Send(std::move(input), [&response_num](Status, PackagePtr) { ++response_num; })) ++request_num;
+    }
+  };
+
+  // backlog makes executor fork engines
+  uint32_t max_engine_num = 1;
+  for (int round = 0; round < 20; ++round) {
+    send(64);
+    max_engine_num = std::max(max_engine_num, executor->GetEngineNum());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  // light load retires engines, while batches are still in flight on them
+  uint32_t min_engine_num = max_engine_num;
+  for (int round = 0; round < 50; ++round) {
+    send(1);
+    min_engine_num = std::min(min_engine_num, executor->GetEngineNum());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  session->WaitTaskDone(tag);
+
+  EXPECT_EQ(response_num.load(), request_num);
+  EXPECT_GT(max_engine_num, 1u);
+  EXPECT_LE(max_engine_num, desc.max_engine_num);
+  EXPECT_LT(min_engine_num, max_engine_num);
+  executor->Unlink(session.get());
+}
+
 }  // namespace infer_server
@@ -0,0 +1,277 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "cnis/processor.h"
+#include "fixture.h"
+#include "model/model.h"
+#include "model/shape_bucket.h"
+#include "processor/output_pool.h"
+
+namespace infer_server {
+namespace {
+
+// runs padding plan on host memory
+std::vector<float> PadOnHost(const std::vector<float>& src, const Shape& src_shape, const Shape& dst_shape,
+                             DimOrder order) {
+  std::vector<float> dst(dst_shape.BatchDataCount(), 0);
+  auto copies = PlanPadding(src_shape, dst_shape, order, sizeof(float));
+  EXPECT_FALSE(copies.empty());
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(src.data());
+  uint8_t* d = reinterpret_cast<uint8_t*>(dst.data());
+  for (auto& copy : copies) {
+    for (size_t row = 0; row < copy.height; ++row) {
+      memcpy(d + copy.dst_offset + row * copy.dst_pitch, s + copy.src_offset + row * copy.src_pitch, copy.width);
+    }
+  }
+  return dst;
+}
+
+std::vector<float> RandomData(const Shape& shape) {
+  std::mt19937 gen(shape.BatchDataCount());
+  std::uniform_real_distribution<float> dis(1, 2);
+  std::vector<float> data(shape.BatchDataCount());
+  for (auto& v : data) v = dis(gen);
+  return data;
+}
+
+// dynamic-shape model on host, output of each item is sum of its elements, padding with zero does not change it
+class HostDynamicModel {
+ public:
+  std::vector<Shape> InferOutputShape(const Shape& in) {
+    ++infer_calls;
+    return {Shape({in[0], 1})};
+  }
+
+  std::vector<float> Run(const std::vector<float>& in, const Shape& shape) {
+    std::vector<float> out(shape[0], 0);
+    size_t item = shape.DataCount();
+    for (size_t idx = 0; idx < in.size(); ++idx) out[idx / item] += in[idx];
+    return out;
+  }
+
+  int infer_calls = 0;
+};
+
+TEST(InferServerCore, PlanPadding) {
+  struct Case {
+    Shape src, dst;
+    DimOrder order;
+    size_t copy_num;
+  };
+  std::vector<Case> cases = {
+      // batch only, one contiguous copy
+      {Shape({2, 4, 6, 3}), Shape({4, 4, 6, 3}), DimOrder::NHWC, 1},
+      // height and batch, one 2D copy of images
+      {Shape({3, 5, 6, 3}), Shape({4, 8, 6, 3}), DimOrder::NHWC, 1},
+      // width, one 2D copy for each image
+      {Shape({3, 5, 6, 3}), Shape({4, 8, 8, 3}), DimOrder::NHWC, 3},
+      // width, one 2D copy for each plane
+      {Shape({2, 3, 5, 6}), Shape({4, 3, 8, 7}), DimOrder::NCHW, 6},
+      {Shape({2, 3, 5, 7}), Shape({2, 3, 8, 7}), DimOrder::NCHW, 1},
+  };
+  for (auto& c : cases) {
+    ASSERT_EQ(PlanPadding(c.src, c.dst, c.order, sizeof(float)).size(), c.copy_num) << c.src << " -> " << c.dst;
+    std::vector<float> src = RandomData(c.src);
+    std::vector<float> dst = PadOnHost(src, c.src, c.dst, c.order);
+    // index of element is the same in both shapes, elements out of source are zero
+    for (int64_t n = 0; n < c.dst[0]; ++n) {
+      for (int64_t i1 = 0; i1 < c.dst[1]; ++i1) {
+        for (int64_t i2 = 0; i2 < c.dst[2]; ++i2) {
+          for (int64_t i3 = 0; i3 < c.dst[3]; ++i3) {
+            float v = dst[((n * c.dst[1] + i1) * c.dst[2] + i2) * c.dst[3] + i3];
+            if (n < c.src[0] && i1 < c.src[1] && i2 < c.src[2] && i3 < c.src[3]) {
+              ASSERT_EQ(v, src[((n * c.src[1] + i1) * c.src[2] + i2) * c.src[3] + i3]);
+            } else {
+              ASSERT_EQ(v, 0);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // channel is not padded, destination must be larger
+  EXPECT_TRUE(PlanPadding(Shape({1, 4, 4, 3}), Shape({1, 4, 4, 4}), DimOrder::NHWC, 4).empty());
+  EXPECT_TRUE(PlanPadding(Shape({1, 3, 4, 4}), Shape({1, 4, 4, 4}), DimOrder::NCHW, 4).empty());
+  EXPECT_TRUE(PlanPadding(Shape({2, 4, 4, 3}), Shape({1, 4, 4, 3}), DimOrder::NHWC, 4).empty());
+  EXPECT_TRUE(PlanPadding(Shape({1, 4, 3}), Shape({1, 4, 3}), DimOrder::NTC, 4).empty());
+}
+
+TEST(InferServerCore, ValidShape) {
+  const Shape in({3, 300, 400, 3}), bucket({4, 320, 416, 3});
+  // output following input, at the same or a lower resolution
+  EXPECT_EQ(ValidShape(in, bucket, DimOrder::NHWC, Shape({4, 320, 416, 2}), DimOrder::NHWC),
+            Shape({3, 300, 400, 2}));
+  EXPECT_EQ(ValidShape(in, bucket, DimOrder::NHWC, Shape({4, 255, 40, 52}), DimOrder::NCHW),
+            Shape({3, 255, 38, 50}));
+  // output not following input, only batch is cut
+  EXPECT_EQ(ValidShape(in, bucket, DimOrder::NHWC, Shape({4, 1000}), DimOrder::NONE), Shape({3, 1000}));
+  EXPECT_EQ(ValidShape(in, bucket, DimOrder::NHWC, Shape({4, 7, 7, 10}), DimOrder::NHWC), Shape({3, 7, 7, 10}));
+  EXPECT_EQ(ValidShape(in, bucket, DimOrder::NHWC, Shape({4, 160, 104, 1}), DimOrder::NHWC),
+            Shape({3, 160, 104, 1}));
+  EXPECT_EQ(ValidShape(in, bucket, DimOrder::NHWC, Shape({1, 100}), DimOrder::NONE), Shape({1, 100}));
+}
+
+TEST(InferServerCore, ShapeBucketSelect) {
+  std::vector<ShapeBucket> buckets = {{4, 640, 640}, {1, 320, 320}, {4, 320, 320}, {0, 320, 320}};
+  ShapeBucketer bucketer(buckets, Shape({-1, -1, -1, 3}), DimOrder::NHWC);
+  // bucket with zero dimension is dropped, the others are sorted by size
+  ASSERT_EQ(bucketer.BucketNum(), 3);
+  EXPECT_EQ(bucketer.BucketShape(0), Shape({1, 320, 320, 3}));
+  EXPECT_EQ(bucketer.BucketShape(1), Shape({4, 320, 320, 3}));
+  EXPECT_EQ(bucketer.BucketShape(2), Shape({4, 640, 640, 3}));
+
+  EXPECT_EQ(bucketer.Select(Shape({1, 320, 320, 3})), 0);
+  EXPECT_EQ(bucketer.Select(Shape({1, 300, 200, 3})), 0);
+  EXPECT_EQ(bucketer.Select(Shape({2, 300, 200, 3})), 1);
+  EXPECT_EQ(bucketer.Select(Shape({1, 321, 200, 3})), 2);
+  EXPECT_EQ(bucketer.Select(Shape({1, 641, 200, 3})), -1);
+  EXPECT_EQ(bucketer.Select(Shape({1, 300, 200, 1})), -1);
+  EXPECT_EQ(bucketer.Select(Shape({8, 300, 200, 3})), -1);
+
+  ShapeBucketer nchw({{2, 16, 32}}, Shape({-1, 3, -1, -1}), DimOrder::NCHW);
+  ASSERT_EQ(nchw.BucketNum(), 1);
+  EXPECT_EQ(nchw.BucketShape(0), Shape({2, 3, 16, 32}));
+  EXPECT_EQ(nchw.Select(Shape({2, 3, 10, 10})), 0);
+
+  // channel must be known
+  ShapeBucketer unknown({{2, 16, 32}}, Shape({-1, -1, -1, -1}), DimOrder::NCHW);
+  EXPECT_EQ(unknown.BucketNum(), 0);
+}
+
+TEST(InferServerCore, ShapeBucketRun) {
+  HostDynamicModel model;
+  ShapeBucketer bucketer({{2, 16, 16}, {4, 32, 32}}, Shape({-1, -1, -1, 3}), DimOrder::NHWC);
+  auto infer = [&model](const Shape& shape) { return model.InferOutputShape(shape); };
+
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> batch_dis(1, 4), side_dis(4, 32);
+  for (int iter = 0; iter < 100; ++iter) {
+    Shape shape({batch_dis(gen), side_dis(gen), side_dis(gen), 3});
+    int idx = bucketer.Select(shape);
+    ASSERT_GE(idx, 0);
+    bucketer.Record(shape, idx);
+    const Shape& bucket_shape = bucketer.BucketShape(idx);
+    // output shapes of bucket are inferred once, and reused by later batches of any shape in bucket
+    std::vector<Shape> out_shapes = bucketer.OutputShapes(idx, infer);
+    ASSERT_EQ(out_shapes.size(), 1u);
+    EXPECT_EQ(out_shapes[0], Shape({bucket_shape[0], 1}));
+
+    std::vector<float> in = RandomData(shape);
+    std::vector<float> expected = model.Run(in, shape);
+    std::vector<float> out = model.Run(PadOnHost(in, shape, bucket_shape, DimOrder::NHWC), bucket_shape);
+    ASSERT_EQ(out.size(), static_cast<size_t>(bucket_shape[0]));
+    for (int64_t n = 0; n < shape[0]; ++n) EXPECT_FLOAT_EQ(out[n], expected[n]);
+    for (int64_t n = shape[0]; n < bucket_shape[0]; ++n) EXPECT_EQ(out[n], 0);
+  }
+  EXPECT_EQ(model.infer_calls, 2);
+
+  bucketer.Record(Shape({8, 8, 8, 3}), -1);
+  PaddingStatistic stat = bucketer.Statistic();
+  EXPECT_EQ(stat.batch_cnt, 100u);
+  EXPECT_EQ(stat.miss_cnt, 1u);
+  EXPECT_GT(stat.padded_elements, stat.real_elements);
+  EXPECT_FLOAT_EQ(stat.overhead, static_cast<float>(static_cast<double>(stat.padded_elements) /
+                                                    stat.real_elements - 1));
+}
+
+TEST(InferServerCore, ShapeBucketNoPadding) {
+  ShapeBucketer bucketer({{2, 16, 16}}, Shape({-1, 3, -1, -1}), DimOrder::NCHW);
+  EXPECT_FLOAT_EQ(bucketer.Statistic().overhead, 0);
+  bucketer.Record(Shape({2, 3, 16, 16}), 0);
+  bucketer.Record(Shape({1, 3, 16, 16}), 0);
+  PaddingStatistic stat = bucketer.Statistic();
+  EXPECT_EQ(stat.real_elements, 3u * 3 * 16 * 16);
+  EXPECT_EQ(stat.padded_elements, 4u * 3 * 16 * 16);
+  EXPECT_FLOAT_EQ(stat.overhead, 1.0f / 3);
+}
+
+TEST_F(InferServerTestAPI, PredictorShapeBucket) {
+  auto model = server_->LoadModel(GetModelInfoStr("resnet50", "url"));
+  ASSERT_TRUE(model);
+  auto runner = ModelManager::Instance()->GetModel(model->GetKey())->GetRunner(device_id_);
+  ASSERT_TRUE(runner);
+  if (runner->FixedInputShape() || model->InputNum() != 1) {
+    LOG(INFO) << "[EasyDK Tests] [InferServer] Model input shape is fixed, shape buckets are not applied";
+    return;
+  }
+  const DataLayout layout = model->InputLayout(0);
+  ASSERT_TRUE(layout.order == DimOrder::NHWC || layout.order == DimOrder::NCHW);
+  const bool nhwc = layout.order == DimOrder::NHWC;
+  Shape model_shape = model->InputShape(0);
+  int64_t c = nhwc ? model_shape[3] : model_shape[1];
+  int64_t h = nhwc ? model_shape[1] : model_shape[2];
+  int64_t w = nhwc ? model_shape[2] : model_shape[3];
+  if (h <= 0) h = 224;
+  if (w <= 0) w = 224;
+  auto bucketer = std::make_shared<ShapeBucketer>(
+      std::vector<ShapeBucket>{ShapeBucket(4, h, w)}, model_shape, layout.order);
+  ASSERT_EQ(bucketer->BucketNum(), 1);
+
+  auto predictor = Predictor::Create();
+  predictor->SetParams("model_info", model, "device_id", device_id_, "shape_bucketer", bucketer);
+  ASSERT_EQ(predictor->Init(), Status::SUCCESS);
+
+  // batch of 2 smaller than bucket, padded on batch, height and width
+  Shape shape = nhwc ? Shape({2, h - 8, w - 8, c}) : Shape({2, c, h - 8, w - 8});
+  CnedkBufSurfaceCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.mem_type = CNEDK_BUF_MEM_DEVICE;
+  params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  params.device_id = device_id_;
+  params.batch_size = 1;
+  params.size = shape.BatchDataCount() * GetTypeSize(layout.dtype);
+  auto in_pool = OutputPool::Attach(OutputPool::MakeKey(device_id_, "test_bucket_in", "", 0), params);
+  ASSERT_TRUE(in_pool);
+  ModelIO in;
+  in.surfs.emplace_back(in_pool->GetBufSurfaceWrapper());
+  ASSERT_TRUE(in.surfs[0]);
+  in.shapes.emplace_back(shape);
+
+  auto pack = std::make_shared<Package>();
+  pack->predict_io.reset(new InferData);
+  pack->predict_io->Set(std::move(in));
+  ASSERT_EQ(predictor->Process(pack), Status::SUCCESS);
+
+  const ModelIO& out = pack->predict_io->GetLref<ModelIO>();
+  ASSERT_EQ(out.shapes.size(), model->OutputNum());
+  ASSERT_EQ(out.valid_shapes.size(), out.shapes.size());
+  for (size_t i = 0; i < out.shapes.size(); ++i) {
+    EXPECT_EQ(out.shapes[i][0], 4);
+    EXPECT_EQ(out.valid_shapes[i][0], 2);
+    ASSERT_EQ(out.valid_shapes[i].Size(), out.shapes[i].Size());
+    for (size_t d = 1; d < out.shapes[i].Size(); ++d) EXPECT_LE(out.valid_shapes[i][d], out.shapes[i][d]);
+  }
+  PaddingStatistic stat = bucketer->Statistic();
+  EXPECT_EQ(stat.batch_cnt, 1u);
+  EXPECT_EQ(stat.miss_cnt, 0u);
+}
+
+}  // namespace
+}  // namespace infer_server
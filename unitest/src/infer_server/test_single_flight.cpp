@@ -0,0 +1,161 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/single_flight.h"
+
+namespace infer_server {
+namespace {
+
+struct FakeModel {
+  explicit FakeModel(const std::string& k) : key(k) {}
+  std::string key;
+};
+
+using FakeModelPtr = std::shared_ptr<FakeModel>;
+
+// stands in for Model::Init, blocks until released or sleeps for a while
+class SlowLoader {
+ public:
+  FakeModelPtr Load(const std::string& key) {
+    ++calls;
+    std::unique_lock<std::mutex> lk(mutex_);
+    ++running_;
+    cond_.notify_all();
+    cond_.wait(lk, [this] { return released_; });
+    --running_;
+    if (fail) return nullptr;
+    return std::make_shared<FakeModel>(key);
+  }
+
+  void Release() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    released_ = true;
+    cond_.notify_all();
+  }
+
+  bool WaitRunning(int num) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    return cond_.wait_for(lk, std::chrono::seconds(5), [this, num] { return running_ >= num; });
+  }
+
+  std::atomic<int> calls{0};
+  std::atomic<bool> fail{false};
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int running_ = 0;
+  bool released_ = false;
+};
+
+bool WaitWaiters(SingleFlight<std::string, FakeModelPtr>* flight, const std::string& key, size_t num) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (flight->Waiters(key) < num) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+TEST(InferServerUtil, SingleFlightParallelKeys) {
+  SingleFlight<std::string, FakeModelPtr> flight;
+  SlowLoader loader;
+  constexpr int kModelNum = 4;
+  std::vector<std::future<FakeModelPtr>> results;
+  for (int i = 0; i < kModelNum; ++i) {
+    std::string key = "model_" + std::to_string(i);
+    results.emplace_back(std::async(std::launch::async, [&flight, &loader, key] {
+      return flight.Do(key, [&loader, &key] { return loader.Load(key); });
+    }));
+  }
+  // all loads of different models are running at the same time
+  ASSERT_TRUE(loader.WaitRunning(kModelNum));
+  loader.Release();
+  for (int i = 0; i < kModelNum; ++i) {
+    FakeModelPtr model = results[i].get();
+    ASSERT_TRUE(model);
+    EXPECT_EQ(model->key, "model_" + std::to_string(i));
+  }
+  EXPECT_EQ(loader.calls, kModelNum);
+}
+
+TEST(InferServerUtil, SingleFlightSameKey) {
+  SingleFlight<std::string, FakeModelPtr> flight;
+  SlowLoader loader;
+  constexpr int kCallerNum = 8;
+  auto load = [&flight, &loader] { return flight.Do("resnet50", [&loader] { return loader.Load("resnet50"); }); };
+  std::vector<std::future<FakeModelPtr>> results;
+  for (int i = 0; i < kCallerNum; ++i) results.emplace_back(std::async(std::launch::async, load));
+  ASSERT_TRUE(loader.WaitRunning(1));
+  ASSERT_TRUE(WaitWaiters(&flight, "resnet50", kCallerNum - 1));
+  loader.Release();
+
+  FakeModelPtr first = results[0].get();
+  ASSERT_TRUE(first);
+  for (int i = 1; i < kCallerNum; ++i) EXPECT_EQ(results[i].get(), first);
+  EXPECT_EQ(loader.calls, 1);
+  EXPECT_EQ(flight.Waiters("resnet50"), 0u);
+}
+
+TEST(InferServerUtil, SingleFlightFailureAndRetry) {
+  SingleFlight<std::string, FakeModelPtr> flight;
+  SlowLoader loader;
+  loader.fail = true;
+  auto load = [&flight, &loader] { return flight.Do("yolov3", [&loader] { return loader.Load("yolov3"); }); };
+  auto first = std::async(std::launch::async, load);
+  ASSERT_TRUE(loader.WaitRunning(1));
+  auto second = std::async(std::launch::async, load);
+  ASSERT_TRUE(WaitWaiters(&flight, "yolov3", 1));
+  loader.Release();
+  // failure is propagated to the waiter
+  EXPECT_FALSE(first.get());
+  EXPECT_FALSE(second.get());
+  EXPECT_EQ(loader.calls, 1);
+
+  // failed result is not kept, the next call retries
+  loader.fail = false;
+  FakeModelPtr model = load();
+  ASSERT_TRUE(model);
+  EXPECT_EQ(model->key, "yolov3");
+  EXPECT_EQ(loader.calls, 2);
+
+  // exception is propagated as well
+  auto throw_load = [&flight] {
+    return flight.Do("yolov3", []() -> FakeModelPtr { throw std::runtime_error("load failed"); });
+  };
+  EXPECT_THROW(throw_load(), std::runtime_error);
+  EXPECT_TRUE(load());
+}
+
+}  // namespace
+}  // namespace infer_server
@@ -20,8 +20,13 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <future>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
@@ -40,9 +45,10 @@ TEST(InferServerCore, TaskNode) {
   auto empty_notifier_func = [](const RequestControl*) {};
   std::unique_ptr<RequestControl> ctrl(new RequestControl(empty_response_func, empty_notifier_func, "", 1, 2));
   PriorityThreadPool tp(nullptr, 2);
+  std::atomic<uint32_t> executing{0};
 
-  TaskNode task_node(proc, []() {}, &tp);
-  auto end_node = task_node.Fork([&tasknode_notify_flag]() { tasknode_notify_flag.set_value(); });
+  TaskNode task_node(proc, []() {}, &tp, &executing);
+  auto end_node = task_node.Fork([&tasknode_notify_flag]() { tasknode_notify_flag.set_value(); }, &executing);
 
   task_node.Link(&end_node);
 
@@ -56,6 +62,62 @@ TEST(InferServerCore, TaskNode) {
 
   auto tasknode_notify_ret = tasknode_notify_flag.get_future().wait_for(std::chrono::seconds(1));
   ASSERT_EQ(std::future_status::ready, tasknode_notify_ret);
+  // nodes are in use until Execute returns
+  while (executing.load()) std::this_thread::yield();
+}
+
+// finishes process on its own thread, like predictor with batches in flight
+class AsyncTestProcessor : public ProcessorForkable<AsyncTestProcessor> {
+ public:
+  AsyncTestProcessor() noexcept : ProcessorForkable<AsyncTestProcessor>("AsyncTestProcessor") {}
+  ~AsyncTestProcessor() {
+    for (auto& it : threads) it.join();
+  }
+  Status Process(PackagePtr data) noexcept override { return Status::SUCCESS; }
+  void ProcessAsync(PackagePtr data, std::function<void(Status)> done) noexcept override {
+    threads.emplace_back([this, done]() {
+      release.wait();
+      done(Status::SUCCESS);
+    });
+  }
+  Status Init() noexcept override { return Status::SUCCESS; }
+
+  std::shared_future<void> release;
+  std::vector<std::thread> threads;
+};
+
+TEST(InferServerCore, TaskNodeAsync) {
+  auto proc = std::make_shared<AsyncTestProcessor>();
+  std::promise<void> release_flag;
+  proc->release = release_flag.get_future().share();
+
+  auto empty_response_func = [](Status, PackagePtr) {};
+  auto empty_notifier_func = [](const RequestControl*) {};
+  std::unique_ptr<RequestControl> ctrl(new RequestControl(empty_response_func, empty_notifier_func, "", 1, 2));
+  PriorityThreadPool tp(nullptr, 2);
+
+  std::promise<void> notify_flag[2];
+  std::atomic<int> notify_idx{0};
+  std::shared_ptr<Processor> end_proc = std::make_shared<TestProcessor>();
+  end_proc->Init();
+  std::atomic<uint32_t> executing{0};
+  TaskNode task_node(proc, []() {}, &tp, &executing);
+  TaskNode end_node(end_proc, [&]() { notify_flag[notify_idx++].set_value(); }, &tp, &executing);
+  task_node.Link(&end_node);
+
+  // Execute returns before process is done, processor is unlocked for the next pack
+  for (int i = 0; i < 2; ++i) {
+    auto input = Package::Create(1);
+    input->data[0]->ctrl = ctrl.get();
+    input->data[0]->index = i;
+    ASSERT_NO_THROW(task_node.Execute(input));
+  }
+  EXPECT_EQ(std::future_status::timeout, notify_flag[0].get_future().wait_for(std::chrono::milliseconds(50)));
+
+  // done transmits packs to the next node
+  release_flag.set_value();
+  ASSERT_EQ(std::future_status::ready, notify_flag[1].get_future().wait_for(std::chrono::seconds(1)));
+  while (executing.load()) std::this_thread::yield();
 }
 
 }  // namespace infer_server
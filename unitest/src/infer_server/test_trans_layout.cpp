@@ -0,0 +1,181 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "core/cast_kernel.h"
+#include "core/data_type.h"
+#include "core/transpose_kernel.h"
+
+namespace infer_server {
+namespace {
+
+using detail::TransposeHost;
+
+std::vector<uint8_t> RandomBytes(size_t size, std::mt19937 *gen) {
+  std::uniform_int_distribution<int> dis(0, 255);
+  std::vector<uint8_t> data(size);
+  for (auto &d : data) d = static_cast<uint8_t>(dis(*gen));
+  return data;
+}
+
+template <typename T>
+void ReferenceTranspose(const T *src, T *dst, size_t batch, size_t rows, size_t cols) {
+  for (size_t b = 0; b < batch; ++b) {
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) dst[(b * cols + c) * rows + r] = src[(b * rows + r) * cols + c];
+    }
+  }
+}
+
+void ReferenceTranspose(const void *src, void *dst, size_t batch, size_t rows, size_t cols, size_t elem_size) {
+  switch (elem_size) {
+    case 1:
+      ReferenceTranspose(static_cast<const uint8_t *>(src), static_cast<uint8_t *>(dst), batch, rows, cols);
+      break;
+    case 2:
+      ReferenceTranspose(static_cast<const uint16_t *>(src), static_cast<uint16_t *>(dst), batch, rows, cols);
+      break;
+    case 4:
+      ReferenceTranspose(static_cast<const uint32_t *>(src), static_cast<uint32_t *>(dst), batch, rows, cols);
+      break;
+    default:
+      FAIL();
+  }
+}
+
+TEST(InferServerTransLayout, ExhaustiveSmallShapes) {
+  std::mt19937 gen(0);
+  // covers the narrow channel paths, partial tiles on both edges and more than one cache block
+  for (size_t elem_size : {1, 2, 4}) {
+    for (size_t rows = 1; rows <= 70; ++rows) {
+      for (size_t cols = 1; cols <= 70; ++cols) {
+        const size_t batch = 1 + (rows + cols) % 3;
+        const size_t size = batch * rows * cols * elem_size;
+        std::vector<uint8_t> src = RandomBytes(size, &gen);
+        std::vector<uint8_t> ref(size), dst(size);
+        ReferenceTranspose(src.data(), ref.data(), batch, rows, cols, elem_size);
+        for (bool simd : {false, true}) {
+          std::fill(dst.begin(), dst.end(), 0);
+          ASSERT_TRUE(TransposeHost(src.data(), dst.data(), batch, rows, cols, elem_size, simd));
+          ASSERT_EQ(dst, ref) << "elem size: " << elem_size << ", rows: " << rows << ", cols: " << cols
+                              << ", simd: " << simd;
+        }
+      }
+    }
+  }
+  uint8_t dummy = 0;
+  EXPECT_FALSE(TransposeHost(&dummy, &dummy, 1, 1, 1, 8));
+}
+
+TEST(InferServerTransLayout, LargeBatch) {
+  std::mt19937 gen(1);
+  // large enough to be split across workers
+  constexpr size_t batch = 9, rows = 224 * 224, cols = 3;
+  std::vector<uint8_t> src = RandomBytes(batch * rows * cols * 4, &gen);
+  std::vector<uint8_t> ref(src.size()), dst(src.size());
+  ReferenceTranspose(src.data(), ref.data(), batch, rows, cols, 4);
+  ASSERT_TRUE(TransposeHost(src.data(), dst.data(), batch, rows, cols, 4));
+  EXPECT_EQ(dst, ref);
+  ReferenceTranspose(src.data(), ref.data(), batch, 100, 301, 4);
+  ASSERT_TRUE(TransposeHost(src.data(), dst.data(), batch, 100, 301, 4));
+  EXPECT_TRUE(memcmp(dst.data(), ref.data(), batch * 100 * 301 * 4) == 0);
+}
+
+TEST(InferServerTransLayout, NHWCAndNCHW) {
+  std::mt19937 gen(2);
+  std::uniform_real_distribution<float> dis(-100.f, 100.f);
+  const Shape nhwc({2, 5, 7, 3});
+  std::vector<float> src(nhwc.BatchDataCount());
+  for (auto &v : src) v = dis(gen);
+
+  // NHWC float to NCHW half
+  std::vector<uint16_t> nchw(src.size());
+  ASSERT_TRUE(detail::TransLayout(src.data(), nchw.data(), {DataType::FLOAT32, DimOrder::NHWC},
+                                  {DataType::FLOAT16, DimOrder::NCHW}, nhwc));
+  for (int n = 0; n < 2; ++n) {
+    for (int h = 0; h < 5; ++h) {
+      for (int w = 0; w < 7; ++w) {
+        for (int c = 0; c < 3; ++c) {
+          ASSERT_EQ(nchw[((n * 3 + c) * 5 + h) * 7 + w], detail::FloatToHalf(src[((n * 5 + h) * 7 + w) * 3 + c]));
+        }
+      }
+    }
+  }
+
+  // back to NHWC float
+  std::vector<float> back(src.size());
+  ASSERT_TRUE(detail::TransLayout(nchw.data(), back.data(), {DataType::FLOAT16, DimOrder::NCHW},
+                                  {DataType::FLOAT32, DimOrder::NHWC}, Shape(DimNHWC2NCHW(nhwc.Vectorize()))));
+  for (size_t i = 0; i < src.size(); ++i) {
+    ASSERT_EQ(back[i], detail::HalfToFloat(detail::FloatToHalf(src[i])));
+  }
+
+  // same order, data type only
+  std::vector<float> copy(src.size());
+  ASSERT_TRUE(detail::TransLayout(src.data(), copy.data(), {DataType::FLOAT32, DimOrder::NHWC},
+                                  {DataType::FLOAT32, DimOrder::NHWC}, nhwc));
+  EXPECT_EQ(copy, src);
+
+  EXPECT_FALSE(detail::TransLayout(src.data(), copy.data(), {DataType::FLOAT32, DimOrder::NHWC},
+                                   {DataType::FLOAT32, DimOrder::TNC}, nhwc));
+}
+
+TEST(InferServerTransLayout, Benchmark) {
+  constexpr int loop = 10;
+  std::mt19937 gen(3);
+  struct Case {
+    const char *name;
+    size_t batch, rows, cols, elem_size;
+  };
+  // image sized tensors, NHWC to NCHW is rows = H * W, cols = C
+  const std::vector<Case> cases = {{"u8 NHWC->NCHW 8x416x416x3", 8, 416 * 416, 3, 1},
+                                   {"u8 NCHW->NHWC 8x3x416x416", 8, 3, 416 * 416, 1},
+                                   {"f16 NHWC->NCHW 8x52x52x255", 8, 52 * 52, 255, 2},
+                                   {"f32 NHWC->NCHW 8x52x52x255", 8, 52 * 52, 255, 4},
+                                   {"f32 NCHW->NHWC 8x255x52x52", 8, 255, 52 * 52, 4}};
+  for (const Case &c : cases) {
+    const size_t size = c.batch * c.rows * c.cols * c.elem_size;
+    std::vector<uint8_t> src = RandomBytes(size, &gen);
+    std::vector<uint8_t> dst(size);
+    double ms[2];
+    for (int n = 0; n < 2; ++n) {
+      auto start = std::chrono::steady_clock::now();
+      for (int l = 0; l < loop; ++l) {
+        ASSERT_TRUE(TransposeHost(src.data(), dst.data(), c.batch, c.rows, c.cols, c.elem_size, n == 1));
+      }
+      std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+      ms[n] = dura.count() / loop;
+    }
+    // bytes read and written
+    double gb = 2.0 * size / (1 << 30);
+    LOG(INFO) << "[EasyDK Tests] [InferServer] Transpose " << c.name << ", scalar: " << ms[0] << " ms ("
+              << gb / ms[0] * 1000 << " GB/s), simd: " << ms[1] << " ms (" << gb / ms[1] * 1000 << " GB/s)";
+  }
+}
+
+}  // namespace
+}  // namespace infer_server
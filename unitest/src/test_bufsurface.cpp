@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <numeric>
 #include <string>
@@ -31,6 +32,7 @@
 #include "cnedk_buf_surface.h"
 #include "cnedk_platform.h"
 
+#include "glog/logging.h"
 #include "test_base.h"
 
 static const size_t device_id = 0;
@@ -138,6 +140,87 @@ TEST(BufSurface, PoolCreateDestory) {
   }
 }
 
+TEST(BufSurface, PoolStats) {
+  CnedkBufPoolStats stats;
+  EXPECT_NE(CnedkBufPoolGetStats(nullptr, &stats), 0);
+
+  void* pool = nullptr;
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = device_id;
+  create_params.batch_size = 1;
+  create_params.width = 320;
+  create_params.height = 240;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  ASSERT_EQ(CnedkBufPoolCreate(&pool, &create_params, 3), 0);
+  EXPECT_NE(CnedkBufPoolGetStats(pool, nullptr), 0);
+
+  ASSERT_EQ(CnedkBufPoolGetStats(pool, &stats), 0);
+  EXPECT_EQ(stats.block_num, 3u);
+  EXPECT_EQ(stats.in_use, 0u);
+  EXPECT_EQ(stats.peak_in_use, 0u);
+  EXPECT_EQ(stats.acquire_count, 0u);
+
+  std::vector<CnedkBufSurface*> surfs(3, nullptr);
+  for (auto& surf : surfs) ASSERT_EQ(CnedkBufSurfaceCreateFromPool(&surf, pool), 0);
+  CnedkBufSurface* empty = nullptr;
+  EXPECT_NE(CnedkBufSurfaceCreateFromPool(&empty, pool), 0);
+  ASSERT_EQ(CnedkBufPoolGetStats(pool, &stats), 0);
+  EXPECT_EQ(stats.in_use, 3u);
+  EXPECT_EQ(stats.peak_in_use, 3u);
+  EXPECT_EQ(stats.acquire_count, 3u);
+  EXPECT_EQ(stats.empty_count, 1u);
+
+  ASSERT_EQ(CnedkBufSurfaceDestroy(surfs[0]), 0);
+  ASSERT_EQ(CnedkBufSurfaceDestroy(surfs[1]), 0);
+  ASSERT_EQ(CnedkBufSurfaceCreateFromPool(&surfs[0], pool), 0);
+  ASSERT_EQ(CnedkBufPoolGetStats(pool, &stats), 0);
+  EXPECT_EQ(stats.in_use, 2u);
+  EXPECT_EQ(stats.peak_in_use, 3u);
+  EXPECT_EQ(stats.acquire_count, 4u);
+  // no blocking acquirement through C API
+  EXPECT_EQ(std::accumulate(stats.wait_hist, stats.wait_hist + CNEDK_BUF_POOL_WAIT_HIST_BINS, uint64_t(0)), 0u);
+  EXPECT_EQ(stats.timeout_count, 0u);
+
+  ASSERT_EQ(CnedkBufSurfaceDestroy(surfs[0]), 0);
+  ASSERT_EQ(CnedkBufSurfaceDestroy(surfs[2]), 0);
+  ASSERT_EQ(CnedkBufPoolGetStats(pool, &stats), 0);
+  EXPECT_EQ(stats.in_use, 0u);
+  ASSERT_EQ(CnedkBufPoolDestroy(pool), 0);
+}
+
+TEST(BufSurface, PoolStatsOverhead) {
+  void* pool = nullptr;
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = device_id;
+  create_params.batch_size = 1;
+  create_params.size = 1024;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  ASSERT_EQ(CnedkBufPoolCreate(&pool, &create_params, 4), 0);
+
+  constexpr int loop = 100000;
+  CnedkBufSurface* surf = nullptr;
+  CnedkBufPoolStats stats;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loop; ++i) {
+    ASSERT_EQ(CnedkBufSurfaceCreateFromPool(&surf, pool), 0);
+    ASSERT_EQ(CnedkBufSurfaceDestroy(surf), 0);
+  }
+  std::chrono::duration<double, std::nano> acquire = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loop; ++i) {
+    ASSERT_EQ(CnedkBufPoolGetStats(pool, &stats), 0);
+  }
+  std::chrono::duration<double, std::nano> query = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(stats.acquire_count, static_cast<uint64_t>(loop));
+  LOG(INFO) << "[EasyDK Tests] [BufSurface] acquire + release: " << acquire.count() / loop << " ns, get stats: "
+            << query.count() / loop << " ns";
+  ASSERT_EQ(CnedkBufPoolDestroy(pool), 0);
+}
+
 TEST(BufSurface, CreateDestory) {
   {
     CnedkBufSurface* surf = nullptr;
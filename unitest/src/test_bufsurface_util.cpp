@@ -18,8 +18,12 @@
  * THE SOFTWARE.
  *************************************************************************/
 #include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "glog/logging.h"
 
@@ -142,6 +146,93 @@ TEST(BufSurfaceWrapper, Function) {
   pool = nullptr;
 }
 
+TEST(BufSurfaceWrapper, ContiguousBatch) {
+  constexpr uint32_t batch_size = 4;
+  constexpr uint32_t item_size = 64;
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = g_device_id;
+  create_params.batch_size = batch_size;
+  create_params.size = item_size;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+
+  cnedk::BufPool pool;
+  ASSERT_EQ(pool.CreatePool(&create_params, 1), 0);
+  cnedk::BufSurfWrapperPtr batch = pool.GetBufSurfaceWrapper();
+  ASSERT_TRUE(batch);
+  CnedkBufSurface *surf = batch->GetBufSurface();
+  ASSERT_TRUE(surf->is_contiguous);
+  // the whole batch is allocated as one block
+  uint8_t *base = static_cast<uint8_t *>(batch->GetData(0, 0));
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    ASSERT_EQ(batch->GetData(0, i), base + i * item_size);
+    EXPECT_EQ(batch->GetHostData(0, i), base + i * item_size);
+    memset(batch->GetData(0, i), i, item_size);
+  }
+  EXPECT_EQ(base[3 * item_size + item_size - 1], 3);
+  batch.reset();
+  pool.DestroyPool();
+}
+
+TEST(BufSurfaceWrapper, HostDataCoherence) {
+  constexpr uint32_t batch_size = 4;
+  constexpr uint32_t item_size = 256;
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = g_device_id;
+  create_params.batch_size = batch_size;
+  create_params.size = item_size;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  create_params.mem_type = CNEDK_BUF_MEM_DEVICE;
+
+  cnedk::BufPool pool;
+  ASSERT_EQ(pool.CreatePool(&create_params, 1), 0);
+  std::vector<uint8_t> data(batch_size * item_size, 1);
+  {
+    cnedk::BufSurfWrapperPtr surf = pool.GetBufSurfaceWrapper();
+    ASSERT_TRUE(surf);
+    void *dev = surf->GetData(0, 0);
+    ASSERT_EQ(cnrtMemcpy(dev, data.data(), data.size(), cnrtMemcpyHostToDev), cnrtSuccess);
+
+    uint8_t *host = static_cast<uint8_t *>(surf->GetHostData(0, 1));
+    ASSERT_TRUE(host);
+    EXPECT_EQ(host[0], 1);
+    // the batch is mirrored at once, pointers are stable
+    EXPECT_EQ(surf->GetHostData(0, 3), host + 2 * item_size);
+    EXPECT_EQ(surf->GetHostData(0, 1), host);
+
+    // device modified, host data is refreshed after invalidation only
+    std::vector<uint8_t> item(item_size, 2);
+    ASSERT_EQ(cnrtMemcpy(surf->GetData(0, 1), item.data(), item_size, cnrtMemcpyHostToDev), cnrtSuccess);
+    EXPECT_EQ(static_cast<uint8_t *>(surf->GetHostData(0, 1))[0], 1);
+    surf->InvalidateHostData(1);
+    EXPECT_EQ(surf->GetHostData(0, 1), host);
+    EXPECT_EQ(host[0], 2);
+    EXPECT_EQ(host[item_size], 1);
+
+    // host modified, synchronized to device
+    memset(surf->GetHostData(0, 2), 3, item_size);
+    surf->SyncHostToDevice(-1, 2);
+    surf->InvalidateHostData();
+    EXPECT_EQ(static_cast<uint8_t *>(surf->GetHostData(0, 2))[item_size - 1], 3);
+    EXPECT_EQ(static_cast<uint8_t *>(surf->GetHostData(0, 1))[0], 2);
+    memset(surf->GetHostData(0, 0), 4, batch_size * item_size);
+    surf->SyncHostToDevice();
+    ASSERT_EQ(cnrtMemcpy(data.data(), dev, data.size(), cnrtMemcpyDevToHost), cnrtSuccess);
+    EXPECT_EQ(data[0], 4);
+    EXPECT_EQ(data[batch_size * item_size - 1], 4);
+  }
+  {
+    // mirror of the former user is not left mapped
+    cnedk::BufSurfWrapperPtr surf = pool.GetBufSurfaceWrapper();
+    ASSERT_TRUE(surf);
+    EXPECT_FALSE(surf->GetSurfaceParams(0)->mapped_data_ptr);
+    EXPECT_EQ(static_cast<uint8_t *>(surf->GetHostData(0, 0))[0], 4);
+  }
+  pool.DestroyPool();
+}
+
 TEST(PlatformJudge, PlatformJudge) {
   EXPECT_NE(IsEdgePlatform(g_device_id), IsCloudPlatform(g_device_id));
 
@@ -200,4 +291,55 @@ TEST(BufPool, BufPool) {
   temp_wrapper = pool.GetBufSurfaceWrapper();
   ASSERT_EQ(temp_wrapper, nullptr);
 }
+
+TEST(BufPool, Stats) {
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = g_device_id;
+  create_params.batch_size = 1;
+  create_params.size = 256;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+
+  cnedk::BufPool pool;
+  CnedkBufPoolStats stats;
+  ASSERT_NE(pool.GetStats(&stats), 0);
+  ASSERT_EQ(pool.CreatePool(&create_params, 2), 0);
+
+  cnedk::BufSurfWrapperPtr a = pool.GetBufSurfaceWrapper();
+  cnedk::BufSurfWrapperPtr b = pool.GetBufSurfaceWrapper();
+  ASSERT_TRUE(a && b);
+  // pool is empty, waits and times out
+  ASSERT_FALSE(pool.GetBufSurfaceWrapper(20));
+  // released by another thread while waiting
+  std::thread releaser([&a]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    a.reset();
+  });
+  cnedk::BufSurfWrapperPtr c = pool.GetBufSurfaceWrapper(1000);
+  releaser.join();
+  ASSERT_TRUE(c);
+
+  ASSERT_EQ(pool.GetStats(&stats), 0);
+  EXPECT_EQ(stats.block_num, 2u);
+  EXPECT_EQ(stats.in_use, 2u);
+  EXPECT_EQ(stats.peak_in_use, 2u);
+  EXPECT_EQ(stats.acquire_count, 3u);
+  EXPECT_EQ(stats.timeout_count, 1u);
+  EXPECT_GT(stats.empty_count, 0u);
+  // two acquirements without waiting, the timed out one and the last one waited for milliseconds
+  EXPECT_EQ(stats.wait_hist[0], 2u);
+  uint64_t waited = 0;
+  for (int i = 1; i < CNEDK_BUF_POOL_WAIT_HIST_BINS; ++i) waited += stats.wait_hist[i];
+  EXPECT_EQ(waited, 2u);
+  EXPECT_EQ(stats.wait_hist[1], 0u);
+  EXPECT_EQ(stats.wait_hist[2], 0u);
+
+  b.reset();
+  c.reset();
+  ASSERT_EQ(pool.GetStats(&stats), 0);
+  EXPECT_EQ(stats.in_use, 0u);
+  pool.DestroyPool();
+}
+
 }  // end namespace cnedk
@@ -0,0 +1,265 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+#include "host_staging_pool.hpp"
+
+namespace cnedk {
+namespace {
+
+// "device" memory is system memory, counts transfers
+class SystemCopyEngine : public ICopyEngine {
+ public:
+  void *AllocHost(size_t size) override {
+    ++alloc_num;
+    return malloc(size);
+  }
+  void FreeHost(void *ptr) override {
+    ++free_num;
+    free(ptr);
+  }
+  int CopyToHost(void *dst, const void *src, size_t size) override {
+    d2h_sizes.push_back(size);
+    memcpy(dst, src, size);
+    return 0;
+  }
+  int CopyToDevice(void *dst, const void *src, size_t size) override {
+    h2d_sizes.push_back(size);
+    memcpy(dst, src, size);
+    return 0;
+  }
+
+  int alloc_num = 0;
+  int free_num = 0;
+  std::vector<size_t> d2h_sizes;
+  std::vector<size_t> h2d_sizes;
+};
+
+class FakeDeviceBatch {
+ public:
+  // items are placed at stride apart, adjacent if stride equals item size
+  FakeDeviceBatch(uint32_t batch_size, uint32_t item_size, uint32_t stride)
+      : memory_(batch_size * stride), params_(batch_size) {
+    memset(&surf_, 0, sizeof(surf_));
+    memset(params_.data(), 0, sizeof(CnedkBufSurfaceParams) * batch_size);
+    for (uint32_t i = 0; i < batch_size; ++i) {
+      params_[i].data_ptr = memory_.data() + i * stride;
+      params_[i].data_size = item_size;
+      memset(params_[i].data_ptr, i, item_size);
+    }
+    surf_.mem_type = CNEDK_BUF_MEM_DEVICE;
+    surf_.batch_size = batch_size;
+    surf_.num_filled = batch_size;
+    surf_.surface_list = params_.data();
+  }
+  CnedkBufSurface *Surf() { return &surf_; }
+  uint8_t *Item(uint32_t i) { return static_cast<uint8_t *>(params_[i].data_ptr); }
+
+ private:
+  std::vector<uint8_t> memory_;
+  std::vector<CnedkBufSurfaceParams> params_;
+  CnedkBufSurface surf_;
+};
+
+TEST(HostStagingPool, Reuse) {
+  SystemCopyEngine *engine = new SystemCopyEngine;
+  HostStagingPool pool(engine, 2 * HostStagingPool::kMinCapacity);
+  size_t cap_a = 0, cap_b = 0, cap_c = 0;
+  void *a = pool.Acquire(100, &cap_a);
+  ASSERT_TRUE(a);
+  EXPECT_EQ(cap_a, HostStagingPool::kMinCapacity);
+  pool.Release(a, cap_a);
+  EXPECT_EQ(pool.CachedBytes(), cap_a);
+
+  // same bucket is reused
+  void *b = pool.Acquire(HostStagingPool::kMinCapacity, &cap_b);
+  EXPECT_EQ(b, a);
+  EXPECT_EQ(pool.AllocCount(), 1u);
+  EXPECT_EQ(pool.CachedBytes(), 0u);
+
+  // larger size goes to another bucket
+  void *c = pool.Acquire(HostStagingPool::kMinCapacity + 1, &cap_c);
+  ASSERT_TRUE(c);
+  EXPECT_EQ(cap_c, 2 * HostStagingPool::kMinCapacity);
+  EXPECT_EQ(pool.AllocCount(), 2u);
+
+  // buffers beyond the cache limit are freed
+  pool.Release(c, cap_c);
+  pool.Release(b, cap_b);
+  EXPECT_EQ(pool.CachedBytes(), cap_c);
+  EXPECT_EQ(engine->free_num, 1);
+}
+
+TEST(HostMirror, CoalesceAdjacentItems) {
+  SystemCopyEngine *engine = new SystemCopyEngine;
+  HostStagingPool pool(engine);
+  FakeDeviceBatch batch(4, 64, 64);
+  HostMirror mirror(&pool);
+
+  uint8_t *item2 = static_cast<uint8_t *>(mirror.Get(batch.Surf(), 2));
+  ASSERT_TRUE(item2);
+  EXPECT_EQ(item2[0], 2);
+  // the whole batch is copied at once
+  ASSERT_EQ(engine->d2h_sizes.size(), 1u);
+  EXPECT_EQ(engine->d2h_sizes[0], 4u * 64);
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_TRUE(mirror.Valid(i));
+    uint8_t *item = static_cast<uint8_t *>(mirror.Get(batch.Surf(), i));
+    EXPECT_EQ(item, item2 + (static_cast<int>(i) - 2) * 64);
+    EXPECT_EQ(item[63], i);
+    EXPECT_TRUE(mirror.Owns(item));
+  }
+  EXPECT_EQ(engine->d2h_sizes.size(), 1u);
+  EXPECT_EQ(pool.AllocCount(), 1u);
+
+  // write back in one transfer
+  ASSERT_EQ(mirror.Sync(batch.Surf(), -1), 0);
+  ASSERT_EQ(engine->h2d_sizes.size(), 1u);
+  EXPECT_EQ(engine->h2d_sizes[0], 4u * 64);
+}
+
+TEST(HostMirror, SeparateItems) {
+  SystemCopyEngine *engine = new SystemCopyEngine;
+  HostStagingPool pool(engine);
+  FakeDeviceBatch batch(4, 64, 128);
+  HostMirror mirror(&pool);
+
+  uint8_t *item1 = static_cast<uint8_t *>(mirror.Get(batch.Surf(), 1));
+  ASSERT_TRUE(item1);
+  EXPECT_EQ(item1[0], 1);
+  EXPECT_EQ(engine->d2h_sizes.size(), 1u);
+  EXPECT_FALSE(mirror.Valid(0));
+  EXPECT_FALSE(mirror.Valid(2));
+  ASSERT_TRUE(mirror.Get(batch.Surf(), 3));
+  EXPECT_EQ(engine->d2h_sizes.size(), 2u);
+
+  // items never read are not written back
+  ASSERT_EQ(mirror.Sync(batch.Surf(), -1), 0);
+  EXPECT_EQ(engine->h2d_sizes.size(), 2u);
+  EXPECT_NE(mirror.Sync(batch.Surf(), 0), 0);
+}
+
+TEST(HostMirror, FetchOnceAndCached) {
+  SystemCopyEngine *engine = new SystemCopyEngine;
+  HostStagingPool pool(engine);
+  FakeDeviceBatch batch(4, 64, 128);
+  HostMirror mirror(&pool);
+  EXPECT_FALSE(mirror.Cached(batch.Surf(), 0));
+
+  // items not adjacent are transferred one by one, at once for the batch
+  ASSERT_EQ(mirror.Fetch(batch.Surf()), 0);
+  EXPECT_EQ(engine->d2h_sizes.size(), 4u);
+  for (uint32_t i = 0; i < 4; ++i) {
+    uint8_t *item = static_cast<uint8_t *>(mirror.Cached(batch.Surf(), i));
+    ASSERT_TRUE(item);
+    EXPECT_EQ(item[63], i);
+    EXPECT_EQ(item, mirror.Get(batch.Surf(), i));
+  }
+  ASSERT_EQ(mirror.Fetch(batch.Surf()), 0);
+  EXPECT_EQ(engine->d2h_sizes.size(), 4u);
+
+  // stale and moved items are not cached, only they are fetched again
+  mirror.Invalidate(1);
+  EXPECT_FALSE(mirror.Cached(batch.Surf(), 1));
+  CnedkBufSurfaceParams &item3 = batch.Surf()->surface_list[3];
+  item3.data_ptr = batch.Item(2) + 64;
+  EXPECT_FALSE(mirror.Cached(batch.Surf(), 3));
+  EXPECT_TRUE(mirror.Cached(batch.Surf(), 2));
+  ASSERT_EQ(mirror.Fetch(batch.Surf()), 0);
+  EXPECT_EQ(engine->d2h_sizes.size(), 6u);
+  EXPECT_TRUE(mirror.Cached(batch.Surf(), 1));
+  EXPECT_TRUE(mirror.Cached(batch.Surf(), 3));
+}
+
+TEST(HostMirror, Coherence) {
+  SystemCopyEngine *engine = new SystemCopyEngine;
+  HostStagingPool pool(engine);
+  FakeDeviceBatch batch(4, 64, 64);
+
+  {
+    HostMirror mirror(&pool);
+    uint8_t *item1 = static_cast<uint8_t *>(mirror.Get(batch.Surf(), 1));
+    ASSERT_TRUE(item1);
+
+    // device is modified, mirror keeps the old data until it is invalidated
+    memset(batch.Item(1), 0x11, 64);
+    memset(batch.Item(2), 0x22, 64);
+    EXPECT_EQ(static_cast<uint8_t *>(mirror.Get(batch.Surf(), 1))[0], 1);
+    EXPECT_EQ(engine->d2h_sizes.size(), 1u);
+
+    mirror.Invalidate(1);
+    EXPECT_FALSE(mirror.Valid(1));
+    EXPECT_TRUE(mirror.Valid(2));
+    EXPECT_EQ(mirror.Get(batch.Surf(), 1), item1);
+    EXPECT_EQ(item1[0], 0x11);
+    // only the stale item is copied
+    ASSERT_EQ(engine->d2h_sizes.size(), 2u);
+    EXPECT_EQ(engine->d2h_sizes[1], 64u);
+    EXPECT_EQ(static_cast<uint8_t *>(mirror.Get(batch.Surf(), 2))[0], 2);
+
+    // host writes reach device, and the mirror stays valid
+    memset(mirror.Get(batch.Surf(), 3), 0x33, 64);
+    ASSERT_EQ(mirror.Sync(batch.Surf(), 3), 0);
+    EXPECT_EQ(batch.Item(3)[63], 0x33);
+    EXPECT_EQ(batch.Item(2)[0], 0x22);
+    EXPECT_TRUE(mirror.Valid(3));
+
+    mirror.Invalidate(-1);
+    EXPECT_EQ(static_cast<uint8_t *>(mirror.Get(batch.Surf(), 0))[64 * 2], 0x22);
+    EXPECT_EQ(engine->d2h_sizes.back(), 4u * 64);
+  }
+  // staging buffer is back to pool
+  EXPECT_EQ(pool.CachedBytes(), HostStagingPool::kMinCapacity);
+  HostMirror another(&pool);
+  ASSERT_TRUE(another.Get(batch.Surf(), 0));
+  EXPECT_EQ(pool.AllocCount(), 1u);
+}
+
+TEST(HostMirror, ReuseForAnotherBatch) {
+  SystemCopyEngine *engine = new SystemCopyEngine;
+  HostStagingPool pool(engine);
+  HostMirror mirror(&pool);
+  FakeDeviceBatch first(2, 64, 64);
+  ASSERT_EQ(static_cast<uint8_t *>(mirror.Get(first.Surf(), 1))[0], 1);
+
+  // items of the same size at other addresses are stale
+  FakeDeviceBatch second(2, 64, 128);
+  memset(second.Item(1), 0x22, 64);
+  ASSERT_EQ(static_cast<uint8_t *>(mirror.Get(second.Surf(), 1))[0], 0x22);
+  EXPECT_FALSE(mirror.Valid(0));
+
+  // larger items are laid out again
+  FakeDeviceBatch third(2, 3 * HostStagingPool::kMinCapacity, 3 * HostStagingPool::kMinCapacity);
+  memset(third.Item(1), 0x33, 3 * HostStagingPool::kMinCapacity);
+  uint8_t *item1 = static_cast<uint8_t *>(mirror.Get(third.Surf(), 1));
+  ASSERT_TRUE(item1);
+  EXPECT_EQ(item1[3 * HostStagingPool::kMinCapacity - 1], 0x33);
+  EXPECT_TRUE(mirror.Owns(item1 + 3 * HostStagingPool::kMinCapacity - 1));
+  EXPECT_EQ(static_cast<uint8_t *>(mirror.Get(third.Surf(), 0))[0], 0);
+}
+
+}  // namespace
+}  // namespace cnedk
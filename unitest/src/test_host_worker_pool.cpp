@@ -0,0 +1,77 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "host_worker_pool.hpp"
+
+namespace cnedk {
+namespace {
+
+TEST(HostWorkerPool, RunEachTaskOnce) {
+  HostWorkerPool pool(4);
+  EXPECT_EQ(pool.Concurrency(), 4u);
+  for (uint32_t num : {0u, 1u, 3u, 100u}) {
+    std::vector<std::atomic<int>> counts(num);
+    for (auto &count : counts) count.store(0);
+    pool.ParallelFor(num, [&](uint32_t i) { counts[i].fetch_add(1); });
+    for (uint32_t i = 0; i < num; ++i) EXPECT_EQ(counts[i].load(), 1) << "num " << num << ", task " << i;
+  }
+}
+
+TEST(HostWorkerPool, SetConcurrency) {
+  HostWorkerPool pool(1);
+  std::atomic<int> sum{0};
+  for (uint32_t concurrency : {1u, 3u, 8u, 2u, 1000u}) {
+    pool.SetConcurrency(concurrency);
+    EXPECT_EQ(pool.Concurrency(), std::min(concurrency, HostWorkerPool::kMaxThreads));
+    sum.store(0);
+    pool.ParallelFor(50, [&](uint32_t i) { sum.fetch_add(i); });
+    EXPECT_EQ(sum.load(), 49 * 50 / 2);
+  }
+  pool.SetConcurrency(0);
+  EXPECT_EQ(pool.Concurrency(), 1u);
+  EXPECT_GE(HostWorkerPool::DefaultConcurrency(), 1u);
+  EXPECT_LE(HostWorkerPool::DefaultConcurrency(), 8u);
+}
+
+TEST(HostWorkerPool, ConcurrentCallers) {
+  // callers arriving while the pool is busy run their tasks by themselves, nested calls as well
+  HostWorkerPool pool(3);
+  std::vector<std::thread> callers;
+  std::atomic<int> total{0};
+  for (int t = 0; t < 4; ++t) {
+    callers.emplace_back([&] {
+      for (int l = 0; l < 50; ++l) {
+        pool.ParallelFor(8, [&](uint32_t) { pool.ParallelFor(2, [&](uint32_t) { total.fetch_add(1); }); });
+      }
+    });
+  }
+  for (auto &caller : callers) caller.join();
+  EXPECT_EQ(total.load(), 4 * 50 * 8 * 2);
+}
+
+}  // namespace
+}  // namespace cnedk
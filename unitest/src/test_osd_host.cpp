@@ -0,0 +1,235 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_osd.h"
+
+namespace {
+
+class HostImage {
+ public:
+  HostImage(CnedkBufSurfaceColorFormat fmt, uint32_t width, uint32_t height) {
+    CnedkBufSurfaceCreateParams params;
+    memset(&params, 0, sizeof(params));
+    params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+    params.batch_size = 1;
+    params.width = width;
+    params.height = height;
+    params.color_format = fmt;
+    CnedkBufSurfaceCreate(&surf_, &params);
+  }
+  ~HostImage() {
+    if (surf_) CnedkBufSurfaceDestroy(surf_);
+  }
+  CnedkBufSurface *Surf() { return surf_; }
+  CnedkBufSurfaceParams &Params() { return surf_->surface_list[0]; }
+  uint8_t *Plane(int i) { return static_cast<uint8_t *>(Params().data_ptr) + Params().plane_params.offset[i]; }
+  bool IsYuv() {
+    return Params().color_format == CNEDK_BUF_COLOR_FORMAT_NV12 || Params().color_format == CNEDK_BUF_COLOR_FORMAT_NV21;
+  }
+  std::vector<uint8_t> Bytes() {
+    const uint8_t *data = static_cast<uint8_t *>(Params().data_ptr);
+    return std::vector<uint8_t>(data, data + Params().data_size);
+  }
+  void Fill(std::mt19937 *gen) {
+    std::uniform_int_distribution<int> dis(0, 255);
+    uint8_t *data = static_cast<uint8_t *>(Params().data_ptr);
+    for (uint32_t i = 0; i < Params().data_size; ++i) data[i] = dis(*gen);
+  }
+
+ private:
+  CnedkBufSurface *surf_ = nullptr;
+};
+
+// per pixel reference, colors in BT.601 video range
+struct RefPixel {
+  int c[3];
+};
+
+RefPixel RefColor(HostImage *img, int r, int g, int b) {
+  const CnedkBufSurfaceColorFormat fmt = img->Params().color_format;
+  RefPixel p;
+  if (img->IsYuv()) {
+    int y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+    int u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+    int v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    p = RefPixel{{y, fmt == CNEDK_BUF_COLOR_FORMAT_NV12 ? u : v, fmt == CNEDK_BUF_COLOR_FORMAT_NV12 ? v : u}};
+  } else {
+    p = fmt == CNEDK_BUF_COLOR_FORMAT_RGB ? RefPixel{{r, g, b}} : RefPixel{{b, g, r}};
+  }
+  return p;
+}
+
+// writes or blends by half pixel (x, y), chroma is touched by the pixel at top left of a 2x2 block
+void RefPut(HostImage *img, int x, int y, const RefPixel &p, bool blend) {
+  auto put = [blend](uint8_t *dst, int v) { *dst = blend ? (*dst + v + 1) >> 1 : v; };
+  const CnedkBufSurfaceParams &params = img->Params();
+  if (!img->IsYuv()) {
+    uint8_t *px = img->Plane(0) + y * params.plane_params.pitch[0] + x * 3;
+    for (int k = 0; k < 3; ++k) put(px + k, p.c[k]);
+    return;
+  }
+  put(img->Plane(0) + y * params.plane_params.pitch[0] + x, p.c[0]);
+  if (x % 2 == 0 && y % 2 == 0) {
+    uint8_t *uv = img->Plane(1) + y / 2 * params.plane_params.pitch[1] + x;
+    put(uv, p.c[1]);
+    put(uv + 1, p.c[2]);
+  }
+}
+
+void RefRects(HostImage *img, const std::vector<CnedkOsdRectParams> &rects, bool fill) {
+  const int w = img->Params().width, h = img->Params().height;
+  for (const CnedkOsdRectParams &r : rects) {
+    const RefPixel p = RefColor(img, (r.color >> 16) & 0xff, (r.color >> 8) & 0xff, r.color & 0xff);
+    const int lw = std::max<int>(r.line_width, 1);
+    for (int y = std::max(r.y, 0); y < std::min(r.y + r.h, h); ++y) {
+      for (int x = std::max(r.x, 0); x < std::min(r.x + r.w, w); ++x) {
+        bool inner = x >= r.x + lw && x < r.x + r.w - lw && y >= r.y + lw && y < r.y + r.h - lw;
+        if (fill || !inner) RefPut(img, x, y, p, false);
+      }
+    }
+  }
+}
+
+void RefBitmap(HostImage *img, const CnedkOsdBitmapParams &bmp) {
+  const int w = img->Params().width, h = img->Params().height;
+  for (int y = std::max(bmp.y, 0); y < std::min(bmp.y + bmp.h, h); ++y) {
+    for (int x = std::max(bmp.x, 0); x < std::min(bmp.x + bmp.w, w); ++x) {
+      const uint8_t *row = static_cast<const uint8_t *>(bmp.bitmap_argb1555) + (y - bmp.y) * bmp.pitch;
+      uint16_t v = reinterpret_cast<const uint16_t *>(row)[x - bmp.x];
+      if (!(v & 0x8000)) continue;
+      int r = (v >> 10) & 31, g = (v >> 5) & 31, b = v & 31;
+      RefPut(img, x, y, RefColor(img, (r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2)), true);
+    }
+  }
+}
+
+std::vector<CnedkOsdRectParams> RandomRects(int num, int width, int height, std::mt19937 *gen) {
+  std::uniform_int_distribution<int> x(-40, width), y(-40, height), size(0, 300), line(0, 7);
+  std::uniform_int_distribution<uint32_t> color(0, 0xffffff);
+  std::vector<CnedkOsdRectParams> rects;
+  for (int i = 0; i < num; ++i) {
+    rects.push_back(CnedkOsdRectParams{x(*gen), y(*gen), size(*gen), size(*gen), color(*gen),
+                                       static_cast<uint32_t>(line(*gen))});
+  }
+  return rects;
+}
+
+const CnedkBufSurfaceColorFormat kFormats[] = {CNEDK_BUF_COLOR_FORMAT_NV12, CNEDK_BUF_COLOR_FORMAT_NV21,
+                                               CNEDK_BUF_COLOR_FORMAT_RGB, CNEDK_BUF_COLOR_FORMAT_BGR};
+
+TEST(OsdHost, Rects) {
+  std::mt19937 gen(11);
+  for (CnedkBufSurfaceColorFormat fmt : kFormats) {
+    for (bool fill : {false, true}) {
+      HostImage img(fmt, 333, 251), ref(fmt, 333, 251);
+      img.Fill(&gen);
+      memcpy(ref.Params().data_ptr, img.Params().data_ptr, img.Params().data_size);
+      // overlapping, clipped, odd and empty rectangles
+      std::vector<CnedkOsdRectParams> rects = RandomRects(60, 333, 251, &gen);
+      rects.push_back(CnedkOsdRectParams{-5, -5, 400, 300, 0xff0000, 3});
+      rects.push_back(CnedkOsdRectParams{11, 13, 1, 1, 0x00ff00, 2});
+      rects.push_back(CnedkOsdRectParams{20, 20, -3, 10, 0x0000ff, 1});
+      if (fill) {
+        ASSERT_EQ(CnedkFillRect(img.Surf(), rects.data(), rects.size()), 0);
+      } else {
+        ASSERT_EQ(CnedkDrawRect(img.Surf(), rects.data(), rects.size()), 0);
+      }
+      RefRects(&ref, rects, fill);
+      EXPECT_TRUE(img.Bytes() == ref.Bytes()) << "format " << fmt << ", fill " << fill;
+    }
+  }
+}
+
+TEST(OsdHost, Bitmap) {
+  std::mt19937 gen(13);
+  std::uniform_int_distribution<int> dis(0, 0xffff);
+  for (CnedkBufSurfaceColorFormat fmt : kFormats) {
+    HostImage img(fmt, 200, 120), ref(fmt, 200, 120);
+    img.Fill(&gen);
+    memcpy(ref.Params().data_ptr, img.Params().data_ptr, img.Params().data_size);
+    // pitch is larger than the row, odd positions and clipping at each side
+    const int bw = 77, bh = 31, pitch = 96 * 2;
+    std::vector<uint16_t> bitmap(pitch / 2 * bh);
+    for (auto &v : bitmap) v = dis(gen);
+    std::vector<CnedkOsdBitmapParams> params;
+    for (auto pos : {std::make_pair(3, 5), std::make_pair(10, 10), std::make_pair(-9, -3), std::make_pair(150, 100),
+                     std::make_pair(61, 40)}) {
+      params.push_back(CnedkOsdBitmapParams{pos.first, pos.second, bw, bh, static_cast<uint32_t>(pitch),
+                                            bitmap.data(), 0});
+    }
+    ASSERT_EQ(CnedkDrawBitmap(img.Surf(), params.data(), params.size()), 0);
+    for (const auto &p : params) RefBitmap(&ref, p);
+    EXPECT_TRUE(img.Bytes() == ref.Bytes()) << "format " << fmt;
+  }
+}
+
+TEST(OsdHost, Unsupported) {
+  HostImage img(CNEDK_BUF_COLOR_FORMAT_ARGB, 64, 64);
+  CnedkOsdRectParams rect{0, 0, 8, 8, 0, 1};
+  EXPECT_NE(CnedkDrawRect(img.Surf(), &rect, 1), 0);
+  HostImage nv12(CNEDK_BUF_COLOR_FORMAT_NV12, 64, 64);
+  EXPECT_NE(CnedkFillRect(nv12.Surf(), nullptr, 1), 0);
+  uint16_t bitmap[16];
+  CnedkOsdBitmapParams bmp{0, 0, 16, 1, 16, bitmap, 0};
+  EXPECT_NE(CnedkDrawBitmap(nv12.Surf(), &bmp, 1), 0);
+}
+
+TEST(OsdHost, Benchmark) {
+  constexpr int kLoop = 20;
+  std::mt19937 gen(17);
+  HostImage img(CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080);
+  img.Fill(&gen);
+  std::vector<CnedkOsdRectParams> rects;
+  std::uniform_int_distribution<int> x(0, 1700), y(0, 900), size(40, 220);
+  for (int i = 0; i < 100; ++i) {
+    rects.push_back(CnedkOsdRectParams{x(gen), y(gen), size(gen), size(gen), 0x00ff00u * (i % 3) + 0x40, 3});
+  }
+  // a label above each box, 12 characters of 16x32
+  std::vector<uint16_t> label(192 * 32);
+  for (size_t i = 0; i < label.size(); ++i) label[i] = (i % 3) ? 0xffff : 0x0000;
+  std::vector<CnedkOsdBitmapParams> labels;
+  for (const auto &r : rects) labels.push_back(CnedkOsdBitmapParams{r.x, r.y, 192, 32, 192 * 2, label.data(), 0});
+
+  auto start = std::chrono::steady_clock::now();
+  for (int l = 0; l < kLoop; ++l) ASSERT_EQ(CnedkDrawRect(img.Surf(), rects.data(), rects.size()), 0);
+  std::chrono::duration<double, std::milli> draw = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  for (int l = 0; l < kLoop; ++l) ASSERT_EQ(CnedkDrawBitmap(img.Surf(), labels.data(), labels.size()), 0);
+  std::chrono::duration<double, std::milli> text = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  for (int l = 0; l < kLoop; ++l) RefRects(&img, rects, false);
+  std::chrono::duration<double, std::milli> ref = std::chrono::steady_clock::now() - start;
+  LOG(INFO) << "[EasyDK Tests] [OsdHost] 100 boxes on NV12 1080p: " << draw.count() / kLoop
+            << " ms, per pixel reference " << ref.count() / kLoop << " ms, 100 labels of 192x32: "
+            << text.count() / kLoop << " ms";
+}
+
+}  // namespace
@@ -324,6 +324,42 @@ TEST(Transform, MeanStd) {
   }
 }
 
+TEST(Transform, LetterboxWithMeanStd) {
+  CnedkTransformParams params;
+  memset(&params, 0, sizeof(params));
+
+  CnedkTransformMeanStdParams mean_std_params;
+  for (uint32_t c_i = 0; c_i < 3; c_i++) {
+    mean_std_params.mean[c_i] = 127.5;
+    mean_std_params.std[c_i] = 127.5;
+  }
+  params.mean_std_params = &mean_std_params;
+
+  CnedkTransformLetterboxParams letterbox;
+  memset(&letterbox, 0x80, sizeof(letterbox));
+  params.letterbox_params = &letterbox;
+
+  CnedkTransformTensorDesc dst_desc;
+  dst_desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_BGR;
+  dst_desc.data_type = CNEDK_TRANSFORM_FLOAT32;
+  dst_desc.shape.n = 1;
+  dst_desc.shape.c = 3;
+  dst_desc.shape.h = 416;
+  dst_desc.shape.w = 416;
+  params.dst_desc = &dst_desc;
+
+  // fused mean std resize does not pad, letterbox must not be stretched silently
+  params.transform_flag = CNEDK_TRANSFORM_MEAN_STD | CNEDK_TRANSFORM_LETTERBOX;
+  EXPECT_NE(TestTensorFun(CNEDK_BUF_COLOR_FORMAT_NV12, CNEDK_BUF_COLOR_FORMAT_TENSOR, 1920, 1080, 416, 416, &params),
+            0);
+  EXPECT_NE(TestTensorFun(CNEDK_BUF_COLOR_FORMAT_BGR, CNEDK_BUF_COLOR_FORMAT_TENSOR, 1920, 1080, 416, 416, &params),
+            0);
+
+  params.transform_flag = CNEDK_TRANSFORM_LETTERBOX;
+  dst_desc.data_type = CNEDK_TRANSFORM_UINT8;
+  EXPECT_EQ(TestTensorFun(CNEDK_BUF_COLOR_FORMAT_NV12, CNEDK_BUF_COLOR_FORMAT_TENSOR, 1920, 1080, 416, 416, &params),
+            0);
+}
 
 TEST(Transform, Tensor) {
   CnedkTransformParams params;
@@ -0,0 +1,776 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_transform.h"
+#include "core/cast_kernel.h"
+
+namespace {
+
+class HostSurface {
+ public:
+  // image if size is 0, otherwise tensor of size bytes
+  HostSurface(CnedkBufSurfaceColorFormat fmt, uint32_t width, uint32_t height, uint32_t size = 0) {
+    CnedkBufSurfaceCreateParams params;
+    memset(&params, 0, sizeof(params));
+    params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+    params.batch_size = 1;
+    params.width = width;
+    params.height = height;
+    params.size = size;
+    params.color_format = fmt;
+    params.force_align_1 = 1;
+    CnedkBufSurfaceCreate(&surf_, &params);
+  }
+  ~HostSurface() {
+    if (surf_) CnedkBufSurfaceDestroy(surf_);
+  }
+  CnedkBufSurface *Surf() { return surf_; }
+  CnedkBufSurfaceParams &Params() { return surf_->surface_list[0]; }
+  uint8_t *Data() { return static_cast<uint8_t *>(surf_->surface_list[0].data_ptr); }
+
+ private:
+  CnedkBufSurface *surf_ = nullptr;
+};
+
+void FillRandom(HostSurface *surf, std::mt19937 *gen) {
+  std::uniform_int_distribution<int> dis(0, 255);
+  for (uint32_t i = 0; i < surf->Params().data_size; ++i) surf->Data()[i] = dis(*gen);
+}
+
+// unfused chain: crop and upsample chroma, resize, convert color, normalize, each into its own buffer
+std::vector<float> ReferenceTransform(HostSurface *src, const CnedkTransformRect &src_roi, uint32_t dst_w,
+                                      uint32_t dst_h, const CnedkTransformRect &dst_roi, bool bgr,
+                                      const CnedkTransformMeanStdParams *mean_std) {
+  const CnedkBufSurfaceParams &p = src->Params();
+  const bool yuv = p.color_format == CNEDK_BUF_COLOR_FORMAT_NV12 || p.color_format == CNEDK_BUF_COLOR_FORMAT_NV21;
+  const bool gray = p.color_format == CNEDK_BUF_COLOR_FORMAT_GRAY8;
+  // 1. crop, three channels per pixel (YUV or RGB)
+  std::vector<float> crop(src_roi.width * src_roi.height * 3);
+  for (uint32_t y = 0; y < src_roi.height; ++y) {
+    for (uint32_t x = 0; x < src_roi.width; ++x) {
+      uint32_t sx = src_roi.left + x, sy = src_roi.top + y;
+      float *px = &crop[(y * src_roi.width + x) * 3];
+      if (yuv) {
+        const uint8_t *uv = src->Data() + p.plane_params.offset[1] + (sy / 2) * p.plane_params.pitch[1] + sx / 2 * 2;
+        bool nv12 = p.color_format == CNEDK_BUF_COLOR_FORMAT_NV12;
+        px[0] = src->Data()[sy * p.plane_params.pitch[0] + sx];
+        px[1] = nv12 ? uv[0] : uv[1];
+        px[2] = nv12 ? uv[1] : uv[0];
+      } else if (gray) {
+        px[0] = px[1] = px[2] = src->Data()[sy * p.plane_params.pitch[0] + sx];
+      } else {
+        const uint8_t *rgb = src->Data() + sy * p.plane_params.pitch[0] + sx * 3;
+        bool is_rgb = p.color_format == CNEDK_BUF_COLOR_FORMAT_RGB;
+        px[0] = is_rgb ? rgb[0] : rgb[2];
+        px[1] = rgb[1];
+        px[2] = is_rgb ? rgb[2] : rgb[0];
+      }
+    }
+  }
+  // 2. bilinear resize, pixel centers aligned
+  auto coord = [](uint32_t d, uint32_t src_len, uint32_t dst_len, int *i0, int *i1, double *w) {
+    double s = (d + 0.5) * src_len / dst_len - 0.5;
+    if (s < 0) s = 0;
+    *i0 = std::min(static_cast<int>(s), static_cast<int>(src_len) - 1);
+    *i1 = std::min(*i0 + 1, static_cast<int>(src_len) - 1);
+    *w = *i0 == *i1 ? 0 : s - *i0;
+  };
+  std::vector<float> resized(dst_roi.width * dst_roi.height * 3);
+  for (uint32_t y = 0; y < dst_roi.height; ++y) {
+    int y0, y1;
+    double wy;
+    coord(y, src_roi.height, dst_roi.height, &y0, &y1, &wy);
+    for (uint32_t x = 0; x < dst_roi.width; ++x) {
+      int x0, x1;
+      double wx;
+      coord(x, src_roi.width, dst_roi.width, &x0, &x1, &wx);
+      for (int c = 0; c < 3; ++c) {
+        auto at = [&](int yy, int xx) { return crop[(yy * src_roi.width + xx) * 3 + c]; };
+        double top = at(y0, x0) * (1 - wx) + at(y0, x1) * wx;
+        double bottom = at(y1, x0) * (1 - wx) + at(y1, x1) * wx;
+        resized[(y * dst_roi.width + x) * 3 + c] = top * (1 - wy) + bottom * wy;
+      }
+    }
+  }
+  // 3. color conversion, BT.601 video range
+  if (yuv) {
+    for (size_t i = 0; i < resized.size(); i += 3) {
+      double y = 1.164383 * (resized[i] - 16), u = resized[i + 1] - 128, v = resized[i + 2] - 128;
+      double rgb[3] = {y + 1.596027 * v, y - 0.391762 * u - 0.812968 * v, y + 2.017232 * u};
+      for (int c = 0; c < 3; ++c) resized[i + c] = std::min(std::max(rgb[c], 0.0), 255.0);
+    }
+  }
+  // 4. channel order and normalization into the whole output, untouched pixels are NaN
+  std::vector<float> out(dst_w * dst_h * 3, NAN);
+  for (uint32_t y = 0; y < dst_roi.height; ++y) {
+    for (uint32_t x = 0; x < dst_roi.width; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        float v = resized[(y * dst_roi.width + x) * 3 + (bgr ? 2 - c : c)];
+        if (mean_std) v = (v - mean_std->mean[c]) / mean_std->std[c];
+        out[((dst_roi.top + y) * dst_w + dst_roi.left + x) * 3 + c] = v;
+      }
+    }
+  }
+  return out;
+}
+
+struct HostCase {
+  CnedkBufSurfaceColorFormat src_fmt;
+  uint32_t src_w, src_h, dst_w, dst_h;
+  CnedkTransformDataType dtype;
+  bool bgr, crop, mean_std;
+};
+
+void RunCase(const HostCase &c, std::mt19937 *gen) {
+  HostSurface src(c.src_fmt, c.src_w, c.src_h);
+  ASSERT_TRUE(src.Surf());
+  FillRandom(&src, gen);
+  const size_t elem = c.dtype == CNEDK_TRANSFORM_UINT8 ? 1 : (c.dtype == CNEDK_TRANSFORM_FLOAT16 ? 2 : 4);
+  HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, c.dst_w, c.dst_h, c.dst_w * c.dst_h * 3 * elem);
+  ASSERT_TRUE(dst.Surf());
+  memset(dst.Data(), 0x5A, dst.Params().data_size);
+
+  CnedkTransformRect src_roi{0, 0, c.src_w, c.src_h}, dst_roi{0, 0, c.dst_w, c.dst_h};
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  CnedkTransformTensorDesc desc;
+  desc.shape = {1, 3, c.dst_h, c.dst_w};
+  desc.data_type = c.dtype;
+  desc.color_format = c.bgr ? CNEDK_TRANSFORM_COLOR_FORMAT_BGR : CNEDK_TRANSFORM_COLOR_FORMAT_RGB;
+  CnedkTransformParams params;
+  memset(&params, 0, sizeof(params));
+  params.dst_desc = &desc;
+  if (c.crop) {
+    src_roi = CnedkTransformRect{c.src_h / 5, c.src_w / 3, c.src_w / 2, c.src_h * 3 / 5};
+    dst_roi = CnedkTransformRect{c.dst_h / 4, 2, c.dst_w - 3, c.dst_h / 2};
+    params.transform_flag |= CNEDK_TRANSFORM_CROP_SRC | CNEDK_TRANSFORM_CROP_DST;
+    params.src_rect = &src_roi;
+    params.dst_rect = &dst_roi;
+  }
+  if (c.mean_std) {
+    params.transform_flag |= CNEDK_TRANSFORM_MEAN_STD;
+    params.mean_std_params = &mean_std;
+  }
+  ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+
+  std::vector<float> ref =
+      ReferenceTransform(&src, src_roi, c.dst_w, c.dst_h, dst_roi, c.bgr, c.mean_std ? &mean_std : nullptr);
+  for (size_t i = 0; i < ref.size(); ++i) {
+    const uint8_t *raw = dst.Data() + i * elem;
+    if (std::isnan(ref[i])) {
+      // outside of dst rect
+      for (size_t b = 0; b < elem; ++b) ASSERT_EQ(raw[b], 0x5A) << "index: " << i;
+      continue;
+    }
+    switch (c.dtype) {
+      case CNEDK_TRANSFORM_UINT8:
+        ASSERT_NEAR(*raw, std::min(std::max(ref[i], 0.f), 255.f), 1.f) << "index: " << i;
+        break;
+      case CNEDK_TRANSFORM_FLOAT32:
+        ASSERT_NEAR(*reinterpret_cast<const float *>(raw), ref[i], 5e-3f) << "index: " << i;
+        break;
+      default:
+        ASSERT_NEAR(infer_server::detail::HalfToFloat(*reinterpret_cast<const uint16_t *>(raw)), ref[i],
+                    1e-3f + std::fabs(ref[i]) * 1e-3f)
+            << "index: " << i;
+        break;
+    }
+  }
+}
+
+TEST(TransformHost, FusedSameAsUnfused) {
+  std::mt19937 gen(0);
+  const CnedkBufSurfaceColorFormat formats[] = {CNEDK_BUF_COLOR_FORMAT_NV12, CNEDK_BUF_COLOR_FORMAT_NV21,
+                                                CNEDK_BUF_COLOR_FORMAT_RGB, CNEDK_BUF_COLOR_FORMAT_BGR,
+                                                CNEDK_BUF_COLOR_FORMAT_GRAY8};
+  const CnedkTransformDataType dtypes[] = {CNEDK_TRANSFORM_UINT8, CNEDK_TRANSFORM_FLOAT32, CNEDK_TRANSFORM_FLOAT16};
+  for (auto fmt : formats) {
+    for (auto dtype : dtypes) {
+      for (int flags = 0; flags < 8; ++flags) {
+        bool bgr = flags & 1, crop = flags & 2, mean_std = flags & 4;
+        // downscale and upscale
+        RunCase({fmt, 64, 48, 37, 29, dtype, bgr, crop, mean_std}, &gen);
+        RunCase({fmt, 30, 20, 67, 51, dtype, bgr, crop, mean_std}, &gen);
+        if (HasFatalFailure()) {
+          FAIL() << "format: " << fmt << ", dtype: " << dtype << ", flags: " << flags;
+        }
+      }
+    }
+  }
+}
+
+// uint8 output without normalization is computed in fixed point, it is within one from the float path
+TEST(TransformHost, FixedPointNearFloat) {
+  std::mt19937 gen(7);
+  const CnedkBufSurfaceColorFormat formats[] = {CNEDK_BUF_COLOR_FORMAT_NV12, CNEDK_BUF_COLOR_FORMAT_NV21,
+                                                CNEDK_BUF_COLOR_FORMAT_RGB, CNEDK_BUF_COLOR_FORMAT_BGR,
+                                                CNEDK_BUF_COLOR_FORMAT_GRAY8};
+  struct Size {
+    uint32_t src_w, src_h, dst_w, dst_h;
+  };
+  for (auto fmt : formats) {
+    // downscale, upscale, and a crop starting from odd columns
+    for (const Size &s : {Size{640, 360, 211, 97}, Size{98, 54, 333, 170}, Size{256, 256, 256, 256}}) {
+      for (bool crop : {false, true}) {
+        HostSurface src(fmt, s.src_w, s.src_h);
+        FillRandom(&src, &gen);
+        HostSurface fixed(CNEDK_BUF_COLOR_FORMAT_TENSOR, s.dst_w, s.dst_h, s.dst_w * s.dst_h * 3);
+        HostSurface ref(CNEDK_BUF_COLOR_FORMAT_TENSOR, s.dst_w, s.dst_h, s.dst_w * s.dst_h * 3 * sizeof(float));
+        CnedkTransformRect src_roi{s.src_w / 4 + 1, s.src_h / 3, s.src_w / 2 + 1, s.src_h / 2};
+        CnedkTransformTensorDesc desc;
+        desc.shape = {1, 3, s.dst_h, s.dst_w};
+        desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_BGR;
+        CnedkTransformParams params;
+        memset(&params, 0, sizeof(params));
+        params.dst_desc = &desc;
+        if (crop) {
+          params.transform_flag = CNEDK_TRANSFORM_CROP_SRC;
+          params.src_rect = &src_roi;
+        }
+        desc.data_type = CNEDK_TRANSFORM_UINT8;
+        ASSERT_EQ(CnedkTransform(src.Surf(), fixed.Surf(), &params), 0);
+        desc.data_type = CNEDK_TRANSFORM_FLOAT32;
+        ASSERT_EQ(CnedkTransform(src.Surf(), ref.Surf(), &params), 0);
+
+        const float *expected = reinterpret_cast<const float *>(ref.Data());
+        for (size_t i = 0; i < s.dst_w * s.dst_h * 3; ++i) {
+          ASSERT_NEAR(fixed.Data()[i], expected[i], 1.f)
+              << "format: " << fmt << ", size: " << s.src_w << "x" << s.src_h << ", crop: " << crop << ", index: " << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(TransformHost, ImageOutput) {
+  std::mt19937 gen(1);
+  HostSurface src(CNEDK_BUF_COLOR_FORMAT_NV12, 64, 32);
+  HostSurface dst(CNEDK_BUF_COLOR_FORMAT_BGR, 40, 20);
+  HostSurface ref(CNEDK_BUF_COLOR_FORMAT_TENSOR, 40, 20, 40 * 20 * 3);
+  FillRandom(&src, &gen);
+  CnedkTransformParams params;
+  memset(&params, 0, sizeof(params));
+  ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+
+  // same as BGR uint8 tensor
+  CnedkTransformTensorDesc desc;
+  desc.shape = {1, 3, 20, 40};
+  desc.data_type = CNEDK_TRANSFORM_UINT8;
+  desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_BGR;
+  params.dst_desc = &desc;
+  ASSERT_EQ(CnedkTransform(src.Surf(), ref.Surf(), &params), 0);
+  EXPECT_EQ(memcmp(dst.Data(), ref.Data(), 40 * 20 * 3), 0);
+
+  // normalization needs tensor output
+  CnedkTransformMeanStdParams mean_std{{0, 0, 0}, {1, 1, 1}};
+  params.transform_flag = CNEDK_TRANSFORM_MEAN_STD;
+  params.mean_std_params = &mean_std;
+  EXPECT_NE(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+}
+
+TEST(TransformHost, Unsupported) {
+  HostSurface src(CNEDK_BUF_COLOR_FORMAT_NV12, 64, 32);
+  HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, 32, 32, 32 * 32 * 4);
+  CnedkTransformTensorDesc desc;
+  desc.shape = {1, 4, 32, 32};
+  desc.data_type = CNEDK_TRANSFORM_UINT8;
+  desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_RGBA;
+  CnedkTransformParams params;
+  memset(&params, 0, sizeof(params));
+  params.dst_desc = &desc;
+  EXPECT_NE(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+
+  desc.shape.c = 3;
+  EXPECT_NE(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+
+  desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_RGB;
+  params.transform_flag = CNEDK_TRANSFORM_MEAN_STD;
+  EXPECT_NE(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+
+  params.transform_flag = CNEDK_TRANSFORM_CROP_SRC;
+  CnedkTransformRect rect{16, 32, 64, 16};
+  params.src_rect = &rect;
+  EXPECT_NE(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+}
+
+TEST(TransformHost, Benchmark) {
+  constexpr int loop = 10;
+  std::mt19937 gen(2);
+  HostSurface src(CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080);
+  FillRandom(&src, &gen);
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  struct Case {
+    uint32_t w, h;
+    CnedkTransformDataType dtype;
+    size_t elem;
+  };
+  for (const Case &c : {Case{416, 416, CNEDK_TRANSFORM_UINT8, 1}, Case{640, 640, CNEDK_TRANSFORM_FLOAT32, 4},
+                        Case{1280, 720, CNEDK_TRANSFORM_FLOAT16, 2}}) {
+    HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, c.w, c.h, c.w * c.h * 3 * c.elem);
+    CnedkTransformTensorDesc desc;
+    desc.shape = {1, 3, c.h, c.w};
+    desc.data_type = c.dtype;
+    desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_RGB;
+    CnedkTransformParams params;
+    memset(&params, 0, sizeof(params));
+    params.transform_flag = CNEDK_TRANSFORM_MEAN_STD;
+    params.mean_std_params = &mean_std;
+    params.dst_desc = &desc;
+    auto start = std::chrono::steady_clock::now();
+    for (int l = 0; l < loop; ++l) ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+    std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+    double ms = dura.count() / loop;
+    LOG(INFO) << "[EasyDK Tests] [TransformHost] NV12 1920x1080 -> RGB " << c.w << "x" << c.h << " dtype " << c.dtype
+              << " with mean std: " << ms << " ms, " << c.w * c.h / ms / 1000 << " output Mpix/s per core";
+  }
+}
+
+// batch of rois on one frame, as the preprocessor builds it: every item refers to the same image
+class RoiBatch {
+ public:
+  RoiBatch(HostSurface *frame, uint32_t num, uint32_t dst_w, uint32_t dst_h, size_t elem) : items_(num) {
+    memset(&src_, 0, sizeof(src_));
+    for (auto &item : items_) item = frame->Params();
+    src_.mem_type = CNEDK_BUF_MEM_SYSTEM;
+    src_.batch_size = num;
+    src_.num_filled = num;
+    src_.surface_list = items_.data();
+    CnedkBufSurfaceCreateParams params;
+    memset(&params, 0, sizeof(params));
+    params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+    params.batch_size = num;
+    params.width = dst_w;
+    params.height = dst_h;
+    params.size = dst_w * dst_h * 3 * elem;
+    params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+    CnedkBufSurfaceCreate(&dst_, &params);
+    dst_->num_filled = num;
+  }
+  ~RoiBatch() {
+    if (dst_) CnedkBufSurfaceDestroy(dst_);
+  }
+  CnedkBufSurface *Src() { return &src_; }
+  CnedkBufSurface *Dst() { return dst_; }
+
+ private:
+  std::vector<CnedkBufSurfaceParams> items_;
+  CnedkBufSurface src_;
+  CnedkBufSurface *dst_ = nullptr;
+};
+
+std::vector<CnedkTransformRect> RandomRois(uint32_t num, uint32_t width, uint32_t height, std::mt19937 *gen) {
+  std::uniform_int_distribution<uint32_t> left(0, width - 2), top(0, height - 2), size(1, 400);
+  std::vector<CnedkTransformRect> rois(num);
+  for (auto &r : rois) {
+    r.left = left(*gen);
+    r.top = top(*gen);
+    r.width = std::min(size(*gen), width - r.left);
+    r.height = std::min(size(*gen), height - r.top);
+  }
+  return rois;
+}
+
+TEST(TransformHost, MultiRoiSameAsSingle) {
+  std::mt19937 gen(3);
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  struct Case {
+    CnedkBufSurfaceColorFormat fmt;
+    CnedkTransformDataType dtype;
+    size_t elem;
+  };
+  for (const Case &c : {Case{CNEDK_BUF_COLOR_FORMAT_NV12, CNEDK_TRANSFORM_UINT8, 1},
+                        Case{CNEDK_BUF_COLOR_FORMAT_NV21, CNEDK_TRANSFORM_FLOAT32, 4},
+                        Case{CNEDK_BUF_COLOR_FORMAT_BGR, CNEDK_TRANSFORM_FLOAT16, 2}}) {
+    constexpr uint32_t kNum = 40, kW = 67, kH = 45;
+    HostSurface frame(c.fmt, 642, 480);
+    FillRandom(&frame, &gen);
+    std::vector<CnedkTransformRect> rois = RandomRois(kNum, 642, 480, &gen);
+    CnedkTransformTensorDesc desc;
+    desc.shape = {1, 3, kH, kW};
+    desc.data_type = c.dtype;
+    desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_BGR;
+    CnedkTransformParams params;
+    memset(&params, 0, sizeof(params));
+    params.transform_flag = CNEDK_TRANSFORM_CROP_SRC | CNEDK_TRANSFORM_MEAN_STD;
+    params.mean_std_params = &mean_std;
+    params.dst_desc = &desc;
+    params.src_rect = rois.data();
+
+    RoiBatch batch(&frame, kNum, kW, kH, c.elem);
+    ASSERT_EQ(CnedkTransform(batch.Src(), batch.Dst(), &params), 0);
+    const size_t size = kW * kH * 3 * c.elem;
+    for (uint32_t i = 0; i < kNum; ++i) {
+      HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, kW, kH, size);
+      params.src_rect = &rois[i];
+      ASSERT_EQ(CnedkTransform(frame.Surf(), dst.Surf(), &params), 0);
+      EXPECT_EQ(memcmp(dst.Data(), batch.Dst()->surface_list[i].data_ptr, size), 0) << "format " << c.fmt << ", roi "
+                                                                                     << i;
+    }
+  }
+}
+
+TEST(TransformHost, MultiRoiBenchmark) {
+  constexpr int loop = 5;
+  constexpr uint32_t kNum = 64;
+  std::mt19937 gen(4);
+  HostSurface frame(CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080);
+  FillRandom(&frame, &gen);
+  // objects of a crowded scene, overlapping boxes of 64 to 400 pixels
+  std::vector<CnedkTransformRect> rois = RandomRois(kNum, 1920, 1080, &gen);
+  CnedkTransformTensorDesc desc;
+  desc.shape = {1, 3, 224, 224};
+  desc.data_type = CNEDK_TRANSFORM_UINT8;
+  desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_RGB;
+  CnedkTransformParams params;
+  memset(&params, 0, sizeof(params));
+  params.transform_flag = CNEDK_TRANSFORM_CROP_SRC;
+  params.dst_desc = &desc;
+  params.src_rect = rois.data();
+
+  RoiBatch batch(&frame, kNum, 224, 224, 1);
+  auto start = std::chrono::steady_clock::now();
+  for (int l = 0; l < loop; ++l) ASSERT_EQ(CnedkTransform(batch.Src(), batch.Dst(), &params), 0);
+  std::chrono::duration<double, std::milli> multi = std::chrono::steady_clock::now() - start;
+
+  // one roi per call, the frame is read once for each of them
+  HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, 224, 224, 224 * 224 * 3);
+  start = std::chrono::steady_clock::now();
+  for (int l = 0; l < loop; ++l) {
+    for (uint32_t i = 0; i < kNum; ++i) {
+      params.src_rect = &rois[i];
+      ASSERT_EQ(CnedkTransform(frame.Surf(), dst.Surf(), &params), 0);
+    }
+  }
+  std::chrono::duration<double, std::milli> single = std::chrono::steady_clock::now() - start;
+  LOG(INFO) << "[EasyDK Tests] [TransformHost] NV12 1920x1080, " << kNum << " rois -> RGB 224x224 uint8: "
+            << multi.count() / loop << " ms in one pass, " << single.count() / loop << " ms one roi per call";
+}
+
+// letterbox rect by the usual float formula, centered
+CnedkTransformRect ExpectedLetterbox(uint32_t src_w, uint32_t src_h, const CnedkTransformRect &frame) {
+  CnedkTransformRect inner = frame;
+  if (static_cast<uint64_t>(src_w) * frame.height < static_cast<uint64_t>(src_h) * frame.width) {
+    inner.width = std::max(1., std::floor(static_cast<double>(src_w) * frame.height / src_h + 0.5));
+  } else {
+    inner.height = std::max(1., std::floor(static_cast<double>(src_h) * frame.width / src_w + 0.5));
+  }
+  inner.left = frame.left + (frame.width - inner.width) / 2;
+  inner.top = frame.top + (frame.height - inner.height) / 2;
+  return inner;
+}
+
+std::vector<float> TensorToFloat(const uint8_t *data, size_t count, CnedkTransformDataType dtype) {
+  std::vector<float> res(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (dtype == CNEDK_TRANSFORM_UINT8) {
+      res[i] = data[i];
+    } else if (dtype == CNEDK_TRANSFORM_FLOAT32) {
+      res[i] = reinterpret_cast<const float *>(data)[i];
+    } else {
+      res[i] = infer_server::detail::HalfToFloat(reinterpret_cast<const uint16_t *>(data)[i]);
+    }
+  }
+  return res;
+}
+
+TEST(TransformHost, Letterbox) {
+  std::mt19937 gen(5);
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  CnedkTransformLetterboxParams letterbox{{114, 37, 200, 0}};
+  struct Case {
+    CnedkBufSurfaceColorFormat fmt;
+    uint32_t src_w, src_h, dst_w, dst_h;
+    CnedkTransformDataType dtype;
+    size_t elem;
+    bool crop, mean_std;
+  };
+  const Case cases[] = {{CNEDK_BUF_COLOR_FORMAT_NV12, 62, 38, 45, 45, CNEDK_TRANSFORM_UINT8, 1, false, false},
+                        {CNEDK_BUF_COLOR_FORMAT_BGR, 30, 77, 51, 33, CNEDK_TRANSFORM_FLOAT32, 4, false, true},
+                        {CNEDK_BUF_COLOR_FORMAT_NV21, 98, 56, 63, 41, CNEDK_TRANSFORM_FLOAT16, 2, true, true},
+                        {CNEDK_BUF_COLOR_FORMAT_RGB, 40, 20, 81, 41, CNEDK_TRANSFORM_UINT8, 1, true, false},
+                        {CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080, 416, 416, CNEDK_TRANSFORM_UINT8, 1, false, false}};
+  for (const Case &c : cases) {
+    HostSurface src(c.fmt, c.src_w, c.src_h);
+    FillRandom(&src, &gen);
+    const size_t count = c.dst_w * c.dst_h * 3;
+    HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, c.dst_w, c.dst_h, count * c.elem);
+    HostSurface ref(CNEDK_BUF_COLOR_FORMAT_TENSOR, c.dst_w, c.dst_h, count * c.elem);
+    // stale content outside the destination rect must be kept
+    memset(dst.Data(), 0xab, count * c.elem);
+    memset(ref.Data(), 0xab, count * c.elem);
+
+    CnedkTransformRect src_rect{3, 5, c.src_w - 12, c.src_h - 7};
+    CnedkTransformRect frame = c.crop ? CnedkTransformRect{2, 3, c.dst_w - 7, c.dst_h - 4}
+                                      : CnedkTransformRect{0, 0, c.dst_w, c.dst_h};
+    CnedkTransformTensorDesc desc;
+    desc.shape = {1, 3, c.dst_h, c.dst_w};
+    desc.data_type = c.dtype;
+    desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_RGB;
+    CnedkTransformParams params;
+    memset(&params, 0, sizeof(params));
+    params.transform_flag = CNEDK_TRANSFORM_LETTERBOX | (c.mean_std ? CNEDK_TRANSFORM_MEAN_STD : 0);
+    if (c.crop) {
+      params.transform_flag |= CNEDK_TRANSFORM_CROP_SRC | CNEDK_TRANSFORM_CROP_DST;
+      params.src_rect = &src_rect;
+      params.dst_rect = &frame;
+    }
+    params.mean_std_params = &mean_std;
+    params.letterbox_params = &letterbox;
+    params.dst_desc = &desc;
+    ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+
+    // reference: plain resize into the inner rect, then the bands are filled
+    const uint32_t roi_w = c.crop ? src_rect.width : c.src_w, roi_h = c.crop ? src_rect.height : c.src_h;
+    CnedkTransformRect inner = ExpectedLetterbox(roi_w, roi_h, frame);
+    if (c.src_w == 1920) {
+      EXPECT_EQ(inner.top, 91u);
+      EXPECT_EQ(inner.height, 234u);
+    }
+    params.transform_flag = CNEDK_TRANSFORM_CROP_DST | (c.crop ? CNEDK_TRANSFORM_CROP_SRC : 0) |
+                            (c.mean_std ? CNEDK_TRANSFORM_MEAN_STD : 0);
+    params.dst_rect = &inner;
+    ASSERT_EQ(CnedkTransform(src.Surf(), ref.Surf(), &params), 0);
+    std::vector<float> out = TensorToFloat(dst.Data(), count, c.dtype);
+    std::vector<float> expected = TensorToFloat(ref.Data(), count, c.dtype);
+    for (uint32_t y = frame.top; y < frame.top + frame.height; ++y) {
+      for (uint32_t x = frame.left; x < frame.left + frame.width; ++x) {
+        if (y >= inner.top && y < inner.top + inner.height && x >= inner.left && x < inner.left + inner.width) continue;
+        for (int k = 0; k < 3; ++k) {
+          float v = letterbox.pad_value[k];
+          if (c.mean_std) v = (v - mean_std.mean[k]) / mean_std.std[k];
+          expected[(y * c.dst_w + x) * 3 + k] = v;
+        }
+      }
+    }
+    const float tolerance = c.dtype == CNEDK_TRANSFORM_FLOAT16 ? 4e-3f : 1e-5f;
+    for (size_t i = 0; i < count; ++i) {
+      if (std::isnan(expected[i])) {
+        ASSERT_TRUE(std::isnan(out[i])) << i;
+      } else {
+        ASSERT_NEAR(out[i], expected[i], tolerance) << "format " << c.fmt << ", pixel " << i / 3;
+      }
+    }
+  }
+}
+
+TEST(TransformHost, LetterboxBenchmark) {
+  constexpr int loop = 10;
+  std::mt19937 gen(6);
+  HostSurface src(CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080);
+  FillRandom(&src, &gen);
+  CnedkTransformLetterboxParams letterbox{{128, 128, 128, 128}};
+  CnedkTransformMeanStdParams mean_std{{0.f, 0.f, 0.f}, {255.f, 255.f, 255.f}};
+  struct Case {
+    uint32_t w, h;
+    CnedkTransformDataType dtype;
+    size_t elem;
+  };
+  for (const Case &c : {Case{416, 416, CNEDK_TRANSFORM_UINT8, 1}, Case{640, 640, CNEDK_TRANSFORM_FLOAT32, 4}}) {
+    const size_t size = c.w * c.h * 3 * c.elem;
+    HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, c.w, c.h, size);
+    CnedkTransformTensorDesc desc;
+    desc.shape = {1, 3, c.h, c.w};
+    desc.data_type = c.dtype;
+    desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_RGB;
+    CnedkTransformParams params;
+    memset(&params, 0, sizeof(params));
+    params.transform_flag = CNEDK_TRANSFORM_LETTERBOX | CNEDK_TRANSFORM_MEAN_STD;
+    params.mean_std_params = &mean_std;
+    params.letterbox_params = &letterbox;
+    params.dst_desc = &desc;
+    auto start = std::chrono::steady_clock::now();
+    for (int l = 0; l < loop; ++l) ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+    std::chrono::duration<double, std::milli> fused = std::chrono::steady_clock::now() - start;
+
+    // the way callers did it: clear the whole output, then resize into the inner rect
+    CnedkTransformRect inner = ExpectedLetterbox(1920, 1080, CnedkTransformRect{0, 0, c.w, c.h});
+    params.transform_flag = CNEDK_TRANSFORM_CROP_DST | CNEDK_TRANSFORM_MEAN_STD;
+    params.dst_rect = &inner;
+    std::vector<float> pad_row(c.w * 3, 128.f / 255.f);
+    start = std::chrono::steady_clock::now();
+    for (int l = 0; l < loop; ++l) {
+      if (c.dtype == CNEDK_TRANSFORM_UINT8) {
+        memset(dst.Data(), 0, size);
+      } else {
+        for (uint32_t y = 0; y < c.h; ++y) memcpy(dst.Data() + y * c.w * 3 * 4, pad_row.data(), c.w * 3 * 4);
+      }
+      ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+    }
+    std::chrono::duration<double, std::milli> unfused = std::chrono::steady_clock::now() - start;
+    LOG(INFO) << "[EasyDK Tests] [TransformHost] NV12 1920x1080 -> letterbox " << c.w << "x" << c.h << " dtype "
+              << c.dtype << ": " << fused.count() / loop << " ms in one pass, " << unfused.count() / loop
+              << " ms with clearing first";
+  }
+}
+
+// restores the default host parameters when a test ends
+class HostParamsGuard {
+ public:
+  ~HostParamsGuard() {
+    CnedkTransformHostParams params{0, 0};
+    CnedkTransformSetHostParams(&params);
+  }
+};
+
+TEST(TransformHost, ThreadsSameResult) {
+  HostParamsGuard guard;
+  std::mt19937 gen(7);
+  CnedkTransformMeanStdParams mean_std{{123.7f, 116.3f, 103.5f}, {58.4f, 57.1f, 57.4f}};
+  CnedkTransformLetterboxParams letterbox{{114, 37, 200, 0}};
+  // odd output sizes, tiles end at odd rows and cut through rows sharing chroma
+  HostSurface frame(CNEDK_BUF_COLOR_FORMAT_NV12, 1002, 750);
+  FillRandom(&frame, &gen);
+  std::vector<CnedkTransformRect> rois = RandomRois(12, 1002, 750, &gen);
+  struct Case {
+    CnedkTransformDataType dtype;
+    size_t elem;
+    uint32_t w, h, num;
+    uint32_t flag;
+  };
+  const Case cases[] = {
+      {CNEDK_TRANSFORM_UINT8, 1, 333, 517, 1, 0},
+      {CNEDK_TRANSFORM_FLOAT32, 4, 639, 641, 1, CNEDK_TRANSFORM_LETTERBOX | CNEDK_TRANSFORM_MEAN_STD},
+      {CNEDK_TRANSFORM_FLOAT16, 2, 97, 211, 12, CNEDK_TRANSFORM_CROP_SRC | CNEDK_TRANSFORM_MEAN_STD},
+      {CNEDK_TRANSFORM_UINT8, 1, 211, 97, 12, CNEDK_TRANSFORM_CROP_SRC | CNEDK_TRANSFORM_LETTERBOX}};
+  for (const Case &c : cases) {
+    CnedkTransformTensorDesc desc;
+    desc.shape = {1, 3, c.h, c.w};
+    desc.data_type = c.dtype;
+    desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_BGR;
+    CnedkTransformParams params;
+    memset(&params, 0, sizeof(params));
+    params.transform_flag = c.flag;
+    params.mean_std_params = &mean_std;
+    params.letterbox_params = &letterbox;
+    params.dst_desc = &desc;
+    params.src_rect = rois.data();
+    const size_t size = c.w * c.h * 3 * c.elem;
+
+    // a single thread and a single tile for each roi
+    CnedkTransformHostParams host_params{1, 0xffffffff};
+    ASSERT_EQ(CnedkTransformSetHostParams(&host_params), 0);
+    RoiBatch expected(&frame, c.num, c.w, c.h, c.elem);
+    ASSERT_EQ(CnedkTransform(expected.Src(), expected.Dst(), &params), 0);
+    for (uint32_t threads = 1; threads <= 5; ++threads) {
+      for (uint32_t grain : {1u, 4099u, 0u}) {
+        host_params.num_threads = threads;
+        host_params.grain_size = grain;
+        ASSERT_EQ(CnedkTransformSetHostParams(&host_params), 0);
+        CnedkTransformHostParams actual;
+        ASSERT_EQ(CnedkTransformGetHostParams(&actual), 0);
+        EXPECT_EQ(actual.num_threads, threads);
+        EXPECT_EQ(actual.grain_size, grain ? grain : 65536u);
+        RoiBatch batch(&frame, c.num, c.w, c.h, c.elem);
+        ASSERT_EQ(CnedkTransform(batch.Src(), batch.Dst(), &params), 0);
+        for (uint32_t i = 0; i < c.num; ++i) {
+          EXPECT_EQ(memcmp(batch.Dst()->surface_list[i].data_ptr, expected.Dst()->surface_list[i].data_ptr, size), 0)
+              << "dtype " << c.dtype << ", flag " << c.flag << ", threads " << threads << ", grain " << grain;
+        }
+      }
+    }
+  }
+  EXPECT_NE(CnedkTransformSetHostParams(nullptr), 0);
+  EXPECT_NE(CnedkTransformGetHostParams(nullptr), 0);
+}
+
+TEST(TransformHost, ThreadsBenchmark) {
+  HostParamsGuard guard;
+  constexpr int loop = 5;
+  std::mt19937 gen(8);
+  HostSurface src(CNEDK_BUF_COLOR_FORMAT_NV12, 3840, 2160);
+  FillRandom(&src, &gen);
+  HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, 1920, 1080, 1920 * 1080 * 3);
+  CnedkTransformTensorDesc desc;
+  desc.shape = {1, 3, 1080, 1920};
+  desc.data_type = CNEDK_TRANSFORM_UINT8;
+  desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_RGB;
+  CnedkTransformParams params;
+  memset(&params, 0, sizeof(params));
+  params.dst_desc = &desc;
+  double base = 0;
+  for (uint32_t threads : {1u, 2u, 4u, 8u}) {
+    CnedkTransformHostParams host_params{threads, 0};
+    ASSERT_EQ(CnedkTransformSetHostParams(&host_params), 0);
+    ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int l = 0; l < loop; ++l) ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+    std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+    const double ms = dura.count() / loop;
+    if (threads == 1) base = ms;
+    LOG(INFO) << "[EasyDK Tests] [TransformHost] NV12 3840x2160 -> RGB 1920x1080 uint8, " << threads
+              << " threads: " << ms << " ms, speedup " << base / ms << " (" << std::thread::hardware_concurrency()
+              << " cores)";
+  }
+}
+
+TEST(TransformHost, FixedPointBenchmark) {
+  HostParamsGuard guard;
+  CnedkTransformHostParams host_params{1, 0};
+  ASSERT_EQ(CnedkTransformSetHostParams(&host_params), 0);
+  constexpr int loop = 10;
+  std::mt19937 gen(9);
+  // normalization takes the float path, its cost does not depend on the values
+  CnedkTransformMeanStdParams mean_std{{0, 0, 0}, {1.5f, 1.5f, 1.5f}};
+  struct Case {
+    CnedkBufSurfaceColorFormat fmt;
+    uint32_t src_w, src_h, w, h;
+  };
+  for (const Case &c : {Case{CNEDK_BUF_COLOR_FORMAT_NV12, 3840, 2160, 1920, 1080},
+                        Case{CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080, 416, 416},
+                        Case{CNEDK_BUF_COLOR_FORMAT_RGB, 1920, 1080, 640, 640}}) {
+    HostSurface src(c.fmt, c.src_w, c.src_h);
+    FillRandom(&src, &gen);
+    HostSurface dst(CNEDK_BUF_COLOR_FORMAT_TENSOR, c.w, c.h, c.w * c.h * 3);
+    CnedkTransformTensorDesc desc;
+    desc.shape = {1, 3, c.h, c.w};
+    desc.data_type = CNEDK_TRANSFORM_UINT8;
+    desc.color_format = CNEDK_TRANSFORM_COLOR_FORMAT_RGB;
+    CnedkTransformParams params;
+    memset(&params, 0, sizeof(params));
+    params.dst_desc = &desc;
+    params.mean_std_params = &mean_std;
+    double ms[2];
+    for (int fixed = 0; fixed < 2; ++fixed) {
+      params.transform_flag = fixed ? 0 : CNEDK_TRANSFORM_MEAN_STD;
+      ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+      auto start = std::chrono::steady_clock::now();
+      for (int l = 0; l < loop; ++l) ASSERT_EQ(CnedkTransform(src.Surf(), dst.Surf(), &params), 0);
+      std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+      ms[fixed] = dura.count() / loop;
+    }
+    LOG(INFO) << "[EasyDK Tests] [TransformHost] " << c.fmt << " " << c.src_w << "x" << c.src_h << " -> RGB " << c.w
+              << "x" << c.h << " uint8, float: " << ms[0] << " ms, fixed point: " << ms[1] << " ms, speedup "
+              << ms[0] / ms[1];
+  }
+}
+
+}  // namespace